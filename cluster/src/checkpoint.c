@@ -0,0 +1,222 @@
+/**
+ * @file checkpoint.c
+ * @brief Gravação e leitura dos checkpoints do treinamento.
+ * 
+ * Esse arquivo contém os métodos para gravar o estado do treinamento em um
+ * arquivo binário, de forma atômica, e para carregá-lo ao retomar uma
+ * execução interrompida.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdio **/
+#include <stdio.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca unistd, para o fsync() **/
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+/**
+ * @brief Acumula bytes na soma de verificação.
+ * 
+ * Aplica o FNV-1a de 64 bits, continuando a partir de hash.
+ * 
+ * @param hash soma acumulada
+ * @param data bytes a serem acumulados
+ * @param size número de bytes
+ * @return uint64_t soma atualizada
+ */
+static uint64_t checksum_update(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *) data;
+
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Calcula a soma de verificação dos vetores de um checkpoint.
+ * 
+ * @param checkpoint checkpoint com os vetores preenchidos
+ * @return uint64_t soma de verificação
+ */
+static uint64_t checkpoint_checksum(const checkpoint_t *checkpoint) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    hash = checksum_update(hash, checkpoint->weights, checkpoint->num_weights * sizeof(float));
+    if(checkpoint->velocity != NULL) {
+        hash = checksum_update(hash, checkpoint->velocity, checkpoint->num_weights * sizeof(float));
+    }
+    if(checkpoint->best_weights != NULL) {
+        hash = checksum_update(hash, checkpoint->best_weights, checkpoint->num_weights * sizeof(float));
+    }
+    hash = checksum_update(hash, checkpoint->seeds, checkpoint->num_seeds * sizeof(unsigned int));
+    hash = checksum_update(hash, checkpoint->order, checkpoint->num_images * sizeof(int));
+
+    return hash;
+}
+
+/**
+ * @brief Grava um checkpoint.
+ * 
+ * O arquivo é gravado com um nome temporário, sincronizado com o disco e
+ * renomeado ao final, de forma que o arquivo em path é sempre um
+ * checkpoint completo.
+ * 
+ * @param path caminho do arquivo de checkpoint
+ * @param checkpoint estado do treinamento
+ * @return int 0, se a gravação foi bem sucedida; -1, caso contrário
+ */
+int checkpoint_save(const char *path, const checkpoint_t *checkpoint) {
+    checkpoint_header_t header;
+    char temp_path[400];
+    FILE *file;
+    int status = 0;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.num_weights = checkpoint->num_weights;
+    header.num_images = checkpoint->num_images;
+    header.num_seeds = checkpoint->num_seeds;
+    header.has_velocity = checkpoint->velocity != NULL;
+    header.num_epochs = checkpoint->num_epochs;
+    header.batch_size = checkpoint->batch_size;
+    header.nesterov = checkpoint->nesterov;
+    header.learning_rate = checkpoint->learning_rate;
+    header.momentum = checkpoint->momentum;
+    header.elapsed = checkpoint->elapsed;
+    header.best_cost = checkpoint->best_cost;
+    header.best_f1 = checkpoint->best_f1;
+    header.validation_fraction = checkpoint->validation_fraction;
+    header.best_epoch = checkpoint->best_epoch;
+    header.num_bad_epochs = checkpoint->num_bad_epochs;
+    header.has_best_weights = checkpoint->best_weights != NULL;
+    for(int k = 0; k < CHECKPOINT_NUM_OUTPUTS; k++) {
+        header.offsets[k] = checkpoint->offsets[k];
+    }
+    snprintf(header.run_name, sizeof(header.run_name), "%s", checkpoint->run_name);
+    header.checksum = checkpoint_checksum(checkpoint);
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    if((file = fopen(temp_path, "wb")) == NULL) {
+        return -1;
+    }
+
+    if(fwrite(&header, sizeof(header), 1, file) != 1
+        || fwrite(checkpoint->weights, sizeof(float), checkpoint->num_weights, file) != (size_t) checkpoint->num_weights
+        || (checkpoint->velocity != NULL && fwrite(checkpoint->velocity, sizeof(float), checkpoint->num_weights, file) != (size_t) checkpoint->num_weights)
+        || (checkpoint->best_weights != NULL && fwrite(checkpoint->best_weights, sizeof(float), checkpoint->num_weights, file) != (size_t) checkpoint->num_weights)
+        || fwrite(checkpoint->seeds, sizeof(unsigned int), checkpoint->num_seeds, file) != (size_t) checkpoint->num_seeds
+        || fwrite(checkpoint->order, sizeof(int), checkpoint->num_images, file) != (size_t) checkpoint->num_images
+        || fflush(file) != 0 || fsync(fileno(file)) != 0) {
+        status = -1;
+    }
+
+    if(fclose(file) != 0 || status == -1 || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Carrega um checkpoint gravado por checkpoint_save().
+ * 
+ * Confere a identificação, a versão e a soma de verificação. Os vetores
+ * são alocados e devem ser liberados por checkpoint_free().
+ * 
+ * @param path caminho do arquivo de checkpoint
+ * @param checkpoint estado do treinamento a ser preenchido
+ * @return int 0, se o checkpoint foi carregado; -1, se está ausente, corrompido ou é de uma versão incompatível
+ */
+int checkpoint_load(const char *path, checkpoint_t *checkpoint) {
+    checkpoint_header_t header;
+    FILE *file;
+
+    memset(checkpoint, 0, sizeof(*checkpoint));
+
+    if((file = fopen(path, "rb")) == NULL) {
+        return -1;
+    }
+
+    if(fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+        || header.version != CHECKPOINT_VERSION || header.num_weights == 0 || header.num_seeds == 0) {
+        fclose(file);
+        return -1;
+    }
+
+    checkpoint->num_weights = header.num_weights;
+    checkpoint->num_images = header.num_images;
+    checkpoint->num_seeds = header.num_seeds;
+    checkpoint->num_epochs = header.num_epochs;
+    checkpoint->batch_size = header.batch_size;
+    checkpoint->nesterov = header.nesterov;
+    checkpoint->learning_rate = header.learning_rate;
+    checkpoint->momentum = header.momentum;
+    checkpoint->elapsed = header.elapsed;
+    checkpoint->best_cost = header.best_cost;
+    checkpoint->best_f1 = header.best_f1;
+    checkpoint->validation_fraction = header.validation_fraction;
+    checkpoint->best_epoch = header.best_epoch;
+    checkpoint->num_bad_epochs = header.num_bad_epochs;
+    for(int k = 0; k < CHECKPOINT_NUM_OUTPUTS; k++) {
+        checkpoint->offsets[k] = header.offsets[k];
+    }
+    memcpy(checkpoint->run_name, header.run_name, sizeof(checkpoint->run_name));
+    checkpoint->run_name[sizeof(checkpoint->run_name) - 1] = '\0';
+
+    checkpoint->weights = (float *) malloc(header.num_weights * sizeof(float));
+    checkpoint->velocity = header.has_velocity ? (float *) malloc(header.num_weights * sizeof(float)) : NULL;
+    checkpoint->best_weights = header.has_best_weights ? (float *) malloc(header.num_weights * sizeof(float)) : NULL;
+    checkpoint->seeds = (unsigned int *) malloc(header.num_seeds * sizeof(unsigned int));
+    checkpoint->order = (int *) malloc((header.num_images > 0 ? header.num_images : 1) * sizeof(int));
+
+    if(checkpoint->weights == NULL || (header.has_velocity && checkpoint->velocity == NULL) || (header.has_best_weights && checkpoint->best_weights == NULL) || checkpoint->seeds == NULL || checkpoint->order == NULL
+        || fread(checkpoint->weights, sizeof(float), header.num_weights, file) != header.num_weights
+        || (header.has_velocity && fread(checkpoint->velocity, sizeof(float), header.num_weights, file) != header.num_weights)
+        || (header.has_best_weights && fread(checkpoint->best_weights, sizeof(float), header.num_weights, file) != header.num_weights)
+        || fread(checkpoint->seeds, sizeof(unsigned int), header.num_seeds, file) != header.num_seeds
+        || fread(checkpoint->order, sizeof(int), header.num_images, file) != header.num_images
+        || checkpoint_checksum(checkpoint) != header.checksum) {
+        checkpoint_free(checkpoint);
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief Libera os vetores de um checkpoint carregado.
+ * 
+ * @param checkpoint checkpoint carregado por checkpoint_load()
+ */
+void checkpoint_free(checkpoint_t *checkpoint) {
+    free(checkpoint->weights);
+    free(checkpoint->velocity);
+    free(checkpoint->best_weights);
+    free(checkpoint->seeds);
+    free(checkpoint->order);
+    checkpoint->weights = checkpoint->velocity = checkpoint->best_weights = NULL;
+    checkpoint->seeds = NULL;
+    checkpoint->order = NULL;
+}
@@ -2,253 +2,382 @@
  * @file csv.c
  * @brief Biblioteca para leitura de arquivos .csv.
  * 
- * Esse arquivo contém os métodos utilizados para leitura de 
- * arquivos .csv. Os métodos são chamados pela função main()
- * no arquivo principal. Retirado do livro 'The Practice of Programming'.
+ * Esse arquivo contém os métodos utilizados para leitura dos arquivos
+ * .csv de entrada. O arquivo é mapeado em memória e dividido em blocos
+ * de linhas completas; todas as funções são reentrantes, permitindo que
+ * os blocos sejam processados em paralelo. A conversão dos pixels possui
+ * um caminho vetorizado (SSE2) para inteiros de 0 a 255.
  * 
- * @author Brian W. Kernighan
- * @author Rob Pike
- * @date 12/10/2018
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
  * 
- * @copyright Copyright (C) 1999 Lucent Technologies
+ * @copyright Copyright (c) 2018
  * 
  */
 
 /* -- Includes -- */
 
-/** Inclusão da biblioteca stdio **/
-#include <stdio.h>
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
 
 /** Inclusão da biblioteca string **/
 #include <string.h>
 
-/** Inclusão da biblioteca stdlib **/
-#include <stdlib.h>
+/** Inclusão das bibliotecas para acesso e mapeamento de arquivos **/
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-/** Inclusão da biblioteca assert **/
-#include <assert.h>
+#ifdef __SSE2__
+/** Inclusão dos intrínsecos SSE2 **/
+#include <emmintrin.h>
+#endif
 
 #include "csv.h"
 
-/* Indicação de fim de memória */
-enum { NOMEM = -2 };          
+/**
+ * @brief Mapeia um arquivo .csv e o divide em blocos.
+ * 
+ * Cada bloco possui aproximadamente chunk_size bytes e termina logo após
+ * uma quebra de linha, de forma que nenhuma linha seja dividida.
+ * 
+ * @param path caminho do arquivo
+ * @param file estrutura que recebe o arquivo mapeado
+ * @param chunk_size tamanho aproximado de cada bloco
+ * @return int 0, se o arquivo foi mapeado; -1, caso contrário
+ */
+int csv_open(const char *path, csv_file_t *file, size_t chunk_size) {
+    struct stat st;
+    const char *p, *end, *next;
+    int fd;
+
+    memset(file, 0, sizeof(*file));
 
-/* String de linhas lidas da entrada */
-static char *line    = NULL;  
+    if((fd = open(path, O_RDONLY)) == -1) {
+        return -1;
+    }
 
-/* Cópia da linha */
-static char *sline   = NULL;  
+    if(fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
 
-/* Tamanho da linha */
-static int  maxline  = 0;   
+    file->size = st.st_size;
 
-/* Pointeiro para campos */
-static char **field  = NULL; 
+    if(file->size > 0) {
+        file->data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(file->data == MAP_FAILED) {
+            file->data = NULL;
+            close(fd);
+            return -1;
+        }
+        madvise((void *) file->data, file->size, MADV_WILLNEED);
+    }
 
-/* Tamanho dos campos */
-static int  maxfield = 0;   
+    close(fd);
 
-/* Número de campos */
-static int  nfield   = 0;   
+    file->chunks = (csv_chunk_t *) calloc(file->size / chunk_size + 1, sizeof(csv_chunk_t));
+    if(file->chunks == NULL) {
+        csv_close(file);
+        return -1;
+    }
 
-/** protótipos de funções **/
-static char *advquoted(char *p, char delim);
-static int split(char delim, int compress);
+    end = file->data + file->size;
+    for(p = file->data; p < end; p = next) {
+        /* avança até a quebra de linha seguinte ao tamanho do bloco */
+        if((size_t) (end - p) <= chunk_size || (next = memchr(p + chunk_size, '\n', end - p - chunk_size)) == NULL) {
+            next = end;
+        } else {
+            next++;
+        }
 
+        file->chunks[file->num_chunks].begin = p;
+        file->chunks[file->num_chunks].end = next;
+        file->num_chunks++;
+    }
+
+    return 0;
+}
 
-/* endofline: check for and consume \r, \n, \r\n, or EOF */
 /**
- * @brief Verifica se o fim do arquivo foi atingido.
+ * @brief Desfaz o mapeamento de um arquivo .csv.
  * 
- * Verifica se o fim do arquivo foi atingido.
+ * @param file arquivo mapeado
+ */
+void csv_close(csv_file_t *file) {
+    if(file->data != NULL) {
+        munmap((void *) file->data, file->size);
+    }
+    free(file->chunks);
+    memset(file, 0, sizeof(*file));
+}
+
+/**
+ * @brief Obtém a próxima linha não vazia.
  * 
- * @param fin ponteiro para o arquivo
- * @param c caractere
- * @return int 1, se o fim do arquivo foi atingido; 0, caso contrário
+ * @param p posição atual
+ * @param end fim do bloco
+ * @param line_end recebe o fim da linha, sem os caracteres \r e \n
+ * @param next recebe a posição seguinte à quebra de linha
+ * @return const char* início da linha; NULL, se não há mais linhas
  */
-static int endofline(FILE *fin, int c)
-{
-	int eol;
-
-	eol = (c=='\r' || c=='\n');
-	if (c == '\r') {
-		c = getc(fin);
-		if (c != '\n' && c != EOF)
-			ungetc(c, fin);
-	}
-	return eol;
+const char *csv_next_line(const char *p, const char *end, const char **line_end, const char **next) {
+    const char *newline;
+
+    while(p < end) {
+        newline = memchr(p, '\n', end - p);
+        *line_end = newline != NULL ? newline : end;
+        *next = newline != NULL ? newline + 1 : end;
+
+        while(*line_end > p && (*line_end)[-1] == '\r') {
+            (*line_end)--;
+        }
+
+        if(*line_end > p) {
+            return p;
+        }
+
+        p = *next;
+    }
+
+    return NULL;
 }
 
-/* reset: set variables back to starting values */
 /**
- * @brief Reseta a leitura do arquivo.
+ * @brief Conta as linhas não vazias de um bloco.
  * 
- * Reseta a leitura do arquivo, ajustando as 
- * variáveis com seus valores iniciais.
+ * @param chunk bloco do arquivo
+ * @return int número de linhas
+ */
+int csv_count_lines(const csv_chunk_t *chunk) {
+    const char *line_end, *p = chunk->begin;
+    int num_lines = 0;
+
+    while(csv_next_line(p, chunk->end, &line_end, &p) != NULL) {
+        num_lines++;
+    }
+
+    return num_lines;
+}
+
+/**
+ * @brief Obtém o fim de um campo, removendo aspas ao redor do valor.
  * 
+ * @param p início do campo; recebe o início do valor
+ * @param end fim da linha
+ * @param value_end recebe o fim do valor
+ * @return const char* posição do separador seguinte ao campo, ou end
  */
-static void reset(void)
-{
-	free(line);
-	free(sline);
-	free(field);
-	line = NULL;
-	sline = NULL;
-	field = NULL;
-	maxline = maxfield = nfield = 0;
+static const char *next_field(const char **p, const char *end, const char **value_end) {
+    const char *separator = memchr(*p, ',', end - *p);
+
+    if(separator == NULL) {
+        separator = end;
+    }
+
+    *value_end = separator;
+    if(*p < separator && **p == '"') {
+        (*p)++;
+    }
+    if(*value_end > *p && (*value_end)[-1] == '"') {
+        (*value_end)--;
+    }
+
+    return separator;
 }
 
 /**
- * @brief Obtém uma linha do arquivo.
+ * @brief Separa os campos de uma linha.
  * 
- * Obtém uma linha do arquivo.
+ * A linha deve conter o nome da imagem, a label e os pixels separados
+ * por espaços, nessa ordem.
  * 
- * @param fin ponteiro para o arquivo
- * @param delim delimitador de linha
- * @param compress 
- * @return char* string contendo a linha lida
+ * @param line início da linha
+ * @param line_end fim da linha
+ * @param record recebe os campos da linha
+ * @return int 0, se a linha possui os três campos; -1, caso contrário
  */
-char *csvgetline(FILE *fin, char delim, int compress)
-{
-	int i, c;
-	char *newl, *news;
-
-	if (line == NULL) {			/* realiza alocaççoes na primeira leitura */
-		maxline = maxfield = 1;
-		line = (char *) malloc(maxline);
-		sline = (char *) malloc(maxline);
-		field = (char **) malloc(maxfield*sizeof(field[0]));
-		if (line == NULL || sline == NULL || field == NULL) {
-			reset();
-			return NULL;		/* estouro de memória */
-		}
-	}
-	for (i=0; (c=getc(fin))!=EOF && !endofline(fin,c); i++) {
-		if (i >= maxline-1) {	/* cresce a linha */
-			maxline *= 2;		/* dobra o tamanho atual */
-			newl = (char *) realloc(line, maxline);
-			if (newl == NULL) {
-				reset();
-				return NULL;
-			}
-			line = newl;
-			news = (char *) realloc(sline, maxline);
-			if (news == NULL) {
-				reset();
-				return NULL;
-			}
-			sline = news;
-
-
-		}
-		line[i] = c;
-	}
-	line[i] = '\0';
-	if (split(delim, compress) == NOMEM) {
-		reset();
-		return NULL;			/* estouro de memória */
-	}
-	return (c == EOF && i == 0) ? NULL : line;
+int csv_parse_record(const char *line, const char *line_end, csv_record_t *record) {
+    const char *p = line, *value_end;
+
+    p = next_field(&line, line_end, &value_end);
+    record->name = line;
+    record->name_length = value_end - line;
+    if(p == line_end) {
+        return -1;
+    }
+
+    line = p + 1;
+    p = next_field(&line, line_end, &value_end);
+    record->label = atoi(line);
+    if(p == line_end) {
+        return -1;
+    }
+
+    line = p + 1;
+    next_field(&line, line_end, &value_end);
+    record->pixels = line;
+    record->pixels_end = value_end;
+
+    return 0;
 }
 
 /**
- * @brief Separa a linha em campos.
+ * @brief Converte um pixel isolado.
  * 
- * Separa a linha em campos.
+ * Usa a conversão direta de dígitos para inteiros e, para outros formatos,
+ * a conversão genérica com strtof.
  * 
- * @param delim delimitador de campos
- * @param compress 
- * @return int número de campos
+ * @param p início do valor
+ * @param end fim do valor
+ * @return float valor do pixel
  */
-static int split(char delim, int compress)
-{
-	char *p, **newf;
-	char *sepp; /* ponteiro para caractere separador temporário */
-	int sepc;   /* caractere separador temporário */
-
-	nfield = 0;
-	if (line[0] == '\0')
-		return 0;
-	strcpy(sline, line);
-	p = sline;
-
-	do {
-		if (nfield >= maxfield) {
-			maxfield *= 2;			/* dobra o tamanho atual */
-			newf = (char **) realloc(field,
-						maxfield * sizeof(field[0]));
-			if (newf == NULL)
-				return NOMEM;
-			field = newf;
-		}
-		/* comprime os caracteres delimitadores subsequentes */
-		if (compress) {
-		    while (*p != '\0' && *p == delim) {
-		        p++;
-		    }
-		}
-		if (*p == '"')
-			sepp = advquoted(++p, delim);	/* pula o inicial */
-		else
-			sepp = p + strcspn(p, &delim);
-		sepc = sepp[0];
-		sepp[0] = '\0';				/* termina o campo */
-		field[nfield++] = p;
-		p = sepp + 1;
-	} while (sepc == (int) delim);
-
-	return nfield;
+static float decode_token(const char *p, const char *end) {
+    char buffer[64];
+    int value = 0;
+    const char *q;
+
+    for(q = p; q < end && *q >= '0' && *q <= '9' && q - p < 9; q++) {
+        value = value * 10 + (*q - '0');
+    }
+
+    if(q == end) {
+        return (float) value;
+    }
+
+    /* formato não inteiro: copia o valor para uma string terminada em '\0' */
+    size_t length = (size_t) (end - p) < sizeof(buffer) - 1 ? (size_t) (end - p) : sizeof(buffer) - 1;
+    memcpy(buffer, p, length);
+    buffer[length] = '\0';
+
+    return strtof(buffer, NULL);
 }
 
 /**
- * @brief Retorna ponteiro para o próximo separador.
+ * @brief Armazena um pixel convertido.
  * 
- * @param p ponteiro para liha
- * @param delim delimitador
- * @return char* string do próximo separador
+ * Se row_u8 for informado, o valor é arredondado e limitado ao intervalo
+ * de 0 a 255; caso contrário, é dividido por normalization e armazenado em row.
+ * 
+ * @param row linha em float
+ * @param row_u8 linha em uint8, ou NULL
+ * @param c índice do pixel
+ * @param value valor lido
+ * @param normalization valor pelo qual o pixel é dividido na linha em float
  */
-static char *advquoted(char *p, char delim)
-{
-	int i, j;
-
-	for (i = j = 0; p[j] != '\0'; i++, j++) {
-		if (p[j] == '"' && p[++j] != '"') {
-			/* copia o próximo separador */
-			int k = strcspn(p+j, &delim);
-			memmove(p+i, p+j, k);
-			i += k;
-			j += k;
-			break;
-		}
-		p[i] = p[j];
-	}
-	p[i] = '\0';
-	return p + j;
+static inline void store_pixel(float *row, uint8_t *row_u8, int c, float value, float normalization) {
+    if(row_u8 != NULL) {
+        row_u8[c] = value <= 0 ? 0 : value >= 255 ? 255 : (uint8_t) (value + 0.5f);
+    } else {
+        row[c] = value / normalization;
+    }
 }
 
 /**
- * @brief Retorna ponteiro para o valor do n-ésimo campo da linha.
+ * @brief Converte os pixels de uma linha.
  * 
- * Retorna ponteiro para o valor do n-ésimo campo da linha.
+ * Os pixels são separados por espaços. No caminho vetorizado, 16 bytes são
+ * examinados por vez e os separadores são localizados com uma única
+ * comparação; valores com até três dígitos são convertidos diretamente e
+ * os demais seguem para a conversão genérica.
  * 
- * @param n index do campo
- * @return char* string do campo
+ * @param p início do campo de pixels
+ * @param end fim do campo de pixels
+ * @param row linha em float que recebe os pixels
+ * @param row_u8 linha em uint8 que recebe os pixels, ou NULL para usar row
+ * @param num_pixels número de pixels esperado
+ * @param normalization valor pelo qual cada pixel é dividido
+ * @return int número de pixels convertidos
  */
-char *csvfield(int n)
-{
-	if (n < 0 || n >= nfield)
-		return NULL;
-	return field[n];
+static int decode_pixels(const char *p, const char *end, float *row, uint8_t *row_u8, int num_pixels, float normalization) {
+    int c = 0;
+
+    while(p < end && *p == ' ') {
+        p++;
+    }
+
+#ifdef __SSE2__
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i zeros = _mm_set1_epi8('0');
+    const __m128i nines = _mm_set1_epi8(9);
+
+    while(c < num_pixels && end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) p);
+        __m128i values = _mm_sub_epi8(bytes, zeros);
+        unsigned space_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, spaces));
+        unsigned digit_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(values, nines), values));
+        int start = 0, position;
+
+        if(space_mask == 0) { //valor com 16 caracteres ou mais
+            break;
+        }
+
+        /* percorre os separadores encontrados no bloco de 16 bytes */
+        while(space_mask != 0 && c < num_pixels) {
+            position = __builtin_ctz(space_mask);
+            space_mask &= space_mask - 1;
+
+            int length = position - start;
+            unsigned token_mask = ((1u << length) - 1) << start;
+
+            /* length igual a zero indica espaços consecutivos */
+            if(length > 0 && length <= 3 && (digit_mask & token_mask) == token_mask) {
+                const unsigned char *d = (const unsigned char *) p + start;
+                int value = length == 1 ? d[0] - '0' : length == 2 ? (d[0] - '0') * 10 + (d[1] - '0') : (d[0] - '0') * 100 + (d[1] - '0') * 10 + (d[2] - '0');
+                store_pixel(row, row_u8, c++, value, normalization);
+            } else if(length > 0) {
+                store_pixel(row, row_u8, c++, decode_token(p + start, p + position), normalization);
+            }
+
+            start = position + 1;
+        }
+
+        p += start;
+    }
+#endif
+
+    /* restante do campo, convertido valor a valor */
+    while(c < num_pixels && p < end) {
+        const char *token_end = memchr(p, ' ', end - p);
+
+        if(token_end == NULL) {
+            token_end = end;
+        }
+
+        if(token_end > p) {
+            store_pixel(row, row_u8, c++, decode_token(p, token_end), normalization);
+        }
+
+        p = token_end + (token_end < end ? 1 : 0);
+    }
+
+    return c;
 }
 
 /**
- * @brief Obtém o número de campos do arquivo.
+ * @brief Converte os pixels de uma linha para float.
  * 
- * Obtém o número de campos do arquivo.
+ * @param p início do campo de pixels
+ * @param end fim do campo de pixels
+ * @param row linha da matriz que recebe os pixels
+ * @param num_pixels número de pixels esperado
+ * @param normalization valor pelo qual cada pixel é dividido
+ * @return int número de pixels convertidos
+ */
+int csv_decode_pixels(const char *p, const char *end, float *row, int num_pixels, float normalization) {
+    return decode_pixels(p, end, row, NULL, num_pixels, normalization);
+}
+
+/**
+ * @brief Converte os pixels de uma linha para uint8, sem normalização.
  * 
- * @return int número de campos do arquivo
+ * @param p início do campo de pixels
+ * @param end fim do campo de pixels
+ * @param row linha da matriz que recebe os pixels
+ * @param num_pixels número de pixels esperado
+ * @return int número de pixels convertidos
  */
-int csvnfield(void)
-{
-	return nfield;
+int csv_decode_pixels_u8(const char *p, const char *end, uint8_t *row, int num_pixels) {
+    return decode_pixels(p, end, NULL, row, num_pixels, 1);
 }
@@ -0,0 +1,121 @@
+#ifndef DATASET_H__
+#define DATASET_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file dataset.h
+ * @brief Interface do contêiner de dados de treinamento e teste.
+ * 
+ * Define a estrutura que armazena as imagens em uma única matriz N x D
+ * contígua, alinhada em 64 bytes, junto com as labels e os nomes das imagens.
+ * A matriz pode ser alocada por dataset_alloc() ou mapeada a partir do
+ * cache binário (cache.h), e os pixels podem ser armazenados já normalizados
+ * em float, em ponto flutuante de 16 bits (float16 ou bfloat16) ou como
+ * inteiros de 0 a 255 em uint8.
+ * 
+ */
+
+/** Alinhamento, em bytes, do buffer de pixels e do início de cada linha **/
+#define DATASET_ALIGNMENT 64
+
+/** Tamanho máximo do nome de uma imagem **/
+#define DATASET_NAME_SIZE 60
+
+/** Tipos de armazenamento dos pixels **/
+enum {
+    DATASET_FLOAT32 = 0,    /* float, já dividido por 255 */
+    DATASET_UINT8 = 1,      /* inteiro de 0 a 255, normalizado nos kernels */
+    DATASET_FLOAT16 = 2,    /* meia precisão IEEE 754, já dividido por 255 */
+    DATASET_BFLOAT16 = 3    /* bfloat16 (os 16 bits mais significativos de um float), já dividido por 255 */
+};
+
+/** Número de tipos de armazenamento **/
+#define DATASET_NUM_DTYPES 4
+
+/**
+ * @brief Conjunto de imagens armazenado em uma matriz contígua.
+ * 
+ * A linha r da matriz começa em data + r * stride elementos. O stride é o
+ * número de pixels por imagem arredondado para um múltiplo do alinhamento,
+ * de forma que todas as linhas iniciem em um endereço alinhado.
+ */
+typedef struct dataset {
+    void *data;                         /* matriz N x D contígua e alinhada */
+    int dtype;                          /* tipo de armazenamento dos pixels (DATASET_*) */
+    int num_images;                     /* número de linhas (N) */
+    int num_pixels;                     /* número de pixels por imagem (D) */
+    int stride;                         /* distância, em elementos, entre duas linhas */
+    int *labels;                        /* label de cada imagem */
+    char (*names)[DATASET_NAME_SIZE];   /* nome de cada imagem */
+    void *mapping;                      /* mapeamento do cache que contém a matriz, ou NULL */
+    size_t mapping_size;                /* tamanho do mapeamento, em bytes */
+} dataset_t;
+
+extern int dataset_alloc(dataset_t *dataset, int num_images, int num_pixels, int dtype); /* aloca o contêiner */
+extern void dataset_free(dataset_t *dataset);                                            /* libera o contêiner */
+extern int dataset_stride(int num_pixels, int dtype);                                    /* stride alinhado de uma linha */
+extern const char *dataset_dtype_name(int dtype);                                        /* nome do tipo de armazenamento */
+extern int dataset_dtype_from_name(const char *name);                                    /* tipo de armazenamento a partir do nome */
+extern void dataset_split(dataset_t *dataset, int num_rows, dataset_t *tail);            /* separa as últimas linhas em uma visão */
+extern void dataset_pack_row(dataset_t *dataset, int r, const float *values, int num_values); /* grava uma linha em float16 ou bfloat16 */
+
+/**
+ * @brief Retorna o tamanho, em bytes, de um pixel armazenado.
+ * 
+ * @param dtype tipo de armazenamento
+ * @return size_t tamanho do pixel
+ */
+static inline size_t dataset_element_size(int dtype) {
+    if(dtype == DATASET_UINT8) {
+        return sizeof(uint8_t);
+    }
+
+    return dtype == DATASET_FLOAT16 || dtype == DATASET_BFLOAT16 ? sizeof(uint16_t) : sizeof(float);
+}
+
+/**
+ * @brief Retorna o tamanho, em bytes, da matriz de pixels.
+ * 
+ * @param dataset contêiner de dados
+ * @return size_t tamanho da matriz
+ */
+static inline size_t dataset_size(const dataset_t *dataset) {
+    return (size_t) dataset->num_images * dataset->stride * dataset_element_size(dataset->dtype);
+}
+
+/**
+ * @brief Retorna o ponteiro para o início da linha r de uma matriz em float.
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha
+ * @return float* ponteiro para o primeiro pixel da linha
+ */
+static inline float *dataset_row(const dataset_t *dataset, int r) {
+    return (float *) dataset->data + (size_t) r * dataset->stride;
+}
+
+/**
+ * @brief Retorna o ponteiro para o início da linha r de uma matriz em uint8.
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha
+ * @return uint8_t* ponteiro para o primeiro pixel da linha
+ */
+static inline uint8_t *dataset_row_u8(const dataset_t *dataset, int r) {
+    return (uint8_t *) dataset->data + (size_t) r * dataset->stride;
+}
+
+/**
+ * @brief Retorna o ponteiro para o início da linha r de uma matriz em float16 ou bfloat16.
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha
+ * @return uint16_t* ponteiro para o primeiro pixel da linha
+ */
+static inline uint16_t *dataset_row_u16(const dataset_t *dataset, int r) {
+    return (uint16_t *) dataset->data + (size_t) r * dataset->stride;
+}
+
+#endif
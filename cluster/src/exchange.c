@@ -0,0 +1,136 @@
+/**
+ * @file exchange.c
+ * @brief Troca dos gradientes entre os processos, com sobreposição ao cálculo.
+ * 
+ * Esse arquivo contém a soma dos gradientes locais entre os processos, de
+ * forma bloqueante ou por segmentos com MPI_Iallreduce. Todas as funções
+ * que chamam o MPI devem ser executadas apenas pela thread mestre
+ * (MPI_THREAD_FUNNELED), e os segmentos devem ser iniciados na mesma
+ * ordem em todos os processos.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+#include "exchange.h"
+
+/**
+ * @brief Inicializa a troca dos gradientes.
+ * 
+ * @param exchange troca a ser inicializada
+ * @param num_weights tamanho do vetor gradiente
+ * @param num_segments número de segmentos (limitado a num_weights); 0 para o MPI_Allreduce bloqueante
+ * @param num_rows número de imagens locais, cujos resíduos são armazenados no acúmulo por segmentos
+ * @return int 0, se a inicialização foi bem sucedida; -1, caso contrário
+ */
+int exchange_init(exchange_t *exchange, int num_weights, int num_segments, int num_rows) {
+    exchange->num_weights = num_weights;
+    exchange->num_segments = num_segments < num_weights ? num_segments : num_weights;
+    exchange->num_posted = 0;
+    exchange->requests = NULL;
+    exchange->residuals = NULL;
+    exchange->time_exposed = 0;
+
+    if(exchange->num_segments <= 0) {
+        exchange->num_segments = 0;
+        return 0;
+    }
+
+    exchange->requests = (MPI_Request *) malloc(exchange->num_segments * sizeof(MPI_Request));
+    exchange->residuals = (float *) malloc((num_rows > 0 ? num_rows : 1) * sizeof(float));
+
+    if(exchange->requests == NULL || exchange->residuals == NULL) {
+        exchange_free(exchange);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Soma o vetor gradiente completo de todos os processos, de forma bloqueante.
+ * 
+ * @param exchange troca dos gradientes
+ * @param gradients vetor gradiente local, substituído pela soma
+ */
+void exchange_allreduce(exchange_t *exchange, float *gradients) {
+    double time_begin = MPI_Wtime();
+
+    MPI_Allreduce(MPI_IN_PLACE, gradients, exchange->num_weights, MPI_FLOAT, MPI_SUM, MPI_COMM_WORLD);
+
+    exchange->time_exposed += MPI_Wtime() - time_begin;
+}
+
+/**
+ * @brief Inicia a soma de um segmento do vetor gradiente.
+ * 
+ * O segmento não deve ser lido nem alterado até exchange_wait().
+ * 
+ * @param exchange troca dos gradientes
+ * @param gradients vetor gradiente local
+ * @param segment índice do segmento, iniciado após os segmentos anteriores
+ */
+void exchange_post(exchange_t *exchange, float *gradients, int segment) {
+    double time_begin = MPI_Wtime();
+    int begin = exchange_segment_begin(exchange, segment), end = exchange_segment_begin(exchange, segment + 1);
+
+    MPI_Iallreduce(MPI_IN_PLACE, gradients + begin, end - begin, MPI_FLOAT, MPI_SUM, MPI_COMM_WORLD, &exchange->requests[segment]);
+    exchange->num_posted = segment + 1;
+
+    exchange->time_exposed += MPI_Wtime() - time_begin;
+}
+
+/**
+ * @brief Faz avançar as reduções pendentes.
+ * 
+ * Sem uma thread de progresso, a biblioteca MPI só avança as operações
+ * não bloqueantes durante as chamadas MPI; a consulta periódica permite
+ * que as reduções ocorram enquanto os segmentos seguintes são calculados.
+ * 
+ * @param exchange troca dos gradientes
+ */
+void exchange_progress(exchange_t *exchange) {
+    int completed;
+
+    if(exchange->num_posted > 0) {
+        double time_begin = MPI_Wtime();
+
+        MPI_Testall(exchange->num_posted, exchange->requests, &completed, MPI_STATUSES_IGNORE);
+
+        exchange->time_exposed += MPI_Wtime() - time_begin;
+    }
+}
+
+/**
+ * @brief Aguarda as reduções iniciadas na passagem atual.
+ * 
+ * @param exchange troca dos gradientes
+ */
+void exchange_wait(exchange_t *exchange) {
+    double time_begin = MPI_Wtime();
+
+    MPI_Waitall(exchange->num_posted, exchange->requests, MPI_STATUSES_IGNORE);
+    exchange->num_posted = 0;
+
+    exchange->time_exposed += MPI_Wtime() - time_begin;
+}
+
+/**
+ * @brief Libera a troca dos gradientes.
+ * 
+ * @param exchange troca dos gradientes
+ */
+void exchange_free(exchange_t *exchange) {
+    free(exchange->requests);
+    free(exchange->residuals);
+    exchange->requests = NULL;
+    exchange->residuals = NULL;
+}
@@ -0,0 +1,57 @@
+#ifndef EXCHANGE_H__
+#define EXCHANGE_H__
+
+/**
+ * @file exchange.h
+ * @brief Interface da troca dos gradientes entre os processos.
+ * 
+ * Sem segmentos, o gradiente local é somado ao dos demais processos com um
+ * MPI_Allreduce bloqueante ao final da passagem pelos dados. Com segmentos,
+ * o vetor é dividido em partes contíguas, e a soma de cada parte é
+ * iniciada com MPI_Iallreduce assim que o seu acúmulo local termina,
+ * enquanto as threads calculam as partes seguintes. A thread mestre
+ * consulta as requisições pendentes durante o cálculo, para que as
+ * reduções avancem, e aguarda todas antes da atualização dos pesos.
+ * 
+ * Em ambos os casos, o tempo gasto pela thread mestre nas chamadas MPI
+ * (a comunicação exposta, que não é sobreposta ao cálculo) é acumulado.
+ * 
+ */
+
+#include <mpi.h>
+
+/** Número de imagens processadas pela thread mestre entre duas consultas às requisições pendentes **/
+#define EXCHANGE_PROGRESS_ROWS 32
+
+/** Troca dos gradientes entre os processos **/
+typedef struct exchange {
+    int num_weights;                /* tamanho do vetor gradiente */
+    int num_segments;               /* número de segmentos; 0 para o MPI_Allreduce bloqueante */
+    int num_posted;                 /* segmentos cuja redução foi iniciada na passagem atual */
+    MPI_Request *requests;          /* requisição de cada segmento */
+    float *residuals;               /* h - y de cada imagem local, usado no acúmulo por segmentos */
+    double time_exposed;            /* tempo da thread mestre nas chamadas MPI, em segundos */
+} exchange_t;
+
+extern int exchange_init(exchange_t *exchange, int num_weights, int num_segments, int num_rows); /* aloca os segmentos */
+extern void exchange_allreduce(exchange_t *exchange, float *gradients);                       /* soma o vetor completo, de forma bloqueante */
+extern void exchange_post(exchange_t *exchange, float *gradients, int segment);               /* inicia a soma de um segmento */
+extern void exchange_progress(exchange_t *exchange);                                          /* faz avançar as reduções pendentes */
+extern void exchange_wait(exchange_t *exchange);                                              /* aguarda as reduções pendentes */
+extern void exchange_free(exchange_t *exchange);                                              /* libera os segmentos */
+
+/**
+ * @brief Retorna a primeira posição de um segmento.
+ * 
+ * Os segmentos dividem o vetor em partes de tamanho quase igual; o
+ * segmento s ocupa as posições [segment_begin(s), segment_begin(s + 1)).
+ * 
+ * @param exchange troca dos gradientes
+ * @param segment índice do segmento
+ * @return int primeira posição do segmento
+ */
+static inline int exchange_segment_begin(const exchange_t *exchange, int segment) {
+    return (long) exchange->num_weights * segment / exchange->num_segments;
+}
+
+#endif
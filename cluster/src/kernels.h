@@ -0,0 +1,74 @@
+#ifndef KERNELS_H__
+#define KERNELS_H__
+
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * @file kernels.h
+ * @brief Interface dos kernels vetoriais usados no treinamento.
+ * 
+ * Os kernels possuem implementações escalar, SSE2, AVX2+FMA e AVX-512.
+ * A implementação é escolhida em tempo de execução por kernels_init(),
+ * de acordo com as instruções suportadas pelo processador.
+ * 
+ */
+
+/** Conjuntos de instruções suportados pelos kernels **/
+typedef enum kernel_isa {
+    KERNEL_ISA_SCALAR,
+    KERNEL_ISA_SSE2,
+    KERNEL_ISA_AVX2,
+    KERNEL_ISA_AVX512
+} kernel_isa_t;
+
+/* produto escalar entre x e y */
+extern float (*kernel_dot)(const float *x, const float *y, int n);
+
+/* y = y + a * x */
+extern void (*kernel_axpy)(float a, const float *x, float *y, int n);
+
+/* h = sigmoid(x . w) e g = g + (h - label) * x, com uma única leitura de x da memória */
+extern float (*kernel_dot_axpy)(const float *x, const float *w, float *g, float label, int n);
+
+/* versões para linhas em uint8: os pixels são convertidos para float nos registradores */
+extern float (*kernel_dot_u8)(const uint8_t *x, const float *y, int n);
+extern void (*kernel_axpy_u8)(float a, const uint8_t *x, float *y, int n);
+
+/* h = sigmoid(scale * (x . w)) e g = g + (h - label) * scale * x */
+extern float (*kernel_dot_axpy_u8)(const uint8_t *x, const float *w, float *g, float label, float scale, int n);
+
+/* versões para linhas em float16 e bfloat16: conversão para float nos registradores e acumulação em float */
+extern float (*kernel_dot_f16)(const uint16_t *x, const float *y, int n);
+extern void (*kernel_axpy_f16)(float a, const uint16_t *x, float *y, int n);
+extern float (*kernel_dot_axpy_f16)(const uint16_t *x, const float *w, float *g, float label, int n);
+extern float (*kernel_dot_bf16)(const uint16_t *x, const float *y, int n);
+extern void (*kernel_axpy_bf16)(float a, const uint16_t *x, float *y, int n);
+extern float (*kernel_dot_axpy_bf16)(const uint16_t *x, const float *w, float *g, float label, int n);
+
+/* versões para vários modelos (linhas de w e y com distância ldw e ldy): cada bloco de x é lido uma vez e usado em até quatro modelos */
+/* results[m] = x . w_m */
+extern void (*kernel_dot_many)(const float *x, const float *w, int ldw, int num_models, int n, float *results);
+
+/* y_m = y_m + a[m] * x */
+extern void (*kernel_axpy_many)(const float *a, const float *x, float *y, int ldy, int num_models, int n);
+
+/* redução da resolução por média de blocos de 2 x 2 e 4 x 4 pixels: y recebe (width / f) x (height / f) pixels */
+extern void (*kernel_pool_2x2)(const float *x, int width, int height, float *y);
+extern void (*kernel_pool_4x4)(const float *x, int width, int height, float *y);
+
+extern int kernels_init(const char *isa_name);  /* seleciona a implementação; NULL para detecção automática */
+extern kernel_isa_t kernels_isa(void);          /* conjunto de instruções selecionado */
+extern const char *kernels_isa_name(void);      /* nome do conjunto de instruções selecionado */
+
+/**
+ * @brief Aplica a função sigmoid.
+ * 
+ * @param z valor de entrada
+ * @return float resultado da função sigmoid
+ */
+static inline float kernel_sigmoid(float z) {
+    return 1/(1 + exp(-z));
+}
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file optimizer.c
+ * @brief Otimizador do gradiente descendente.
+ * 
+ * Esse arquivo contém os métodos de atualização do vetor de pesos, com
+ * momento opcional, e de embaralhamento das imagens para o treinamento
+ * em mini-lotes.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+#include "optimizer.h"
+
+/**
+ * @brief Inicializa o otimizador.
+ * 
+ * @param optimizer otimizador a ser inicializado
+ * @param num_weights tamanho do vetor de pesos
+ * @param learning_rate taxa de aprendizado
+ * @param momentum coeficiente do momento; 0 desativa o momento
+ * @param nesterov 1 para usar o momento de Nesterov
+ * @param batch_size imagens por atualização; 0 para o lote completo
+ * @param seed semente do embaralhamento
+ * @return int 0, se a inicialização foi bem sucedida; -1, caso contrário
+ */
+int optimizer_init(optimizer_t *optimizer, int num_weights, float learning_rate, float momentum, int nesterov, int batch_size, unsigned int seed) {
+    optimizer->num_weights = num_weights;
+    optimizer->learning_rate = learning_rate;
+    optimizer->momentum = momentum;
+    optimizer->nesterov = nesterov;
+    optimizer->batch_size = batch_size > 0 ? batch_size : 0;
+    optimizer->seed = seed;
+    optimizer->velocity = NULL;
+
+    if(momentum != 0 && (optimizer->velocity = (float *) calloc(num_weights, sizeof(float))) == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Libera o estado do otimizador.
+ * 
+ * @param optimizer otimizador
+ */
+void optimizer_free(optimizer_t *optimizer) {
+    free(optimizer->velocity);
+    optimizer->velocity = NULL;
+}
+
+/**
+ * @brief Calcula o número de lotes de uma época.
+ * 
+ * @param optimizer otimizador
+ * @param num_images número de imagens da época
+ * @return int número de lotes; 1, no lote completo
+ */
+int optimizer_num_batches(const optimizer_t *optimizer, int num_images) {
+    if(optimizer->batch_size == 0 || optimizer->batch_size >= num_images) {
+        return 1;
+    }
+
+    return (num_images + optimizer->batch_size - 1) / optimizer->batch_size;
+}
+
+/**
+ * @brief Embaralha a ordem das imagens (Fisher-Yates).
+ * 
+ * Usa rand_r com o estado do otimizador, de forma que a sequência não
+ * depende das demais chamadas a rand() e pode ser reproduzida.
+ * 
+ * @param optimizer otimizador
+ * @param order vetor com os índices das imagens
+ * @param num_images tamanho do vetor
+ */
+void optimizer_shuffle(optimizer_t *optimizer, int *order, int num_images) {
+    for(int i = num_images - 1; i > 0; i--) {
+        int j = rand_r(&optimizer->seed) % (i + 1);
+        int temp = order[i];
+
+        order[i] = order[j];
+        order[j] = temp;
+    }
+}
+
+/**
+ * @brief Atualiza o vetor de pesos com o gradiente de um lote.
+ * 
+ * Com momento, v = m * v + g e os pesos são atualizados por v ou, com
+ * Nesterov, por m * v + g, em que g é o gradiente médio multiplicado pela
+ * taxa de aprendizado. Sem momento, a atualização é w = w - g.
+ * 
+ * Os pesos são divididos estaticamente entre as threads: quando chamada
+ * dentro de uma região paralela, deve ser chamada por todas as threads.
+ * 
+ * @param optimizer otimizador
+ * @param weights vetor de pesos
+ * @param gradients vetor gradiente somado sobre as imagens do lote
+ * @param num_images número de imagens do lote
+ */
+void optimizer_step(optimizer_t *optimizer, float *weights, const float *gradients, int num_images) {
+    float learning_rate = optimizer->learning_rate, momentum = optimizer->momentum;
+    float *velocity = optimizer->velocity;
+
+    if(velocity == NULL) {
+        #pragma omp for schedule(static)
+        for(int c = 0; c < optimizer->num_weights; c++) {
+            weights[c] = weights[c] - ((gradients[c] * learning_rate) / num_images);
+        }
+    } else if(optimizer->nesterov) {
+        #pragma omp for schedule(static)
+        for(int c = 0; c < optimizer->num_weights; c++) {
+            float step = (gradients[c] * learning_rate) / num_images;
+
+            velocity[c] = momentum * velocity[c] + step;
+            weights[c] = weights[c] - (momentum * velocity[c] + step);
+        }
+    } else {
+        #pragma omp for schedule(static)
+        for(int c = 0; c < optimizer->num_weights; c++) {
+            velocity[c] = momentum * velocity[c] + (gradients[c] * learning_rate) / num_images;
+            weights[c] = weights[c] - velocity[c];
+        }
+    }
+}
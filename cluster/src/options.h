@@ -0,0 +1,17 @@
+#ifndef OPTIONS_H__
+#define OPTIONS_H__
+
+/**
+ * @file options.h
+ * @brief Interface para leitura das opções de linha de comando.
+ * 
+ * As opções são informadas após os argumentos posicionais, no formato
+ * --nome=valor ou apenas --nome.
+ * 
+ */
+
+extern const char *option_get(int argc, char *argv[], const char *name);            /* valor da opção ou NULL */
+extern int option_get_int(int argc, char *argv[], const char *name, int fallback);        /* valor inteiro da opção */
+extern float option_get_float(int argc, char *argv[], const char *name, float fallback);  /* valor real da opção */
+
+#endif
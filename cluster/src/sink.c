@@ -0,0 +1,171 @@
+/**
+ * @file sink.c
+ * @brief Escritor assíncrono de registros com buffer circular sem travas.
+ * 
+ * Esse arquivo contém o buffer circular de um produtor e um consumidor
+ * usado para retirar a gravação dos resultados de cada época do caminho
+ * crítico do treinamento. O produtor copia o registro para a próxima
+ * posição livre e publica o novo total com uma escrita atômica; a thread
+ * de escrita consome todos os registros publicados de uma vez, grava-os
+ * e descarrega os arquivos, aguardando brevemente quando o buffer está vazio.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca time **/
+#include <time.h>
+
+#include "sink.h"
+
+/** Intervalo de espera quando o buffer está vazio (ou cheio, no produtor), em nanossegundos **/
+#define SINK_POLL_INTERVAL 1000000
+
+/**
+ * @brief Aguarda um intervalo de SINK_POLL_INTERVAL.
+ */
+static void sink_wait(void) {
+    struct timespec interval = { 0, SINK_POLL_INTERVAL };
+
+    nanosleep(&interval, NULL);
+}
+
+/**
+ * @brief Laço da thread de escrita.
+ * 
+ * Grava em lote todos os registros publicados e descarrega os arquivos.
+ * Termina quando sink_close() foi chamada e não há registros pendentes.
+ * 
+ * @param arg escritor assíncrono
+ * @return void* NULL
+ */
+static void *writer(void *arg) {
+    sink_t *sink = (sink_t *) arg;
+    unsigned long tail = atomic_load_explicit(&sink->tail, memory_order_relaxed);
+
+    while(1) {
+        /* closing é lido antes de head: registros enviados antes do encerramento são sempre vistos */
+        int closing = atomic_load_explicit(&sink->closing, memory_order_acquire);
+        unsigned long head = atomic_load_explicit(&sink->head, memory_order_acquire);
+
+        if(tail == head) {
+            if(closing) {
+                break;
+            }
+
+            sink_wait();
+            continue;
+        }
+
+        for(; tail != head; tail++) {
+            sink->write(sink->records + (tail & (sink->capacity - 1)) * sink->record_size, sink->context);
+        }
+
+        /* os registros só são dados como gravados após a descarga (ver sink_sync()) */
+        sink->flush(sink->context);
+        atomic_store_explicit(&sink->tail, tail, memory_order_release);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Inicia o escritor assíncrono.
+ * 
+ * @param sink escritor a ser inicializado
+ * @param record_size tamanho de um registro, em bytes
+ * @param capacity número de registros do buffer circular (arredondado para uma potência de 2)
+ * @param write função que formata e grava um registro, executada pela thread de escrita
+ * @param flush função que descarrega os arquivos ao final de cada lote
+ * @param context argumento repassado às funções write e flush
+ * @return int 0, se a thread de escrita foi iniciada; -1, caso contrário
+ */
+int sink_open(sink_t *sink, size_t record_size, unsigned long capacity, sink_write_t write, sink_flush_t flush, void *context) {
+    sink->capacity = 1;
+    while(sink->capacity < capacity) {
+        sink->capacity *= 2;
+    }
+
+    sink->record_size = record_size;
+    sink->write = write;
+    sink->flush = flush;
+    sink->context = context;
+    atomic_init(&sink->head, 0);
+    atomic_init(&sink->tail, 0);
+    atomic_init(&sink->closing, 0);
+
+    if((sink->records = (char *) malloc(sink->capacity * record_size)) == NULL) {
+        return -1;
+    }
+
+    if(pthread_create(&sink->thread, NULL, writer, sink) != 0) {
+        free(sink->records);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Envia um registro para a thread de escrita.
+ * 
+ * O registro é copiado para o buffer circular e a chamada retorna sem
+ * aguardar a gravação. A espera só ocorre se o buffer estiver cheio, isto
+ * é, se a thread de escrita estiver capacity registros atrasada.
+ * 
+ * @param sink escritor assíncrono
+ * @param record registro de record_size bytes
+ */
+void sink_push(sink_t *sink, const void *record) {
+    unsigned long head = atomic_load_explicit(&sink->head, memory_order_relaxed);
+
+    while(head - atomic_load_explicit(&sink->tail, memory_order_acquire) >= sink->capacity) {
+        sink_wait();
+    }
+
+    memcpy(sink->records + (head & (sink->capacity - 1)) * sink->record_size, record, sink->record_size);
+    atomic_store_explicit(&sink->head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief Aguarda a gravação dos registros enviados.
+ * 
+ * Ao retornar, todos os registros enviados até a chamada foram gravados e
+ * os arquivos foram descarregados, de forma que o tamanho dos arquivos
+ * corresponde exatamente aos registros enviados. A thread de escrita
+ * continua ativa.
+ * 
+ * @param sink escritor assíncrono
+ */
+void sink_sync(sink_t *sink) {
+    unsigned long head = atomic_load_explicit(&sink->head, memory_order_relaxed);
+
+    while(atomic_load_explicit(&sink->tail, memory_order_acquire) != head) {
+        sink_wait();
+    }
+}
+
+/**
+ * @brief Grava os registros pendentes e encerra a thread de escrita.
+ * 
+ * Ao retornar, todos os registros enviados foram gravados e os arquivos
+ * podem voltar a ser usados diretamente.
+ * 
+ * @param sink escritor assíncrono
+ */
+void sink_close(sink_t *sink) {
+    atomic_store_explicit(&sink->closing, 1, memory_order_release);
+    pthread_join(sink->thread, NULL);
+    free(sink->records);
+}
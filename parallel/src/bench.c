@@ -0,0 +1,473 @@
+/**
+ * @file bench.c
+ * @brief Microbenchmarks das etapas críticas do treinamento.
+ * 
+ * Mede isoladamente a função hipótese, a época de treinamento (hipótese,
+ * métricas, custo e gradiente em uma única passagem, seguida da atualização
+ * dos pesos), o registro dos resultados de uma época e a conversão das linhas do arquivo .csv, variando o número de imagens, o
+ * número de threads, o conjunto de instruções dos kernels e o armazenamento
+ * dos pixels. Os dados são sintéticos e gerados em memória.
+ * 
+ * Cada medição executa repetições de aquecimento, seguidas das repetições
+ * cronometradas, e gera uma linha CSV na saída padrão com a mediana, o
+ * percentil 95 e o mínimo dos tempos, além das taxas em GB/s e GFLOP/s
+ * calculadas a partir da mediana.
+ * 
+ * As funções de main.c são usadas diretamente: o arquivo é compilado com
+ * a função main renomeada (ver o alvo bench do Makefile).
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdio **/
+#include <stdio.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca OPENMP **/
+#include <omp.h>
+
+/** Inclusão do arquivo de cabeçalho responsável pela leitura dos arquivos de entrada **/
+#include "csv.h"
+
+/** Inclusão do arquivo de cabeçalho do contêiner de dados **/
+#include "dataset.h"
+
+/** Inclusão do arquivo de cabeçalho dos kernels vetoriais **/
+#include "kernels.h"
+
+/** Inclusão do arquivo de cabeçalho das opções de linha de comando **/
+#include "options.h"
+
+/** Inclusão do arquivo de cabeçalho do otimizador **/
+#include "optimizer.h"
+
+/** Inclusão do arquivo de cabeçalho do posicionamento nos nós NUMA **/
+#include "topology.h"
+
+/** Inclusão do arquivo de cabeçalho com as constantes e as funções de main.c **/
+#include "main.h"
+
+/** Número máximo de valores em uma lista de opções **/
+#define BENCH_MAX_VALUES 16
+
+/** Dados compartilhados pelas medições de um número de imagens **/
+typedef struct bench_context {
+    dataset_t training;         /* imagens sintéticas no armazenamento atual */
+    float *weights;             /* vetor de pesos */
+    float *gradients;           /* vetor gradiente compartilhado entre as threads */
+    float *all_hypothesis;      /* valores de hipótese */
+    double metrics[NUM_METRICS]; /* matriz de confusão e custo de uma época */
+    optimizer_t optimizer;      /* otimizador sem momento e com taxa de aprendizado nula */
+    char *text;                 /* linhas .csv com as mesmas imagens */
+    const char **lines;         /* início de cada linha de text */
+    size_t text_size;           /* tamanho de text, em bytes */
+    FILE *file_null;            /* destino dos registros de save_training_results */
+    volatile float sink;        /* acumula resultados para que não sejam descartados */
+} bench_context_t;
+
+/** Descrição de uma medição **/
+typedef struct benchmark {
+    const char *name;                                                       /* nome da medição */
+    void (*run)(bench_context_t *context);                                  /* execução cronometrada */
+    void (*traffic)(const bench_context_t *context, double *bytes, double *flops); /* volume de uma execução */
+    int sweep_threads;                                                      /* varia o número de threads */
+    int sweep_isa;                                                          /* varia o conjunto de instruções */
+    int sweep_dtype;                                                        /* varia o armazenamento dos pixels */
+} benchmark_t;
+
+/**
+ * @brief Calcula a função hipótese de todas as imagens, como em uma época.
+ * 
+ * @param context dados da medição
+ */
+static void run_hypothesis(bench_context_t *context) {
+    #pragma omp parallel for schedule(static)
+    for(int r = 0; r < context->training.num_images; r++) {
+        context->all_hypothesis[r] = hypothesis_function(&context->training, r, context->weights);
+    }
+}
+
+/**
+ * @brief Executa uma época de treinamento e atualiza os pesos.
+ * 
+ * @param context dados da medição
+ */
+static void run_train_epoch(bench_context_t *context) {
+    double metrics[NUM_METRICS];
+
+    #pragma omp parallel
+    train_epoch(&context->training, context->weights, &context->optimizer, context->gradients, metrics, NULL);
+
+    context->sink += metrics[METRIC_COST];
+}
+
+/**
+ * @brief Registra os resultados de uma época em /dev/null.
+ * 
+ * @param context dados da medição
+ */
+static void run_save_training_results(bench_context_t *context) {
+    FILE *file = context->file_null;
+
+    context->sink += save_training_results(0, context->metrics, context->training.num_images, file, file, file, file, file, file);
+}
+
+/**
+ * @brief Converte todas as linhas .csv para o contêiner.
+ * 
+ * @param context dados da medição
+ */
+static void run_csv_parser(bench_context_t *context) {
+    dataset_t *dataset = &context->training;
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int r = 0; r < dataset->num_images; r++) {
+        const char *line_end, *next;
+        const char *line = csv_next_line(context->lines[r], context->lines[r + 1], &line_end, &next);
+        csv_record_t record;
+
+        if(line == NULL || csv_parse_record(line, line_end, &record) == -1) {
+            continue;
+        }
+
+        dataset->labels[r] = record.label;
+        if(dataset->dtype == DATASET_UINT8) {
+            csv_decode_pixels_u8(record.pixels, record.pixels_end, dataset_row_u8(dataset, r), dataset->num_pixels);
+        } else if(dataset_element_size(dataset->dtype) == sizeof(uint16_t)) {
+            float values[NUM_PIXELS];
+
+            csv_decode_pixels(record.pixels, record.pixels_end, values, dataset->num_pixels, 255);
+            dataset_pack_row(dataset, r, values, dataset->num_pixels);
+        } else {
+            csv_decode_pixels(record.pixels, record.pixels_end, dataset_row(dataset, r), dataset->num_pixels, 255);
+        }
+    }
+}
+
+/**
+ * @brief Volume da função hipótese: leitura da matriz e dos pesos; uma multiplicação e uma soma por pixel.
+ */
+static void traffic_hypothesis(const bench_context_t *context, double *bytes, double *flops) {
+    const dataset_t *dataset = &context->training;
+
+    *bytes = (double) dataset_size(dataset) + dataset->num_pixels * sizeof(float) + dataset->num_images * sizeof(float);
+    *flops = 2.0 * dataset->num_images * dataset->num_pixels;
+}
+
+/**
+ * @brief Volume da época: uma única leitura da matriz e dos labels; produto escalar e axpy por imagem e atualização dos pesos.
+ */
+static void traffic_train_epoch(const bench_context_t *context, double *bytes, double *flops) {
+    const dataset_t *dataset = &context->training;
+
+    *bytes = (double) dataset_size(dataset) + dataset->num_images * sizeof(int) + 3.0 * dataset->num_pixels * sizeof(float);
+    *flops = 4.0 * dataset->num_images * dataset->num_pixels + 3.0 * dataset->num_pixels;
+}
+
+/**
+ * @brief Volume do registro dos resultados: apenas as métricas da época.
+ */
+static void traffic_save_training_results(const bench_context_t *context, double *bytes, double *flops) {
+    (void) context;
+
+    *bytes = (double) NUM_METRICS * sizeof(double);
+    *flops = 0;
+}
+
+/**
+ * @brief Volume da conversão: texto lido e matriz gravada.
+ */
+static void traffic_csv_parser(const bench_context_t *context, double *bytes, double *flops) {
+    *bytes = (double) context->text_size + dataset_size(&context->training);
+    *flops = 0;
+}
+
+/** Medições realizadas **/
+static const benchmark_t BENCHMARKS[] = {
+    { "hypothesis_function", run_hypothesis, traffic_hypothesis, 1, 1, 1 },
+    { "train_epoch", run_train_epoch, traffic_train_epoch, 1, 1, 1 },
+    { "save_training_results", run_save_training_results, traffic_save_training_results, 0, 0, 0 },
+    { "csv_parser", run_csv_parser, traffic_csv_parser, 1, 0, 1 }
+};
+
+/**
+ * @brief Converte uma lista de inteiros separados por vírgula.
+ * 
+ * @param value lista no formato "a,b,c"
+ * @param values vetor que recebe os valores
+ * @return int número de valores convertidos
+ */
+static int parse_list(const char *value, int *values) {
+    int num_values = 0;
+    char *end;
+
+    while(*value != '\0' && num_values < BENCH_MAX_VALUES) {
+        values[num_values] = strtol(value, &end, 10);
+        if(end == value) {
+            break;
+        }
+        if(values[num_values] > 0) {
+            num_values++;
+        }
+        value = *end == ',' ? end + 1 : end;
+    }
+
+    return num_values;
+}
+
+/**
+ * @brief Compara dois tempos, para ordenação com qsort.
+ */
+static int compare_times(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Gera as imagens sintéticas e as linhas .csv correspondentes.
+ * 
+ * @param context dados da medição
+ * @param pixels matriz num_images x NUM_PIXELS com os pixels de 0 a 255
+ * @param num_images número de imagens
+ * @return int 0, se a geração foi bem sucedida; -1, caso contrário
+ */
+static int generate_text(bench_context_t *context, const unsigned char *pixels, int num_images) {
+    size_t capacity = (size_t) num_images * (NUM_PIXELS * 4 + 32) + 1;
+    char *p;
+
+    context->text = (char *) malloc(capacity);
+    context->lines = (const char **) malloc((num_images + 1) * sizeof(const char *));
+    if(context->text == NULL || context->lines == NULL) {
+        return -1;
+    }
+
+    p = context->text;
+    for(int r = 0; r < num_images; r++) {
+        const unsigned char *row = pixels + (size_t) r * NUM_PIXELS;
+
+        context->lines[r] = p;
+        p += sprintf(p, "image_%d.png,%d,", r, r % 2);
+        for(int c = 0; c < NUM_PIXELS; c++) {
+            p += sprintf(p, c + 1 < NUM_PIXELS ? "%d " : "%d\n", row[c]);
+        }
+    }
+
+    context->lines[num_images] = p;
+    context->text_size = p - context->text;
+
+    return 0;
+}
+
+/**
+ * @brief Preenche o contêiner com os pixels sintéticos no armazenamento informado.
+ * 
+ * @param context dados da medição
+ * @param pixels matriz num_images x NUM_PIXELS com os pixels de 0 a 255
+ * @param num_images número de imagens
+ * @param dtype tipo de armazenamento dos pixels
+ * @return int 0, se a alocação foi bem sucedida; -1, caso contrário
+ */
+static int fill_dataset(bench_context_t *context, const unsigned char *pixels, int num_images, int dtype) {
+    dataset_t *dataset = &context->training;
+
+    if(dataset_alloc(dataset, num_images, NUM_PIXELS, dtype) == -1) {
+        return -1;
+    }
+
+    for(int r = 0; r < num_images; r++) {
+        const unsigned char *row = pixels + (size_t) r * NUM_PIXELS;
+        float values[NUM_PIXELS];
+
+        dataset->labels[r] = r % 2;
+        for(int c = 0; c < NUM_PIXELS; c++) {
+            if(dtype == DATASET_UINT8) {
+                dataset_row_u8(dataset, r)[c] = row[c];
+            } else {
+                values[c] = row[c] / 255.0f;
+            }
+        }
+
+        if(dtype == DATASET_FLOAT32) {
+            memcpy(dataset_row(dataset, r), values, sizeof(values));
+        } else if(dtype != DATASET_UINT8) {
+            dataset_pack_row(dataset, r, values, NUM_PIXELS);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Executa uma medição e grava a linha CSV correspondente.
+ * 
+ * @param context dados da medição
+ * @param benchmark medição
+ * @param isa nome do conjunto de instruções, ou "-" se não se aplica
+ * @param dtype nome do armazenamento, ou "-" se não se aplica
+ * @param num_threads número de threads
+ * @param warmup número de repetições de aquecimento
+ * @param repetitions número de repetições cronometradas
+ * @param times vetor com espaço para repetitions tempos
+ */
+static void run_benchmark(bench_context_t *context, const benchmark_t *benchmark, const char *isa, const char *dtype, int num_threads, int warmup, int repetitions, double *times) {
+    double bytes, flops, median, p95;
+
+    omp_set_num_threads(num_threads);
+
+    for(int i = 0; i < warmup; i++) {
+        benchmark->run(context);
+    }
+
+    for(int i = 0; i < repetitions; i++) {
+        double begin = omp_get_wtime();
+
+        benchmark->run(context);
+        times[i] = omp_get_wtime() - begin;
+    }
+
+    qsort(times, repetitions, sizeof(double), compare_times);
+    median = repetitions % 2 ? times[repetitions / 2] : (times[repetitions / 2 - 1] + times[repetitions / 2]) / 2;
+    p95 = times[(int) (0.95 * (repetitions - 1) + 0.5)];
+    benchmark->traffic(context, &bytes, &flops);
+
+    printf("%s,%s,%s,%d,%d,%d,%.9f,%.9f,%.9f,%.3f,%.3f\n", benchmark->name, isa, dtype, context->training.num_images, num_threads, repetitions, median, p95, times[0], bytes / median / 1e9, flops / median / 1e9);
+    fflush(stdout);
+}
+
+/**
+ * @brief Função principal dos microbenchmarks.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv opções:
+ * --images=a,b,... números de imagens (padrão 250,1000,4272)
+ * --threads=a,b,... números de threads (padrão 1,2,4)
+ * --isa=nome executa apenas o conjunto de instruções informado (padrão: todos os suportados)
+ * --dtype=float32|uint8|float16|bfloat16 executa apenas o armazenamento informado (padrão: todos)
+ * --warmup=n repetições de aquecimento (padrão 2)
+ * --repetitions=n repetições cronometradas (padrão 10)
+ * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
+ */
+int main(int argc, char *argv[]) {
+    static const char *ISA_NAMES[] = { "scalar", "sse2", "avx2", "avx512" };
+    const char *isa_option = option_get(argc, argv, "isa");
+    const char *dtype_option = option_get(argc, argv, "dtype");
+    int warmup = option_get_int(argc, argv, "warmup", 2);
+    int repetitions = option_get_int(argc, argv, "repetitions", 10);
+    int images[BENCH_MAX_VALUES], threads[BENCH_MAX_VALUES];
+    int num_images_values = parse_list(option_get(argc, argv, "images") != NULL ? option_get(argc, argv, "images") : "250,1000,4272", images);
+    int num_threads_values = parse_list(option_get(argc, argv, "threads") != NULL ? option_get(argc, argv, "threads") : "1,2,4", threads);
+    double *times;
+    bench_context_t context;
+
+    if(repetitions < 1 || warmup < 0) {
+        fprintf(stderr, "Número de repetições inválido!\n");
+        return -1;
+    }
+
+    times = (double *) malloc(repetitions * sizeof(double));
+    memset(&context, 0, sizeof(context));
+    context.weights = (float *) malloc(NUM_PIXELS * sizeof(float));
+    context.gradients = (float *) malloc(NUM_PIXELS * sizeof(float));
+    context.file_null = fopen("/dev/null", "w");
+
+    if(times == NULL || context.weights == NULL || context.gradients == NULL || context.file_null == NULL
+        || optimizer_init(&context.optimizer, NUM_PIXELS, 0, 0, 0, 0, 1) == -1) {
+        fprintf(stderr, "Não foi possível alocar memória para os dados!\n");
+        return -1;
+    }
+
+    for(int c = 0; c < NUM_PIXELS; c++) {
+        context.weights[c] = (rand() / (RAND_MAX + 1.0f) - 0.5f) / NUM_PIXELS;
+    }
+
+    printf("benchmark,isa,dtype,images,threads,repetitions,median_s,p95_s,min_s,gb_per_s,gflop_per_s\n");
+
+    for(int i = 0; i < num_images_values; i++) {
+        int num_images = images[i];
+        unsigned char *pixels = (unsigned char *) malloc((size_t) num_images * NUM_PIXELS);
+
+        context.all_hypothesis = (float *) malloc(num_images * sizeof(float));
+
+        if(pixels == NULL || context.all_hypothesis == NULL) {
+            fprintf(stderr, "Não foi possível alocar memória para os dados!\n");
+            return -1;
+        }
+
+        for(size_t k = 0; k < (size_t) num_images * NUM_PIXELS; k++) {
+            pixels[k] = rand() % 256;
+        }
+
+        /* matriz de confusão com um terço de positivos e custo arbitrário */
+        context.metrics[0] = num_images / 3;
+        context.metrics[1] = num_images / 6;
+        context.metrics[2] = num_images / 6;
+        context.metrics[3] = num_images - 2 * (num_images / 6) - num_images / 3;
+        context.metrics[4] = 0.69 * num_images;
+
+        if(generate_text(&context, pixels, num_images) == -1) {
+            fprintf(stderr, "Não foi possível alocar memória para os dados!\n");
+            return -1;
+        }
+
+        for(int dtype = DATASET_FLOAT32, first_dtype = 1; dtype < DATASET_NUM_DTYPES; dtype++) {
+            if(dtype_option != NULL && strcmp(dtype_option, dataset_dtype_name(dtype)) != 0) {
+                continue;
+            }
+
+            if(fill_dataset(&context, pixels, num_images, dtype) == -1) {
+                fprintf(stderr, "Não foi possível alocar memória para os dados!\n");
+                return -1;
+            }
+
+            for(int isa = 0, first_isa = 1; isa < (int) (sizeof(ISA_NAMES) / sizeof(ISA_NAMES[0])); isa++) {
+                /* ignora os conjuntos de instruções não selecionados ou não suportados */
+                if((isa_option != NULL && strcmp(isa_option, ISA_NAMES[isa]) != 0) || kernels_init(ISA_NAMES[isa]) == -1) {
+                    continue;
+                }
+
+                for(int b = 0; b < (int) (sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0])); b++) {
+                    const benchmark_t *benchmark = &BENCHMARKS[b];
+
+                    /* medições que não dependem dos kernels ou do armazenamento são executadas uma única vez */
+                    if((!benchmark->sweep_isa && !first_isa) || (!benchmark->sweep_dtype && !first_dtype)) {
+                        continue;
+                    }
+
+                    for(int t = 0; t < (benchmark->sweep_threads ? num_threads_values : 1); t++) {
+                        run_benchmark(&context, benchmark, benchmark->sweep_isa ? kernels_isa_name() : "-", benchmark->sweep_dtype ? dataset_dtype_name(dtype) : "-", benchmark->sweep_threads ? threads[t] : 1, warmup, repetitions, times);
+                    }
+                }
+
+                first_isa = 0;
+            }
+
+            dataset_free(&context.training);
+            first_dtype = 0;
+        }
+
+        free(pixels);
+        free(context.text);
+        free(context.lines);
+        free(context.all_hypothesis);
+    }
+
+    fclose(context.file_null);
+    optimizer_free(&context.optimizer);
+    free(context.weights);
+    free(context.gradients);
+    free(times);
+
+    return 0;
+}
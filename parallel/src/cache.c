@@ -0,0 +1,439 @@
+/**
+ * @file cache.c
+ * @brief Cache binário do dataset mapeado em memória.
+ * 
+ * Esse arquivo contém os métodos para gravar as imagens convertidas em um
+ * arquivo binário versionado e para mapeá-lo em memória na inicialização,
+ * evitando a conversão dos arquivos .csv a cada execução. O cache é
+ * considerado desatualizado quando o conteúdo dos arquivos de origem muda.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdio **/
+#include <stdio.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão das bibliotecas para acesso e mapeamento de arquivos **/
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+/** Alinhamento das seções do arquivo, compatível com o offset do mmap **/
+#define CACHE_PAGE_SIZE 4096
+
+/** Tamanho do buffer usado na leitura dos arquivos de origem **/
+#define CACHE_BUFFER_SIZE (1 << 20)
+
+/**
+ * @brief Arredonda um deslocamento para o início da próxima página.
+ * 
+ * @param offset deslocamento em bytes
+ * @return uint64_t deslocamento alinhado
+ */
+static uint64_t page_align(uint64_t offset) {
+    return (offset + CACHE_PAGE_SIZE - 1) / CACHE_PAGE_SIZE * CACHE_PAGE_SIZE;
+}
+
+/**
+ * @brief Calcula a soma de verificação dos arquivos de origem.
+ * 
+ * Aplica o FNV-1a de 64 bits sobre o conteúdo de todos os arquivos, na ordem informada.
+ * 
+ * @param sources nomes dos arquivos
+ * @param num_sources número de arquivos
+ * @param checksum soma de verificação resultante
+ * @return int 0, se todos os arquivos foram lidos; -1, caso contrário
+ */
+static int sources_checksum(const char *sources[], int num_sources, uint64_t *checksum) {
+    unsigned char *buffer = (unsigned char *) malloc(CACHE_BUFFER_SIZE);
+    uint64_t hash = 14695981039346656037ULL;
+    size_t length;
+    FILE *file;
+
+    if(buffer == NULL) {
+        return -1;
+    }
+
+    for(int i = 0; i < num_sources; i++) {
+        if((file = fopen(sources[i], "rb")) == NULL) {
+            free(buffer);
+            return -1;
+        }
+
+        while((length = fread(buffer, 1, CACHE_BUFFER_SIZE, file)) > 0) {
+            for(size_t j = 0; j < length; j++) {
+                hash = (hash ^ buffer[j]) * 1099511628211ULL;
+            }
+        }
+
+        fclose(file);
+    }
+
+    free(buffer);
+    *checksum = hash;
+    return 0;
+}
+
+/**
+ * @brief Obtém o tamanho e a data de modificação dos arquivos de origem.
+ * 
+ * @param sources nomes dos arquivos
+ * @param num_sources número de arquivos
+ * @param stats vetor que recebe os dados de cada arquivo
+ * @return int 0, se todos os arquivos existem; -1, caso contrário
+ */
+static int sources_stat(const char *sources[], int num_sources, cache_source_t *stats) {
+    struct stat st;
+
+    for(int i = 0; i < num_sources; i++) {
+        if(stat(sources[i], &st) != 0) {
+            return -1;
+        }
+
+        stats[i].size = st.st_size;
+        stats[i].mtime = st.st_mtime;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Lê e confere o cabeçalho do arquivo de cache.
+ * 
+ * @param fd descritor do arquivo de cache
+ * @param header cabeçalho lido
+ * @return int 0, se o cabeçalho é de uma versão compatível; -1, caso contrário
+ */
+int cache_read_header(int fd, cache_header_t *header) {
+    if(pread(fd, header, sizeof(*header), 0) != sizeof(*header)) {
+        return -1;
+    }
+
+    if(memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 || header->version != CACHE_VERSION
+        || header->dtype >= DATASET_NUM_DTYPES) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Regrava o cabeçalho do arquivo de cache.
+ * 
+ * Falhas são ignoradas: o cache continua válido e apenas a próxima
+ * verificação precisará recalcular a soma de verificação.
+ * 
+ * @param path caminho do arquivo de cache
+ * @param header cabeçalho a ser gravado
+ */
+static void update_header(const char *path, const cache_header_t *header) {
+    int fd = open(path, O_WRONLY);
+
+    if(fd != -1) {
+        ssize_t written = pwrite(fd, header, sizeof(*header), 0);
+        (void) written;
+        close(fd);
+    }
+}
+
+/**
+ * @brief Verifica se o cache está atualizado.
+ * 
+ * Confere a versão, as dimensões e o tipo dos pixels do cache. Se o tamanho ou a data de
+ * modificação de algum arquivo de origem mudou, a soma de verificação do
+ * conteúdo é recalculada; caso o conteúdo seja o mesmo, os novos dados dos
+ * arquivos são gravados no cabeçalho para que a próxima verificação seja imediata.
+ * 
+ * @param path caminho do arquivo de cache
+ * @param sources nomes dos arquivos .csv de origem
+ * @param num_sources número de arquivos de origem
+ * @param num_pixels número de pixels por imagem esperado
+ * @param dtype tipo de armazenamento dos pixels esperado
+ * @return int 0, se o cache pode ser usado; -1, se está ausente ou desatualizado
+ */
+int cache_validate(const char *path, const char *sources[], int num_sources, int num_pixels, int dtype) {
+    cache_header_t header;
+    cache_source_t stats[CACHE_MAX_SOURCES];
+    uint64_t checksum;
+    int fd, status = 0;
+
+    if(num_sources > CACHE_MAX_SOURCES || (fd = open(path, O_RDONLY)) == -1) {
+        return -1;
+    }
+
+    if(cache_read_header(fd, &header) == -1 || header.num_pixels != (uint32_t) num_pixels || header.dtype != (uint32_t) dtype || header.num_sources != (uint32_t) num_sources || sources_stat(sources, num_sources, stats) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    if(memcmp(header.sources, stats, num_sources * sizeof(stats[0])) != 0) {
+        if(sources_checksum(sources, num_sources, &checksum) == -1 || checksum != header.checksum) {
+            status = -1;
+        } else {
+            memcpy(header.sources, stats, num_sources * sizeof(stats[0]));
+            update_header(path, &header);
+        }
+    }
+
+    close(fd);
+    return status;
+}
+
+/**
+ * @brief Abre o cache para gravação incremental.
+ * 
+ * Grava o cabeçalho com o tamanho final das seções e reserva o arquivo
+ * inteiro, de forma que as linhas possam ser gravadas em blocos e em
+ * qualquer ordem; linhas não gravadas ficam zeradas. O arquivo é gravado
+ * com um nome temporário e só é renomeado em cache_writer_close(), de forma
+ * que um cache incompleto nunca seja lido.
+ * 
+ * @param writer gravador a ser inicializado
+ * @param path caminho do arquivo de cache
+ * @param sources nomes dos arquivos .csv de origem
+ * @param num_sources número de arquivos de origem
+ * @param layout contêiner com o tipo, o número de pixels e o stride das linhas
+ * @param num_images_testing número de imagens de teste
+ * @param num_images_training número de imagens de treinamento
+ * @return int 0, se o arquivo foi criado; -1, caso contrário
+ */
+int cache_writer_open(cache_writer_t *writer, const char *path, const char *sources[], int num_sources, const dataset_t *layout, int num_images_testing, int num_images_training) {
+    cache_header_t *header = &writer->header;
+    uint64_t section_size;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+    header->version = CACHE_VERSION;
+    header->dtype = layout->dtype;
+    header->num_pixels = layout->num_pixels;
+    header->stride = layout->stride;
+    header->num_sources = num_sources;
+
+    if(num_sources > CACHE_MAX_SOURCES || sources_stat(sources, num_sources, header->sources) == -1 || sources_checksum(sources, num_sources, &header->checksum) == -1) {
+        return -1;
+    }
+
+    writer->row_size = (size_t) layout->stride * dataset_element_size(layout->dtype);
+    section_size = writer->row_size + sizeof(int) + sizeof(layout->names[0]);
+
+    header->testing.num_images = num_images_testing;
+    header->testing.offset = page_align(sizeof(*header));
+    header->training.num_images = num_images_training;
+    header->training.offset = page_align(header->testing.offset + num_images_testing * section_size);
+
+    writer->path = path;
+    snprintf(writer->temp_path, sizeof(writer->temp_path), "%s.tmp", path);
+
+    if((writer->file = fopen(writer->temp_path, "wb")) == NULL) {
+        return -1;
+    }
+
+    if(fwrite(header, sizeof(*header), 1, writer->file) != 1 || fflush(writer->file) != 0
+        || ftruncate(fileno(writer->file), header->training.offset + num_images_training * section_size) != 0) {
+        cache_writer_abort(writer);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Grava um bloco de linhas consecutivas em uma seção do cache.
+ * 
+ * @param writer gravador aberto por cache_writer_open()
+ * @param section CACHE_SECTION_TESTING ou CACHE_SECTION_TRAINING
+ * @param first_row posição da primeira linha do bloco na seção
+ * @param rows contêiner com as linhas do bloco
+ * @param num_rows número de linhas do bloco
+ * @return int 0, se a gravação foi bem sucedida; -1, caso contrário
+ */
+int cache_writer_put(cache_writer_t *writer, int section, int first_row, const dataset_t *rows, int num_rows) {
+    const cache_section_t *target = section == CACHE_SECTION_TESTING ? &writer->header.testing : &writer->header.training;
+    uint64_t labels_offset = target->offset + target->num_images * writer->row_size;
+    uint64_t names_offset = labels_offset + target->num_images * sizeof(int);
+
+    if(first_row < 0 || num_rows < 0 || (uint32_t) (first_row + num_rows) > target->num_images) {
+        return -1;
+    }
+
+    if(fseek(writer->file, target->offset + first_row * writer->row_size, SEEK_SET) != 0
+        || fwrite(rows->data, writer->row_size, num_rows, writer->file) != (size_t) num_rows
+        || fseek(writer->file, labels_offset + first_row * sizeof(int), SEEK_SET) != 0
+        || fwrite(rows->labels, sizeof(int), num_rows, writer->file) != (size_t) num_rows
+        || fseek(writer->file, names_offset + first_row * sizeof(rows->names[0]), SEEK_SET) != 0
+        || fwrite(rows->names, sizeof(rows->names[0]), num_rows, writer->file) != (size_t) num_rows) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Conclui a gravação e publica o cache com o nome definitivo.
+ * 
+ * @param writer gravador aberto por cache_writer_open()
+ * @return int 0, se o cache foi gravado; -1, caso contrário
+ */
+int cache_writer_close(cache_writer_t *writer) {
+    if(fclose(writer->file) != 0 || rename(writer->temp_path, writer->path) != 0) {
+        remove(writer->temp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Descarta uma gravação incompleta do cache.
+ * 
+ * @param writer gravador aberto por cache_writer_open()
+ */
+void cache_writer_abort(cache_writer_t *writer) {
+    fclose(writer->file);
+    remove(writer->temp_path);
+}
+
+/**
+ * @brief Mapeia uma seção do cache em um contêiner de dados.
+ * 
+ * A matriz é mapeada somente para leitura a partir do arquivo; as labels
+ * e os nomes das linhas selecionadas são copiados para o contêiner.
+ * 
+ * @param fd descritor do arquivo de cache
+ * @param header cabeçalho do cache
+ * @param section seção a ser mapeada
+ * @param dataset contêiner a ser inicializado
+ * @param first_row primeira linha da seção a ser usada
+ * @param num_rows número de linhas a partir de first_row
+ * @return int 0, se o mapeamento foi bem sucedido; -1, caso contrário
+ */
+static int map_section(int fd, const cache_header_t *header, const cache_section_t *section, dataset_t *dataset, int first_row, int num_rows) {
+    size_t data_size = (size_t) section->num_images * header->stride * dataset_element_size(header->dtype);
+    size_t mapping_size = data_size + section->num_images * (sizeof(int) + sizeof(dataset->names[0]));
+    char *mapping;
+
+    if(first_row < 0 || num_rows < 0 || (uint32_t) (first_row + num_rows) > section->num_images) {
+        return -1;
+    }
+
+    mapping = mmap(NULL, mapping_size, PROT_READ, MAP_SHARED, fd, section->offset);
+    if(mapping == MAP_FAILED) {
+        return -1;
+    }
+
+    dataset->dtype = header->dtype;
+    dataset->num_images = num_rows;
+    dataset->num_pixels = header->num_pixels;
+    dataset->stride = header->stride;
+    dataset->data = mapping + (size_t) first_row * header->stride * dataset_element_size(header->dtype);
+    dataset->mapping = mapping;
+    dataset->mapping_size = mapping_size;
+    dataset->labels = (int *) malloc((num_rows > 0 ? num_rows : 1) * sizeof(int));
+    dataset->names = malloc((num_rows > 0 ? num_rows : 1) * sizeof(dataset->names[0]));
+
+    if(dataset->labels == NULL || dataset->names == NULL) {
+        dataset_free(dataset);
+        return -1;
+    }
+
+    memcpy(dataset->labels, mapping + data_size + first_row * sizeof(int), num_rows * sizeof(int));
+    memcpy(dataset->names, mapping + data_size + section->num_images * sizeof(int) + first_row * sizeof(dataset->names[0]), num_rows * sizeof(dataset->names[0]));
+
+    return 0;
+}
+
+/**
+ * @brief Mapeia o cache binário do dataset.
+ * 
+ * @param path caminho do arquivo de cache
+ * @param testing contêiner que recebe todas as imagens de teste; NULL para não mapear o teste
+ * @param training contêiner que recebe as imagens de treinamento selecionadas
+ * @param first_row primeira imagem de treinamento a ser usada
+ * @param num_rows número de imagens de treinamento a partir de first_row
+ * @return int 0, se o mapeamento foi bem sucedido; -1, caso contrário
+ */
+int cache_open(const char *path, dataset_t *testing, dataset_t *training, int first_row, int num_rows) {
+    cache_header_t header;
+    int fd, status = 0;
+
+    if((fd = open(path, O_RDONLY)) == -1) {
+        return -1;
+    }
+
+    if(cache_read_header(fd, &header) == -1) {
+        status = -1;
+    } else if(testing != NULL && map_section(fd, &header, &header.testing, testing, 0, header.testing.num_images) == -1) {
+        status = -1;
+    } else if(map_section(fd, &header, &header.training, training, first_row, num_rows) == -1) {
+        if(testing != NULL) {
+            dataset_free(testing);
+        }
+        status = -1;
+    }
+
+    close(fd); //os mapeamentos continuam válidos após o fechamento do arquivo
+    return status;
+}
+
+/**
+ * @brief Conta as linhas não vazias dos arquivos informados.
+ * 
+ * Segue a regra de csv_next_line(): uma linha formada apenas por
+ * caracteres \r é vazia e não é contada, de forma que o total corresponde
+ * ao número de imagens lidas dos arquivos.
+ * 
+ * @param sources nomes dos arquivos
+ * @param num_sources número de arquivos
+ * @return int número total de linhas não vazias; -1, se algum arquivo não pôde ser lido
+ */
+int cache_count_lines(const char *sources[], int num_sources) {
+    char *buffer = (char *) malloc(CACHE_BUFFER_SIZE);
+    size_t length;
+    int num_lines = 0, in_line;
+    FILE *file;
+
+    if(buffer == NULL) {
+        return -1;
+    }
+
+    for(int i = 0; i < num_sources; i++) {
+        if((file = fopen(sources[i], "rb")) == NULL) {
+            free(buffer);
+            return -1;
+        }
+
+        in_line = 0; //a linha atual tem algum caractere além de \r
+        while((length = fread(buffer, 1, CACHE_BUFFER_SIZE, file)) > 0) {
+            for(size_t c = 0; c < length; c++) {
+                if(buffer[c] == '\n') {
+                    num_lines += in_line;
+                    in_line = 0;
+                } else if(buffer[c] != '\r') {
+                    in_line = 1;
+                }
+            }
+        }
+
+        num_lines += in_line; //última linha sem quebra de linha
+
+        fclose(file);
+    }
+
+    free(buffer);
+    return num_lines;
+}
@@ -0,0 +1,79 @@
+#ifndef CACHE_H__
+#define CACHE_H__
+
+/**
+ * @file cache.h
+ * @brief Interface do cache binário do dataset.
+ * 
+ * O cache armazena as imagens de teste e de treinamento já convertidas,
+ * precedidas por um cabeçalho versionado com as dimensões, o tipo dos
+ * pixels e a soma de verificação dos arquivos .csv de origem. Na leitura,
+ * as matrizes são mapeadas em memória (mmap) sem nenhuma conversão.
+ * 
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "dataset.h"
+
+/** Identificação do arquivo de cache **/
+#define CACHE_MAGIC "TEC508DS"
+
+/** Versão do formato do arquivo de cache **/
+#define CACHE_VERSION 1
+
+/** Número máximo de arquivos de origem registrados no cabeçalho **/
+#define CACHE_MAX_SOURCES 8
+
+/** Tamanho e data de modificação de um arquivo de origem **/
+typedef struct cache_source {
+    uint64_t size;
+    int64_t mtime;
+} cache_source_t;
+
+/** Posição e tamanho de um conjunto de imagens no arquivo **/
+typedef struct cache_section {
+    uint64_t offset;        /* início da matriz, alinhado em página */
+    uint32_t num_images;    /* número de linhas */
+    uint32_t reserved;
+} cache_section_t;
+
+/** Cabeçalho do arquivo de cache **/
+typedef struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;                             /* tipo de armazenamento dos pixels (DATASET_*) */
+    uint32_t num_pixels;
+    uint32_t stride;
+    uint32_t num_sources;
+    uint32_t reserved;
+    uint64_t checksum;                          /* FNV-1a do conteúdo dos arquivos de origem */
+    cache_source_t sources[CACHE_MAX_SOURCES];
+    cache_section_t testing;
+    cache_section_t training;
+} cache_header_t;
+
+/** Seções do cache gravadas por cache_writer_put() **/
+#define CACHE_SECTION_TESTING 0
+#define CACHE_SECTION_TRAINING 1
+
+/** Gravação incremental do cache, em blocos de linhas **/
+typedef struct cache_writer {
+    FILE *file;
+    const char *path;
+    char temp_path[400];
+    size_t row_size;        /* bytes de uma linha da matriz */
+    cache_header_t header;
+} cache_writer_t;
+
+extern int cache_read_header(int fd, cache_header_t *header); /* lê e confere o cabeçalho */
+extern int cache_validate(const char *path, const char *sources[], int num_sources, int num_pixels, int dtype); /* verifica se o cache está atualizado */
+extern int cache_writer_open(cache_writer_t *writer, const char *path, const char *sources[], int num_sources, const dataset_t *layout, int num_images_testing, int num_images_training); /* cria o cache para gravação em blocos */
+extern int cache_writer_put(cache_writer_t *writer, int section, int first_row, const dataset_t *rows, int num_rows); /* grava um bloco de linhas */
+extern int cache_writer_close(cache_writer_t *writer); /* conclui a gravação do cache */
+extern void cache_writer_abort(cache_writer_t *writer); /* descarta a gravação do cache */
+extern int cache_open(const char *path, dataset_t *testing, dataset_t *training, int first_row, int num_rows); /* mapeia o cache */
+extern int cache_count_lines(const char *sources[], int num_sources);  /* conta as linhas não vazias dos arquivos */
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef CHECKPOINT_H__
+#define CHECKPOINT_H__
+
+/**
+ * @file checkpoint.h
+ * @brief Interface dos checkpoints do treinamento.
+ * 
+ * Um checkpoint contém tudo o que é necessário para continuar um
+ * treinamento exatamente de onde ele parou: o vetor de pesos, o número de
+ * épocas concluídas, a velocidade do momento, o estado do gerador usado no
+ * embaralhamento e a ordem das imagens de cada processo, o estado da
+ * parada antecipada, o tempo de treinamento decorrido e o tamanho dos
+ * arquivos de saída no momento da gravação. O arquivo é gravado com um nome temporário e renomeado, de
+ * forma que uma interrupção durante a gravação preserva o checkpoint anterior.
+ * 
+ * Layout do arquivo: cabeçalho, pesos, velocidade (se has_velocity),
+ * pesos da melhor época de validação (se has_best_weights), estados do
+ * gerador (num_seeds) e ordens das imagens (num_images).
+ * 
+ */
+
+#include <stdint.h>
+
+/** Identificação do arquivo de checkpoint **/
+#define CHECKPOINT_MAGIC "TEC508CK"
+
+/** Versão do formato; incrementada a cada mudança de layout **/
+#define CHECKPOINT_VERSION 2
+
+/** Número de arquivos de saída cujo tamanho é registrado **/
+#define CHECKPOINT_NUM_OUTPUTS 8
+
+/** Tamanho do nome da execução, que identifica os arquivos de log **/
+#define CHECKPOINT_RUN_NAME_SIZE 32
+
+/** Cabeçalho do arquivo de checkpoint **/
+typedef struct checkpoint_header {
+    char magic[8];                  /* CHECKPOINT_MAGIC, sem o terminador */
+    uint32_t version;               /* CHECKPOINT_VERSION */
+    uint32_t num_weights;           /* tamanho do vetor de pesos */
+    uint32_t num_images;            /* soma do número de imagens de treinamento dos processos */
+    uint32_t num_seeds;             /* número de processos */
+    uint32_t has_velocity;          /* 1, se a velocidade do momento foi gravada */
+    uint32_t num_epochs;            /* épocas concluídas */
+    int32_t batch_size;             /* imagens por mini-lote; 0 para o lote completo */
+    int32_t nesterov;               /* 1 para o momento de Nesterov */
+    float learning_rate;            /* taxa de aprendizado */
+    float momentum;                 /* coeficiente do momento */
+    double elapsed;                 /* tempo de treinamento decorrido, em segundos */
+    double best_cost;               /* menor custo de validação */
+    double best_f1;                 /* F1 de validação da época de menor custo */
+    float validation_fraction;      /* fração das imagens de treinamento usada na validação */
+    int32_t best_epoch;             /* época de menor custo de validação, ou 0 */
+    int32_t num_bad_epochs;         /* épocas consecutivas sem melhora da validação */
+    uint32_t has_best_weights;      /* 1, se os pesos da melhor época de validação foram gravados */
+    uint64_t offsets[CHECKPOINT_NUM_OUTPUTS]; /* tamanho dos arquivos de saída, em bytes */
+    char run_name[CHECKPOINT_RUN_NAME_SIZE];  /* nome da execução (data e hora de início) */
+    uint64_t checksum;              /* FNV-1a do conteúdo após o cabeçalho */
+} checkpoint_header_t;
+
+/** Estado do treinamento gravado em um checkpoint **/
+typedef struct checkpoint {
+    int num_weights;
+    int num_images;
+    int num_seeds;
+    int num_epochs;
+    int batch_size;
+    int nesterov;
+    float learning_rate;
+    float momentum;
+    double elapsed;
+    float validation_fraction;
+    int best_epoch;
+    int num_bad_epochs;
+    double best_cost;
+    double best_f1;
+    long offsets[CHECKPOINT_NUM_OUTPUTS];
+    char run_name[CHECKPOINT_RUN_NAME_SIZE];
+    float *weights;                 /* num_weights pesos */
+    float *velocity;                /* num_weights velocidades, ou NULL sem momento */
+    float *best_weights;            /* pesos da melhor época de validação, ou NULL sem validação */
+    unsigned int *seeds;            /* estado do gerador de cada processo */
+    int *order;                     /* ordem das imagens de cada processo, concatenadas */
+} checkpoint_t;
+
+extern int checkpoint_save(const char *path, const checkpoint_t *checkpoint); /* grava o checkpoint */
+extern int checkpoint_load(const char *path, checkpoint_t *checkpoint);       /* carrega o checkpoint */
+extern void checkpoint_free(checkpoint_t *checkpoint);                        /* libera os vetores carregados */
+
+#endif
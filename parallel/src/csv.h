@@ -1,14 +1,53 @@
 #ifndef CSV_H__
 #define CSV_H__
 
-/* Copyright (C) 1999 Lucent Technologies */
-/* Excerpted from 'The Practice of Programming' */
-/* by Brian W. Kernighan and Rob Pike */
+/**
+ * @file csv.h
+ * @brief Interface da biblioteca de leitura dos arquivos .csv de entrada.
+ * 
+ * Os arquivos são mapeados em memória e divididos em blocos que terminam
+ * em fim de linha, de forma que cada bloco possa ser processado por uma
+ * thread diferente. Nenhuma função mantém estado global.
+ * 
+ */
 
-/* csv.h: interface for csv library */
+#include <stddef.h>
+#include <stdint.h>
 
-extern char *csvgetline(FILE *f, char delim, int compress); /* read next input line */
-extern char *csvfield(int n);	  /* return field n */
-extern int csvnfield(void);		  /* return number of fields */
+/** Tamanho aproximado, em bytes, de cada bloco de um arquivo **/
+#define CSV_CHUNK_SIZE (1 << 20)
+
+/** Bloco de linhas completas de um arquivo **/
+typedef struct csv_chunk {
+    const char *begin;      /* primeiro caractere do bloco */
+    const char *end;        /* caractere seguinte ao último do bloco */
+    int num_lines;          /* número de linhas não vazias, obtido por csv_count_lines() */
+    int first_line;         /* índice da primeira linha do bloco, atribuído pelo chamador */
+} csv_chunk_t;
+
+/** Arquivo .csv mapeado em memória **/
+typedef struct csv_file {
+    const char *data;       /* conteúdo do arquivo */
+    size_t size;            /* tamanho do arquivo, em bytes */
+    csv_chunk_t *chunks;    /* blocos do arquivo */
+    int num_chunks;         /* número de blocos */
+} csv_file_t;
+
+/** Campos de uma linha: nome da imagem, label e pixels **/
+typedef struct csv_record {
+    const char *name;       /* início do nome da imagem (não terminado em '\0') */
+    int name_length;        /* tamanho do nome da imagem */
+    int label;              /* label convertida para inteiro */
+    const char *pixels;     /* início do campo de pixels */
+    const char *pixels_end; /* fim do campo de pixels */
+} csv_record_t;
+
+extern int csv_open(const char *path, csv_file_t *file, size_t chunk_size);   /* mapeia o arquivo e o divide em blocos */
+extern void csv_close(csv_file_t *file);                                     /* desfaz o mapeamento */
+extern int csv_count_lines(const csv_chunk_t *chunk);                        /* conta as linhas não vazias de um bloco */
+extern const char *csv_next_line(const char *p, const char *end, const char **line_end, const char **next); /* obtém a próxima linha não vazia */
+extern int csv_parse_record(const char *line, const char *line_end, csv_record_t *record); /* separa os campos de uma linha */
+extern int csv_decode_pixels(const char *p, const char *end, float *row, int num_pixels, float normalization); /* converte os pixels */
+extern int csv_decode_pixels_u8(const char *p, const char *end, uint8_t *row, int num_pixels); /* converte os pixels para uint8 */
 
 #endif
@@ -0,0 +1,207 @@
+/**
+ * @file dtype_report.c
+ * @brief Comparação da acurácia e do custo entre os armazenamentos dos pixels.
+ * 
+ * Treina o modelo com as imagens dos arquivos de entrada armazenadas em
+ * cada tipo (float32, uint8, float16 e bfloat16), a partir dos mesmos pesos
+ * iniciais e com as mesmas épocas de lote completo, e gera na saída padrão
+ * uma linha CSV por época com o custo, a acurácia e o F1 de treinamento,
+ * a diferença de cada um em relação ao float32 e o tempo da época. Ao
+ * final de cada tipo, uma linha com fase "test" registra as mesmas
+ * métricas sobre as imagens de teste.
+ * 
+ * Os kernels sempre acumulam em float, de forma que as diferenças medem
+ * apenas o arredondamento dos pixels armazenados.
+ * 
+ * As funções de main.c são usadas diretamente: o arquivo é compilado com
+ * a função main renomeada (ver o alvo dtype-report do Makefile).
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdio **/
+#include <stdio.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca OPENMP **/
+#include <omp.h>
+
+/** Inclusão do arquivo de cabeçalho do contêiner de dados **/
+#include "dataset.h"
+
+/** Inclusão do arquivo de cabeçalho dos kernels vetoriais **/
+#include "kernels.h"
+
+/** Inclusão do arquivo de cabeçalho das opções de linha de comando **/
+#include "options.h"
+
+/** Inclusão do arquivo de cabeçalho do otimizador **/
+#include "optimizer.h"
+
+/** Inclusão do arquivo de cabeçalho do posicionamento nos nós NUMA **/
+#include "topology.h"
+
+/** Inclusão do arquivo de cabeçalho com as constantes e as funções de main.c **/
+#include "main.h"
+
+/** Custo, acurácia e F1 de uma época **/
+typedef struct report_row {
+    double cost;
+    double accuracy;
+    double f1;
+} report_row_t;
+
+/**
+ * @brief Calcula o custo médio, a acurácia e o F1 a partir das métricas acumuladas.
+ * 
+ * @param metrics matriz de confusão e custo total, indexados por METRIC_*
+ * @param num_images número de imagens
+ * @return report_row_t métricas da época
+ */
+static report_row_t summarize(const double metrics[NUM_METRICS], int num_images) {
+    double true_positive = metrics[METRIC_TRUE_POSITIVE], true_negative = metrics[METRIC_TRUE_NEGATIVE];
+    double false_positive = metrics[METRIC_FALSE_POSITIVE], false_negative = metrics[METRIC_FALSE_NEGATIVE];
+    report_row_t row;
+
+    row.cost = metrics[METRIC_COST] / num_images;
+    row.accuracy = (true_positive + true_negative) / num_images;
+    row.f1 = true_positive > 0 ? 2 * true_positive / (2 * true_positive + false_positive + false_negative) : 0;
+
+    return row;
+}
+
+/**
+ * @brief Grava uma linha do relatório.
+ * 
+ * @param dtype tipo de armazenamento
+ * @param phase "train" ou "test"
+ * @param epoch número da época (1 em diante), ou o número de épocas na fase "test"
+ * @param row métricas do tipo de armazenamento
+ * @param baseline métricas do float32 na mesma época
+ * @param time tempo da época ou da classificação, em segundos
+ * @param memory tamanho da matriz, em MB
+ */
+static void print_row(int dtype, const char *phase, int epoch, const report_row_t *row, const report_row_t *baseline, double time, double memory) {
+    printf("%s,%s,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.2f\n", dataset_dtype_name(dtype), phase, epoch,
+        row->cost, row->accuracy, row->f1, row->cost - baseline->cost, row->accuracy - baseline->accuracy, row->f1 - baseline->f1, time, memory);
+}
+
+/**
+ * @brief Função principal da comparação entre os armazenamentos.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv opções:
+ * --epochs=n número de épocas (padrão 30)
+ * --lr=x taxa de aprendizado (padrão 0.01)
+ * --images=n número de imagens de treinamento, incluindo o bias (padrão 4272)
+ * --threads=n número de threads (padrão: o do OpenMP)
+ * --isa=nome conjunto de instruções dos kernels (padrão: detecção automática)
+ * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
+ */
+int main(int argc, char *argv[]) {
+    int num_epochs = option_get_int(argc, argv, "epochs", 30);
+    float learning_rate = option_get_float(argc, argv, "lr", 0.01f);
+    int num_images_training = option_get_int(argc, argv, "images", 4272);
+    int num_threads = option_get_int(argc, argv, "threads", omp_get_max_threads());
+    float *initial_weights, *weights, *gradients;
+    report_row_t *baseline;
+
+    if(num_epochs < 1 || num_images_training < 2 || num_threads < 1) {
+        fprintf(stderr, "Parâmetros inválidos!\n");
+        return -1;
+    }
+
+    if(kernels_init(option_get(argc, argv, "isa")) == -1) {
+        fprintf(stderr, "Conjunto de instruções não suportado: %s\n", option_get(argc, argv, "isa"));
+        return -1;
+    }
+
+    omp_set_num_threads(num_threads);
+
+    initial_weights = (float *) malloc(NUM_PIXELS * sizeof(float));
+    weights = (float *) malloc(NUM_PIXELS * sizeof(float));
+    gradients = (float *) malloc(NUM_PIXELS * sizeof(float));
+    baseline = (report_row_t *) malloc((num_epochs + 1) * sizeof(report_row_t));
+
+    if(initial_weights == NULL || weights == NULL || gradients == NULL || baseline == NULL) {
+        fprintf(stderr, "Não foi possível alocar memória para os dados!\n");
+        return -1;
+    }
+
+    initialize_weights(initial_weights, num_images_training);
+
+    printf("dtype,phase,epoch,cost,accuracy,f1,cost_diff,accuracy_diff,f1_diff,time_s,memory_mb\n");
+
+    /* o float32 é o primeiro tipo, e as diferenças dos demais são calculadas em relação a ele */
+    for(int dtype = DATASET_FLOAT32; dtype < DATASET_NUM_DTYPES; dtype++) {
+        dataset_t testing, training;
+        optimizer_t optimizer;
+        double metrics[NUM_METRICS];
+        double time_begin;
+        report_row_t row;
+
+        if(dataset_alloc(&testing, NUM_IMAGES_TESTING, NUM_PIXELS, dtype) == -1 || dataset_alloc(&training, num_images_training, NUM_PIXELS, dtype) == -1) {
+            fprintf(stderr, "Não foi possível alocar memória para os dados!\n");
+            return -1;
+        }
+
+        if(read_data_and_labels(stderr, &testing, &training) == -1 || optimizer_init(&optimizer, NUM_PIXELS, learning_rate, 0, 0, 0, 1) == -1) {
+            return -1;
+        }
+
+        memcpy(weights, initial_weights, NUM_PIXELS * sizeof(float));
+
+        for(int epoch = 0; epoch < num_epochs; epoch++) {
+            time_begin = omp_get_wtime();
+
+            #pragma omp parallel
+            train_epoch(&training, weights, &optimizer, gradients, metrics, NULL);
+
+            row = summarize(metrics, training.num_images);
+            if(dtype == DATASET_FLOAT32) {
+                baseline[epoch] = row;
+            }
+
+            print_row(dtype, "train", epoch + 1, &row, &baseline[epoch], omp_get_wtime() - time_begin, dataset_size(&training) / 1048576.0);
+        }
+
+        /* classifica as imagens de teste com os pesos finais */
+        memset(metrics, 0, sizeof(metrics));
+        time_begin = omp_get_wtime();
+
+        #pragma omp parallel for schedule(static) reduction(+:metrics[:NUM_METRICS])
+        for(int r = 0; r < testing.num_images; r++) {
+            accumulate_metrics(metrics, hypothesis_function(&testing, r, weights), testing.labels[r]);
+        }
+
+        row = summarize(metrics, testing.num_images);
+        if(dtype == DATASET_FLOAT32) {
+            baseline[num_epochs] = row;
+        }
+
+        print_row(dtype, "test", num_epochs, &row, &baseline[num_epochs], omp_get_wtime() - time_begin, dataset_size(&testing) / 1048576.0);
+        fflush(stdout);
+
+        optimizer_free(&optimizer);
+        dataset_free(&testing);
+        dataset_free(&training);
+    }
+
+    free(initial_weights);
+    free(weights);
+    free(gradients);
+    free(baseline);
+
+    return 0;
+}
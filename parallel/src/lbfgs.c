@@ -0,0 +1,384 @@
+/**
+ * @file lbfgs.c
+ * @brief Otimizador L-BFGS com busca em linha de Wolfe.
+ * 
+ * Esse arquivo contém a recursão de dois laços que calcula a direção de
+ * busca a partir do histórico de pares (s, y) e a busca em linha que
+ * satisfaz as condições fortes de Wolfe, com a expansão do intervalo e o
+ * refinamento por interpolação cúbica descritos em Nocedal e Wright,
+ * Numerical Optimization, algoritmos 3.5 e 3.6.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca math **/
+#include <math.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+#include "lbfgs.h"
+
+/** Ponto da busca em linha: passo, custo e derivada direcional **/
+typedef struct line_point {
+    double step;
+    double cost;
+    double slope;
+} line_point_t;
+
+/**
+ * @brief Calcula o produto escalar de dois vetores, acumulado em double.
+ * 
+ * @param a primeiro vetor
+ * @param b segundo vetor
+ * @param n tamanho dos vetores
+ * @return double produto escalar
+ */
+static double dot(const float *a, const float *b, int n) {
+    double sum = 0;
+
+    for(int c = 0; c < n; c++) {
+        sum += (double) a[c] * b[c];
+    }
+
+    return sum;
+}
+
+/**
+ * @brief Inicializa o otimizador.
+ * 
+ * @param lbfgs otimizador a ser inicializado
+ * @param num_weights tamanho do vetor de pesos
+ * @param history número máximo de pares (s, y) armazenados
+ * @param evaluate função que calcula o custo e o gradiente
+ * @param context contexto passado à função de custo
+ * @return int 0, se a inicialização foi bem sucedida; -1, caso contrário
+ */
+int lbfgs_init(lbfgs_t *lbfgs, int num_weights, int history, lbfgs_evaluate_t evaluate, void *context) {
+    memset(lbfgs, 0, sizeof(lbfgs_t));
+    lbfgs->num_weights = num_weights;
+    lbfgs->history = history;
+    lbfgs->evaluate = evaluate;
+    lbfgs->context = context;
+
+    if(history < 1) {
+        return -1;
+    }
+
+    lbfgs->s = (float *) malloc((size_t) history * num_weights * sizeof(float));
+    lbfgs->y = (float *) malloc((size_t) history * num_weights * sizeof(float));
+    lbfgs->rho = (double *) malloc(history * sizeof(double));
+    lbfgs->alpha = (double *) malloc(history * sizeof(double));
+    lbfgs->direction = (float *) malloc(num_weights * sizeof(float));
+    lbfgs->trial_weights = (float *) malloc(num_weights * sizeof(float));
+    lbfgs->trial_gradients = (float *) malloc(num_weights * sizeof(float));
+
+    if(lbfgs->s == NULL || lbfgs->y == NULL || lbfgs->rho == NULL || lbfgs->alpha == NULL || lbfgs->direction == NULL
+        || lbfgs->trial_weights == NULL || lbfgs->trial_gradients == NULL) {
+        lbfgs_free(lbfgs);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Avalia os pesos iniciais.
+ * 
+ * Deve ser chamada antes da primeira iteração e conta como uma avaliação.
+ * 
+ * @param lbfgs otimizador
+ * @param weights vetor de pesos iniciais
+ * @param gradients vetor que recebe o gradiente nos pesos iniciais
+ */
+void lbfgs_start(lbfgs_t *lbfgs, const float *weights, float *gradients) {
+    lbfgs->cost = lbfgs->evaluate(lbfgs->context, weights, gradients);
+    lbfgs->num_pairs = 0;
+    lbfgs->newest = lbfgs->history - 1;
+    lbfgs->step = 0;
+    lbfgs->num_evaluations = 1;
+    lbfgs->total_evaluations = 1;
+}
+
+/**
+ * @brief Calcula a direção de busca pela recursão de dois laços.
+ * 
+ * A aproximação inicial da inversa da hessiana é a identidade multiplicada
+ * por s . y / y . y do par mais recente.
+ * 
+ * @param lbfgs otimizador
+ * @param gradients gradiente nos pesos atuais
+ */
+static void compute_direction(lbfgs_t *lbfgs, const float *gradients) {
+    int n = lbfgs->num_weights;
+    float *q = lbfgs->direction;
+
+    memcpy(q, gradients, n * sizeof(float));
+
+    /* do par mais recente para o mais antigo */
+    for(int k = 0; k < lbfgs->num_pairs; k++) {
+        int i = (lbfgs->newest - k + lbfgs->history) % lbfgs->history;
+        const float *s = lbfgs->s + (size_t) i * n, *y = lbfgs->y + (size_t) i * n;
+        float alpha;
+
+        lbfgs->alpha[i] = lbfgs->rho[i] * dot(s, q, n);
+        alpha = lbfgs->alpha[i];
+
+        for(int c = 0; c < n; c++) {
+            q[c] -= alpha * y[c];
+        }
+    }
+
+    if(lbfgs->num_pairs > 0) {
+        const float *s = lbfgs->s + (size_t) lbfgs->newest * n, *y = lbfgs->y + (size_t) lbfgs->newest * n;
+        float gamma = dot(s, y, n) / dot(y, y, n);
+
+        for(int c = 0; c < n; c++) {
+            q[c] *= gamma;
+        }
+    }
+
+    /* do par mais antigo para o mais recente */
+    for(int k = lbfgs->num_pairs - 1; k >= 0; k--) {
+        int i = (lbfgs->newest - k + lbfgs->history) % lbfgs->history;
+        const float *s = lbfgs->s + (size_t) i * n, *y = lbfgs->y + (size_t) i * n;
+        float coefficient = lbfgs->alpha[i] - lbfgs->rho[i] * dot(y, q, n);
+
+        for(int c = 0; c < n; c++) {
+            q[c] += coefficient * s[c];
+        }
+    }
+
+    for(int c = 0; c < n; c++) {
+        q[c] = -q[c];
+    }
+}
+
+/**
+ * @brief Avalia o custo e o gradiente em um passo ao longo da direção de busca.
+ * 
+ * @param lbfgs otimizador
+ * @param weights pesos atuais
+ * @param step tamanho do passo
+ * @return line_point_t passo, custo e derivada direcional no ponto avaliado
+ */
+static line_point_t evaluate_step(lbfgs_t *lbfgs, const float *weights, double step) {
+    line_point_t point = { step, 0, 0 };
+
+    for(int c = 0; c < lbfgs->num_weights; c++) {
+        lbfgs->trial_weights[c] = weights[c] + (float) step * lbfgs->direction[c];
+    }
+
+    point.cost = lbfgs->evaluate(lbfgs->context, lbfgs->trial_weights, lbfgs->trial_gradients);
+    point.slope = dot(lbfgs->trial_gradients, lbfgs->direction, lbfgs->num_weights);
+    lbfgs->num_evaluations++;
+
+    return point;
+}
+
+/**
+ * @brief Escolhe um passo entre dois pontos pelo mínimo da interpolação cúbica.
+ * 
+ * Se o mínimo não é finito ou está a menos de 10% do intervalo de uma das
+ * extremidades (por exemplo, quando o custo em um dos pontos é infinito),
+ * usa o ponto médio.
+ * 
+ * @param lo ponto com o menor custo que satisfaz o decréscimo suficiente
+ * @param hi outra extremidade do intervalo
+ * @return double passo escolhido
+ */
+static double interpolate(const line_point_t *lo, const line_point_t *hi) {
+    double d1 = lo->slope + hi->slope - 3 * (lo->cost - hi->cost) / (lo->step - hi->step);
+    double d2 = (hi->step > lo->step ? 1 : -1) * sqrt(d1 * d1 - lo->slope * hi->slope);
+    double step = hi->step - (hi->step - lo->step) * (hi->slope + d2 - d1) / (hi->slope - lo->slope + 2 * d2);
+    double low = fmin(lo->step, hi->step), high = fmax(lo->step, hi->step), margin = 0.1 * (high - low);
+
+    if(!(step >= low + margin && step <= high - margin)) {
+        step = 0.5 * (lo->step + hi->step);
+    }
+
+    return step;
+}
+
+/**
+ * @brief Refina o intervalo que contém um passo que satisfaz as condições fortes de Wolfe.
+ * 
+ * @param lbfgs otimizador
+ * @param weights pesos atuais
+ * @param origin ponto de passo zero
+ * @param lo extremidade com o menor custo que satisfaz o decréscimo suficiente
+ * @param hi outra extremidade
+ * @return int 0, se um passo foi aceito (o último avaliado); -1, caso contrário
+ */
+static int zoom(lbfgs_t *lbfgs, const float *weights, const line_point_t *origin, line_point_t lo, line_point_t hi) {
+    while(lbfgs->num_evaluations < LBFGS_MAX_EVALUATIONS) {
+        line_point_t point = evaluate_step(lbfgs, weights, interpolate(&lo, &hi));
+
+        if(!(point.cost <= origin->cost + LBFGS_C1 * point.step * origin->slope) || point.cost >= lo.cost) {
+            hi = point;
+        } else {
+            if(fabs(point.slope) <= -LBFGS_C2 * origin->slope) {
+                lbfgs->step = point.step;
+                lbfgs->cost = point.cost;
+                return 0;
+            }
+
+            if(point.slope * (hi.step - lo.step) >= 0) {
+                hi = lo;
+            }
+
+            lo = point;
+        }
+    }
+
+    /* sem a condição de curvatura, aceita o menor custo encontrado, se houver decréscimo */
+    if(lo.step > 0) {
+        evaluate_step(lbfgs, weights, lo.step);
+        lbfgs->step = lo.step;
+        lbfgs->cost = lo.cost;
+        return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Busca um passo que satisfaça as condições fortes de Wolfe.
+ * 
+ * O passo inicial é expandido até que o intervalo entre o passo anterior
+ * e o atual contenha um passo aceitável, que é então refinado por zoom().
+ * Um custo infinito ou indefinido é tratado como uma violação do
+ * decréscimo suficiente.
+ * 
+ * @param lbfgs otimizador
+ * @param weights pesos atuais
+ * @param slope derivada direcional nos pesos atuais (negativa)
+ * @param initial_step passo inicial
+ * @return int 0, se um passo foi aceito (o último avaliado); -1, caso contrário
+ */
+static int line_search(lbfgs_t *lbfgs, const float *weights, double slope, double initial_step) {
+    line_point_t origin = { 0, lbfgs->cost, slope }, previous = origin;
+    double step = initial_step;
+
+    while(lbfgs->num_evaluations < LBFGS_MAX_EVALUATIONS) {
+        line_point_t point = evaluate_step(lbfgs, weights, step);
+
+        if(!(point.cost <= origin.cost + LBFGS_C1 * step * origin.slope) || (previous.step > 0 && point.cost >= previous.cost)) {
+            return zoom(lbfgs, weights, &origin, previous, point);
+        }
+
+        if(fabs(point.slope) <= -LBFGS_C2 * origin.slope) {
+            lbfgs->step = step;
+            lbfgs->cost = point.cost;
+            return 0;
+        }
+
+        if(point.slope >= 0) {
+            return zoom(lbfgs, weights, &origin, point, previous);
+        }
+
+        previous = point;
+        step *= 2;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Faz uma iteração do L-BFGS.
+ * 
+ * Calcula a direção de busca, escolhe o passo pela busca em linha,
+ * atualiza os pesos e o gradiente e armazena o novo par (s, y), que
+ * substitui o mais antigo quando o histórico está cheio. Se a direção não
+ * é de descida, o histórico é descartado e a iteração usa o gradiente. Na
+ * primeira iteração, o passo inicial tem comprimento 1.
+ * 
+ * @param lbfgs otimizador iniciado por lbfgs_start()
+ * @param weights vetor de pesos, atualizado
+ * @param gradients gradiente nos pesos, atualizado
+ * @return int 0, se os pesos foram atualizados; -1, se a busca em linha não encontrou um passo (pesos inalterados)
+ */
+int lbfgs_iterate(lbfgs_t *lbfgs, float *weights, float *gradients) {
+    int n = lbfgs->num_weights;
+    int next = (lbfgs->newest + 1) % lbfgs->history;
+    float *s = lbfgs->s + (size_t) next * n, *y = lbfgs->y + (size_t) next * n;
+    double slope, initial_step = 1, curvature;
+
+    lbfgs->num_evaluations = 0;
+
+    compute_direction(lbfgs, gradients);
+    slope = dot(gradients, lbfgs->direction, n);
+
+    if(!(slope < 0)) {
+        lbfgs->num_pairs = 0;
+        compute_direction(lbfgs, gradients);
+        slope = dot(gradients, lbfgs->direction, n);
+    }
+
+    if(lbfgs->num_pairs == 0) {
+        initial_step = 1 / sqrt(-slope);
+    }
+
+    if(line_search(lbfgs, weights, slope, initial_step) == -1) {
+        lbfgs->total_evaluations += lbfgs->num_evaluations;
+        return -1;
+    }
+
+    lbfgs->total_evaluations += lbfgs->num_evaluations;
+
+    for(int c = 0; c < n; c++) {
+        s[c] = lbfgs->trial_weights[c] - weights[c];
+        y[c] = lbfgs->trial_gradients[c] - gradients[c];
+    }
+
+    /* o par só é armazenado com curvatura positiva; com o histórico cheio, a posição era a do par mais antigo */
+    if((curvature = dot(s, y, n)) > 0) {
+        lbfgs->rho[next] = 1 / curvature;
+        lbfgs->newest = next;
+        lbfgs->num_pairs += lbfgs->num_pairs < lbfgs->history;
+    } else if(lbfgs->num_pairs == lbfgs->history) {
+        lbfgs->num_pairs--;
+    }
+
+    memcpy(weights, lbfgs->trial_weights, n * sizeof(float));
+    memcpy(gradients, lbfgs->trial_gradients, n * sizeof(float));
+
+    return 0;
+}
+
+/**
+ * @brief Calcula a norma euclidiana do gradiente.
+ * 
+ * @param lbfgs otimizador
+ * @param gradients vetor gradiente
+ * @return double norma do gradiente
+ */
+double lbfgs_gradient_norm(const lbfgs_t *lbfgs, const float *gradients) {
+    return sqrt(dot(gradients, gradients, lbfgs->num_weights));
+}
+
+/**
+ * @brief Libera o histórico e os vetores do otimizador.
+ * 
+ * @param lbfgs otimizador
+ */
+void lbfgs_free(lbfgs_t *lbfgs) {
+    free(lbfgs->s);
+    free(lbfgs->y);
+    free(lbfgs->rho);
+    free(lbfgs->alpha);
+    free(lbfgs->direction);
+    free(lbfgs->trial_weights);
+    free(lbfgs->trial_gradients);
+    lbfgs->s = lbfgs->y = lbfgs->direction = lbfgs->trial_weights = lbfgs->trial_gradients = NULL;
+    lbfgs->rho = lbfgs->alpha = NULL;
+}
@@ -0,0 +1,75 @@
+#ifndef LBFGS_H__
+#define LBFGS_H__
+
+/**
+ * @file lbfgs.h
+ * @brief Interface do otimizador L-BFGS com busca em linha de Wolfe.
+ * 
+ * O L-BFGS aproxima a inversa da hessiana a partir dos últimos m pares
+ * (s, y), em que s é o deslocamento dos pesos e y a variação do gradiente
+ * em uma iteração, e calcula a direção de busca pela recursão de dois
+ * laços. O tamanho do passo ao longo da direção é escolhido por uma busca
+ * em linha que satisfaz as condições fortes de Wolfe (decréscimo
+ * suficiente e curvatura), o que garante y . s > 0 e mantém a aproximação
+ * definida positiva.
+ * 
+ * O custo e o gradiente são calculados por uma função fornecida pelo
+ * chamador, sobre o lote completo; cada iteração faz uma ou mais
+ * avaliações, e a última avaliação de uma iteração bem sucedida é sempre
+ * a dos pesos aceitos.
+ * 
+ */
+
+/** Número padrão de pares (s, y) armazenados **/
+#define LBFGS_DEFAULT_HISTORY 10
+
+/** Número máximo de avaliações da função de custo em uma busca em linha **/
+#define LBFGS_MAX_EVALUATIONS 20
+
+/** Constante da condição de decréscimo suficiente (Armijo) **/
+#define LBFGS_C1 1e-4
+
+/** Constante da condição forte de curvatura **/
+#define LBFGS_C2 0.9
+
+/** Norma do gradiente abaixo da qual o mínimo é considerado atingido **/
+#define LBFGS_GRADIENT_TOLERANCE 1e-6
+
+/**
+ * @brief Função que calcula o custo médio e o gradiente médio em um vetor de pesos.
+ * 
+ * @param context contexto do chamador
+ * @param weights vetor de pesos
+ * @param gradients vetor que recebe o gradiente
+ * @return double custo
+ */
+typedef double (*lbfgs_evaluate_t)(void *context, const float *weights, float *gradients);
+
+/** Estado do otimizador L-BFGS **/
+typedef struct lbfgs {
+    int num_weights;                /* tamanho do vetor de pesos */
+    int history;                    /* número máximo de pares (m) */
+    int num_pairs;                  /* número de pares armazenados */
+    int newest;                     /* posição do par mais recente */
+    float *s;                       /* deslocamentos dos pesos, history x num_weights */
+    float *y;                       /* variações do gradiente, history x num_weights */
+    double *rho;                    /* 1 / (y . s) de cada par */
+    double *alpha;                  /* coeficientes do primeiro laço da recursão */
+    float *direction;               /* direção de busca */
+    float *trial_weights;           /* pesos avaliados na busca em linha */
+    float *trial_gradients;         /* gradiente nos pesos avaliados */
+    double cost;                    /* custo nos pesos atuais */
+    double step;                    /* passo aceito na última iteração */
+    int num_evaluations;            /* avaliações da última iteração */
+    int total_evaluations;          /* avaliações desde lbfgs_start() */
+    lbfgs_evaluate_t evaluate;      /* função de custo */
+    void *context;                  /* contexto da função de custo */
+} lbfgs_t;
+
+extern int lbfgs_init(lbfgs_t *lbfgs, int num_weights, int history, lbfgs_evaluate_t evaluate, void *context); /* aloca o histórico */
+extern void lbfgs_start(lbfgs_t *lbfgs, const float *weights, float *gradients);                            /* avalia os pesos iniciais */
+extern int lbfgs_iterate(lbfgs_t *lbfgs, float *weights, float *gradients);                                 /* faz uma iteração */
+extern double lbfgs_gradient_norm(const lbfgs_t *lbfgs, const float *gradients);                            /* norma euclidiana do gradiente */
+extern void lbfgs_free(lbfgs_t *lbfgs);                                                                     /* libera o histórico */
+
+#endif
@@ -36,42 +36,213 @@
 /** Inclusão da biblioteca time **/
 #include <time.h>
 
+/** Inclusão da biblioteca unistd, para o truncate() **/
+#include <unistd.h>
+
 /** Inclusão da biblioteca OPENMP **/
 #include <omp.h>
 
-/** Inclusão do arquivo de cabeçalho responsável pela leitura do arquivo de entrada **/
+/** Inclusão do arquivo de cabeçalho responsável pela leitura dos arquivos de entrada **/
 #include "csv.h"
 
+/** Inclusão do arquivo de cabeçalho do contêiner de dados **/
+#include "dataset.h"
+
+/** Inclusão do arquivo de cabeçalho dos kernels vetoriais **/
+#include "kernels.h"
+
+/** Inclusão do arquivo de cabeçalho das opções de linha de comando **/
+#include "options.h"
+
+/** Inclusão do arquivo de cabeçalho do cache binário do dataset **/
+#include "cache.h"
+
+/** Inclusão do arquivo de cabeçalho do otimizador **/
+#include "optimizer.h"
+
+/** Inclusão do arquivo de cabeçalho do modelo treinado **/
+#include "model.h"
+
+/** Inclusão do arquivo de cabeçalho da projeção aleatória **/
+#include "projection.h"
+
+/** Inclusão do arquivo de cabeçalho da leitura em blocos **/
+#include "stream.h"
+
+/** Inclusão do arquivo de cabeçalho do escritor assíncrono **/
+#include "sink.h"
+
+/** Inclusão do arquivo de cabeçalho dos checkpoints **/
+#include "checkpoint.h"
+
+/** Inclusão do arquivo de cabeçalho do posicionamento nos nós NUMA **/
+#include "topology.h"
+
+/** Inclusão do arquivo de cabeçalho do otimizador L-BFGS **/
+#include "lbfgs.h"
+
+/** Inclusão do arquivo de cabeçalho com as constantes e as funções usadas pelos programas de medição **/
+#include "main.h"
+
+
+/**
+ * @brief Largura, altura e número de atributos das imagens usadas no treinamento, registrados no modelo.
+ * 
+ * Com --resolution, as imagens são reduzidas na leitura (ver pool_row()).
+ * Com --projection, image_pixels é o número de componentes da projeção, e
+ * as imagens lidas têm image_width x image_height pixels.
+ */
+static int image_width = 128, image_height = 128, image_pixels = 128 * 128;
 
 /**
- * @brief Constante definindo o número de imagens para teste.
+ * @brief Projeção aleatória aplicada às imagens após a leitura (--projection); num_components é 0 sem projeção.
  * 
  */
-static const int NUM_IMAGES_TESTING = 1210;
+static projection_t image_projection = { 0 };
 
 /**
- * @brief Constante definindo o número de pixels.
+ * @brief Constante definindo o número de arquivos de entrada.
  * 
  */
-static const int NUM_PIXELS = 128 * 128;
+static const int NUM_FOLDS = 5;
 
+/**
+ * @brief Arquivos de entrada: o primeiro contém as imagens de teste e os demais, as de treinamento.
+ * 
+ */
+static const char *FOLD_FILES[] = {
+    "../../data/fold_0_after.csv",
+    "../../data/fold_1_after.csv",
+    "../../data/fold_2_after.csv",
+    "../../data/fold_3_after.csv",
+    "../../data/fold_4_after.csv"
+};
 
+/**
+ * @brief Caminhos padrão do cache binário do dataset, indexados pelo tipo de armazenamento dos pixels.
+ * 
+ */
+static const char *DEFAULT_CACHE_FILES[] = {
+    [DATASET_FLOAT32] = "../../data/dataset.bin",
+    [DATASET_UINT8] = "../../data/dataset_uint8.bin",
+    [DATASET_FLOAT16] = "../../data/dataset_float16.bin",
+    [DATASET_BFLOAT16] = "../../data/dataset_bfloat16.bin"
+};
 
 /**
- * @brief Realiza alocação dinâmica para uma string.
+ * @brief Arquivo de checkpoint padrão.
  * 
- * Realiza a alocação dinâmica para um espaço de memória de acordo com
- * a string informada.
+ */
+static const char *DEFAULT_CHECKPOINT_FILE = "../output/checkpoint.bin";
+
+/**
+ * @brief Fator de normalização dos pixels armazenados em uint8.
  * 
- * @param s string para a qual se deseja alocar um espaço de memória
- * @return void* ponteiro para o endereço de memória alocado
  */
-char *estrdup (char *s) {
-	char *t;
-	t = (char *) malloc(strlen(s)+1);
-	strcpy(t, s);
-	return t;
-}
+static const float PIXEL_SCALE = 1.0f / 255;
+
+/**
+ * @brief Registro de uma época, enviado ao escritor assíncrono.
+ */
+typedef struct epoch_record {
+    int epoch_num;                  /* número da época */
+    int model;                      /* modelo da varredura (--sweep) ao qual o registro pertence */
+    int num_images;                 /* número de imagens processadas na época */
+    double elapsed;                 /* tempo de treinamento decorrido ao final da época */
+    double metrics[NUM_METRICS];    /* métricas da época */
+    int num_evaluations;            /* avaliações do custo na iteração do L-BFGS (--lbfgs); 0 no gradiente descendente */
+    double step;                    /* passo aceito pela busca em linha do L-BFGS */
+    double update_rate;             /* atualizações dos pesos por segundo (--hogwild); 0 nos demais modos */
+} epoch_record_t;
+
+/**
+ * @brief Arquivos de saída gravados a cada época pelo escritor assíncrono.
+ */
+typedef struct epoch_files {
+    FILE *log, *cost, *accuracy, *precision, *f1, *recall, *accuracy_time;
+    FILE *cost_time;                /* custo em função do tempo (--lbfgs), ou NULL */
+} epoch_files_t;
+
+/**
+ * @brief Arquivos de saída cujo tamanho é registrado nos checkpoints (CHECKPOINT_NUM_OUTPUTS).
+ */
+enum { OUTPUT_LOG, OUTPUT_CSV, OUTPUT_COST, OUTPUT_ACCURACY, OUTPUT_PRECISION, OUTPUT_RECALL, OUTPUT_F1, OUTPUT_ACCURACY_TIME };
+
+/**
+ * @brief Motivos da parada antecipada do treinamento.
+ */
+enum { STOP_NONE, STOP_PATIENCE, STOP_TARGET_F1, STOP_GRADIENT, STOP_LINE_SEARCH };
+
+/**
+ * @brief Descrição de cada motivo da parada antecipada, indexada por STOP_*.
+ */
+static const char *STOP_NAMES[] = { "", "paciência", "F1 alvo", "gradiente nulo", "busca em linha sem decréscimo" };
+
+/**
+ * @brief Critérios de parada antecipada e estado do monitoramento da validação.
+ */
+typedef struct early_stopping {
+    int patience;                   /* épocas sem melhora do custo de validação antes da parada; 0 desativa */
+    float min_delta;                /* redução mínima do custo de validação considerada uma melhora */
+    float target_f1;                /* F1 de validação que encerra o treinamento; 0 desativa */
+    double best_cost;               /* menor custo de validação */
+    double best_f1;                 /* F1 de validação da época de menor custo */
+    int best_epoch;                 /* época de menor custo (a partir de 1), ou 0 */
+    int num_bad_epochs;             /* épocas consecutivas sem melhora */
+    float *best_weights;            /* pesos ao final da época best_epoch */
+} early_stopping_t;
+
+/**
+ * @brief Imagens de treinamento processadas juntas na varredura de taxas de aprendizado (--sweep).
+ * 
+ */
+static const int SWEEP_BLOCK_ROWS = 4;
+
+/**
+ * @brief Pixels de cada faixa de colunas na varredura: os pesos de todos os modelos na faixa permanecem na cache L1.
+ * 
+ */
+static const int SWEEP_TILE = 512;
+
+/**
+ * @brief Varredura de taxas de aprendizado (--sweep): modelos independentes treinados na mesma passagem pelos dados.
+ */
+typedef struct sweep {
+    int num_models;                 /* número de modelos; 0 sem --sweep */
+    float *weights;                 /* pesos dos modelos, image_pixels por modelo */
+    float *gradients;               /* gradientes dos modelos, somados entre as threads */
+    float *partials;                /* gradientes privados de cada thread, num_models * image_pixels por thread */
+    float *rows;                    /* bloco de imagens convertido para float, SWEEP_BLOCK_ROWS * image_pixels por thread */
+    float *products;                /* produtos escalares e resíduos do bloco, (SWEEP_BLOCK_ROWS + 1) * num_models por thread */
+    double *metrics;                /* métricas da época de cada modelo, NUM_METRICS por modelo */
+    optimizer_t *optimizers;        /* otimizador de cada modelo, com a sua taxa de aprendizado */
+    epoch_files_t *files;           /* arquivos de saída de cada modelo */
+} sweep_t;
+
+/**
+ * @brief SGD assíncrono sem travas (--hogwild): progresso de cada thread.
+ */
+typedef struct hogwild {
+    int num_threads;                /* número de threads; 0 sem --hogwild */
+    float learning_rate;            /* taxa de aprendizado de cada atualização */
+    unsigned int *seeds;            /* estado do embaralhamento da fatia de cada thread */
+    long *updates;                  /* atualizações dos pesos feitas por cada thread */
+    double *busy;                   /* tempo de cada thread nas suas fatias, em segundos */
+} hogwild_t;
+
+/**
+ * @brief Número padrão de imagens por lote no modo de inferência.
+ * 
+ */
+static const int INFERENCE_BATCH_SIZE = 256;
+
+/**
+ * @brief Número de imagens convertidas e gravadas por vez na criação do cache.
+ * 
+ */
+static const int CACHE_BLOCK_ROWS = 256;
+
+
 
 /**
  * @brief Gera números reais aleatórios.
@@ -95,460 +266,2833 @@ float rand_range(float min, float max) {
  * @param row referência para o vetor de pesos
  */
 void initialize_weights(float *row, int num_total_images_training) {
-    for(int i=0; i < NUM_PIXELS; i++) {
-        *(row+i) = rand_range(-1, 1) / (NUM_PIXELS + num_total_images_training);
+    for(int i=0; i < image_pixels; i++) {
+        *(row+i) = rand_range(-1, 1) / (image_pixels + num_total_images_training);
     }
 }
 
 /**
- * @brief Realiza a leitura completa do arquivo .csv de entrada.
- * 
- * Realiza a leitura completa do arquivo .csv de entrada e armazena
- * os pixels lidos nas matrizes para dados de teste e treinamento. Os
- * labels lidos são armazenados nos vetores de treinamento e de teste.
+ * @brief Define a resolução das imagens usadas no treinamento.
  * 
- * @param testing_images_names[NUM_IMAGES_TESTING][60] array contendo os nomes das imagens de teste
- * @param file_log_output ponteiro para escrita no log de saída
- * @param data_testing referência para matriz com dados para teste
- * @param data_training referência para matriz com dados para treinamento
- * @param labels_testing referência para vetor com labels para teste
- * @param labels_training referência para vetor com labels para treinamento
- * 
- * @return int 1, se a leitura foi bem sucedida; 0, caso contrário
- */
-int read_data_and_labels(char testing_images_names[NUM_IMAGES_TESTING][60], FILE *file_log_output, float **data_testing, float **data_training, int *labels_testing, int *labels_training, int num_total_images_training) {
-    char *line; //linha lida do arquivo
-    int row_testing = 0; //contador para linhas da matriz com dados para teste
-    int row_training = 1; //contador para linhas da matriz com dados para treinamento
-    char *label, *pixels, *usage, *pch, *name; 
-    float temp; 
-    FILE *file_input;
-    char *file_name;
-    int file_cont = 0;
-
-    /** aloca espaço para o bias e adiciona o bias ao dataset de treinamento **/
-    data_training[0] = (float *) malloc(NUM_PIXELS * sizeof(float));
-    for(int i = 0; i < NUM_PIXELS; i++) {
-        data_training[0][i] = 0;
-    } 
-    labels_training[0] = 1;
-
-    while (file_cont < 5 && row_training != num_total_images_training) {
-
-        if(file_cont == 0) {
-            file_name = estrdup("../../data/fold_0_after.csv");
-        } else if(file_cont == 1) {
-            file_name = estrdup("../../data/fold_1_after.csv");
-        } else if(file_cont == 2) {
-            file_name = estrdup("../../data/fold_2_after.csv");
-        } else if(file_cont == 3) {
-            file_name = estrdup("../../data/fold_3_after.csv");
-        } else if(file_cont == 4) {
-            file_name = estrdup("../../data/fold_4_after.csv");
-        }
-
-        /* tenta abrir o arquivo de entrada */
-        if ((file_input = fopen(file_name, "r")) == NULL) {
-            fprintf(file_log_output, "Não foi possível abrir o arquivo!");
-            return -1;
-        }
-
-        /* itera o arquivo até o final, ou seja, até a linha obtida ser NULL */
-        while(((line = csvgetline(file_input, ',', 0)) != NULL) && row_training != num_total_images_training) {
-            name = estrdup(csvfield(0)); //obtém o nome do arquivo 
-            label = estrdup(csvfield(1)); //obtém o primeiro campo de uma linha (label)
-            pixels = estrdup(csvfield(2)); //obtém o segundo campo de uma linha (pixels)
-
-            pch = strtok(pixels, " "); //separa os pixels por espaços
-
-            if(file_cont == 0) { //verifica se a linha possui dados para teste
-                data_testing[row_testing] = (float *) malloc(NUM_PIXELS * sizeof(float));
-                labels_testing[row_testing] = atoi(label); //converte a label para inteiro e divide por 4, tornando-a 1 ou 0
-                strcpy(testing_images_names[row_testing], estrdup(csvfield(0)));
-            } else {
-                data_training[row_training] = (float *) malloc(NUM_PIXELS * sizeof(float));
-                labels_training[row_training] = atoi(label);
-            }
-
-            /** realiza iteração para cada pixel que será lido **/
-            for(int c = 0; c < NUM_PIXELS; c++) {
-                temp = strtof(pch, NULL); //obtém 1 pixel
-                temp = temp/255; //realiza normalização no pixel
-
-                if(file_cont == 0) { 
-                    data_testing[row_testing][c] = temp;
-                } else {
-                    data_training[row_training][c] = temp;
-                }
-
-                pch = strtok(NULL, " ");
-            }
-
-            if(file_cont == 0) {
-                row_testing++; //atualiza a contagem das linhas de teste
-            } else {
-                row_training++; //atualiza a contagem das linhas de treinamento
-            }
-        }
-
-        fclose(file_input);
-        file_cont++;
+ * @param width largura das imagens: IMAGE_WIDTH, IMAGE_WIDTH / 2 ou IMAGE_WIDTH / 4 (a altura é reduzida na mesma proporção)
+ * @return int 0, se a resolução é suportada; -1, caso contrário
+ */
+int set_resolution(int width) {
+    if(width != IMAGE_WIDTH && width != IMAGE_WIDTH / 2 && width != IMAGE_WIDTH / 4) {
+        return -1;
     }
 
+    image_width = width;
+    image_height = IMAGE_HEIGHT / (IMAGE_WIDTH / width);
+    image_pixels = image_width * image_height;
+
     return 0;
 }
 
 /**
- * @brief Salva os resultados do treinamento em arquivo
+ * @brief Define a projeção aleatória das imagens usadas no treinamento.
  * 
- * @param epoch_num número da epoca
- * @param results vetor contendo resultados da regressão logistica
- * @param labels labels lidas do arquivo (valores corretos)
- * @param num_images número de imagens que foram processadas
- * @param file_log_output ponteiro para o arquivo de log de saída
- * @param file_accuracy_output ponteiro para o arquivo com registros de acurácia
- * @param file_precision_output ponteiro para o arquivo com registros de precisão
- * @param file_f1_output ponteiro para o arquivo com registros de f1
- * @param file_recall_output ponteiro para o arquivo com registros de recall
+ * Deve ser chamada após set_resolution(). A matriz é gerada com a semente
+ * PROJECTION_SEED, de forma que um treinamento retomado de um checkpoint
+ * use a mesma projeção.
+ * 
+ * @param num_components número de componentes (de 1 ao número de pixels - 1); 0 para treinar com os pixels
+ * @return int 0, se a projeção foi gerada; -1, caso contrário
  */
-void save_training_results(int epoch_num, int *results, int *labels, int num_images, FILE *file_log_output, FILE *file_accuracy_output, FILE *file_precision_output, FILE *file_f1_output, FILE *file_recall_output) {
-    int true_positive = 0, true_negative = 0, false_positive = 0, false_negative = 0;
-    float accuracy = 0, precision = 0, recall = 0, f1 = 0;
-
-    /** computa os verdadeiros positivos e negativos e os falsos positivos e negativos **/
-    for(int i=0; i < num_images; i++) {
-        if(results[i] == 1 && labels[i] == 1) {
-            true_positive++;
-        } else if(results[i] == 1 && labels[i] == 0) {
-            false_positive++;
-        } else if(results[i] == 0 && labels[i] == 1) {
-            false_negative++;
-        } else {
-            true_negative++;
-        }
+int set_projection(int num_components) {
+    if(num_components == 0) {
+        return 0;
     }
 
-    accuracy = (float) (true_positive + true_negative) / (true_positive + true_negative + false_positive + false_negative);
-    precision = (float) (true_positive) / (true_positive + false_positive); 
-    recall = (float) true_positive/(true_positive + false_negative);
-    f1 = 2 * ((precision * recall) / (precision + recall));
+    if(projection_init(&image_projection, image_width * image_height, num_components, PROJECTION_SEED) == -1) {
+        image_projection.num_components = 0;
+        return -1;
+    }
 
-    fprintf(file_log_output, "-- ÉPOCA %d --\n", epoch_num + 1);
-    fprintf(file_log_output, "MATRIZ DE CONFUSÃO:\n");
-    fprintf(file_log_output, "%d    %d\n", true_negative, false_positive);
-    fprintf(file_log_output, "%d    %d\n\n", false_negative, true_positive);
+    image_pixels = num_components;
 
-    fprintf(file_log_output, "Acertos: %d       Erros: %d\n", true_positive + true_negative, false_positive + false_negative);
-    fprintf(file_log_output, "Acurácia: %f      Precisão: %f        Revocação: %f       F1: %f\n", accuracy, precision, recall, f1);
-    fprintf(file_accuracy_output, "%d,%f\n", epoch_num + 1, accuracy);
-    fprintf(file_precision_output, "%d,%f\n", epoch_num + 1, precision);
-    fprintf(file_recall_output, "%d,%f\n", epoch_num + 1, recall);
-    fprintf(file_f1_output, "%d,%f\n", epoch_num + 1, f1);
+    return 0;
 }
 
 /**
- * @brief Salva os resultados do teste em arquivo
+ * @brief Reduz a resolução de uma imagem dos arquivos de entrada pela média de blocos de pixels.
  * 
- * @param results vetor contendo resultados da regressão logistica
- * @param labels labels lidas do arquivo (valores corretos)
- * @param num_images número de imagens que foram processadas
- * @param testing_images_names[NUM_IMAGES_TESTING][60] array contendo os nomes das imagens de teste
- * @param file_log_output ponteiro para escrita no log de saída
- * @param file_csv_output ponteiro para escrita no arquivo csv de saída
+ * O fator de redução é definido pelo número de pixels da imagem reduzida,
+ * e cada fator tem o seu kernel vetorial (kernel_pool_2x2, kernel_pool_4x4).
+ * 
+ * @param pixels imagem na resolução dos arquivos de entrada (NUM_PIXELS pixels)
+ * @param pooled imagem reduzida
+ * @param num_pixels número de pixels da imagem reduzida (NUM_PIXELS / 4 ou NUM_PIXELS / 16)
  */
-void save_testing_results(int *results, int *labels, int num_images, char testing_images_names[NUM_IMAGES_TESTING][60], FILE *file_log_output, FILE *file_csv_output) {
-    int true_positive = 0, true_negative = 0, false_positive = 0, false_negative = 0;
-    float accuracy = 0, precision = 0, recall = 0, f1 = 0;
-
-    fprintf(file_csv_output, "%s,%s,%s\n", "nome_da_imagem", "genero", "genero_predito");
-
-    /** computa os verdadeiros positivos e negativos e os falsos positivos e negativos **/
-    for(int i=0; i < num_images; i++) {
-        if(results[i] == 1 && labels[i] == 1) {
-            true_positive++;
-        } else if(results[i] == 1 && labels[i] == 0) {
-            false_positive++;
-        } else if(results[i] == 0 && labels[i] == 1) {
-            false_negative++;
-        } else {
-            true_negative++;
-        }
+void pool_row(const float *pixels, float *pooled, int num_pixels) {
+    if(num_pixels * 4 == NUM_PIXELS) {
+        kernel_pool_2x2(pixels, IMAGE_WIDTH, IMAGE_HEIGHT, pooled);
+    } else {
+        kernel_pool_4x4(pixels, IMAGE_WIDTH, IMAGE_HEIGHT, pooled);
+    }
+}
 
-        fprintf(file_csv_output, "%s,%c,%c\n", testing_images_names[i], labels[i] == 0 ? 'f' : 'm', results[i] == 0 ? 'f' : 'm');
+/**
+ * @brief Reduz a resolução de uma imagem e a grava em uma linha do contêiner.
+ * 
+ * @param dataset contêiner de dados com resolução reduzida
+ * @param r índice da linha da matriz
+ * @param pixels imagem normalizada (0 a 1) na resolução dos arquivos de entrada
+ * @param scratch buffer de dataset->num_pixels posições, usado pelos tipos diferentes de float
+ */
+void store_pooled_row(dataset_t *dataset, int r, const float *pixels, float *scratch) {
+    if(dataset->dtype == DATASET_FLOAT32) {
+        pool_row(pixels, dataset_row(dataset, r), dataset->num_pixels);
+        return;
     }
 
-    accuracy = (float) (true_positive + true_negative) / (true_positive + true_negative + false_positive + false_negative);
-    precision = (float) (true_positive) / (true_positive + false_positive); 
-    recall = (float) true_positive/(true_positive + false_negative);
-    f1 = 2 * ((precision * recall) / (precision + recall));
+    pool_row(pixels, scratch, dataset->num_pixels);
 
-    fprintf(file_log_output, "MATRIZ DE CONFUSÃO:\n");
-    fprintf(file_log_output, "%d    %d\n", true_negative, false_positive);
-    fprintf(file_log_output, "%d    %d\n\n", false_negative, true_positive);
+    if(dataset->dtype == DATASET_UINT8) {
+        uint8_t *row = dataset_row_u8(dataset, r);
 
-    fprintf(file_log_output, "Acertos: %d       Erros: %d\n", true_positive + true_negative, false_positive + false_negative);
-    fprintf(file_log_output, "Acurácia: %f      Precisão: %f        Revocação: %f       F1: %f\n", accuracy, precision, recall, f1);
+        for(int c = 0; c < dataset->num_pixels; c++) {
+            row[c] = (uint8_t) (scratch[c] * 255 + 0.5f);
+        }
+    } else {
+        dataset_pack_row(dataset, r, scratch, dataset->num_pixels);
+    }
 }
 
 /**
- * @brief Realiza o cálculo da função hipótese.
+ * @brief Retorna uma imagem em float.
  * 
- * Realiza o cálculo da função hipótese de acordo com uma
- * linha da matriz e com o vetor de pesos informado.
+ * Linhas em float são usadas diretamente; as demais são convertidas (e
+ * normalizadas, em uint8) no buffer informado.
  * 
- * @param row linha da matriz
- * @param weights vetor de pesos
- * @return float resultado da função hipotese
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz
+ * @param buffer buffer de dataset->num_pixels posições usado na conversão
+ * @return const float* pixels da imagem
  */
-float hypothesis_function(float *row, float *weights) {
-    float result = 0;
+const float *row_to_float(const dataset_t *dataset, int r, float *buffer) {
+    if(dataset->dtype == DATASET_FLOAT32) {
+        return dataset_row(dataset, r);
+    }
 
-    //pede os pesos
+    memset(buffer, 0, dataset->num_pixels * sizeof(float));
 
-    #pragma omp parallel for reduction(+:result)
-    for(int c=0; c < NUM_PIXELS; c++) {
-        result += weights[c] * row[c];
+    if(dataset->dtype == DATASET_UINT8) {
+        kernel_axpy_u8(PIXEL_SCALE, dataset_row_u8(dataset, r), buffer, dataset->num_pixels);
+    } else if(dataset->dtype == DATASET_FLOAT16) {
+        kernel_axpy_f16(1, dataset_row_u16(dataset, r), buffer, dataset->num_pixels);
+    } else {
+        kernel_axpy_bf16(1, dataset_row_u16(dataset, r), buffer, dataset->num_pixels);
     }
 
-    //envia pro front end
-    
-    //essa parte de baixo vai ter q ser feita uma unica vez no front end
-    return 1/(1 + exp(-result)); //aplica a função sigmoid e retorna o resultado
+    return buffer;
 }
 
 /**
- * @brief Realiza o cálculo do gradiente descendente.
+ * @brief Reduz a resolução de todas as imagens de um contêiner.
  * 
- * Realiza o cálculo do gradiente descendente de acordo com o dataset de treinamento
- * informado, labels de treinamento e valores de hipótese.
+ * Usada com as imagens mapeadas do cache, que são gravadas na resolução
+ * dos arquivos de entrada. O contêiner é substituído por um contêiner
+ * alocado com as imagens reduzidas, no mesmo tipo de armazenamento.
  * 
- * @param data_training dataset de treinamento
- * @param labels labels de treinamento
- * @param all_hypothesis valores calculados para hipótese
- * @param c valor atual da coluna
- * @param learning_rate taxa de aprendizado
- * @return float valor de gradiente resultante
+ * @param dataset contêiner na resolução dos arquivos de entrada
+ * @param num_pixels número de pixels das imagens reduzidas
+ * @return int 0, se a redução foi bem sucedida; -1, caso contrário
  */
-float gradient(float **data_training, int *labels, float *all_hypothesis, int c, float learning_rate, int num_total_images_training) {
-    float gradient_sum = 0;
+int dataset_pool(dataset_t *dataset, int num_pixels) {
+    dataset_t pooled;
+
+    if(dataset_alloc(&pooled, dataset->num_images, num_pixels, dataset->dtype) == -1) {
+        return -1;
+    }
+
+    memcpy(pooled.labels, dataset->labels, dataset->num_images * sizeof(int));
+    memcpy(pooled.names, dataset->names, dataset->num_images * sizeof(dataset->names[0]));
+
+    #pragma omp parallel
+    {
+        float *scratch = (float *) malloc((NUM_PIXELS + num_pixels) * sizeof(float));
 
-    //pede as hipóteses da época atual
+        #pragma omp for schedule(static)
+        for(int r = 0; r < dataset->num_images; r++) {
+            store_pooled_row(&pooled, r, row_to_float(dataset, r, scratch), scratch + NUM_PIXELS);
+        }
 
-    #pragma omp parallel for reduction(+:gradient_sum)
-    for(int r = 0; r < num_total_images_training; r++) { //divide o numero do dataset (imagens) por máquina
-        gradient_sum += (all_hypothesis[r] - labels[r]) * data_training[r][c];
+        free(scratch);
     }
 
-    //envia pro front end
+    dataset_free(dataset);
+    *dataset = pooled;
 
-    return gradient_sum * learning_rate;
+    return 0;
 }
 
 /**
- * @brief Realiza a atualização dos pesos.
+ * @brief Projeta todas as imagens de um contêiner.
  * 
- * Realiza a atualização do vetor de pesos após a
- * execução de uma época de treinamento.
+ * As imagens de cada bloco de linhas são convertidas para float e
+ * projetadas pelas threads. O contêiner é substituído por um contêiner em
+ * float com os componentes da projeção, qualquer que seja o armazenamento
+ * dos pixels, já que os componentes não estão entre 0 e 1.
  * 
- * @param data_training dataset de treinamento
- * @param weights vetor de pesos
- * @param all_hypothesis valores calculados para hipótese
- * @param labels labels de treinamento
- * @param learning_rate taxa de aprendizado
+ * @param dataset contêiner com image_width x image_height pixels por imagem
+ * @param projection projeção inicializada
+ * @return int 0, se a projeção foi bem sucedida; -1, caso contrário
  */
-void update_weights(float **data_training, float *weights, float *all_hypothesis, int *labels, float learning_rate, int num_total_images_training) {
+int dataset_project(dataset_t *dataset, const projection_t *projection) {
+    dataset_t projected;
+
+    if(dataset_alloc(&projected, dataset->num_images, projection->num_components, DATASET_FLOAT32) == -1) {
+        return -1;
+    }
+
+    memcpy(projected.labels, dataset->labels, dataset->num_images * sizeof(int));
+    memcpy(projected.names, dataset->names, dataset->num_images * sizeof(dataset->names[0]));
+
+    #pragma omp parallel
+    {
+        float *buffer = (float *) malloc(dataset->num_pixels * sizeof(float));
 
-    for(int c=0; c < NUM_PIXELS; c++) {
-        weights[c] = weights[c] - (gradient(data_training, labels, all_hypothesis, c, learning_rate, num_total_images_training)/num_total_images_training);
+        #pragma omp for schedule(static)
+        for(int r = 0; r < dataset->num_images; r++) {
+            projection_apply(projection, row_to_float(dataset, r, buffer), dataset_row(&projected, r));
+        }
+
+        free(buffer);
     }
 
+    dataset_free(dataset);
+    *dataset = projected;
+
+    return 0;
 }
 
 /**
- * @brief Realiza o cálculo da função de custo.
+ * @brief Armazena uma linha do .csv de entrada em uma linha do contêiner.
  * 
- * Realiza o cálculo da função de custo.
+ * A linha é rejeitada se não tem os campos de nome, label e pixels ou se
+ * o número de pixels convertidos é diferente do esperado: NUM_PIXELS,
+ * quando a imagem é reduzida na leitura, ou dataset->num_pixels.
  * 
- * @param all_hypothesis vetor com valores calculados para hipótese
- * @param weights vetor de pesos
- * @param labels vetor de labels
- * @param num_total_images_training número de imagens
- * @return float custo resultante
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz que recebe a imagem
+ * @param line início da linha
+ * @param line_end fim da linha
+ * @param normalization valor pelo qual cada pixel armazenado em float é dividido
+ * @param scratch buffer de NUM_PIXELS + dataset->num_pixels posições, usado na redução da resolução e na conversão para 16 bits, ou NULL se não é necessário
+ * @return int 0, se a linha foi armazenada; -1, se a linha é inválida
  */
-float cost_function(float *all_hypothesis, float *weights, int *labels, int num_total_images_training) {
-    float cost = 0;
+int store_record(dataset_t *dataset, int r, const char *line, const char *line_end, float normalization, float *scratch) {
+    csv_record_t record;
+    int num_decoded = 0;
+
+    if(csv_parse_record(line, line_end, &record) == -1) {
+        return -1;
+    }
 
-    for(int r=0; r < num_total_images_training; r++) {
-        cost += -(labels[r] * log(all_hypothesis[r])) - (1 - labels[r]) * log(1 - all_hypothesis[r]);
+    dataset->labels[r] = record.label;
+    memcpy(dataset->names[r], record.name, record.name_length < DATASET_NAME_SIZE ? record.name_length : DATASET_NAME_SIZE - 1);
+
+    /* --resolution: a linha tem a resolução dos arquivos de entrada e é reduzida após a conversão */
+    if(dataset->num_pixels != NUM_PIXELS) {
+        if(csv_decode_pixels(record.pixels, record.pixels_end, scratch, NUM_PIXELS, normalization) != NUM_PIXELS) {
+            return -1;
+        }
+
+        store_pooled_row(dataset, r, scratch, scratch + NUM_PIXELS);
+        return 0;
     }
 
-    return cost / num_total_images_training;
+    if(dataset->dtype == DATASET_UINT8) {
+        num_decoded = csv_decode_pixels_u8(record.pixels, record.pixels_end, dataset_row_u8(dataset, r), dataset->num_pixels); //normalização realizada nos kernels
+    } else if(scratch != NULL) {
+        num_decoded = csv_decode_pixels(record.pixels, record.pixels_end, scratch, dataset->num_pixels, normalization);
+        if(num_decoded == dataset->num_pixels) {
+            dataset_pack_row(dataset, r, scratch, dataset->num_pixels);
+        }
+    } else {
+        num_decoded = csv_decode_pixels(record.pixels, record.pixels_end, dataset_row(dataset, r), dataset->num_pixels, normalization);
+    }
+
+    return num_decoded == dataset->num_pixels ? 0 : -1;
 }
 
 /**
- * @brief Função principal, na qual é iniciada a execução do algoritmo.
+ * @brief Realiza a leitura completa do arquivo .csv de entrada.
  * 
- * Função principal, na qual é iniciada a execução do algoritmo de acordo
- * com os argumntos informados no terminal para número de épocas e taxa
- * de aprendizagem.
+ * Realiza a leitura completa do arquivo .csv de entrada e armazena
+ * os pixels lidos nas matrizes para dados de teste e treinamento. Os
+ * labels lidos são armazenados nos vetores de treinamento e de teste.
  * 
- * @param argc quantidade de argumentos
- * @param argv vetor contendo os argumentos número de épocas e taxa de aprendizado
- * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
+ * Os cinco arquivos são mapeados em memória e divididos em blocos de
+ * linhas completas. As linhas de cada bloco são contadas para definir a
+ * posição de cada imagem nas matrizes e, em seguida, os blocos de todos
+ * os arquivos são convertidos concorrentemente pelas threads.
+ * 
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param testing contêiner com dados, labels e nomes das imagens de teste
+ * @param training contêiner com dados e labels das imagens de treinamento
+ * 
+ * @return int 0, se a leitura foi bem sucedida; -1, caso contrário
  */
-int main(int argc, char *argv[]) {
-    /** obtém os argumentos, converte para int ou float e inicializa o número de 
-     * épocas e a taxa de aprendizado **/
-    int num_max_epochs = atoi(argv[1]);
-    float learning_rate = atof(argv[2]);
-    int num_total_images_training = atoi(argv[4]);
+int read_data_and_labels(FILE *file_log_output, dataset_t *testing, dataset_t *training) {
+    csv_file_t files[NUM_FOLDS]; //arquivos de entrada mapeados
+    csv_chunk_t **chunks; //blocos de todos os arquivos
+    int *chunk_files; //arquivo de cada bloco
+    int num_chunks = 0;
+    int num_invalid = 0; //linhas rejeitadas por store_record()
+    int next_row_testing = 0, next_row_training = 1; //posição da próxima linha de teste e de treinamento
+
+    /** adiciona o bias ao dataset de treinamento (a linha 0 já é alocada com zeros) **/
+    training->labels[0] = 1;
+
+    /* mapeia os arquivos de entrada */
+    for(int file_cont = 0; file_cont < NUM_FOLDS; file_cont++) {
+        if(csv_open(FOLD_FILES[file_cont], &files[file_cont], CSV_CHUNK_SIZE) == -1) {
+            fprintf(file_log_output, "Não foi possível abrir o arquivo!");
+            while(file_cont-- > 0) {
+                csv_close(&files[file_cont]);
+            }
+            return -1;
+        }
+        num_chunks += files[file_cont].num_chunks;
+    }
 
+    chunks = (csv_chunk_t **) malloc(num_chunks * sizeof(csv_chunk_t *));
+    chunk_files = (int *) malloc(num_chunks * sizeof(int));
 
-    /* define o número de threads com base no valor informado */
-    omp_set_num_threads(atoi(argv[3]));
+    for(int file_cont = 0, i = 0; file_cont < NUM_FOLDS; file_cont++) {
+        for(int k = 0; k < files[file_cont].num_chunks; k++, i++) {
+            chunks[i] = &files[file_cont].chunks[k];
+            chunk_files[i] = file_cont;
+        }
+    }
 
-    /* vetor de pesos */
-    float *weights = (float *) malloc(NUM_PIXELS * sizeof(float));
-    /* número de épocas */
-    int num_epochs = 0;
+    /* conta as linhas de cada bloco */
+    #pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < num_chunks; i++) {
+        chunks[i]->num_lines = csv_count_lines(chunks[i]);
+    }
 
-    int corretos = 0;
-    
-    /* vetor contendo todos os valores de hipóteses calculados na épca */
-    float *all_hypothesis = (float *) malloc(num_total_images_training * sizeof(float));
+    /* define a linha da matriz que recebe a primeira imagem de cada bloco: o arquivo 0
+     * contém as imagens de teste e os demais, as de treinamento, após o bias */
+    for(int i = 0; i < num_chunks; i++) {
+        if(chunk_files[i] == 0) {
+            chunks[i]->first_line = next_row_testing;
+            next_row_testing += chunks[i]->num_lines;
+        } else {
+            chunks[i]->first_line = next_row_training;
+            next_row_training += chunks[i]->num_lines;
+        }
+    }
 
-    /* vetor contendo os resultados, ou seja, os valores de hipótese binarizados */
-    int *results = (int *) malloc(num_total_images_training * sizeof(int));
+    /* converte as linhas de todos os blocos */
+    #pragma omp parallel for schedule(dynamic) reduction(+:num_invalid)
+    for(int i = 0; i < num_chunks; i++) {
+        dataset_t *dataset = chunk_files[i] == 0 ? testing : training;
+        int row_end = dataset->num_images; //ignora imagens excedentes
+        const char *p = chunks[i]->begin, *line, *line_end;
+        int pooling = dataset->num_pixels != NUM_PIXELS; //--resolution: imagens reduzidas na leitura
+        float *scratch = pooling || dataset_element_size(dataset->dtype) == sizeof(uint16_t) ? (float *) malloc((NUM_PIXELS + dataset->num_pixels) * sizeof(float)) : NULL; //pixels em float antes da redução ou da conversão para 16 bits
+
+        for(int r = chunks[i]->first_line; r < row_end && (line = csv_next_line(p, chunks[i]->end, &line_end, &p)) != NULL; r++) {
+            if(store_record(dataset, r, line, line_end, 255, scratch) == -1) { //realiza normalização nos pixels
+                num_invalid++;
+            }
+        }
 
-    int *results_testing = (int *) malloc(NUM_IMAGES_TESTING * sizeof(int));
+        free(scratch);
+    }
+
+    for(int file_cont = 0; file_cont < NUM_FOLDS; file_cont++) {
+        csv_close(&files[file_cont]);
+    }
+
+    free(chunks);
+    free(chunk_files);
+
+    if(num_invalid > 0) {
+        fprintf(file_log_output, "Arquivos de entrada inválidos: %d linha(s) sem nome, label ou pixels, ou com um número de pixels diferente de %d!", num_invalid, NUM_PIXELS);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Converte os arquivos .csv de entrada para o cache binário.
+ * 
+ * Os arquivos são percorridos em sequência e as imagens são convertidas
+ * em blocos de CACHE_BLOCK_ROWS linhas, gravados no cache assim que
+ * prontos; apenas um bloco fica em memória, de forma que a conversão não
+ * depende do tamanho do conjunto de treinamento. As linhas de cada bloco
+ * são convertidas concorrentemente pelas threads.
+ * 
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param cache_path caminho do arquivo de cache
+ * @param dtype tipo de armazenamento dos pixels
+ * @return int 0, se a conversão foi bem sucedida; -1, caso contrário
+ */
+int convert_data_to_cache(FILE *file_log_output, const char *cache_path, int dtype) {
+    cache_writer_t writer;
+    csv_file_t file;
+    dataset_t block; //bloco de imagens convertidas
+    const char **lines, **line_ends; //linhas do bloco
+    float *scratch = NULL; //pixels em float antes da conversão para 16 bits, 2 * NUM_PIXELS por thread
+    int num_images_training = cache_count_lines(FOLD_FILES + 1, NUM_FOLDS - 1); //imagens de treinamento disponíveis
+    int next_row_testing = 0, next_row_training = 1; //posição da próxima linha de teste e de treinamento
+    int num_invalid = 0; //linhas rejeitadas por store_record()
+    int status = 0;
+
+    if(num_images_training == -1) {
+        fprintf(file_log_output, "Não foi possível abrir o arquivo!");
+        return -1;
+    }
+
+    lines = (const char **) malloc(CACHE_BLOCK_ROWS * sizeof(char *));
+    line_ends = (const char **) malloc(CACHE_BLOCK_ROWS * sizeof(char *));
+    if(dataset_element_size(dtype) == sizeof(uint16_t)) {
+        scratch = (float *) malloc((size_t) omp_get_max_threads() * 2 * NUM_PIXELS * sizeof(float));
+    }
+
+    if(lines == NULL || line_ends == NULL || (dataset_element_size(dtype) == sizeof(uint16_t) && scratch == NULL) || dataset_alloc(&block, CACHE_BLOCK_ROWS, NUM_PIXELS, dtype) == -1) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        free(lines);
+        free(line_ends);
+        free(scratch);
+        return -1;
+    }
+
+    /* a linha adicional corresponde ao bias */
+    if(cache_writer_open(&writer, cache_path, FOLD_FILES, NUM_FOLDS, &block, NUM_IMAGES_TESTING, num_images_training + 1) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+        dataset_free(&block);
+        free(lines);
+        free(line_ends);
+        free(scratch);
+        return -1;
+    }
+
+    /** grava o bias na linha 0 do treinamento (o bloco é alocado com zeros) **/
+    block.labels[0] = 1;
+    if(cache_writer_put(&writer, CACHE_SECTION_TRAINING, 0, &block, 1) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+        status = -1;
+    }
+
+    /* o arquivo 0 contém as imagens de teste e os demais, as de treinamento */
+    for(int file_cont = 0; status == 0 && num_invalid == 0 && file_cont < NUM_FOLDS; file_cont++) {
+        int section = file_cont == 0 ? CACHE_SECTION_TESTING : CACHE_SECTION_TRAINING;
+        int *next_row = file_cont == 0 ? &next_row_testing : &next_row_training;
+        int row_end = file_cont == 0 ? NUM_IMAGES_TESTING : num_images_training + 1; //ignora imagens excedentes
+        const char *p, *end;
+        int num_rows;
+
+        if(csv_open(FOLD_FILES[file_cont], &file, CSV_CHUNK_SIZE) == -1) {
+            fprintf(file_log_output, "Não foi possível abrir o arquivo!");
+            status = -1;
+            break;
+        }
+
+        p = file.data;
+        end = file.data + file.size;
+
+        do {
+            /* separa as próximas linhas do arquivo */
+            for(num_rows = 0; num_rows < CACHE_BLOCK_ROWS && *next_row + num_rows < row_end
+                && (lines[num_rows] = csv_next_line(p, end, &line_ends[num_rows], &p)) != NULL; num_rows++);
+
+            memset(block.names, 0, num_rows * sizeof(block.names[0]));
+
+            #pragma omp parallel for schedule(dynamic) reduction(+:num_invalid)
+            for(int r = 0; r < num_rows; r++) {
+                float *thread_scratch = scratch != NULL ? scratch + (size_t) omp_get_thread_num() * 2 * NUM_PIXELS : NULL;
+
+                if(store_record(&block, r, lines[r], line_ends[r], 255, thread_scratch) == -1) { //realiza normalização nos pixels
+                    num_invalid++;
+                }
+            }
+
+            if(num_invalid == 0 && num_rows > 0 && cache_writer_put(&writer, section, *next_row, &block, num_rows) == -1) {
+                fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+                status = -1;
+            }
+
+            *next_row += num_rows;
+        } while(status == 0 && num_invalid == 0 && num_rows == CACHE_BLOCK_ROWS);
+
+        csv_close(&file);
+    }
+
+    if(num_invalid > 0) {
+        fprintf(file_log_output, "Arquivos de entrada inválidos: %d linha(s) sem nome, label ou pixels, ou com um número de pixels diferente de %d!", num_invalid, NUM_PIXELS);
+        status = -1;
+    }
+
+    if(status == -1) {
+        cache_writer_abort(&writer);
+    } else if(cache_writer_close(&writer) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+        status = -1;
+    }
+
+    dataset_free(&block);
+    free(lines);
+    free(line_ends);
+    free(scratch);
+
+    return status;
+}
+
+/**
+ * @brief Realiza a leitura dos dados a partir do cache binário.
+ * 
+ * Verifica o cache e, se ele estiver ausente ou desatualizado, converte
+ * os arquivos .csv de entrada. Em seguida, as matrizes são mapeadas em
+ * memória diretamente a partir do arquivo; com --resolution, as imagens
+ * mapeadas são reduzidas para novas matrizes (ver dataset_pool()).
+ * 
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param cache_path caminho do arquivo de cache
+ * @param testing contêiner para as imagens de teste
+ * @param training contêiner para as imagens de treinamento
+ * @param num_total_images_training número de imagens de treinamento usadas
+ * @param dtype tipo de armazenamento dos pixels
+ * @return int 0, se a leitura foi bem sucedida; -1, caso contrário
+ */
+int read_cached_data_and_labels(FILE *file_log_output, const char *cache_path, dataset_t *testing, dataset_t *training, int num_total_images_training, int dtype) {
+    if(cache_validate(cache_path, FOLD_FILES, NUM_FOLDS, NUM_PIXELS, dtype) == -1 && convert_data_to_cache(file_log_output, cache_path, dtype) == -1) {
+        return -1;
+    }
+
+    if(cache_open(cache_path, testing, training, 0, num_total_images_training) == -1) {
+        fprintf(file_log_output, "Não foi possível mapear o cache %s!", cache_path);
+        return -1;
+    }
+
+    /* --resolution: o cache é gravado na resolução dos arquivos de entrada */
+    if(image_width != IMAGE_WIDTH && (dataset_pool(testing, image_width * image_height) == -1 || dataset_pool(training, image_width * image_height) == -1)) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Salva os resultados do treinamento em arquivo
+ * 
+ * @param epoch_num número da epoca
+ * @param metrics métricas da época
+ * @param num_images número de imagens que foram processadas
+ * @param file_log_output ponteiro para o arquivo de log de saída
+ * @param file_cost_output ponteiro para o arquivo com registros de custo
+ * @param file_accuracy_output ponteiro para o arquivo com registros de acurácia
+ * @param file_precision_output ponteiro para o arquivo com registros de precisão
+ * @param file_f1_output ponteiro para o arquivo com registros de f1
+ * @param file_recall_output ponteiro para o arquivo com registros de recall
+ * @return float acurácia da época
+ */
+float save_training_results(int epoch_num, double metrics[NUM_METRICS], int num_images, FILE *file_log_output, FILE *file_cost_output, FILE *file_accuracy_output, FILE *file_precision_output, FILE *file_f1_output, FILE *file_recall_output) {
+    int true_positive = metrics[METRIC_TRUE_POSITIVE], true_negative = metrics[METRIC_TRUE_NEGATIVE];
+    int false_positive = metrics[METRIC_FALSE_POSITIVE], false_negative = metrics[METRIC_FALSE_NEGATIVE];
+    float accuracy = 0, precision = 0, recall = 0, f1 = 0;
+    float cost = metrics[METRIC_COST] / num_images;
+
+    accuracy = (float) (true_positive + true_negative) / (true_positive + true_negative + false_positive + false_negative);
+    precision = (float) (true_positive) / (true_positive + false_positive); 
+    recall = (float) true_positive/(true_positive + false_negative);
+    f1 = 2 * ((precision * recall) / (precision + recall));
+
+    fprintf(file_log_output, "-- ÉPOCA %d --\n", epoch_num + 1);
+    fprintf(file_log_output, "MATRIZ DE CONFUSÃO:\n");
+    fprintf(file_log_output, "%d    %d\n", true_negative, false_positive);
+    fprintf(file_log_output, "%d    %d\n\n", false_negative, true_positive);
+
+    fprintf(file_log_output, "Acertos: %d       Erros: %d\n", true_positive + true_negative, false_positive + false_negative);
+    fprintf(file_log_output, "Acurácia: %f      Precisão: %f        Revocação: %f       F1: %f\n", accuracy, precision, recall, f1);
+    fprintf(file_log_output, "Custo:    %f\n\n", cost);
+    fprintf(file_cost_output, "%d,%f\n", epoch_num + 1, cost);
+    fprintf(file_accuracy_output, "%d,%f\n", epoch_num + 1, accuracy);
+    fprintf(file_precision_output, "%d,%f\n", epoch_num + 1, precision);
+    fprintf(file_recall_output, "%d,%f\n", epoch_num + 1, recall);
+    fprintf(file_f1_output, "%d,%f\n", epoch_num + 1, f1);
+
+    return accuracy;
+}
+
+/**
+ * @brief Grava o registro de uma época, na thread do escritor assíncrono
+ * 
+ * @param record registro da época (epoch_record_t)
+ * @param context arquivos de saída (epoch_files_t)
+ */
+void write_epoch_record(const void *record, void *context) {
+    epoch_record_t *epoch = (epoch_record_t *) record;
+    epoch_files_t *files = (epoch_files_t *) context;
+
+    float accuracy = save_training_results(epoch->epoch_num, epoch->metrics, epoch->num_images, files->log, files->cost, files->accuracy, files->precision, files->f1, files->recall);
+    fprintf(files->accuracy_time, "%d,%f,%f\n", epoch->epoch_num + 1, epoch->elapsed, accuracy);
+
+    if(epoch->num_evaluations > 0) {
+        fprintf(files->log, "Avaliações do custo: %d      Passo: %g\n\n", epoch->num_evaluations, epoch->step);
+    }
+
+    if(epoch->update_rate > 0) {
+        fprintf(files->log, "Atualizações por segundo: %.0f\n\n", epoch->update_rate);
+    }
+
+    if(files->cost_time != NULL) {
+        fprintf(files->cost_time, "%d,%f,%f,%d\n", epoch->epoch_num + 1, epoch->elapsed, epoch->metrics[METRIC_COST] / epoch->num_images, epoch->num_evaluations);
+    }
+}
+
+/**
+ * @brief Descarrega os arquivos de saída ao final de um lote de registros
+ * 
+ * @param context arquivos de saída (epoch_files_t)
+ */
+void flush_epoch_files(void *context) {
+    epoch_files_t *files = (epoch_files_t *) context;
+
+    fflush(files->log);
+    fflush(files->cost);
+    fflush(files->accuracy);
+    fflush(files->precision);
+    fflush(files->f1);
+    fflush(files->recall);
+    fflush(files->accuracy_time);
+    if(files->cost_time != NULL) {
+        fflush(files->cost_time);
+    }
+}
+
+/**
+ * @brief Grava o registro de uma época de um modelo da varredura, na thread do escritor assíncrono
+ * 
+ * @param record registro da época (epoch_record_t)
+ * @param context varredura (sweep_t), com os arquivos de saída de cada modelo
+ */
+void write_sweep_record(const void *record, void *context) {
+    epoch_record_t *epoch = (epoch_record_t *) record;
+    sweep_t *sweep = (sweep_t *) context;
+
+    fprintf(sweep->files[epoch->model].log, "MODELO %d  /  TAXA DE APRENDIZADO: %f\n", epoch->model, sweep->optimizers[epoch->model].learning_rate);
+    write_epoch_record(record, &sweep->files[epoch->model]);
+}
+
+/**
+ * @brief Descarrega os arquivos de saída de todos os modelos da varredura
+ * 
+ * @param context varredura (sweep_t)
+ */
+void flush_sweep_files(void *context) {
+    sweep_t *sweep = (sweep_t *) context;
+
+    for(int m = 0; m < sweep->num_models; m++) {
+        flush_epoch_files(&sweep->files[m]);
+    }
+}
+
+/**
+ * @brief Abre um arquivo de saída
+ * 
+ * Sem checkpoint, o arquivo é criado vazio. Ao retomar um treinamento, o
+ * arquivo é cortado no tamanho registrado no checkpoint, descartando o que
+ * foi gravado após ele, e aberto para acréscimo.
+ * 
+ * @param path caminho do arquivo
+ * @param resumed checkpoint carregado por --resume, ou NULL
+ * @param output índice do arquivo (OUTPUT_*)
+ * @return FILE* arquivo aberto, ou NULL
+ */
+FILE *open_output(const char *path, const checkpoint_t *resumed, int output) {
+    if(resumed == NULL) {
+        return fopen(path, "w");
+    }
+
+    /* um arquivo removido após o checkpoint é recriado */
+    if(truncate(path, resumed->offsets[output]) == -1 && errno != ENOENT) {
+        return NULL;
+    }
+
+    return fopen(path, "a");
+}
+
+/**
+ * @brief Grava um checkpoint ao final de uma época
+ * 
+ * Aguarda o escritor assíncrono, de forma que o tamanho registrado de cada
+ * arquivo de saída corresponda exatamente às épocas concluídas.
+ * 
+ * @param path caminho do arquivo de checkpoint
+ * @param checkpoint estado do treinamento, com os vetores preenchidos
+ * @param sink escritor assíncrono dos resultados das épocas
+ * @param output_files arquivos de saída, indexados por OUTPUT_*
+ * @param num_epochs número de épocas concluídas
+ * @param elapsed tempo de treinamento decorrido
+ * @param stopping estado da parada antecipada, gravado quando há validação
+ * @return int 0, se o checkpoint foi gravado; -1, caso contrário
+ */
+int write_checkpoint(const char *path, checkpoint_t *checkpoint, sink_t *sink, FILE *output_files[CHECKPOINT_NUM_OUTPUTS], int num_epochs, double elapsed, const early_stopping_t *stopping) {
+    sink_sync(sink);
+
+    for(int k = 0; k < CHECKPOINT_NUM_OUTPUTS; k++) {
+        checkpoint->offsets[k] = ftell(output_files[k]);
+    }
+
+    checkpoint->num_epochs = num_epochs;
+    checkpoint->elapsed = elapsed;
+    checkpoint->best_cost = stopping->best_cost;
+    checkpoint->best_f1 = stopping->best_f1;
+    checkpoint->best_epoch = stopping->best_epoch;
+    checkpoint->num_bad_epochs = stopping->num_bad_epochs;
+
+    return checkpoint_save(path, checkpoint);
+}
+
+/**
+ * @brief Salva os resultados do teste em arquivo
+ * 
+ * @param results vetor contendo resultados da regressão logistica
+ * @param labels labels lidas do arquivo (valores corretos)
+ * @param num_images número de imagens que foram processadas
+ * @param testing_images_names array contendo os nomes das imagens de teste
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param file_csv_output ponteiro para escrita no arquivo csv de saída
+ */
+void save_testing_results(int *results, int *labels, int num_images, char testing_images_names[][DATASET_NAME_SIZE], FILE *file_log_output, FILE *file_csv_output) {
+    int true_positive = 0, true_negative = 0, false_positive = 0, false_negative = 0;
+    float accuracy = 0, precision = 0, recall = 0, f1 = 0;
+
+    fprintf(file_csv_output, "%s,%s,%s\n", "nome_da_imagem", "genero", "genero_predito");
+
+    /** computa os verdadeiros positivos e negativos e os falsos positivos e negativos **/
+    for(int i=0; i < num_images; i++) {
+        if(results[i] == 1 && labels[i] == 1) {
+            true_positive++;
+        } else if(results[i] == 1 && labels[i] == 0) {
+            false_positive++;
+        } else if(results[i] == 0 && labels[i] == 1) {
+            false_negative++;
+        } else {
+            true_negative++;
+        }
+
+        fprintf(file_csv_output, "%s,%c,%c\n", testing_images_names[i], labels[i] == 0 ? 'f' : 'm', results[i] == 0 ? 'f' : 'm');
+    }
+
+    accuracy = (float) (true_positive + true_negative) / (true_positive + true_negative + false_positive + false_negative);
+    precision = (float) (true_positive) / (true_positive + false_positive); 
+    recall = (float) true_positive/(true_positive + false_negative);
+    f1 = 2 * ((precision * recall) / (precision + recall));
+
+    fprintf(file_log_output, "MATRIZ DE CONFUSÃO:\n");
+    fprintf(file_log_output, "%d    %d\n", true_negative, false_positive);
+    fprintf(file_log_output, "%d    %d\n\n", false_negative, true_positive);
+
+    fprintf(file_log_output, "Acertos: %d       Erros: %d\n", true_positive + true_negative, false_positive + false_negative);
+    fprintf(file_log_output, "Acurácia: %f      Precisão: %f        Revocação: %f       F1: %f\n", accuracy, precision, recall, f1);
+}
+
+/**
+ * @brief Realiza o cálculo da função hipótese.
+ * 
+ * Realiza o cálculo da função hipótese de acordo com uma
+ * linha da matriz e com o vetor de pesos informado. Usa a
+ * implementação do produto escalar selecionada por kernels_init().
+ * Linhas em uint8 são normalizadas após o produto escalar; linhas em
+ * float16 e bfloat16 são convertidas para float nos registradores.
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz
+ * @param weights vetor de pesos
+ * @return float resultado da função hipotese
+ */
+float hypothesis_function(const dataset_t *dataset, int r, float *weights) {
+    float result;
+
+    if(dataset->dtype == DATASET_UINT8) {
+        result = kernel_dot_u8(dataset_row_u8(dataset, r), weights, dataset->num_pixels) * PIXEL_SCALE;
+    } else if(dataset->dtype == DATASET_FLOAT16) {
+        result = kernel_dot_f16(dataset_row_u16(dataset, r), weights, dataset->num_pixels);
+    } else if(dataset->dtype == DATASET_BFLOAT16) {
+        result = kernel_dot_bf16(dataset_row_u16(dataset, r), weights, dataset->num_pixels);
+    } else {
+        result = kernel_dot(dataset_row(dataset, r), weights, dataset->num_pixels);
+    }
+
+    return kernel_sigmoid(result); //aplica a função sigmoid e retorna o resultado
+}
+
+/**
+ * @brief Calcula a função hipótese de uma imagem e acumula a sua contribuição no gradiente.
+ * 
+ * O termo (h_r - y_r) * x_r é acumulado no vetor gradiente logo após o
+ * cálculo de h_r, enquanto a linha ainda está na cache, de forma que cada
+ * linha do dataset de treinamento é lida da memória uma única vez por
+ * época. Usa o kernel kernel_dot_axpy selecionado por kernels_init(); em
+ * linhas uint8, a normalização é aplicada ao produto escalar e ao coeficiente.
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz (imagem)
+ * @param weights vetor de pesos
+ * @param gradients vetor gradiente no qual a contribuição é acumulada
+ * @return float resultado da função hipótese
+ */
+float hypothesis_gradient(const dataset_t *dataset, int r, float *weights, float *gradients) {
+    if(dataset->dtype == DATASET_UINT8) {
+        return kernel_dot_axpy_u8(dataset_row_u8(dataset, r), weights, gradients, dataset->labels[r], PIXEL_SCALE, dataset->num_pixels);
+    }
+
+    if(dataset->dtype == DATASET_FLOAT16) {
+        return kernel_dot_axpy_f16(dataset_row_u16(dataset, r), weights, gradients, dataset->labels[r], dataset->num_pixels);
+    }
+
+    if(dataset->dtype == DATASET_BFLOAT16) {
+        return kernel_dot_axpy_bf16(dataset_row_u16(dataset, r), weights, gradients, dataset->labels[r], dataset->num_pixels);
+    }
+
+    return kernel_dot_axpy(dataset_row(dataset, r), weights, gradients, dataset->labels[r], dataset->num_pixels);
+}
+
+/**
+ * @brief Soma uma imagem multiplicada por um coeficiente a um vetor (y = y + a * x_r).
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz (imagem)
+ * @param a coeficiente
+ * @param y vetor que recebe a soma
+ */
+void add_row(const dataset_t *dataset, int r, float a, float *y) {
+    if(dataset->dtype == DATASET_UINT8) {
+        kernel_axpy_u8(a * PIXEL_SCALE, dataset_row_u8(dataset, r), y, dataset->num_pixels);
+    } else if(dataset->dtype == DATASET_FLOAT16) {
+        kernel_axpy_f16(a, dataset_row_u16(dataset, r), y, dataset->num_pixels);
+    } else if(dataset->dtype == DATASET_BFLOAT16) {
+        kernel_axpy_bf16(a, dataset_row_u16(dataset, r), y, dataset->num_pixels);
+    } else {
+        kernel_axpy(a, dataset_row(dataset, r), y, dataset->num_pixels);
+    }
+}
+
+/**
+ * @brief Acumula o resultado de uma imagem nas métricas da época.
+ * 
+ * Incrementa a posição da matriz de confusão correspondente à hipótese
+ * binarizada e à label da imagem e soma o custo (log-loss) da imagem.
+ * 
+ * @param metrics vetor de métricas, indexado por METRIC_*
+ * @param hypothesis valor da função hipótese
+ * @param label label da imagem
+ */
+void accumulate_metrics(double metrics[NUM_METRICS], float hypothesis, int label) {
+    int result = hypothesis >= 0.5; //realiza binarização do valor de hipótese
+
+    if(label == 1) {
+        metrics[result ? METRIC_TRUE_POSITIVE : METRIC_FALSE_NEGATIVE]++;
+    } else {
+        metrics[result ? METRIC_FALSE_POSITIVE : METRIC_TRUE_NEGATIVE]++;
+    }
+
+    metrics[METRIC_COST] += -(label * log(hypothesis)) - (1 - label) * log(1 - hypothesis);
+}
+
+/**
+ * @brief Calcula as métricas e o gradiente somado sobre todas as imagens de treinamento.
+ * 
+ * Em uma única passagem pelas linhas do dataset de treinamento, calcula a
+ * função hipótese de cada imagem, acumula a matriz de confusão e o custo
+ * e soma a contribuição da imagem no gradiente.
+ * 
+ * Deve ser chamada por todas as threads de uma região paralela já aberta:
+ * as imagens são divididas estaticamente entre as threads, e o gradiente
+ * e as métricas privados de cada thread são reduzidos ao final da passagem.
+ * 
+ * @param training contêiner com o dataset de treinamento
+ * @param weights vetor de pesos
+ * @param gradients vetor gradiente compartilhado entre as threads
+ * @param metrics vetor que recebe as métricas, indexado por METRIC_*
+ * @param topology topologia do modo NUMA, cujos gradientes parciais são somados por topology_reduce(), ou NULL para a redução do OpenMP
+ */
+void accumulate_full_batch(const dataset_t *training, float *weights, float *gradients, double metrics[NUM_METRICS], const topology_t *topology) {
+    #pragma omp single
+    {
+        memset(gradients, 0, image_pixels * sizeof(float));
+        memset(metrics, 0, NUM_METRICS * sizeof(double));
+    }
+
+    if(topology != NULL) {
+        float *partial = topology_gradients(topology);
+
+        #pragma omp for schedule(static) nowait reduction(+:metrics[:NUM_METRICS])
+        for(int r = 0; r < training->num_images; r++) {
+            accumulate_metrics(metrics, hypothesis_gradient(training, r, weights, partial), training->labels[r]);
+        }
+
+        topology_reduce(topology, gradients);
+    } else {
+        #pragma omp for schedule(static) reduction(+:gradients[:image_pixels], metrics[:NUM_METRICS])
+        for(int r = 0; r < training->num_images; r++) {
+            accumulate_metrics(metrics, hypothesis_gradient(training, r, weights, gradients), training->labels[r]);
+        }
+    }
+}
+
+/**
+ * @brief Realiza uma época de treinamento com o lote completo.
+ * 
+ * Calcula as métricas e o gradiente com accumulate_full_batch() e, ao
+ * final, atualiza os pesos pelo otimizador. Deve ser chamada por todas as
+ * threads de uma região paralela já aberta.
+ * 
+ * @param training contêiner com o dataset de treinamento
+ * @param weights vetor de pesos
+ * @param optimizer otimizador com a taxa de aprendizado e o momento
+ * @param gradients vetor gradiente compartilhado entre as threads
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
+ * @param topology topologia do modo NUMA, ou NULL
+ */
+void train_epoch(const dataset_t *training, float *weights, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS], const topology_t *topology) {
+    accumulate_full_batch(training, weights, gradients, metrics, topology);
+
+    optimizer_step(optimizer, weights, gradients, training->num_images);
+}
+
+/**
+ * @brief Dados da função de custo do lote completo usada pelo L-BFGS (--lbfgs).
+ */
+typedef struct full_batch {
+    const dataset_t *training;      /* imagens de treinamento */
+    const topology_t *topology;     /* topologia do modo NUMA, ou NULL */
+    double *metrics;                /* métricas da última avaliação, indexadas por METRIC_* */
+} full_batch_t;
+
+/**
+ * @brief Calcula o custo médio e o gradiente médio do lote completo (lbfgs_evaluate_t).
+ * 
+ * Abre uma região paralela e usa a mesma passagem pelos dados das épocas
+ * do gradiente descendente (accumulate_full_batch()); as métricas da
+ * avaliação ficam em batch->metrics.
+ * 
+ * @param context dados da função de custo (full_batch_t)
+ * @param weights vetor de pesos
+ * @param gradients vetor que recebe o gradiente médio
+ * @return double custo médio (log-loss)
+ */
+double evaluate_full_batch(void *context, const float *weights, float *gradients) {
+    full_batch_t *batch = (full_batch_t *) context;
+    int num_images = batch->training->num_images;
+
+    #pragma omp parallel
+    {
+        accumulate_full_batch(batch->training, (float *) weights, gradients, batch->metrics, batch->topology);
+
+        #pragma omp for schedule(static)
+        for(int c = 0; c < image_pixels; c++) {
+            gradients[c] /= num_images;
+        }
+    }
+
+    return batch->metrics[METRIC_COST] / num_images;
+}
+
+/**
+ * @brief Realiza uma época de treinamento em mini-lotes.
+ * 
+ * As imagens são embaralhadas e divididas em lotes, e os pesos são
+ * atualizados ao final de cada lote com o gradiente médio do lote. A
+ * hipótese de cada imagem, calculada com os pesos vigentes no momento em
+ * que a imagem é visitada, é acumulada nas métricas da época.
+ * 
+ * Deve ser chamada por todas as threads de uma região paralela já aberta:
+ * as imagens de cada lote são divididas estaticamente entre as threads.
+ * 
+ * @param training contêiner com o dataset de treinamento
+ * @param weights vetor de pesos
+ * @param order ordem de visita das imagens, embaralhada a cada época
+ * @param optimizer otimizador com o tamanho dos lotes
+ * @param gradients vetor gradiente compartilhado entre as threads
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
+ * @param topology topologia do modo NUMA, cujos gradientes parciais são somados por topology_reduce(), ou NULL para a redução do OpenMP
+ */
+void train_minibatch_epoch(const dataset_t *training, float *weights, int *order, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS], const topology_t *topology) {
+    int num_images = training->num_images;
+    int num_batches = optimizer_num_batches(optimizer, num_images);
+
+    #pragma omp single
+    {
+        memset(metrics, 0, NUM_METRICS * sizeof(double));
+        optimizer_shuffle(optimizer, order, num_images);
+    }
+
+    for(int k = 0; k < num_batches; k++) {
+        int begin = optimizer_batch_begin(num_images, num_batches, k), end = optimizer_batch_begin(num_images, num_batches, k + 1);
+
+        if(topology != NULL) {
+            float *partial = topology_gradients(topology);
+
+            #pragma omp for schedule(static) nowait reduction(+:metrics[:NUM_METRICS])
+            for(int i = begin; i < end; i++) {
+                int r = order[i];
+
+                accumulate_metrics(metrics, hypothesis_gradient(training, r, weights, partial), training->labels[r]);
+            }
+
+            topology_reduce(topology, gradients);
+        } else {
+            #pragma omp single
+            memset(gradients, 0, image_pixels * sizeof(float));
+
+            #pragma omp for schedule(static) reduction(+:gradients[:image_pixels], metrics[:NUM_METRICS])
+            for(int i = begin; i < end; i++) {
+                int r = order[i];
+
+                accumulate_metrics(metrics, hypothesis_gradient(training, r, weights, gradients), training->labels[r]);
+            }
+        }
+
+        optimizer_step(optimizer, weights, gradients, end - begin);
+    }
+}
+
+/**
+ * @brief Inicializa o SGD assíncrono sem travas.
+ * 
+ * @param hogwild estado a ser inicializado
+ * @param num_threads número de threads do treinamento
+ * @param learning_rate taxa de aprendizado de cada atualização
+ * @return int 0, se a inicialização foi bem sucedida; -1, se não há memória
+ */
+int hogwild_init(hogwild_t *hogwild, int num_threads, float learning_rate) {
+    hogwild->num_threads = num_threads;
+    hogwild->learning_rate = learning_rate;
+    hogwild->seeds = (unsigned int *) malloc(num_threads * sizeof(unsigned int));
+    hogwild->updates = (long *) calloc(num_threads, sizeof(long));
+    hogwild->busy = (double *) calloc(num_threads, sizeof(double));
+
+    if(hogwild->seeds == NULL || hogwild->updates == NULL || hogwild->busy == NULL) {
+        return -1;
+    }
+
+    for(int t = 0; t < num_threads; t++) {
+        hogwild->seeds[t] = t + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Libera o estado do SGD assíncrono sem travas.
+ * 
+ * @param hogwild estado inicializado por hogwild_init()
+ */
+void hogwild_free(hogwild_t *hogwild) {
+    free(hogwild->seeds);
+    free(hogwild->updates);
+    free(hogwild->busy);
+}
+
+/**
+ * @brief Realiza uma época do SGD assíncrono sem travas (Hogwild).
+ * 
+ * As imagens são divididas estaticamente entre as threads, e cada thread
+ * embaralha a sua fatia e atualiza os pesos compartilhados após cada
+ * imagem, w = w - lr * (h - y) * x, sem travas nem barreiras entre as
+ * atualizações: as leituras e escritas de uma thread podem se intercalar
+ * com as das demais, e uma atualização concorrente de um mesmo peso pode
+ * ser perdida. Como cada imagem altera todos os pesos com um coeficiente
+ * pequeno, essas perdas são raras em relação ao número de atualizações e
+ * não impedem a convergência, e as threads não esperam umas pelas outras.
+ * 
+ * As métricas da época são as hipóteses calculadas antes de cada
+ * atualização, com os pesos vigentes no momento; para o custo dos pesos
+ * finais, ver a passagem de consistência em main().
+ * 
+ * Deve ser chamada por todas as threads de uma região paralela já aberta.
+ * 
+ * @param training contêiner com o dataset de treinamento
+ * @param weights vetor de pesos compartilhado entre as threads
+ * @param order ordem de visita das imagens; cada thread embaralha apenas a sua fatia
+ * @param hogwild estado do SGD assíncrono, cujo progresso por thread é atualizado
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
+ */
+void train_hogwild_epoch(const dataset_t *training, float *weights, int *order, hogwild_t *hogwild, double metrics[NUM_METRICS]) {
+    int num_threads = omp_get_num_threads(), thread = omp_get_thread_num();
+    int begin = optimizer_batch_begin(training->num_images, num_threads, thread), end = optimizer_batch_begin(training->num_images, num_threads, thread + 1);
+    unsigned int seed = hogwild->seeds[thread];
+    double local[NUM_METRICS] = { 0 }, time_begin = omp_get_wtime();
+
+    #pragma omp single
+    memset(metrics, 0, NUM_METRICS * sizeof(double));
+
+    /* embaralha a fatia da thread (Fisher-Yates) com o estado copiado, sem escritas em posições vizinhas de outras threads */
+    for(int i = end - 1; i > begin; i--) {
+        int j = begin + rand_r(&seed) % (i - begin + 1);
+        int temp = order[i];
+
+        order[i] = order[j];
+        order[j] = temp;
+    }
+
+    for(int i = begin; i < end; i++) {
+        int r = order[i];
+        float hypothesis = hypothesis_function(training, r, weights);
+
+        accumulate_metrics(local, hypothesis, training->labels[r]);
+        add_row(training, r, -hogwild->learning_rate * (hypothesis - training->labels[r]), weights);
+    }
+
+    hogwild->seeds[thread] = seed;
+    hogwild->updates[thread] += end - begin;
+    hogwild->busy[thread] += omp_get_wtime() - time_begin;
+
+    for(int m = 0; m < NUM_METRICS; m++) {
+        #pragma omp atomic
+        metrics[m] += local[m];
+    }
+
+    /* os pesos e as métricas da época só são lidos após a passagem de todas as threads */
+    #pragma omp barrier
+}
+
+/**
+ * @brief Realiza uma época de treinamento com o lote completo, lendo as imagens em blocos.
+ * 
+ * Equivalente a train_epoch() no treinamento fora da memória: as linhas de
+ * cada bloco entregue por stream_next() são processadas enquanto a thread
+ * de leitura carrega o bloco seguinte, e os pesos são atualizados após o
+ * último bloco da época.
+ * 
+ * Deve ser chamada por todas as threads de uma região paralela já aberta:
+ * uma única thread obtém cada bloco e as linhas do bloco são divididas
+ * estaticamente entre as threads. Uma falha de leitura interrompe o
+ * processamento dos blocos e é registrada em stream->status.
+ * 
+ * @param stream leitura em blocos das imagens de treinamento
+ * @param weights vetor de pesos
+ * @param optimizer otimizador com a taxa de aprendizado e o momento
+ * @param gradients vetor gradiente compartilhado entre as threads
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
+ * @param chunk contêiner compartilhado entre as threads, que aponta para o bloco atual
+ * @param topology topologia do modo NUMA, cujos gradientes parciais são somados por topology_reduce(), ou NULL para a redução do OpenMP
+ */
+void train_stream_epoch(stream_t *stream, float *weights, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS], dataset_t *chunk, const topology_t *topology) {
+    /* no modo NUMA, cada thread acumula os blocos da época no seu gradiente parcial */
+    float *partial = topology != NULL ? topology_gradients(topology) : gradients;
+
+    #pragma omp single
+    {
+        memset(gradients, 0, image_pixels * sizeof(float));
+        memset(metrics, 0, NUM_METRICS * sizeof(double));
+    }
+
+    for(int k = 0; k < stream->num_chunks; k++) {
+        /* a barreira ao final do laço anterior garante que o buffer do bloco
+         * anterior, que recebe a próxima leitura, não está mais em uso */
+        #pragma omp single
+        stream_next(stream, chunk);
+
+        if(topology != NULL) {
+            #pragma omp for schedule(static) reduction(+:metrics[:NUM_METRICS])
+            for(int r = 0; r < chunk->num_images; r++) {
+                accumulate_metrics(metrics, hypothesis_gradient(chunk, r, weights, partial), chunk->labels[r]);
+            }
+        } else {
+            #pragma omp for schedule(static) reduction(+:gradients[:image_pixels], metrics[:NUM_METRICS])
+            for(int r = 0; r < chunk->num_images; r++) {
+                accumulate_metrics(metrics, hypothesis_gradient(chunk, r, weights, gradients), chunk->labels[r]);
+            }
+        }
+    }
+
+    if(topology != NULL) {
+        topology_reduce(topology, gradients);
+    }
+
+    optimizer_step(optimizer, weights, gradients, stream->num_rows);
+}
+
+/**
+ * @brief Realiza uma época de treinamento com o lote completo formado por vários conjuntos de imagens.
+ * 
+ * Equivale a train_epoch() sobre a união dos conjuntos, que podem ser
+ * visões de contêineres diferentes: as imagens de cada conjunto são
+ * divididas estaticamente entre as threads, e o gradiente e as métricas
+ * acumulam as contribuições de todos os conjuntos antes da atualização.
+ * 
+ * Deve ser chamada por todas as threads de uma região paralela já aberta.
+ * 
+ * @param segments conjuntos de imagens de treinamento
+ * @param num_segments número de conjuntos
+ * @param weights vetor de pesos
+ * @param optimizer otimizador com a taxa de aprendizado e o momento
+ * @param gradients vetor gradiente compartilhado entre as threads
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
+ */
+void train_segments_epoch(const dataset_t *segments, int num_segments, float *weights, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS]) {
+    int num_images = 0;
+
+    #pragma omp single
+    {
+        memset(gradients, 0, image_pixels * sizeof(float));
+        memset(metrics, 0, NUM_METRICS * sizeof(double));
+    }
+
+    for(int s = 0; s < num_segments; s++) {
+        const dataset_t *segment = &segments[s];
+
+        #pragma omp for schedule(static) reduction(+:gradients[:image_pixels], metrics[:NUM_METRICS])
+        for(int r = 0; r < segment->num_images; r++) {
+            accumulate_metrics(metrics, hypothesis_gradient(segment, r, weights, gradients), segment->labels[r]);
+        }
+
+        num_images += segment->num_images;
+    }
+
+    optimizer_step(optimizer, weights, gradients, num_images);
+}
+
+/**
+ * @brief Inicializa a varredura de taxas de aprendizado.
+ * 
+ * Cada taxa da lista define um modelo, com o seu otimizador e os seus
+ * pesos iniciais, gerados em sequência por initialize_weights(): o
+ * primeiro modelo parte dos mesmos pesos de um treinamento sem --sweep.
+ * 
+ * @param sweep varredura a ser inicializada
+ * @param rates taxas de aprendizado separadas por vírgulas
+ * @param num_threads número de threads do treinamento
+ * @param momentum coeficiente do momento, comum a todos os modelos
+ * @param nesterov 1 para usar o momento de Nesterov
+ * @param num_total_images_training número de imagens de treinamento, usado na inicialização dos pesos
+ * @return int 0, se a inicialização foi bem sucedida; -1, se a lista é inválida ou não há memória
+ */
+int sweep_init(sweep_t *sweep, const char *rates, int num_threads, float momentum, int nesterov, int num_total_images_training) {
+    const char *cursor = rates;
+    char *end;
+
+    memset(sweep, 0, sizeof(*sweep));
+    sweep->num_models = 1;
+    for(const char *c = rates; *c != '\0'; c++) {
+        sweep->num_models += *c == ',';
+    }
+
+    int num_models = sweep->num_models;
+
+    sweep->weights = (float *) malloc((size_t) num_models * image_pixels * sizeof(float));
+    sweep->gradients = (float *) malloc((size_t) num_models * image_pixels * sizeof(float));
+    sweep->partials = (float *) malloc((size_t) num_threads * num_models * image_pixels * sizeof(float));
+    sweep->rows = (float *) malloc((size_t) num_threads * SWEEP_BLOCK_ROWS * image_pixels * sizeof(float));
+    sweep->products = (float *) malloc((size_t) num_threads * (SWEEP_BLOCK_ROWS + 1) * num_models * sizeof(float));
+    sweep->metrics = (double *) malloc((size_t) num_models * NUM_METRICS * sizeof(double));
+    sweep->optimizers = (optimizer_t *) calloc(num_models, sizeof(optimizer_t));
+    sweep->files = (epoch_files_t *) calloc(num_models, sizeof(epoch_files_t));
+
+    if(sweep->weights == NULL || sweep->gradients == NULL || sweep->partials == NULL || sweep->rows == NULL
+        || sweep->products == NULL || sweep->metrics == NULL || sweep->optimizers == NULL || sweep->files == NULL) {
+        return -1;
+    }
+
+    for(int m = 0; m < num_models; m++) {
+        float learning_rate = strtof(cursor, &end);
+
+        if(end == cursor || learning_rate <= 0 || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+
+        if(optimizer_init(&sweep->optimizers[m], image_pixels, learning_rate, momentum, nesterov, 0, 1) == -1) {
+            return -1;
+        }
+
+        initialize_weights(sweep->weights + (size_t) m * image_pixels, num_total_images_training);
+        cursor = end + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Libera a varredura de taxas de aprendizado.
+ * 
+ * @param sweep varredura
+ */
+void sweep_free(sweep_t *sweep) {
+    for(int m = 0; sweep->optimizers != NULL && m < sweep->num_models; m++) {
+        optimizer_free(&sweep->optimizers[m]);
+    }
+
+    free(sweep->weights);
+    free(sweep->gradients);
+    free(sweep->partials);
+    free(sweep->rows);
+    free(sweep->products);
+    free(sweep->metrics);
+    free(sweep->optimizers);
+    free(sweep->files);
+}
+
+/**
+ * @brief Realiza uma época de lote completo de todos os modelos da varredura.
+ * 
+ * As imagens são processadas em blocos de SWEEP_BLOCK_ROWS linhas, como
+ * um produto de matrizes: para cada faixa de SWEEP_TILE colunas, os
+ * produtos escalares de todas as imagens do bloco com os pesos de todos
+ * os modelos são calculados por kernel_dot_many(), de forma que cada
+ * pixel lido da memória é usado por todos os modelos. Em seguida, as
+ * hipóteses e os resíduos de cada modelo são calculados e, com o bloco
+ * ainda na cache, os gradientes privados da thread recebem o produto dos
+ * resíduos pelas imagens (kernel_axpy_many()). Ao final, os gradientes
+ * das threads são somados e os pesos de cada modelo são atualizados pelo
+ * seu otimizador.
+ * 
+ * Deve ser chamada por todas as threads de uma região paralela já aberta.
+ * 
+ * @param training contêiner com o dataset de treinamento
+ * @param sweep varredura, cujos pesos, gradientes e métricas são atualizados
+ */
+void train_sweep_epoch(const dataset_t *training, sweep_t *sweep) {
+    int num_models = sweep->num_models, num_threads = omp_get_num_threads(), thread = omp_get_thread_num();
+    size_t num_weights = (size_t) num_models * image_pixels;
+    float *partial = sweep->partials + thread * num_weights;
+    float *buffer = sweep->rows + (size_t) thread * SWEEP_BLOCK_ROWS * image_pixels;
+    float *products = sweep->products + (size_t) thread * (SWEEP_BLOCK_ROWS + 1) * num_models;
+    float *residuals = products + num_models;
+    double *metrics = sweep->metrics;
+
+    memset(partial, 0, num_weights * sizeof(float));
+
+    #pragma omp single
+    memset(metrics, 0, num_models * NUM_METRICS * sizeof(double));
+
+    #pragma omp for schedule(static) reduction(+:metrics[:num_models * NUM_METRICS])
+    for(int begin = 0; begin < training->num_images; begin += SWEEP_BLOCK_ROWS) {
+        int num_rows = training->num_images - begin < SWEEP_BLOCK_ROWS ? training->num_images - begin : SWEEP_BLOCK_ROWS;
+        const float *rows[SWEEP_BLOCK_ROWS];
+
+        for(int i = 0; i < num_rows; i++) {
+            rows[i] = row_to_float(training, begin + i, buffer + (size_t) i * image_pixels);
+        }
+
+        /* produtos escalares do bloco com os pesos de todos os modelos, acumulados por faixa de colunas */
+        memset(residuals, 0, (size_t) num_rows * num_models * sizeof(float));
+
+        for(int column = 0; column < image_pixels; column += SWEEP_TILE) {
+            int width = image_pixels - column < SWEEP_TILE ? image_pixels - column : SWEEP_TILE;
+
+            for(int i = 0; i < num_rows; i++) {
+                kernel_dot_many(rows[i] + column, sweep->weights + column, image_pixels, num_models, width, products);
+
+                for(int m = 0; m < num_models; m++) {
+                    residuals[i * num_models + m] += products[m];
+                }
+            }
+        }
+
+        /* hipóteses e métricas; os produtos são substituídos pelos resíduos h - y */
+        for(int i = 0; i < num_rows; i++) {
+            int label = training->labels[begin + i];
+
+            for(int m = 0; m < num_models; m++) {
+                float hypothesis = kernel_sigmoid(residuals[i * num_models + m]);
+
+                accumulate_metrics(metrics + m * NUM_METRICS, hypothesis, label);
+                residuals[i * num_models + m] = hypothesis - label;
+            }
+        }
+
+        /* gradientes de todos os modelos, por faixa de colunas, com o bloco ainda na cache */
+        for(int column = 0; column < image_pixels; column += SWEEP_TILE) {
+            int width = image_pixels - column < SWEEP_TILE ? image_pixels - column : SWEEP_TILE;
+
+            for(int i = 0; i < num_rows; i++) {
+                kernel_axpy_many(residuals + i * num_models, rows[i] + column, partial + column, image_pixels, num_models, width);
+            }
+        }
+    }
+
+    /* soma os gradientes privados das threads (a redução acima termina com uma barreira) */
+    #pragma omp for schedule(static)
+    for(size_t c = 0; c < num_weights; c++) {
+        float sum = 0;
+
+        for(int t = 0; t < num_threads; t++) {
+            sum += sweep->partials[t * num_weights + c];
+        }
+
+        sweep->gradients[c] = sum;
+    }
+
+    for(int m = 0; m < num_models; m++) {
+        optimizer_step(&sweep->optimizers[m], sweep->weights + m * image_pixels, sweep->gradients + m * image_pixels, training->num_images);
+    }
+}
+
+/**
+ * @brief Calcula as métricas do conjunto de validação.
+ * 
+ * As imagens de validação são divididas entre as threads e as métricas
+ * privadas de cada thread são reduzidas ao final.
+ * 
+ * @param validation contêiner com as imagens de validação
+ * @param weights vetor de pesos
+ * @param metrics vetor que recebe as métricas de validação, indexado por METRIC_*
+ */
+void validate(const dataset_t *validation, float *weights, double metrics[NUM_METRICS]) {
+    memset(metrics, 0, NUM_METRICS * sizeof(double));
+
+    #pragma omp parallel for schedule(static) reduction(+:metrics[:NUM_METRICS])
+    for(int r = 0; r < validation->num_images; r++) {
+        accumulate_metrics(metrics, hypothesis_function(validation, r, weights), validation->labels[r]);
+    }
+}
+
+/**
+ * @brief Atualiza o monitoramento da validação ao final de uma época.
+ * 
+ * Uma época melhora o treinamento quando reduz o menor custo de validação
+ * em mais de min_delta; nesse caso, os pesos são copiados para
+ * best_weights. O treinamento deve ser encerrado após patience épocas
+ * consecutivas sem melhora ou quando o F1 de validação atinge target_f1.
+ * 
+ * @param stopping critérios e estado da parada antecipada
+ * @param metrics métricas de validação da época, indexadas por METRIC_*
+ * @param num_images número de imagens de validação
+ * @param weights pesos ao final da época
+ * @param epoch_num número de épocas concluídas
+ * @return int motivo da parada (STOP_*), ou STOP_NONE para continuar
+ */
+int early_stopping_update(early_stopping_t *stopping, double metrics[NUM_METRICS], int num_images, const float *weights, int epoch_num) {
+    double cost = metrics[METRIC_COST] / num_images;
+    double true_positive = metrics[METRIC_TRUE_POSITIVE];
+    double f1 = true_positive > 0 ? 2 * true_positive / (2 * true_positive + metrics[METRIC_FALSE_POSITIVE] + metrics[METRIC_FALSE_NEGATIVE]) : 0;
+
+    if(cost < stopping->best_cost - stopping->min_delta) {
+        stopping->best_cost = cost;
+        stopping->best_f1 = f1;
+        stopping->best_epoch = epoch_num;
+        stopping->num_bad_epochs = 0;
+        memcpy(stopping->best_weights, weights, image_pixels * sizeof(float));
+    } else {
+        stopping->num_bad_epochs++;
+    }
+
+    if(stopping->target_f1 > 0 && f1 >= stopping->target_f1) {
+        return STOP_TARGET_F1;
+    }
+
+    if(stopping->patience > 0 && stopping->num_bad_epochs >= stopping->patience) {
+        return STOP_PATIENCE;
+    }
+
+    return STOP_NONE;
+}
+
+/**
+ * @brief Salva a aceleração e a eficiência do treinamento.
+ * 
+ * Calcula a aceleração (A = tempo serial / tempo paralelo) e a eficiência
+ * (E = A / número de threads) a partir do tempo de treinamento serial de
+ * referência, no mesmo formato usado em final_results_profiling.txt.
+ * 
+ * @param file_log_output ponteiro para o arquivo de log de saída
+ * @param time_serial tempo de treinamento serial de referência, em segundos
+ * @param time_parallel tempo de treinamento medido, em segundos
+ * @param num_threads número de threads utilizadas
+ */
+void save_speedup_results(FILE *file_log_output, double time_serial, double time_parallel, int num_threads) {
+    double speedup = time_serial / time_parallel;
+
+    fprintf(file_log_output, "A: %.4f / %.4f = %.3f\n", time_serial, time_parallel, speedup);
+    fprintf(file_log_output, "E: %.3f / %d = %.3f\n\n", speedup, num_threads, speedup / num_threads);
+}
+
+/**
+ * @brief Realiza a leitura de um arquivo .csv de imagens.
+ * 
+ * O arquivo é mapeado em memória e dividido em blocos de linhas completas,
+ * como em read_data_and_labels(). O contêiner é alocado com o número de
+ * linhas do arquivo.
+ * 
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param path caminho do arquivo .csv
+ * @param dataset contêiner a ser alocado e preenchido
+ * @param num_pixels número de pixels por imagem
+ * @param dtype tipo de armazenamento dos pixels
+ * @param normalization divisor aplicado aos pixels armazenados em float
+ * @return int 0, se a leitura foi bem sucedida; -1, caso contrário
+ */
+int read_images(FILE *file_log_output, const char *path, dataset_t *dataset, int num_pixels, int dtype, float normalization) {
+    csv_file_t file;
+    int num_images = 0, num_invalid = 0;
+
+    if(csv_open(path, &file, CSV_CHUNK_SIZE) == -1) {
+        fprintf(file_log_output, "Não foi possível abrir o arquivo %s!", path);
+        return -1;
+    }
+
+    /* conta as linhas de cada bloco */
+    #pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < file.num_chunks; i++) {
+        file.chunks[i].num_lines = csv_count_lines(&file.chunks[i]);
+    }
+
+    for(int i = 0; i < file.num_chunks; i++) {
+        file.chunks[i].first_line = num_images;
+        num_images += file.chunks[i].num_lines;
+    }
+
+    if(dataset_alloc(dataset, num_images, num_pixels, dtype) == -1) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        csv_close(&file);
+        return -1;
+    }
+
+    /* converte as linhas de todos os blocos */
+    #pragma omp parallel for schedule(dynamic) reduction(+:num_invalid)
+    for(int i = 0; i < file.num_chunks; i++) {
+        const char *p = file.chunks[i].begin, *line, *line_end;
+        int pooling = dataset->num_pixels != NUM_PIXELS; //--resolution: imagens reduzidas na leitura
+        float *scratch = pooling || dataset_element_size(dataset->dtype) == sizeof(uint16_t) ? (float *) malloc((NUM_PIXELS + dataset->num_pixels) * sizeof(float)) : NULL; //pixels em float antes da redução ou da conversão para 16 bits
+
+        for(int r = file.chunks[i].first_line; (line = csv_next_line(p, file.chunks[i].end, &line_end, &p)) != NULL; r++) {
+            if(store_record(dataset, r, line, line_end, normalization, scratch) == -1) {
+                num_invalid++;
+            }
+        }
+
+        free(scratch);
+    }
+
+    csv_close(&file);
+
+    if(num_invalid > 0) {
+        fprintf(file_log_output, "Arquivo %s inválido: %d linha(s) sem nome, label ou pixels, ou com um número de pixels diferente de %d!", path, num_invalid, NUM_PIXELS); //as imagens reduzidas na leitura têm a resolução dos arquivos de entrada
+        dataset_free(dataset);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Compara dois valores double, para uso com qsort().
+ * 
+ * @param a ponteiro para o primeiro valor
+ * @param b ponteiro para o segundo valor
+ * @return int negativo, zero ou positivo, conforme a ordem dos valores
+ */
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Executa o modo de inferência.
+ * 
+ * Carrega o modelo gravado ao final de um treinamento e classifica as
+ * imagens de um arquivo .csv, no formato dos arquivos de entrada, ou da
+ * seção de teste de um cache binário (.bin). As imagens são processadas em
+ * lotes e o tempo de cada lote é medido; o log registra as imagens por
+ * segundo, a latência dos lotes e a matriz de confusão, e o tempo de cada
+ * lote é gravado em ../graphics.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv vetor contendo as opções:
+ * --predict=arquivo modelo gravado por um treinamento
+ * --input=arquivo imagens a classificar (.csv ou cache .bin); padrão: imagens de teste
+ * --batch=B número de imagens por lote (padrão: INFERENCE_BATCH_SIZE)
+ * --isa e --dtype, como no treinamento
+ * --threads=T número de threads (padrão: todas as disponíveis)
+ * @return int 0, se a inferência foi finalizada sem erros; -1, caso contrário
+ */
+int run_inference(int argc, char *argv[]) {
+    const char *model_path = option_get(argc, argv, "predict");
+    const char *input_path = option_get(argc, argv, "input");
+    int dtype = dataset_dtype_from_name(option_get(argc, argv, "dtype"));
+    int batch_size = option_get_int(argc, argv, "batch", INFERENCE_BATCH_SIZE);
+    int num_batches, status = 0;
+    double time_reading_begin, time_reading_end, time_inference;
+    double *latencies = NULL, *sorted_latencies = NULL;
+    float *hypothesis = NULL;
+    int *results = NULL;
+    model_t model = { 0 };
+    dataset_t images = { 0 }, unused;
+    FILE *file_log_output, *file_csv_output, *file_latency_output;
+    char filename[400], filename2[400], file_name_graphics[120];
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+    int num_threads = option_get_int(argc, argv, "threads", omp_get_max_threads());
+
+    /* define o número de threads com base no valor informado */
+    omp_set_num_threads(num_threads);
+
+    strftime(filename, sizeof(filename)-1, "../output/%Y%m%d-%H%M-inference.txt", t);
+    strftime(filename2, sizeof(filename2)-1, "../output/%Y%m%d-%H%M-inference.csv", t);
+
+    if((file_log_output = fopen(filename, "w")) == NULL) {
+        fprintf(stderr, "Não foi possível abrir o arquivo de log %s!\n", filename);
+        status = -1;
+        goto cleanup;
+    }
+
+    if(input_path == NULL) {
+        input_path = FOLD_FILES[0];
+    }
+
+    if(kernels_init(option_get(argc, argv, "isa")) == -1) {
+        fprintf(file_log_output, "Conjunto de instruções não suportado: %s", option_get(argc, argv, "isa"));
+        status = -1;
+        goto cleanup;
+    }
+
+    if(dtype == -1) {
+        fprintf(file_log_output, "Tipo de armazenamento não suportado: %s", option_get(argc, argv, "dtype"));
+        status = -1;
+        goto cleanup;
+    }
+
+    if(batch_size <= 0) {
+        fprintf(file_log_output, "Tamanho de lote inválido: %d", batch_size);
+        status = -1;
+        goto cleanup;
+    }
+
+    if(model_load(model_path, &model) == -1) {
+        fprintf(file_log_output, "Não foi possível carregar o modelo %s!", model_path);
+        status = -1;
+        goto cleanup;
+    }
+
+    /* modelos treinados com --resolution reduzem as imagens na leitura; os treinados com --projection as projetam em model_predict() */
+    if(set_resolution(model.width) == -1 || model.width * model.height != image_pixels) {
+        fprintf(file_log_output, "Resolução do modelo %s não suportada: %d x %d!", model_path, model.width, model.height);
+        status = -1;
+        goto cleanup;
+    }
+
+    time_reading_begin = omp_get_wtime();
+
+    /* um cache binário é mapeado diretamente; os demais arquivos são lidos como .csv */
+    if(cache_open(input_path, &images, &unused, 0, 0) == 0) {
+        dataset_free(&unused);
+        if(images.num_pixels == NUM_PIXELS && image_pixels != NUM_PIXELS && dataset_pool(&images, image_pixels) == -1) {
+            fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+            status = -1;
+            goto cleanup;
+        }
+    } else if(read_images(file_log_output, input_path, &images, image_pixels, dtype, 1 / model.pixel_scale) == -1) {
+        status = -1;
+        goto cleanup;
+    }
+
+    time_reading_end = omp_get_wtime();
+
+    if(images.num_pixels != image_pixels || images.num_images == 0) {
+        fprintf(file_log_output, "As imagens de %s não correspondem ao modelo (%d x %d)!", input_path, model.width, model.height);
+        status = -1;
+        goto cleanup;
+    }
+
+    num_batches = (images.num_images + batch_size - 1) / batch_size;
+    hypothesis = (float *) malloc(images.num_images * sizeof(float));
+    results = (int *) malloc(images.num_images * sizeof(int));
+    latencies = (double *) malloc(num_batches * sizeof(double));
+    sorted_latencies = (double *) malloc(num_batches * sizeof(double));
+
+    if(hypothesis == NULL || results == NULL || latencies == NULL || sorted_latencies == NULL) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        status = -1;
+        goto cleanup;
+    }
+
+    /* classifica as imagens lote a lote, medindo o tempo de cada lote */
+    for(int k = 0; k < num_batches; k++) {
+        int first_row = k * batch_size;
+        int num_rows = images.num_images - first_row < batch_size ? images.num_images - first_row : batch_size;
+        double time_batch_begin = omp_get_wtime();
+
+        model_predict(&model, &images, first_row, num_rows, hypothesis + first_row);
+
+        latencies[k] = omp_get_wtime() - time_batch_begin;
+    }
+
+    time_inference = 0;
+    for(int k = 0; k < num_batches; k++) {
+        time_inference += latencies[k];
+    }
+
+    //realiza binarização dos valores de hipótese
+    for(int r = 0; r < images.num_images; r++) {
+        results[r] = hypothesis[r] >= model.threshold;
+    }
+
+    memcpy(sorted_latencies, latencies, num_batches * sizeof(double));
+    qsort(sorted_latencies, num_batches, sizeof(double), compare_double);
+
+    fprintf(file_log_output, "RESULTADO - INFERÊNCIA:\n");
+    fprintf(file_log_output, "MODELO: %s (%d x %d pixels, %d épocas, taxa de aprendizado %f, %d imagens de treinamento)\n", model_path, model.width, model.height, model.num_epochs, model.learning_rate, model.num_images_training);
+    if(model.projection != NULL) {
+        fprintf(file_log_output, "PROJEÇÃO ALEATÓRIA: %d componentes (aplicada a cada lote)\n", model.num_weights);
+    }
+    fprintf(file_log_output, "ENTRADA: %s\n", input_path);
+    fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  TAMANHO DO LOTE: %d  /  NÚMERO DE LOTES: %d\n", images.num_images, batch_size, num_batches);
+    fprintf(file_log_output, "CONJUNTO DE INSTRUÇÕES: %s\n", kernels_isa_name());
+    fprintf(file_log_output, "ARMAZENAMENTO DOS PIXELS: %s (%.2f MB)\n", dataset_dtype_name(images.dtype), dataset_size(&images) / 1048576.0);
+    fprintf(file_log_output, "NÚMERO DE THREADS: %d\n", num_threads);
+    fprintf(file_log_output, "TEMPO DE LEITURA: %f s\n", time_reading_end - time_reading_begin);
+    fprintf(file_log_output, "TEMPO DE INFERÊNCIA: %f s\n", time_inference);
+    fprintf(file_log_output, "IMAGENS POR SEGUNDO: %.1f\n", images.num_images / time_inference);
+    fprintf(file_log_output, "LATÊNCIA POR LOTE (ms): média %.4f  /  mediana %.4f  /  p95 %.4f  /  máxima %.4f\n\n\n", time_inference / num_batches * 1000,
+        sorted_latencies[(num_batches - 1) / 2] * 1000, sorted_latencies[(int) (0.95 * (num_batches - 1))] * 1000, sorted_latencies[num_batches - 1] * 1000);
+
+    /* grava as predições e a matriz de confusão em relação às labels do arquivo */
+    if((file_csv_output = fopen(filename2, "w")) == NULL) {
+        fprintf(file_log_output, "Não foi possível abrir o arquivo de saída %s!", filename2);
+        status = -1;
+        goto cleanup;
+    }
+
+    save_testing_results(results, images.labels, images.num_images, images.names, file_log_output, file_csv_output);
+    fclose(file_csv_output);
+
+    /* grava o tempo de cada lote */
+    snprintf(file_name_graphics, sizeof(file_name_graphics), "../graphics/inference_latency_%d_images_%d_batch_output.csv", images.num_images, batch_size);
+
+    if((file_latency_output = fopen(file_name_graphics, "w")) != NULL) {
+        for(int k = 0; k < num_batches; k++) {
+            fprintf(file_latency_output, "%d,%f\n", k + 1, latencies[k]);
+        }
+        fclose(file_latency_output);
+    } else {
+        status = -1;
+    }
+
+cleanup:
+    dataset_free(&images);
+    model_free(&model);
+    free(hypothesis);
+    free(results);
+    free(latencies);
+    free(sorted_latencies);
+
+    if(file_log_output != NULL) {
+        fclose(file_log_output);
+    }
+
+    return status;
+}
+
+/**
+ * @brief Executa a varredura de taxas de aprendizado (--sweep).
+ * 
+ * Treina todos os modelos da varredura por num_max_epochs épocas de lote
+ * completo (ver train_sweep_epoch()). Os resultados de cada época de cada
+ * modelo são gravados pelo escritor assíncrono no log e nos arquivos de
+ * custo, acurácia, precisão, revocação, F1 e acurácia em função do tempo
+ * do modelo, identificados pelo índice e pela taxa de aprendizado. Ao
+ * final, cada modelo é gravado e avaliado nas imagens de teste.
+ * 
+ * @param file_log_output ponteiro para o arquivo de log de saída
+ * @param sweep varredura inicializada por sweep_init()
+ * @param training contêiner com o dataset de treinamento
+ * @param testing contêiner com o dataset de teste
+ * @param num_max_epochs número de épocas
+ * @param run_name nome da execução, usado nos arquivos de saída
+ * @param argv argumentos da linha de comando, usados nos nomes dos arquivos de saída
+ * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
+ */
+int run_sweep(FILE *file_log_output, sweep_t *sweep, const dataset_t *training, dataset_t *testing, int num_max_epochs, const char *run_name, char *argv[]) {
+    static const char *prefixes[] = { "cost", "accuracy", "precision", "f1", "recall", "accuracy_time" };
+    int *results_testing = (int *) malloc(NUM_IMAGES_TESTING * sizeof(int));
+    double time_training_begin, time_training_end;
+    epoch_record_t record = { 0 };
+    sink_t sink;
+    char path[400];
+
+    /* cria os arquivos de saída de dados de cada modelo */
+    for(int m = 0; m < sweep->num_models; m++) {
+        epoch_files_t *files = &sweep->files[m];
+        FILE **outputs[] = { &files->cost, &files->accuracy, &files->precision, &files->f1, &files->recall, &files->accuracy_time };
+
+        files->log = file_log_output;
+
+        for(int o = 0; o < (int) (sizeof(outputs) / sizeof(outputs[0])); o++) {
+            snprintf(path, sizeof(path), "../graphics/%s_%s_pdataset_%s_epochs_model_%d_lr_%g_output.csv", prefixes[o], argv[4], argv[1], m, sweep->optimizers[m].learning_rate);
+
+            if((*outputs[o] = fopen(path, "w")) == NULL) {
+                fprintf(file_log_output, "Não foi possível criar o arquivo %s!", path);
+                return -1;
+            }
+        }
+    }
+
+    if(results_testing == NULL || sink_open(&sink, sizeof(epoch_record_t), SINK_DEFAULT_CAPACITY, write_sweep_record, flush_sweep_files, sweep) == -1) {
+        fprintf(file_log_output, "Não foi possível iniciar o escritor assíncrono!");
+        return -1;
+    }
+
+    time_training_begin = omp_get_wtime();
+
+    for(int epoch = 0; epoch < num_max_epochs; epoch++) {
+        #pragma omp parallel
+        train_sweep_epoch(training, sweep);
+
+        record.epoch_num = epoch;
+        record.num_images = training->num_images;
+        record.elapsed = omp_get_wtime() - time_training_begin;
+
+        for(int m = 0; m < sweep->num_models; m++) {
+            record.model = m;
+            memcpy(record.metrics, sweep->metrics + m * NUM_METRICS, sizeof(record.metrics));
+            sink_push(&sink, &record);
+        }
+    }
+
+    time_training_end = omp_get_wtime();
+
+    /* aguarda a gravação dos registros pendentes antes de voltar a escrever no log */
+    sink_close(&sink);
+
+    fprintf(file_log_output, "TEMPO DE TREINAMENTO: %f s  /  POR MODELO: %f s\n", time_training_end - time_training_begin, (time_training_end - time_training_begin) / sweep->num_models);
+
+    fprintf(file_log_output, "\n\n\nRESULTADO - TESTE:\n");
+    fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d\n\n\n", NUM_IMAGES_TESTING);
+
+    for(int m = 0; m < sweep->num_models; m++) {
+        epoch_files_t *files = &sweep->files[m];
+        float *weights = sweep->weights + m * image_pixels;
+        float learning_rate = sweep->optimizers[m].learning_rate;
+        FILE *file_csv_output;
+
+        fclose(files->cost);
+        fclose(files->accuracy);
+        fclose(files->precision);
+        fclose(files->f1);
+        fclose(files->recall);
+        fclose(files->accuracy_time);
+
+        fprintf(file_log_output, "-- MODELO %d  /  TAXA DE APRENDIZADO: %f --\n", m, learning_rate);
+
+        /* grava o modelo treinado */
+        model_t model = { weights, image_width, image_height, image_pixels, MODEL_BIAS_ROW, PIXEL_SCALE, 0.5f, learning_rate, num_max_epochs, training->num_images,
+            image_projection.num_components > 0 ? &image_projection : NULL };
+
+        snprintf(path, sizeof(path), "../output/%s-model-%d.bin", run_name, m);
+
+        if(model_save(path, &model) == -1) {
+            fprintf(file_log_output, "Não foi possível gravar o modelo %s!\n", path);
+        } else {
+            fprintf(file_log_output, "MODELO: %s\n", path);
+        }
+
+        //executa a etapa de testes
+        #pragma omp parallel for schedule(static)
+        for(int r = 0; r < NUM_IMAGES_TESTING; r++) {
+            results_testing[r] = hypothesis_function(testing, r, weights) >= 0.5;
+        }
+
+        snprintf(path, sizeof(path), "../output/%s-output-%d.csv", run_name, m);
+
+        if((file_csv_output = fopen(path, "w")) == NULL) {
+            fprintf(file_log_output, "Não foi possível criar o arquivo %s!", path);
+            return -1;
+        }
+
+        save_testing_results(results_testing, testing->labels, NUM_IMAGES_TESTING, testing->names, file_log_output, file_csv_output);
+        fprintf(file_log_output, "\n");
+        fclose(file_csv_output);
+    }
+
+    free(results_testing);
+
+    return 0;
+}
+
+/**
+ * @brief Separa uma faixa de linhas de um contêiner em uma visão.
+ * 
+ * @param dataset contêiner de dados
+ * @param first_row primeira linha da faixa
+ * @param num_rows número de linhas da faixa
+ * @param view visão que recebe as linhas [first_row, first_row + num_rows)
+ */
+void dataset_range(const dataset_t *dataset, int first_row, int num_rows, dataset_t *view) {
+    dataset_t head = *dataset;
+
+    head.num_images = first_row + num_rows;
+    dataset_split(&head, num_rows, view);
+}
+
+/**
+ * @brief Executa a validação cruzada nos NUM_FOLDS arquivos de entrada (--cross-validation).
+ * 
+ * Os arquivos são lidos uma única vez, como no treinamento (o primeiro no
+ * contêiner de teste e os demais no de treinamento, após o bias), e cada
+ * arquivo passa a ser uma visão somente leitura das matrizes. O modelo do
+ * arquivo k é treinado com o bias e os demais arquivos e avaliado no
+ * arquivo k; todos os modelos partem dos mesmos pesos iniciais.
+ * 
+ * Os modelos são treinados concorrentemente: as threads são divididas em
+ * até NUM_FOLDS grupos, e cada grupo treina um modelo por vez com uma
+ * região paralela aninhada. O log registra as métricas de teste e o tempo
+ * de cada modelo, além da média e do desvio padrão amostral das métricas,
+ * que também são gravadas, uma linha por arquivo, em ../graphics.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv argumentos posicionais do treinamento (o número de imagens é
+ * ignorado: todas as imagens dos arquivos são usadas) e as opções:
+ * --isa, --dtype, --cache, --momentum, --nesterov, --resolution e --projection, como no treinamento
+ * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
+ */
+int run_cross_validation(int argc, char *argv[]) {
+    int num_max_epochs = atoi(argv[1]);
+    float learning_rate = atof(argv[2]);
+    int num_threads = atoi(argv[3]);
+    const char *cache_path = option_get(argc, argv, "cache");
+    const char *dtype_name = option_get(argc, argv, "dtype");
+    float momentum = option_get_float(argc, argv, "momentum", 0);
+    int nesterov = option_get(argc, argv, "nesterov") != NULL;
+    int dtype, num_images_training = 1, status = 0;
+    int num_groups = num_threads < NUM_FOLDS ? num_threads : NUM_FOLDS;
+    int fold_rows[NUM_FOLDS], fold_groups[NUM_FOLDS];
+    double time_reading_begin, time_reading_end, time_begin, time_total;
+    double fold_metrics[NUM_FOLDS][NUM_METRICS], fold_scores[NUM_FOLDS][4], fold_times[NUM_FOLDS];
+    static const char *score_names[] = { "ACURÁCIA", "PRECISÃO", "REVOCAÇÃO", "F1" };
+    dataset_t testing, training, folds[NUM_FOLDS], bias;
+    float *initial_weights;
+    FILE *file_log_output, *file_cv_output;
+    char filename[400], file_name_graphics[120];
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+
+    strftime(filename, sizeof(filename)-1, "../output/%Y%m%d-%H%M-cross-validation.txt", t);
+
+    file_log_output = fopen(filename, "w");
+
+    if(num_max_epochs <= 0 || num_threads <= 0) {
+        fprintf(file_log_output, "Número de épocas ou de threads inválido!");
+        return -1;
+    }
+
+    if(kernels_init(option_get(argc, argv, "isa")) == -1) {
+        fprintf(file_log_output, "Conjunto de instruções não suportado: %s", option_get(argc, argv, "isa"));
+        return -1;
+    }
+
+    if((dtype = dataset_dtype_from_name(dtype_name)) == -1) {
+        fprintf(file_log_output, "Tipo de armazenamento não suportado: %s", dtype_name);
+        return -1;
+    }
+
+    if(set_resolution(option_get_int(argc, argv, "resolution", IMAGE_WIDTH)) == -1) {
+        fprintf(file_log_output, "Resolução não suportada: %s", option_get(argc, argv, "resolution"));
+        return -1;
+    }
+
+    if(set_projection(option_get_int(argc, argv, "projection", 0)) == -1) {
+        fprintf(file_log_output, "Projeção não suportada: %s (use de 1 a %d componentes)", option_get(argc, argv, "projection"), image_width * image_height - 1);
+        return -1;
+    }
+
+    /* número de imagens de cada arquivo de treinamento, que define as visões */
+    for(int k = 1; k < NUM_FOLDS; k++) {
+        if((fold_rows[k] = cache_count_lines(FOLD_FILES + k, 1)) == -1) {
+            fprintf(file_log_output, "Não foi possível abrir o arquivo %s!", FOLD_FILES[k]);
+            return -1;
+        }
+        num_images_training += fold_rows[k];
+    }
+
+    time_reading_begin = omp_get_wtime();
+    omp_set_num_threads(num_threads);
+
+    if(cache_path != NULL) {
+        if(read_cached_data_and_labels(file_log_output, *cache_path != '\0' ? cache_path : DEFAULT_CACHE_FILES[dtype], &testing, &training, num_images_training, dtype) == -1) {
+            return -1;
+        }
+    } else {
+        if((fold_rows[0] = cache_count_lines(FOLD_FILES, 1)) == -1 || dataset_alloc(&testing, fold_rows[0], image_width * image_height, dtype) == -1
+            || dataset_alloc(&training, num_images_training, image_width * image_height, dtype) == -1) {
+            fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+            return -1;
+        }
+
+        if(read_data_and_labels(file_log_output, &testing, &training) == -1) {
+            return -1;
+        }
+    }
+
+    /* --projection: as imagens são projetadas uma única vez, antes da divisão nas visões */
+    if(image_projection.num_components > 0 && (dataset_project(&testing, &image_projection) == -1 || dataset_project(&training, &image_projection) == -1)) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        return -1;
+    }
+
+    time_reading_end = omp_get_wtime();
+
+    if(training.num_images != num_images_training) {
+        fprintf(file_log_output, "O número de imagens de treinamento (%d) não corresponde aos arquivos de entrada (%d)!", training.num_images - 1, num_images_training - 1);
+        return -1;
+    }
+
+    /* visões de cada arquivo; o bias é a linha 0 do contêiner de treinamento */
+    folds[0] = testing;
+    fold_rows[0] = testing.num_images;
+    dataset_range(&training, 0, 1, &bias);
+    for(int k = 1, first_row = 1; k < NUM_FOLDS; first_row += fold_rows[k], k++) {
+        dataset_range(&training, first_row, fold_rows[k], &folds[k]);
+    }
+
+    initial_weights = (float *) malloc(image_pixels * sizeof(float));
+    initialize_weights(initial_weights, num_images_training);
+
+    fprintf(file_log_output, "RESULTADO - VALIDAÇÃO CRUZADA:\n");
+    fprintf(file_log_output, "NÚMERO DE ARQUIVOS: %d  /  IMAGENS POR ARQUIVO:", NUM_FOLDS);
+    for(int k = 0; k < NUM_FOLDS; k++) {
+        fprintf(file_log_output, " %d", fold_rows[k]);
+    }
+    fprintf(file_log_output, "\nNÚMERO DE ÉPOCAS: %d  /  TAXA DE APRENDIZADO: %f  /  MOMENTO: %f%s\n", num_max_epochs, learning_rate, momentum, nesterov ? " (Nesterov)" : "");
+    fprintf(file_log_output, "CONJUNTO DE INSTRUÇÕES: %s\n", kernels_isa_name());
+    fprintf(file_log_output, "ARMAZENAMENTO DOS PIXELS: %s (%.2f MB, lidos uma única vez)\n", dataset_dtype_name(dtype), (dataset_size(&testing) + dataset_size(&training)) / 1048576.0);
+    fprintf(file_log_output, "RESOLUÇÃO: %d x %d\n", image_width, image_height);
+    if(image_projection.num_components > 0) {
+        fprintf(file_log_output, "PROJEÇÃO ALEATÓRIA: %d componentes (%d elementos não nulos)\n", image_projection.num_components, projection_num_nonzeros(&image_projection));
+    }
+    fprintf(file_log_output, "TEMPO DE LEITURA: %f s\n", time_reading_end - time_reading_begin);
+    fprintf(file_log_output, "NÚMERO DE THREADS: %d  /  GRUPOS DE THREADS: %d\n\n\n", num_threads, num_groups);
+
+    /* cada grupo de threads treina um modelo por vez, com uma região paralela aninhada */
+    omp_set_max_active_levels(2);
+    time_begin = omp_get_wtime();
+
+    #pragma omp parallel for num_threads(num_groups) schedule(dynamic, 1) reduction(|:status)
+    for(int k = 0; k < NUM_FOLDS; k++) {
+        int group = omp_get_thread_num();
+        int group_threads = num_threads / num_groups + (group < num_threads % num_groups);
+        float *weights = (float *) malloc(image_pixels * sizeof(float));
+        float *gradients = (float *) malloc(image_pixels * sizeof(float));
+        double *metrics = fold_metrics[k];
+        dataset_t segments[NUM_FOLDS];
+        optimizer_t optimizer;
+        double fold_begin = omp_get_wtime();
+
+        if(weights == NULL || gradients == NULL || optimizer_init(&optimizer, image_pixels, learning_rate, momentum, nesterov, 0, 1) == -1) {
+            status |= -1;
+            free(weights);
+            free(gradients);
+            continue;
+        }
+
+        /* treinamento: o bias e os demais arquivos */
+        segments[0] = bias;
+        for(int j = 0, s = 1; j < NUM_FOLDS; j++) {
+            if(j != k) {
+                segments[s++] = folds[j];
+            }
+        }
+
+        memcpy(weights, initial_weights, image_pixels * sizeof(float));
+
+        for(int epoch = 0; epoch < num_max_epochs; epoch++) {
+            #pragma omp parallel num_threads(group_threads)
+            train_segments_epoch(segments, NUM_FOLDS, weights, &optimizer, gradients, metrics);
+        }
+
+        /* avaliação no arquivo separado */
+        const dataset_t *fold = &folds[k];
+
+        memset(metrics, 0, NUM_METRICS * sizeof(double));
+
+        #pragma omp parallel for num_threads(group_threads) schedule(static) reduction(+:metrics[:NUM_METRICS])
+        for(int r = 0; r < fold->num_images; r++) {
+            accumulate_metrics(metrics, hypothesis_function(fold, r, weights), fold->labels[r]);
+        }
+
+        fold_times[k] = omp_get_wtime() - fold_begin;
+        fold_groups[k] = group_threads;
+
+        optimizer_free(&optimizer);
+        free(weights);
+        free(gradients);
+    }
+
+    time_total = omp_get_wtime() - time_begin;
+
+    if(status != 0) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os modelos!");
+        return -1;
+    }
+
+    snprintf(file_name_graphics, sizeof(file_name_graphics), "../graphics/cross_validation_%d_folds_%d_epochs_output.csv", NUM_FOLDS, num_max_epochs);
+    file_cv_output = fopen(file_name_graphics, "w");
+
+    /* métricas de teste de cada arquivo; uma divisão por zero conta como 0 */
+    for(int k = 0; k < NUM_FOLDS; k++) {
+        double *metrics = fold_metrics[k];
+        double true_positive = metrics[METRIC_TRUE_POSITIVE], true_negative = metrics[METRIC_TRUE_NEGATIVE];
+        double false_positive = metrics[METRIC_FALSE_POSITIVE], false_negative = metrics[METRIC_FALSE_NEGATIVE];
+        double *scores = fold_scores[k];
+
+        scores[0] = (true_positive + true_negative) / folds[k].num_images;
+        scores[1] = true_positive + false_positive > 0 ? true_positive / (true_positive + false_positive) : 0;
+        scores[2] = true_positive + false_negative > 0 ? true_positive / (true_positive + false_negative) : 0;
+        scores[3] = scores[1] + scores[2] > 0 ? 2 * scores[1] * scores[2] / (scores[1] + scores[2]) : 0;
+
+        fprintf(file_log_output, "-- ARQUIVO %d (%s) --\n", k, FOLD_FILES[k]);
+        fprintf(file_log_output, "IMAGENS DE TREINAMENTO: %d  /  IMAGENS DE TESTE: %d  /  THREADS: %d  /  TEMPO: %f s\n", num_images_training + fold_rows[0] - fold_rows[k], folds[k].num_images, fold_groups[k], fold_times[k]);
+        fprintf(file_log_output, "MATRIZ DE CONFUSÃO:\n");
+        fprintf(file_log_output, "%d    %d\n", (int) true_negative, (int) false_positive);
+        fprintf(file_log_output, "%d    %d\n\n", (int) false_negative, (int) true_positive);
+        fprintf(file_log_output, "Acurácia: %f      Precisão: %f        Revocação: %f       F1: %f      Custo: %f\n\n", scores[0], scores[1], scores[2], scores[3], metrics[METRIC_COST] / folds[k].num_images);
+
+        if(file_cv_output != NULL) {
+            fprintf(file_cv_output, "%d,%f,%f,%f,%f,%f\n", k, scores[0], scores[1], scores[2], scores[3], fold_times[k]);
+        }
+    }
+
+    /* média e desvio padrão amostral entre os arquivos */
+    fprintf(file_log_output, "\n\n\nRESULTADO - MÉDIA ENTRE OS ARQUIVOS:\n");
+    for(int i = 0; i < 4; i++) {
+        double mean = 0, variance = 0;
+
+        for(int k = 0; k < NUM_FOLDS; k++) {
+            mean += fold_scores[k][i] / NUM_FOLDS;
+        }
+        for(int k = 0; k < NUM_FOLDS; k++) {
+            variance += (fold_scores[k][i] - mean) * (fold_scores[k][i] - mean) / (NUM_FOLDS - 1);
+        }
+
+        fprintf(file_log_output, "%s: %f +- %f\n", score_names[i], mean, sqrt(variance));
+    }
+
+    fprintf(file_log_output, "TEMPO TOTAL: %f s  /  SOMA DOS TEMPOS DOS ARQUIVOS: %f s\n", time_total, fold_times[0] + fold_times[1] + fold_times[2] + fold_times[3] + fold_times[4]);
+
+    if(file_cv_output != NULL) {
+        fclose(file_cv_output);
+    } else {
+        status = -1;
+    }
+
+    dataset_free(&testing);
+    dataset_free(&training);
+    free(initial_weights);
+
+    fclose(file_log_output);
+
+    return status;
+}
+
+/**
+ * @brief Função principal, na qual é iniciada a execução do algoritmo.
+ * 
+ * Função principal, na qual é iniciada a execução do algoritmo de acordo
+ * com os argumntos informados no terminal para número de épocas e taxa
+ * de aprendizagem.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv vetor contendo os argumentos número de épocas, taxa de aprendizado,
+ * número de threads, número de imagens e, opcionalmente, o tempo de treinamento
+ * serial de referência em segundos, seguidos das opções:
+ * --isa=scalar|sse2|avx2|avx512 força o conjunto de instruções dos kernels
+ * --cache[=arquivo] lê os dados do cache binário, criando-o quando necessário
+ * --dtype=float32|uint8|float16|bfloat16 define o armazenamento dos pixels (uint8 ocupa 1/4 da memória; float16 e bfloat16, metade)
+ * --batch=B treina em mini-lotes de B imagens, embaralhadas a cada época
+ * --momentum=m aplica momento com coeficiente m; --nesterov usa o momento de Nesterov
+ * --stream[=MB] lê as imagens de treinamento do cache em blocos, com a memória dos buffers limitada a MB (padrão: STREAM_DEFAULT_BUDGET_MB)
+ * --model=arquivo define o arquivo em que o modelo treinado é gravado (padrão: ../output/<data>-model.bin)
+ * --checkpoint-epochs=K e --checkpoint-seconds=T gravam um checkpoint a cada K épocas e/ou T segundos
+ * --checkpoint=arquivo define o arquivo de checkpoint (padrão: DEFAULT_CHECKPOINT_FILE)
+ * --resume retoma o treinamento do checkpoint, continuando os arquivos de saída da execução interrompida
+ * --validation=f separa a fração f das imagens de treinamento para validação; ao final, os pesos da época de menor custo de validação são restaurados
+ * --patience=P encerra o treinamento após P épocas sem redução do custo de validação maior que --min-delta=d
+ * --target-f1=f encerra o treinamento quando o F1 de validação atinge f (mantendo os pesos dessa época)
+ * --numa fixa as threads nas CPUs dos nós NUMA, copia as imagens de treinamento para a memória das threads que as processam e soma os gradientes em árvore, por nó (ver topology.h)
+ * --sweep=lr1,lr2,... treina um modelo por taxa de aprendizado, no lugar da taxa informada, na mesma passagem pelos dados (ver run_sweep())
+ * --predict=arquivo apenas classifica imagens com um modelo gravado (ver run_inference())
+ * --cross-validation avalia o modelo por validação cruzada nos NUM_FOLDS arquivos de entrada, no lugar do treinamento (ver run_cross_validation())
+ * --resolution=W reduz as imagens na leitura para W x W pixels (128, 64 ou 32), pela média de blocos de pixels
+ * --lbfgs[=m] substitui o gradiente descendente pelo L-BFGS com m pares de histórico (padrão LBFGS_DEFAULT_HISTORY) e busca em linha de Wolfe; cada época é uma iteração (ver lbfgs.h)
+ * --hogwild substitui o gradiente do lote completo pelo SGD assíncrono sem travas: cada thread atualiza os pesos compartilhados a cada imagem da sua fatia
+ * --projection=k treina com k componentes de uma projeção aleatória esparsa das imagens, gravada com o modelo (ver projection.h)
+ * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
+ */
+int main(int argc, char *argv[]) {
+    /* --predict: executa apenas a inferência, sem os argumentos posicionais do treinamento */
+    if(option_get(argc, argv, "predict") != NULL) {
+        return run_inference(argc, argv);
+    }
+
+    /* --cross-validation: treina e avalia um modelo por arquivo de entrada */
+    if(option_get(argc, argv, "cross-validation") != NULL) {
+        return run_cross_validation(argc, argv);
+    }
+
+    /* --resolution: define o tamanho dos vetores antes da alocação; uma resolução não suportada é registrada no log */
+    int resolution_supported = set_resolution(option_get_int(argc, argv, "resolution", IMAGE_WIDTH)) == 0;
+
+    /* --projection: o número de pesos passa a ser o número de componentes */
+    int projection_supported = set_projection(option_get_int(argc, argv, "projection", 0)) == 0;
+
+    /** obtém os argumentos, converte para int ou float e inicializa o número de 
+     * épocas e a taxa de aprendizado **/
+    int num_max_epochs = atoi(argv[1]);
+    float learning_rate = atof(argv[2]);
+    int num_total_images_training = atoi(argv[4]);
+    double time_serial = (argc > 5 && argv[5][0] != '-') ? atof(argv[5]) : 0; //tempo serial de referência
+    double time_training_begin, time_training_end; //tempo de treinamento
+    double time_reading_begin, time_reading_end; //tempo de leitura dos dados
+    double time_projection = 0; //tempo da projeção das imagens
+    const char *cache_path = option_get(argc, argv, "cache"); //cache binário do dataset
+    const char *dtype_name = option_get(argc, argv, "dtype"); //armazenamento dos pixels
+    int dtype;
+    const char *model_path = option_get(argc, argv, "model"); //arquivo do modelo treinado
+    int streaming = option_get(argc, argv, "stream") != NULL; //treinamento fora da memória
+    int stream_budget = option_get_int(argc, argv, "stream", STREAM_DEFAULT_BUDGET_MB); //memória dos buffers de leitura, em MB
+    int batch_size = option_get_int(argc, argv, "batch", 0); //imagens por mini-lote; 0 para o lote completo
+    float momentum = option_get_float(argc, argv, "momentum", 0); //coeficiente do momento
+    int nesterov = option_get(argc, argv, "nesterov") != NULL; //momento de Nesterov
+    const char *checkpoint_path = option_get(argc, argv, "checkpoint"); //arquivo de checkpoint
+    int checkpoint_epochs = option_get_int(argc, argv, "checkpoint-epochs", 0); //épocas entre dois checkpoints
+    float checkpoint_seconds = option_get_float(argc, argv, "checkpoint-seconds", 0); //segundos entre dois checkpoints
+    int resuming = option_get(argc, argv, "resume") != NULL; //retoma o treinamento do checkpoint
+    float validation_fraction = option_get_float(argc, argv, "validation", 0); //fração das imagens de treinamento usada na validação
+    int validating = validation_fraction > 0;
+    int numa = option_get(argc, argv, "numa") != NULL; //fixa as threads e posiciona os dados nos nós NUMA
+    const char *sweep_rates = option_get(argc, argv, "sweep"); //taxas de aprendizado da varredura
+    int lbfgs_history = option_get(argc, argv, "lbfgs") != NULL ? option_get_int(argc, argv, "lbfgs", LBFGS_DEFAULT_HISTORY) : 0; //pares do L-BFGS; 0 para o gradiente descendente
+    int hogwild_enabled = option_get(argc, argv, "hogwild") != NULL; //SGD assíncrono sem travas
+
+    /* define o número de threads com base no valor informado */
+    omp_set_num_threads(atoi(argv[3]));
+
+    /* vetor de pesos */
+    float *weights = (float *) malloc(image_pixels * sizeof(float));
+    /* número de épocas */
+    int num_epochs = 0;
+
+    int corretos = 0;
+    
+    /* ordem de visita das imagens nos mini-lotes */
+    int *order = (int *) malloc(num_total_images_training * sizeof(int));
+
+    int *results_testing = (int *) malloc(NUM_IMAGES_TESTING * sizeof(int));
+
+    /* vetor gradiente compartilhado entre as threads */
+    float *gradients = (float *) malloc(image_pixels * sizeof(float));
+
+    /* métricas da época, indexadas por METRIC_* */
+    double metrics[NUM_METRICS];
+
+    /* otimizador: taxa de aprendizado, momento e tamanho dos lotes */
+    optimizer_t optimizer;
+
+    /* leitura em blocos das imagens de treinamento (--stream) */
+    stream_t stream;
+
+    /* escritor assíncrono dos resultados de cada época e os arquivos que ele grava */
+    sink_t sink;
+    epoch_files_t epoch_files;
+
+    /* registro da época enviado ao escritor assíncrono */
+    epoch_record_t record = { 0 };
+
+    /* estado gravado nos checkpoints e estado carregado por --resume (resumed é NULL sem --resume) */
+    checkpoint_t checkpoint, resume, *resumed = NULL;
+
+    /* imagens de validação (--validation), métricas de validação da época e critérios de parada antecipada */
+    dataset_t validation = { 0 };
+    double validation_metrics[NUM_METRICS];
+    early_stopping_t stopping = { option_get_int(argc, argv, "patience", 0), option_get_float(argc, argv, "min-delta", 0), option_get_float(argc, argv, "target-f1", 0), INFINITY, 0, 0, 0, NULL };
+    int stop_reason = STOP_NONE;
+
+    /* número de imagens de treinamento e de validação (em todos os processos) */
+    int num_images_training = num_total_images_training, num_images_validation = 0;
+
+    /* número de checkpoints gravados, tempo gasto nas gravações e instante da última */
+    int num_checkpoints = 0;
+    double time_checkpoints = 0, time_last_checkpoint;
+
+    /* bloco atual da leitura em blocos, compartilhado entre as threads */
+    dataset_t chunk;
+
+    /* distribuição das threads nos nós NUMA (--numa); epoch_topology é NULL sem --numa */
+    topology_t topology, *epoch_topology = NULL;
+    double time_placement = 0;
+
+    /* modelos treinados na varredura de taxas de aprendizado (--sweep); num_models é 0 sem --sweep */
+    sweep_t sweep = { 0 };
+
+    /* otimizador L-BFGS (--lbfgs), a sua função de custo e o arquivo com o custo em função do tempo */
+    lbfgs_t lbfgs = { 0 };
+    full_batch_t full_batch;
+    FILE *file_cost_time_output = NULL;
+
+    /* SGD assíncrono sem travas (--hogwild); num_threads é 0 sem --hogwild */
+    hogwild_t hogwild = { 0 };
+    double time_epoch_begin;
 
     /* ponteiro para o arquivo de entrada */
     FILE *file_input;
 
-    /* ponteiro para o arquivos de log de saída */
-    FILE *file_log_output, *file_csv_output;
+    /* ponteiro para o arquivos de log de saída; com --sweep, apenas o log é aberto aqui (ver run_sweep()) */
+    FILE *file_log_output, *file_csv_output = NULL;
 
     /* ponteiro para o arquivo de dados de saída */
-    FILE *file_cost_output, *file_accuracy_output, *file_precision_output, *file_recall_output, *file_f1_output;
+    FILE *file_cost_output = NULL, *file_accuracy_output = NULL, *file_precision_output = NULL, *file_recall_output = NULL, *file_f1_output = NULL;
+
+    /* ponteiro para o arquivo com a acurácia em função do tempo de treinamento */
+    FILE *file_accuracy_time_output = NULL;
 
     /* linha do arquivo */
     char *line; 
 
-    /* matrizes com dados para teste e treinamento */
-    float **data_testing, **data_training; 
+    /* contêineres com dados, labels e nomes das imagens para teste e treinamento */
+    dataset_t testing, training;
 
-    /* vetores com labels para teste e treinamento */
-    int *labels_testing, *labels_training;
-
-    /* nomes das imagens lidas */
-    char testing_images_names[NUM_IMAGES_TESTING][60];
-
-    char filename[400], filename2[400];
+    char filename[400], filename2[400], filename3[400], run_name[CHECKPOINT_RUN_NAME_SIZE];
     time_t now = time(NULL);
     struct tm *t = localtime(&now);
-    strftime(filename, sizeof(filename)-1, "../output/%Y%m%d-%H%M-output.txt", t);
-    strftime(filename2, sizeof(filename2)-1, "../output/%Y%m%d-%H%M-output.csv", t);
+    strftime(run_name, sizeof(run_name)-1, "%Y%m%d-%H%M", t);
+
+    if(checkpoint_path == NULL || *checkpoint_path == '\0') {
+        checkpoint_path = DEFAULT_CHECKPOINT_FILE;
+    }
+
+    /* --resume: o checkpoint deve ter sido gravado com os mesmos parâmetros; a execução continua os arquivos da interrompida */
+    if(resuming && checkpoint_load(checkpoint_path, &resume) == 0) {
+        if(resume.num_weights == image_pixels && resume.num_images == num_total_images_training && resume.num_seeds == 1 && resume.batch_size == (batch_size > 0 ? batch_size : 0)
+            && resume.learning_rate == learning_rate && resume.momentum == momentum && resume.nesterov == nesterov && resume.validation_fraction == validation_fraction) {
+            resumed = &resume;
+            strcpy(run_name, resume.run_name);
+        } else {
+            checkpoint_free(&resume);
+        }
+    }
+
+    snprintf(filename, sizeof(filename), "../output/%s-output.txt", run_name);
+    snprintf(filename2, sizeof(filename2), "../output/%s-output.csv", run_name);
+    snprintf(filename3, sizeof(filename3), "../output/%s-model.bin", run_name);
 
     /* cria o arquivo log de saída */
-    file_log_output = fopen(filename, "w");
-    file_csv_output = fopen(filename2, "w");
+    file_log_output = open_output(filename, resumed, OUTPUT_LOG);
+
+    if(file_log_output == NULL) {
+        fprintf(stderr, "Não foi possível abrir o arquivo de log %s!\n", filename);
+        return -1;
+    }
 
-    char file_name_graphics[80], *file_name_middle = "_pdataset_", *file_name_end = "_epochs_output.csv";
+    /* --sweep: cada modelo da varredura tem os seus próprios arquivos de saída (ver run_sweep()) */
+    if(sweep_rates == NULL) {
+        file_csv_output = open_output(filename2, resumed, OUTPUT_CSV);
 
-    /* cria os arquivos de saída de dados */
-    strcpy(file_name_graphics, "../graphics/cost_");
-    strcat(file_name_graphics, argv[4]);
-    strcat(file_name_graphics, file_name_middle);
-    strcat(file_name_graphics, argv[1]);
-    strcat(file_name_graphics, file_name_end);
+        char file_name_graphics[80], *file_name_middle = "_pdataset_", *file_name_end = "_epochs_output.csv";
 
-    file_cost_output = fopen(file_name_graphics, "w");
+        /* cria os arquivos de saída de dados */
+        strcpy(file_name_graphics, "../graphics/cost_");
+        strcat(file_name_graphics, argv[4]);
+        strcat(file_name_graphics, file_name_middle);
+        strcat(file_name_graphics, argv[1]);
+        strcat(file_name_graphics, file_name_end);
 
-    strcpy(file_name_graphics, "../graphics/accuracy_");
-    strcat(file_name_graphics, argv[4]);
-    strcat(file_name_graphics, file_name_middle);
-    strcat(file_name_graphics, argv[1]);
-    strcat(file_name_graphics, file_name_end);
+        file_cost_output = open_output(file_name_graphics, resumed, OUTPUT_COST);
 
-    file_accuracy_output = fopen(file_name_graphics, "w");
+        strcpy(file_name_graphics, "../graphics/accuracy_");
+        strcat(file_name_graphics, argv[4]);
+        strcat(file_name_graphics, file_name_middle);
+        strcat(file_name_graphics, argv[1]);
+        strcat(file_name_graphics, file_name_end);
 
-    strcpy(file_name_graphics, "../graphics/precision_");
-    strcat(file_name_graphics, argv[4]);
-    strcat(file_name_graphics, file_name_middle);
-    strcat(file_name_graphics, argv[1]);
-    strcat(file_name_graphics, file_name_end);
+        file_accuracy_output = open_output(file_name_graphics, resumed, OUTPUT_ACCURACY);
 
-    file_precision_output = fopen(file_name_graphics, "w");
+        strcpy(file_name_graphics, "../graphics/precision_");
+        strcat(file_name_graphics, argv[4]);
+        strcat(file_name_graphics, file_name_middle);
+        strcat(file_name_graphics, argv[1]);
+        strcat(file_name_graphics, file_name_end);
 
-    strcpy(file_name_graphics, "../graphics/recall_");
-    strcat(file_name_graphics, argv[4]);
-    strcat(file_name_graphics, file_name_middle);
-    strcat(file_name_graphics, argv[1]);
-    strcat(file_name_graphics, file_name_end);
+        file_precision_output = open_output(file_name_graphics, resumed, OUTPUT_PRECISION);
 
-    file_recall_output = fopen(file_name_graphics, "w");
+        strcpy(file_name_graphics, "../graphics/recall_");
+        strcat(file_name_graphics, argv[4]);
+        strcat(file_name_graphics, file_name_middle);
+        strcat(file_name_graphics, argv[1]);
+        strcat(file_name_graphics, file_name_end);
 
-    strcpy(file_name_graphics, "../graphics/f1_");
-    strcat(file_name_graphics, argv[4]);
-    strcat(file_name_graphics, file_name_middle);
-    strcat(file_name_graphics, argv[1]);
-    strcat(file_name_graphics, file_name_end);
+        file_recall_output = open_output(file_name_graphics, resumed, OUTPUT_RECALL);
 
-    file_f1_output = fopen(file_name_graphics, "w");
+        strcpy(file_name_graphics, "../graphics/f1_");
+        strcat(file_name_graphics, argv[4]);
+        strcat(file_name_graphics, file_name_middle);
+        strcat(file_name_graphics, argv[1]);
+        strcat(file_name_graphics, file_name_end);
 
-    /* realiza alocação de espaços de memórias para matrizes e vetores usados */
-    data_testing = (float **) malloc(NUM_IMAGES_TESTING * sizeof(float *));
-    data_training = (float **) malloc(num_total_images_training * sizeof(float *));
-    labels_testing = (int *) malloc(NUM_IMAGES_TESTING * sizeof(int));
-    labels_training = (int *) malloc(num_total_images_training * sizeof(int));
-    
-    if(read_data_and_labels(testing_images_names, file_log_output, data_testing, data_training, labels_testing, labels_training, num_total_images_training) == -1) {
+        file_f1_output = open_output(file_name_graphics, resumed, OUTPUT_F1);
+
+        snprintf(file_name_graphics, sizeof(file_name_graphics), "../graphics/accuracy_time_%s_pdataset_%s_epochs_%d_batch_output.csv", argv[4], argv[1], batch_size > 0 ? batch_size : num_total_images_training);
+
+        file_accuracy_time_output = open_output(file_name_graphics, resumed, OUTPUT_ACCURACY_TIME);
+    }
+
+    if(sweep_rates == NULL && (file_csv_output == NULL || file_cost_output == NULL || file_accuracy_output == NULL || file_precision_output == NULL || file_recall_output == NULL || file_f1_output == NULL || file_accuracy_time_output == NULL)) {
+        fprintf(file_log_output, "Não foi possível abrir os arquivos de saída em ../output e ../graphics!");
+        return -1;
+    }
+
+    /* arquivos cujo tamanho é registrado nos checkpoints, indexados por OUTPUT_* */
+    FILE *output_files[CHECKPOINT_NUM_OUTPUTS] = { file_log_output, file_csv_output, file_cost_output, file_accuracy_output, file_precision_output, file_recall_output, file_f1_output, file_accuracy_time_output };
+
+    if(resuming && resumed == NULL) {
+        fprintf(file_log_output, "Não foi possível retomar o treinamento: o checkpoint %s está ausente, corrompido ou não corresponde aos parâmetros informados!", checkpoint_path);
+        return -1;
+    }
+
+    /* seleciona os kernels vetoriais; --isa força um conjunto de instruções específico */
+    if(kernels_init(option_get(argc, argv, "isa")) == -1) {
+        fprintf(file_log_output, "Conjunto de instruções não suportado: %s", option_get(argc, argv, "isa"));
+        return -1;
+    }
+
+    if((dtype = dataset_dtype_from_name(dtype_name)) == -1) {
+        fprintf(file_log_output, "Tipo de armazenamento não suportado: %s", dtype_name);
+        return -1;
+    }
+
+    if(!resolution_supported || (streaming && image_width != IMAGE_WIDTH)) {
+        fprintf(file_log_output, "Resolução não suportada: %s (use 128, 64 ou 32, sem o treinamento fora da memória)", option_get(argc, argv, "resolution"));
+        return -1;
+    }
+
+    if(!projection_supported || (streaming && image_projection.num_components > 0)) {
+        fprintf(file_log_output, "Projeção não suportada: %s (use de 1 a %d componentes, sem o treinamento fora da memória)", option_get(argc, argv, "projection"), image_width * image_height - 1);
+        return -1;
+    }
+
+    if(optimizer_init(&optimizer, image_pixels, learning_rate, momentum, nesterov, batch_size, 1) == -1) {
+        fprintf(file_log_output, "Não foi possível alocar memória para o otimizador!");
+        return -1;
+    }
+
+    if(streaming && batch_size > 0) {
+        fprintf(file_log_output, "O treinamento fora da memória (--stream) usa apenas o lote completo!");
+        return -1;
+    }
+
+    if(validation_fraction < 0 || validation_fraction >= 1 || (validating && streaming)) {
+        fprintf(file_log_output, "A fração de validação deve estar entre 0 e 1 e não pode ser usada com o treinamento fora da memória (--stream)!");
+        return -1;
+    }
+
+    /* o early stopping precisa de ao menos uma imagem de validação */
+    if(validating && (int) (num_total_images_training * validation_fraction) < 1) {
+        fprintf(file_log_output, "A fração de validação %g não separa nenhuma das %d imagens de treinamento!", validation_fraction, num_total_images_training);
+        return -1;
+    }
+
+    if((stopping.patience > 0 || stopping.target_f1 > 0) && !validating) {
+        fprintf(file_log_output, "Os critérios de parada antecipada (--patience, --target-f1) requerem um conjunto de validação (--validation)!");
+        return -1;
+    }
+
+    if(sweep_rates != NULL && (batch_size > 0 || streaming || validating || numa || resuming || checkpoint_epochs > 0 || checkpoint_seconds > 0 || model_path != NULL)) {
+        fprintf(file_log_output, "A varredura de taxas de aprendizado (--sweep) usa apenas o lote completo e não pode ser usada com --batch, --stream, --validation, --numa, --model, checkpoints ou --resume!");
         return -1;
     }
 
+    if(option_get(argc, argv, "lbfgs") != NULL && (lbfgs_history < 1 || batch_size > 0 || streaming || sweep_rates != NULL || momentum != 0 || resuming || checkpoint_epochs > 0 || checkpoint_seconds > 0)) {
+        fprintf(file_log_output, "O L-BFGS (--lbfgs) requer um histórico positivo, usa apenas o lote completo e não pode ser usado com --batch, --stream, --sweep, --momentum, checkpoints ou --resume!");
+        return -1;
+    }
+
+    if(hogwild_enabled && (batch_size > 0 || streaming || sweep_rates != NULL || lbfgs_history > 0 || momentum != 0 || numa || resuming || checkpoint_epochs > 0 || checkpoint_seconds > 0)) {
+        fprintf(file_log_output, "O SGD assíncrono (--hogwild) atualiza os pesos a cada imagem e não pode ser usado com --batch, --stream, --sweep, --lbfgs, --momentum, --numa, checkpoints ou --resume!");
+        return -1;
+    }
+
+    if(hogwild_enabled && hogwild_init(&hogwild, atoi(argv[3]), learning_rate) == -1) {
+        fprintf(file_log_output, "Não foi possível alocar memória para o SGD assíncrono!");
+        return -1;
+    }
+
+    if(sweep_rates != NULL && sweep_init(&sweep, sweep_rates, atoi(argv[3]), momentum, nesterov, num_total_images_training) == -1) {
+        fprintf(file_log_output, "Não foi possível iniciar a varredura de taxas de aprendizado: %s", sweep_rates);
+        return -1;
+    }
+
+    time_reading_begin = omp_get_wtime();
+
+    if(streaming) {
+        /* --stream: mapeia apenas as imagens de teste; as de treinamento são lidas em blocos a cada época */
+        cache_path = cache_path != NULL && *cache_path != '\0' ? cache_path : DEFAULT_CACHE_FILES[dtype];
+
+        if(read_cached_data_and_labels(file_log_output, cache_path, &testing, &training, 0, dtype) == -1) {
+            return -1;
+        }
+
+        if(stream_open(&stream, cache_path, 0, num_total_images_training, (size_t) stream_budget << 20) == -1) {
+            fprintf(file_log_output, "Não foi possível ler o cache %s em blocos!", cache_path);
+            return -1;
+        }
+    } else if(cache_path != NULL) {
+        /* --cache: mapeia as matrizes a partir do cache binário */
+        if(read_cached_data_and_labels(file_log_output, *cache_path != '\0' ? cache_path : DEFAULT_CACHE_FILES[dtype], &testing, &training, num_total_images_training, dtype) == -1) {
+            return -1;
+        }
+    } else {
+        /* realiza alocação de espaços de memórias para as matrizes e vetores usados */
+        if(dataset_alloc(&testing, NUM_IMAGES_TESTING, image_width * image_height, dtype) == -1 || dataset_alloc(&training, num_total_images_training, image_width * image_height, dtype) == -1) {
+            fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+            return -1;
+        }
+        
+        if(read_data_and_labels(file_log_output, &testing, &training) == -1) {
+            return -1;
+        }
+    }
+
+    time_reading_end = omp_get_wtime();
+
+    /* --projection: substitui as imagens pelos componentes, antes da separação da validação */
+    if(image_projection.num_components > 0) {
+        time_projection = omp_get_wtime();
+
+        if(dataset_project(&testing, &image_projection) == -1 || dataset_project(&training, &image_projection) == -1) {
+            fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+            return -1;
+        }
+
+        time_projection = omp_get_wtime() - time_projection;
+    }
+
+    /* imagens separadas para a validação, do final das imagens de treinamento */
+    int num_rows_validation = (int) (training.num_images * validation_fraction);
+
+    /* --numa: fixa as threads e copia as imagens para a memória das threads que as processam */
+    if(numa) {
+        double time_placement_begin = omp_get_wtime();
+
+        if(topology_init(&topology, atoi(argv[3]), image_pixels) == -1 || topology_bind(&topology) == -1
+            || topology_place(&topology, &training, training.num_images - num_rows_validation) == -1) {
+            fprintf(file_log_output, "Não foi possível posicionar as threads e os dados nos nós NUMA!");
+            return -1;
+        }
+
+        epoch_topology = &topology;
+        time_placement = omp_get_wtime() - time_placement_begin;
+    }
+
+    /* --validation: separa as últimas imagens de treinamento para a validação */
+    if(validating) {
+        dataset_split(&training, num_rows_validation, &validation);
+        stopping.best_weights = (float *) malloc(image_pixels * sizeof(float));
+        num_images_validation = validation.num_images;
+        num_images_training = training.num_images;
+    }
+
     initialize_weights(weights, num_total_images_training);
 
-    fprintf(file_log_output, "RESULTADO - TREINAMENTOS:\n");
-    fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  NÚMERO DE ÉPOCAS: %d  /  TAXA DE APRENDIZADO: %f\n", num_total_images_training, num_max_epochs, learning_rate);
-    fprintf(file_log_output, "NÚMERO DE THREADS: %d\n\n\n", atoi(argv[3]));
+    for(int r = 0; r < num_total_images_training; r++) {
+        order[r] = r;
+    }
+
+    /* --resume: restaura os pesos, o otimizador e a ordem das imagens gravados no checkpoint */
+    if(resumed != NULL) {
+        memcpy(weights, resumed->weights, image_pixels * sizeof(float));
+        if(resumed->velocity != NULL) {
+            memcpy(optimizer.velocity, resumed->velocity, image_pixels * sizeof(float));
+        }
+        optimizer.seed = resumed->seeds[0];
+        memcpy(order, resumed->order, num_total_images_training * sizeof(int));
+        num_epochs = resumed->num_epochs;
+        if(resumed->best_weights != NULL) {
+            memcpy(stopping.best_weights, resumed->best_weights, image_pixels * sizeof(float));
+            stopping.best_cost = resumed->best_cost;
+            stopping.best_f1 = resumed->best_f1;
+            stopping.best_epoch = resumed->best_epoch;
+            stopping.num_bad_epochs = resumed->num_bad_epochs;
+        }
+    }
+
+    if(resumed == NULL) {
+        fprintf(file_log_output, "RESULTADO - TREINAMENTOS:\n");
+        fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  NÚMERO DE ÉPOCAS: %d  /  TAXA DE APRENDIZADO: %f\n", num_total_images_training, num_max_epochs, learning_rate);
+        fprintf(file_log_output, "TAMANHO DO LOTE: %d  /  MOMENTO: %f%s\n", batch_size > 0 ? batch_size : num_images_training, optimizer.momentum, optimizer.nesterov ? " (Nesterov)" : "");
+        fprintf(file_log_output, "CONJUNTO DE INSTRUÇÕES: %s\n", kernels_isa_name());
+        fprintf(file_log_output, "ARMAZENAMENTO DOS PIXELS: %s (%.2f MB)\n", dataset_dtype_name(dtype), (dataset_size(&testing) + dataset_size(&training)) / 1048576.0);
+        if(image_width != IMAGE_WIDTH) {
+            fprintf(file_log_output, "RESOLUÇÃO: %d x %d (média de blocos de %d x %d pixels na leitura)\n", image_width, image_height, IMAGE_WIDTH / image_width, IMAGE_HEIGHT / image_height);
+        }
+        if(image_projection.num_components > 0) {
+            fprintf(file_log_output, "PROJEÇÃO ALEATÓRIA: %d componentes de %d pixels (%d elementos não nulos)  /  TEMPO DE PROJEÇÃO: %f s\n", image_projection.num_components,
+                image_projection.num_inputs, projection_num_nonzeros(&image_projection), time_projection);
+        }
+        if(streaming) {
+            fprintf(file_log_output, "TREINAMENTO FORA DA MEMÓRIA: %d blocos de até %d imagens  /  %.2f MB por buffer (orçamento: %d MB)\n", stream.num_chunks, stream.chunk_rows, stream_chunk_size(&stream) / 1048576.0, stream_budget);
+        }
+        if(validating) {
+            fprintf(file_log_output, "VALIDAÇÃO: %d imagens  /  PACIÊNCIA: %d  /  DELTA MÍNIMO: %f  /  F1 ALVO: %f\n", num_images_validation, stopping.patience, stopping.min_delta, stopping.target_f1);
+        }
+        if(numa) {
+            fprintf(file_log_output, "NUMA: %d nó(s)  /  THREADS POR NÓ:", topology.num_nodes);
+            for(int n = 0; n < topology.num_nodes; n++) {
+                fprintf(file_log_output, " %d", topology_node_threads(&topology, n));
+            }
+            fprintf(file_log_output, "  /  AFINIDADE: %s  /  TEMPO DE POSICIONAMENTO: %f s\n", topology.bound ? "uma CPU por thread" : "OMP_PROC_BIND", time_placement);
+        }
+        if(lbfgs_history > 0) {
+            fprintf(file_log_output, "OTIMIZADOR: L-BFGS  /  HISTÓRICO: %d pares  /  BUSCA EM LINHA: Wolfe forte (c1 = %g, c2 = %g, até %d avaliações)\n", lbfgs_history, LBFGS_C1, LBFGS_C2, LBFGS_MAX_EVALUATIONS);
+        }
+        if(hogwild.num_threads > 0) {
+            fprintf(file_log_output, "OTIMIZADOR: SGD assíncrono sem travas (Hogwild)  /  UMA ATUALIZAÇÃO POR IMAGEM  /  %d FATIAS\n", hogwild.num_threads);
+        }
+        if(sweep.num_models > 0) {
+            fprintf(file_log_output, "VARREDURA: %d modelos  /  TAXAS DE APRENDIZADO:", sweep.num_models);
+            for(int m = 0; m < sweep.num_models; m++) {
+                fprintf(file_log_output, " %f", sweep.optimizers[m].learning_rate);
+            }
+            fprintf(file_log_output, "\n");
+        }
+        fprintf(file_log_output, "TEMPO DE LEITURA: %f s\n", time_reading_end - time_reading_begin);
+        fprintf(file_log_output, "NÚMERO DE THREADS: %d\n\n\n", atoi(argv[3]));
+    } else {
+        /* a execução interrompida já registrou o cabeçalho no log */
+        fprintf(file_log_output, "RETOMADO DO CHECKPOINT: %s  /  ÉPOCAS CONCLUÍDAS: %d  /  TEMPO DE LEITURA: %f s\n\n", checkpoint_path, num_epochs, time_reading_end - time_reading_begin);
+    }
+
+    /* --sweep: treina os modelos da varredura no lugar do modelo único */
+    if(sweep.num_models > 0) {
+        int status = run_sweep(file_log_output, &sweep, &training, &testing, num_max_epochs, run_name, argv);
+
+        sweep_free(&sweep);
+        dataset_free(&testing);
+        dataset_free(&training);
+        fclose(file_log_output);
+
+        return status;
+    }
+
+    /* os resultados de cada época são formatados e gravados fora da thread de treinamento */
+    epoch_files = (epoch_files_t) { file_log_output, file_cost_output, file_accuracy_output, file_precision_output, file_f1_output, file_recall_output, file_accuracy_time_output, NULL };
+
+    /* --lbfgs: o custo de cada iteração é gravado em função do tempo, para a comparação com o gradiente descendente */
+    if(lbfgs_history > 0) {
+        char file_name_cost_time[120];
+
+        snprintf(file_name_cost_time, sizeof(file_name_cost_time), "../graphics/cost_time_%s_pdataset_%s_epochs_lbfgs_%d_output.csv", argv[4], argv[1], lbfgs_history);
+
+        full_batch = (full_batch_t) { &training, epoch_topology, metrics };
+
+        if((file_cost_time_output = fopen(file_name_cost_time, "w")) == NULL || lbfgs_init(&lbfgs, image_pixels, lbfgs_history, evaluate_full_batch, &full_batch) == -1) {
+            fprintf(file_log_output, "Não foi possível iniciar o L-BFGS!");
+            return -1;
+        }
+
+        epoch_files.cost_time = file_cost_time_output;
+    }
+
+    if(sink_open(&sink, sizeof(epoch_record_t), SINK_DEFAULT_CAPACITY, write_epoch_record, flush_epoch_files, &epoch_files) == -1) {
+        fprintf(file_log_output, "Não foi possível iniciar o escritor assíncrono!");
+        return -1;
+    }
+
+    /* estado gravado nos checkpoints; os vetores são os do próprio treinamento */
+    checkpoint = (checkpoint_t) { .num_weights = image_pixels, .num_images = num_total_images_training, .num_seeds = 1, .batch_size = optimizer.batch_size, .nesterov = optimizer.nesterov,
+        .learning_rate = learning_rate, .momentum = optimizer.momentum, .weights = weights, .velocity = optimizer.velocity, .validation_fraction = validation_fraction, .best_weights = stopping.best_weights, .seeds = &optimizer.seed, .order = order };
+    strcpy(checkpoint.run_name, run_name);
+
+    /* ao retomar, o tempo de treinamento continua a partir do registrado no checkpoint */
+    time_training_begin = omp_get_wtime() - (resumed != NULL ? resumed->elapsed : 0);
+    time_last_checkpoint = omp_get_wtime();
+
+    /* --lbfgs: avalia o custo e o gradiente dos pesos iniciais, usados na primeira direção de busca */
+    if(lbfgs_history > 0) {
+        lbfgs_start(&lbfgs, weights, gradients);
+    }
 
     /* realiza iterações até o número máximo de épocas */
     while (num_epochs < num_max_epochs) {
 
-        /* realiza iterações de acordo com o número de imagens para treinamento */
-        for(int r=0; r < num_total_images_training; r++) {
+        /* --lbfgs: uma iteração, com uma região paralela por avaliação do custo; as métricas são as dos pesos aceitos */
+        if(lbfgs_history > 0) {
+            if(lbfgs_iterate(&lbfgs, weights, gradients) == -1) {
+                stop_reason = STOP_LINE_SEARCH;
+                break;
+            }
+        } else if(hogwild.num_threads > 0) {
+            time_epoch_begin = omp_get_wtime();
 
-            all_hypothesis[r] = hypothesis_function((float *) data_training[r], weights);
+            /* --hogwild: cada thread atualiza os pesos a cada imagem da sua fatia */
+            #pragma omp parallel
+            train_hogwild_epoch(&training, weights, order, &hogwild, metrics);
 
-            //realiza binarização dos valores de hipótese
-            if(all_hypothesis[r] >= 0.5) {
-                results[r] = 1;
-            } else {
-                results[r] = 0;
+            record.update_rate = training.num_images / (omp_get_wtime() - time_epoch_begin);
+        } else {
+            /* abre uma única região paralela por época */
+            #pragma omp parallel
+            {
+                /* calcula as hipóteses, as métricas e o gradiente em uma única passagem pelos dados */
+                if(streaming) {
+                    train_stream_epoch(&stream, weights, &optimizer, gradients, metrics, &chunk, epoch_topology);
+                } else if(optimizer.batch_size > 0) {
+                    train_minibatch_epoch(&training, weights, order, &optimizer, gradients, metrics, epoch_topology);
+                } else {
+                    train_epoch(&training, weights, &optimizer, gradients, metrics, epoch_topology);
+                }
             }
         }
 
-        save_training_results(num_epochs, results, labels_training, num_total_images_training, file_log_output, file_accuracy_output, file_precision_output, file_f1_output, file_recall_output);
-        fprintf(file_cost_output, "%d,%f\n", num_epochs+1, cost_function(all_hypothesis, weights, labels_training, num_total_images_training));
-        fprintf(file_log_output, "Custo:    %f\n\n", cost_function(all_hypothesis, weights, labels_training, num_total_images_training));
-        update_weights(data_training, weights, all_hypothesis, labels_training, learning_rate, num_total_images_training);
+        if(streaming && stream.status == -1) {
+            sink_close(&sink);
+            fprintf(file_log_output, "Não foi possível ler um bloco do cache %s!", cache_path);
+            return -1;
+        }
+
+        record.epoch_num = num_epochs;
+        record.num_images = num_images_training;
+        record.elapsed = omp_get_wtime() - time_training_begin;
+        memcpy(record.metrics, metrics, sizeof(record.metrics));
+        record.num_evaluations = lbfgs.num_evaluations;
+        record.step = lbfgs.step;
+        sink_push(&sink, &record);
+
         num_epochs++;
+
+        /* --validation: avalia os pesos atualizados e aplica os critérios de parada antecipada */
+        if(validating) {
+            validate(&validation, weights, validation_metrics);
+
+            stop_reason = early_stopping_update(&stopping, validation_metrics, num_images_validation, weights, num_epochs);
+        }
+
+        /* --lbfgs: encerra o treinamento quando o gradiente se anula */
+        if(lbfgs_history > 0 && stop_reason == STOP_NONE && lbfgs_gradient_norm(&lbfgs, gradients) < LBFGS_GRADIENT_TOLERANCE) {
+            stop_reason = STOP_GRADIENT;
+        }
+
+        /* --checkpoint-epochs/--checkpoint-seconds: grava o estado ao final da época */
+        if((checkpoint_epochs > 0 && num_epochs % checkpoint_epochs == 0) || (checkpoint_seconds > 0 && omp_get_wtime() - time_last_checkpoint >= checkpoint_seconds)) {
+            double time_checkpoint_begin = omp_get_wtime();
+
+            if(write_checkpoint(checkpoint_path, &checkpoint, &sink, output_files, num_epochs, time_checkpoint_begin - time_training_begin, &stopping) == -1) {
+                /* o treinamento continua; o log está sincronizado pela gravação */
+                fprintf(file_log_output, "Não foi possível gravar o checkpoint %s!\n", checkpoint_path);
+            } else {
+                num_checkpoints++;
+            }
+
+            time_last_checkpoint = omp_get_wtime();
+            time_checkpoints += time_last_checkpoint - time_checkpoint_begin;
+        }
+
+        if(stop_reason != STOP_NONE) {
+            break;
+        }
+    }
+
+    time_training_end = omp_get_wtime();
+
+    /* épocas que produziram os pesos do modelo */
+    int model_epochs = num_epochs;
+
+    /* restaura os pesos da época de menor custo de validação; a parada pelo F1 alvo mantém os pesos que o atingiram */
+    if(validating && stop_reason != STOP_TARGET_F1 && stopping.best_epoch > 0 && stopping.best_epoch != num_epochs) {
+        memcpy(weights, stopping.best_weights, image_pixels * sizeof(float));
+        model_epochs = stopping.best_epoch;
+    }
+
+    /* aguarda a gravação dos registros pendentes antes de voltar a escrever no log */
+    sink_close(&sink);
+
+    fprintf(file_log_output, "TEMPO DE TREINAMENTO: %f s\n", time_training_end - time_training_begin);
+
+    if(lbfgs_history > 0) {
+        fprintf(file_log_output, "L-BFGS: %d iterações  /  AVALIAÇÕES DO CUSTO: %d  /  CUSTO FINAL: %f  /  NORMA DO GRADIENTE: %g\n", num_epochs, lbfgs.total_evaluations, lbfgs.cost, lbfgs_gradient_norm(&lbfgs, gradients));
+        fclose(file_cost_time_output);
+        lbfgs_free(&lbfgs);
+    }
+
+    /* --hogwild: progresso de cada thread e passagem de consistência sobre os pesos finais, já sem escritas concorrentes */
+    if(hogwild.num_threads > 0) {
+        long num_updates = 0;
+        double busy_max = 0, busy_total = 0;
+        double consistency_metrics[NUM_METRICS];
+        int num_non_finite = 0;
+
+        for(int t = 0; t < hogwild.num_threads; t++) {
+            fprintf(file_log_output, "THREAD %d: %ld atualizações  /  TEMPO: %f s  /  %.0f atualizações/s\n", t, hogwild.updates[t], hogwild.busy[t], hogwild.busy[t] > 0 ? hogwild.updates[t] / hogwild.busy[t] : 0);
+            num_updates += hogwild.updates[t];
+            busy_total += hogwild.busy[t];
+            busy_max = hogwild.busy[t] > busy_max ? hogwild.busy[t] : busy_max;
+        }
+
+        fprintf(file_log_output, "HOGWILD: %ld atualizações  /  %.0f atualizações/s  /  DESEQUILÍBRIO ENTRE AS THREADS: %.3f\n", num_updates, num_updates / (time_training_end - time_training_begin),
+            busy_total > 0 ? busy_max * hogwild.num_threads / busy_total : 1);
+
+        validate(&training, weights, consistency_metrics);
+
+        for(int c = 0; c < image_pixels; c++) {
+            num_non_finite += !isfinite(weights[c]);
+        }
+
+        fprintf(file_log_output, "PASSAGEM DE CONSISTÊNCIA: CUSTO DOS PESOS FINAIS: %f  /  ACERTOS: %.0f DE %d  /  CUSTO DURANTE A ÚLTIMA ÉPOCA: %f  /  PESOS NÃO FINITOS: %d\n",
+            consistency_metrics[METRIC_COST] / num_images_training, consistency_metrics[METRIC_TRUE_POSITIVE] + consistency_metrics[METRIC_TRUE_NEGATIVE], num_images_training,
+            num_epochs > 0 ? metrics[METRIC_COST] / num_images_training : 0, num_non_finite);
+
+        hogwild_free(&hogwild);
+    }
+
+    if(validating) {
+        fprintf(file_log_output, "MELHOR ÉPOCA DE VALIDAÇÃO: %d  /  CUSTO: %f  /  F1: %f%s\n", stopping.best_epoch, stopping.best_cost, stopping.best_f1, model_epochs != num_epochs ? "  /  PESOS RESTAURADOS" : "");
+    }
+
+    if(stop_reason != STOP_NONE) {
+        fprintf(file_log_output, "PARADA ANTECIPADA: ÉPOCA %d DE %d (%s)  /  TEMPO ECONOMIZADO ESTIMADO: %f s\n", num_epochs, num_max_epochs, STOP_NAMES[stop_reason], num_epochs > 0 ? (num_max_epochs - num_epochs) * (time_training_end - time_training_begin) / num_epochs : 0);
+    }
+
+    if(checkpoint_epochs > 0 || checkpoint_seconds > 0) {
+        fprintf(file_log_output, "CHECKPOINTS: %d gravados em %s  /  TEMPO DE GRAVAÇÃO: %f s\n", num_checkpoints, checkpoint_path, time_checkpoints);
+    }
+
+    if(streaming) {
+        fprintf(file_log_output, "TEMPO DE LEITURA DOS BLOCOS: %f s  /  TEMPO DE ESPERA PELOS BLOCOS: %f s\n", stream.time_reading, stream.time_waiting);
+        stream_close(&stream);
+    }
+
+    if(time_serial > 0) {
+        save_speedup_results(file_log_output, time_serial, time_training_end - time_training_begin, atoi(argv[3]));
     }
 
     fclose(file_cost_output);
     fclose(file_accuracy_output);
     fclose(file_f1_output);
+    fclose(file_accuracy_time_output);
     fclose(file_precision_output);
     fclose(file_recall_output);
 
+    /* grava o modelo treinado; --model define o caminho do arquivo */
+    model_t model = { weights, image_width, image_height, image_pixels, MODEL_BIAS_ROW, PIXEL_SCALE, 0.5f, learning_rate, model_epochs, num_images_training,
+        image_projection.num_components > 0 ? &image_projection : NULL };
+
+    if(model_path == NULL || *model_path == '\0') {
+        model_path = filename3;
+    }
+
+    if(model_save(model_path, &model) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o modelo %s!\n", model_path);
+    } else {
+        fprintf(file_log_output, "MODELO: %s\n", model_path);
+    }
+
     fprintf(file_log_output, "\n\n\nRESULTADO - TESTE:\n");
     fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  TAXA DE APRENDIZADO: %f\n\n\n", NUM_IMAGES_TESTING, learning_rate);
 
-    float hypothesis = 0;
-
     //executa a etapa de testes
+    #pragma omp parallel for schedule(static)
     for(int r=0; r < NUM_IMAGES_TESTING; r++) {
-        hypothesis = hypothesis_function((float *) data_testing[r], weights);
+        float hypothesis;
+
+        hypothesis = hypothesis_function(&testing, r, weights);
                  
         //realiza binarização dos valores de hipótese
         if(hypothesis >= 0.5) {
@@ -558,8 +3102,25 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    save_testing_results(results_testing, labels_testing, NUM_IMAGES_TESTING, testing_images_names, file_log_output, file_csv_output);
+    save_testing_results(results_testing, testing.labels, NUM_IMAGES_TESTING, testing.names, file_log_output, file_csv_output);
+
+    dataset_free(&testing);
+    dataset_free(&training);
+    free(gradients);
+    optimizer_free(&optimizer);
+
+    if(resumed != NULL) {
+        checkpoint_free(resumed);
+    }
+
+    free(stopping.best_weights);
+
+    if(numa) {
+        topology_free(&topology);
+    }
 
     fclose(file_log_output);
     fclose(file_csv_output);
+
+    return 0;
 }
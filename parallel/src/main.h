@@ -0,0 +1,54 @@
+#ifndef MAIN_H__
+#define MAIN_H__
+
+/**
+ * @file main.h
+ * @brief Interface de main.c usada pelos programas de medição.
+ *
+ * Os programas de medição (bench.c, dtype_report.c e resolution_report.c)
+ * são ligados a main_bench.o, a versão de main.c compilada com
+ * -Dmain=tec508_main, e usam as mesmas funções de leitura, de treinamento
+ * e de métricas da execução normal. As dimensões das imagens e as posições
+ * do vetor de métricas são definidas aqui para que não sejam copiadas.
+ *
+ */
+
+#include <stdio.h>
+
+#include "dataset.h"
+#include "optimizer.h"
+#include "topology.h"
+
+/**
+ * @brief Constante definindo o número de imagens para teste.
+ *
+ */
+static const int NUM_IMAGES_TESTING = 1210;
+
+/**
+ * @brief Constante definindo o número de pixels das imagens dos arquivos de entrada e do cache.
+ *
+ */
+static const int NUM_PIXELS = 128 * 128;
+
+/**
+ * @brief Constantes definindo a largura e a altura das imagens dos arquivos de entrada.
+ *
+ */
+static const int IMAGE_WIDTH = 128, IMAGE_HEIGHT = 128;
+
+/**
+ * @brief Posições do vetor de métricas de uma época.
+ *
+ */
+enum { METRIC_TRUE_NEGATIVE, METRIC_FALSE_POSITIVE, METRIC_FALSE_NEGATIVE, METRIC_TRUE_POSITIVE, METRIC_COST, NUM_METRICS };
+
+extern int set_resolution(int width); /* define a resolução das imagens usadas no treinamento */
+extern void initialize_weights(float *row, int num_total_images_training); /* inicializa o vetor de pesos */
+extern int read_data_and_labels(FILE *file_log_output, dataset_t *testing, dataset_t *training); /* lê os arquivos .csv de entrada */
+extern float hypothesis_function(const dataset_t *dataset, int r, float *weights); /* calcula a função hipótese de uma linha */
+extern void accumulate_metrics(double metrics[NUM_METRICS], float hypothesis, int label); /* acumula o resultado de uma imagem */
+extern void train_epoch(const dataset_t *training, float *weights, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS], const topology_t *topology); /* realiza uma época com o lote completo */
+extern float save_training_results(int epoch_num, double metrics[NUM_METRICS], int num_images, FILE *file_log_output, FILE *file_cost_output, FILE *file_accuracy_output, FILE *file_precision_output, FILE *file_f1_output, FILE *file_recall_output); /* grava as métricas de uma época */
+
+#endif
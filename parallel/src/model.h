@@ -0,0 +1,69 @@
+#ifndef MODEL_H__
+#define MODEL_H__
+
+/**
+ * @file model.h
+ * @brief Interface do arquivo binário do modelo treinado.
+ * 
+ * O modelo é gravado ao final do treinamento com um cabeçalho versionado
+ * contendo as dimensões das imagens, a normalização dos pixels, o
+ * tratamento do bias e o limiar de binarização, seguido do vetor de pesos
+ * e, nos modelos treinados com a projeção aleatória (projection.h), da
+ * matriz de projeção. O mesmo arquivo é carregado pelo modo de inferência
+ * (--predict), que projeta as imagens antes da função hipótese.
+ * 
+ */
+
+#include <stdint.h>
+
+#include "dataset.h"
+#include "projection.h"
+
+/** Identificação do arquivo do modelo **/
+#define MODEL_MAGIC "TEC508MD"
+
+/** Versão do formato do arquivo do modelo **/
+#define MODEL_VERSION 2
+
+/** Tratamentos do bias **/
+enum {
+    MODEL_BIAS_ROW = 0      /* linha nula de label 1 no treinamento; a hipótese não tem termo independente */
+};
+
+/** Cabeçalho do arquivo do modelo **/
+typedef struct model_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;                 /* largura das imagens, em pixels */
+    uint32_t height;                /* altura das imagens, em pixels */
+    uint32_t num_weights;           /* número de pesos: largura x altura ou, se menor, o número de componentes da projeção (versão 2) */
+    uint32_t bias;                  /* tratamento do bias (MODEL_BIAS_*) */
+    float pixel_scale;              /* fator aplicado aos pixels de 0 a 255 */
+    float threshold;                /* limiar de binarização da hipótese */
+    float learning_rate;            /* taxa de aprendizado do treinamento */
+    uint32_t num_epochs;            /* número de épocas do treinamento */
+    uint32_t num_images_training;   /* número de imagens de treinamento */
+    uint64_t checksum;              /* FNV-1a dos pesos e da matriz de projeção */
+} model_header_t;
+
+/** Modelo de regressão logística **/
+typedef struct model {
+    float *weights;                 /* vetor de pesos */
+    int width;                      /* largura das imagens, em pixels */
+    int height;                     /* altura das imagens, em pixels */
+    int num_weights;                /* número de pesos */
+    int bias;                       /* tratamento do bias (MODEL_BIAS_*) */
+    float pixel_scale;              /* fator aplicado aos pixels de 0 a 255 */
+    float threshold;                /* limiar de binarização da hipótese */
+    float learning_rate;            /* taxa de aprendizado do treinamento */
+    int num_epochs;                 /* número de épocas do treinamento */
+    int num_images_training;        /* número de imagens de treinamento */
+    projection_t *projection;       /* projeção aplicada às imagens antes da hipótese, ou NULL */
+} model_t;
+
+extern int model_save(const char *path, const model_t *model);  /* grava o modelo */
+extern int model_load(const char *path, model_t *model);        /* carrega o modelo */
+extern void model_free(model_t *model);                         /* libera um modelo carregado e a sua projeção */
+extern void model_predict(const model_t *model, const dataset_t *dataset, int first_row, int num_rows, float *hypothesis); /* hipóteses de um lote */
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef OPTIMIZER_H__
+#define OPTIMIZER_H__
+
+/**
+ * @file optimizer.h
+ * @brief Interface do otimizador do gradiente descendente.
+ * 
+ * O otimizador aplica o gradiente ao vetor de pesos com momento opcional
+ * (clássico ou de Nesterov) e define a divisão de uma época em mini-lotes,
+ * embaralhando a ordem das imagens a cada época.
+ * 
+ */
+
+/** Parâmetros e estado do otimizador **/
+typedef struct optimizer {
+    float *velocity;        /* velocidade acumulada pelo momento (NULL sem momento) */
+    int num_weights;        /* tamanho do vetor de pesos */
+    float learning_rate;    /* taxa de aprendizado */
+    float momentum;         /* coeficiente do momento; 0 desativa o momento */
+    int nesterov;           /* 1 para usar o momento de Nesterov */
+    int batch_size;         /* imagens por atualização; 0 para o lote completo */
+    unsigned int seed;      /* estado do gerador usado no embaralhamento */
+} optimizer_t;
+
+extern int optimizer_init(optimizer_t *optimizer, int num_weights, float learning_rate, float momentum, int nesterov, int batch_size, unsigned int seed); /* inicializa o otimizador */
+extern void optimizer_free(optimizer_t *optimizer);                                         /* libera o estado do otimizador */
+extern int optimizer_num_batches(const optimizer_t *optimizer, int num_images);             /* número de lotes de uma época */
+extern void optimizer_shuffle(optimizer_t *optimizer, int *order, int num_images);          /* embaralha a ordem das imagens */
+extern void optimizer_step(optimizer_t *optimizer, float *weights, const float *gradients, int num_images); /* atualiza os pesos */
+
+/**
+ * @brief Retorna o início de um lote.
+ * 
+ * Os lotes dividem as posições 0 a num_images - 1 em partes de tamanho
+ * quase igual; o lote k ocupa as posições [batch_begin(k), batch_begin(k + 1)).
+ * 
+ * @param num_images número de imagens da época
+ * @param num_batches número de lotes da época
+ * @param k índice do lote
+ * @return int primeira posição do lote
+ */
+static inline int optimizer_batch_begin(int num_images, int num_batches, int k) {
+    return (long) num_images * k / num_batches;
+}
+
+#endif
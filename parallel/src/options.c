@@ -0,0 +1,81 @@
+/**
+ * @file options.c
+ * @brief Leitura das opções de linha de comando.
+ * 
+ * Esse arquivo contém os métodos para obtenção das opções opcionais
+ * (--nome=valor) informadas após os argumentos posicionais do programa.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+#include "options.h"
+
+/**
+ * @brief Obtém o valor de uma opção.
+ * 
+ * Procura nos argumentos uma opção no formato --nome=valor ou --nome.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv vetor de argumentos
+ * @param name nome da opção, sem os hífens iniciais
+ * @return const char* valor da opção; string vazia, se informada sem valor; NULL, se ausente
+ */
+const char *option_get(int argc, char *argv[], const char *name) {
+    size_t length = strlen(name);
+
+    for(int i = 1; i < argc; i++) {
+        if(strncmp(argv[i], "--", 2) != 0 || strncmp(argv[i] + 2, name, length) != 0) {
+            continue;
+        }
+
+        if(argv[i][length + 2] == '=') {
+            return argv[i] + length + 3;
+        } else if(argv[i][length + 2] == '\0') {
+            return "";
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Obtém o valor inteiro de uma opção.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv vetor de argumentos
+ * @param name nome da opção
+ * @param fallback valor retornado quando a opção não é informada
+ * @return int valor da opção
+ */
+int option_get_int(int argc, char *argv[], const char *name, int fallback) {
+    const char *value = option_get(argc, argv, name);
+
+    return (value == NULL || *value == '\0') ? fallback : atoi(value);
+}
+
+/**
+ * @brief Obtém o valor real de uma opção.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv vetor de argumentos
+ * @param name nome da opção
+ * @param fallback valor retornado quando a opção não é informada
+ * @return float valor da opção
+ */
+float option_get_float(int argc, char *argv[], const char *name, float fallback) {
+    const char *value = option_get(argc, argv, name);
+
+    return (value == NULL || *value == '\0') ? fallback : (float) atof(value);
+}
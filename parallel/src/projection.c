@@ -0,0 +1,239 @@
+/**
+ * @file projection.c
+ * @brief Geração, aplicação e gravação da projeção aleatória esparsa.
+ * 
+ * Esse arquivo contém os métodos para gerar a matriz de projeção a partir
+ * de uma semente, para projetar uma imagem e para gravar e ler a matriz
+ * junto com o modelo treinado.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca math **/
+#include <math.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+#include "projection.h"
+
+/**
+ * @brief Gera o próximo número do gerador SplitMix64.
+ * 
+ * O gerador é independente do rand() da biblioteca C, de forma que a
+ * mesma semente gere a mesma matriz em qualquer plataforma.
+ * 
+ * @param state estado do gerador, atualizado
+ * @return uint64_t número pseudoaleatório
+ */
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Sorteia os elementos não nulos da matriz.
+ * 
+ * Com columns igual a NULL, apenas conta os elementos de cada componente
+ * em offsets; caso contrário, grava as colunas nas posições já contadas.
+ * As duas passagens partem da mesma semente e sorteiam os mesmos elementos.
+ * 
+ * @param projection projeção com num_inputs e num_components definidos
+ * @param density_inverse inverso da densidade (s)
+ * @param seed semente do gerador
+ * @param columns vetor de colunas, ou NULL na contagem
+ */
+static void draw_nonzeros(projection_t *projection, int density_inverse, uint64_t seed, int *columns) {
+    uint64_t state = seed;
+    int count = 0;
+
+    for(int c = 0; c < projection->num_components; c++) {
+        /* sorteia a linha inteira e grava os positivos antes dos negativos */
+        uint64_t row_state = state;
+
+        for(int sign = 0; sign < 2; sign++) {
+            state = row_state;
+
+            if(columns == NULL) {
+                projection->offsets[2 * c + sign] = count;
+            }
+
+            for(int j = 0; j < projection->num_inputs; j++) {
+                if(splitmix64(&state) % (2 * density_inverse) == (uint64_t) sign) {
+                    if(columns != NULL) {
+                        columns[count] = j;
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+
+    if(columns == NULL) {
+        projection->offsets[2 * projection->num_components] = count;
+    }
+}
+
+/**
+ * @brief Gera a matriz de projeção.
+ * 
+ * @param projection projeção a ser inicializada
+ * @param num_inputs número de pixels por imagem
+ * @param num_components número de componentes projetados (de 1 a num_inputs - 1)
+ * @param seed semente do gerador
+ * @return int 0, se a matriz foi gerada; -1, se os parâmetros são inválidos ou não há memória
+ */
+int projection_init(projection_t *projection, int num_inputs, int num_components, uint64_t seed) {
+    int density_inverse = (int) (sqrt((double) num_inputs) + 0.5);
+
+    projection->num_inputs = num_inputs;
+    projection->num_components = num_components;
+    projection->scale = sqrtf((float) density_inverse / num_components);
+    projection->offsets = NULL;
+    projection->columns = NULL;
+
+    if(num_components < 1 || num_components >= num_inputs) {
+        return -1;
+    }
+
+    projection->offsets = (int *) malloc((2 * num_components + 1) * sizeof(int));
+
+    if(projection->offsets == NULL) {
+        return -1;
+    }
+
+    draw_nonzeros(projection, density_inverse, seed, NULL);
+
+    projection->columns = (int *) malloc((projection_num_nonzeros(projection) + 1) * sizeof(int));
+
+    if(projection->columns == NULL) {
+        projection_free(projection);
+        return -1;
+    }
+
+    draw_nonzeros(projection, density_inverse, seed, projection->columns);
+
+    return 0;
+}
+
+/**
+ * @brief Projeta uma imagem.
+ * 
+ * Cada componente é a diferença entre a soma dos pixels das colunas
+ * positivas e a dos pixels das colunas negativas, multiplicada por scale.
+ * 
+ * @param projection projeção inicializada
+ * @param x imagem, com num_inputs pixels em float
+ * @param y vetor que recebe os num_components componentes
+ */
+void projection_apply(const projection_t *projection, const float *x, float *y) {
+    const int *offsets = projection->offsets, *columns = projection->columns;
+
+    for(int c = 0; c < projection->num_components; c++) {
+        float positive = 0, negative = 0;
+
+        for(int i = offsets[2 * c]; i < offsets[2 * c + 1]; i++) {
+            positive += x[columns[i]];
+        }
+
+        for(int i = offsets[2 * c + 1]; i < offsets[2 * c + 2]; i++) {
+            negative += x[columns[i]];
+        }
+
+        y[c] = (positive - negative) * projection->scale;
+    }
+}
+
+/**
+ * @brief Grava a matriz de projeção em um arquivo aberto.
+ * 
+ * Layout: scale, offsets (2k + 1 posições) e colunas dos elementos não
+ * nulos. As dimensões são gravadas pelo chamador.
+ * 
+ * @param projection projeção inicializada
+ * @param file arquivo aberto para escrita
+ * @return int 0, se a gravação foi bem sucedida; -1, caso contrário
+ */
+int projection_write(const projection_t *projection, FILE *file) {
+    size_t num_offsets = 2 * projection->num_components + 1, num_nonzeros = projection_num_nonzeros(projection);
+
+    if(fwrite(&projection->scale, sizeof(float), 1, file) != 1 || fwrite(projection->offsets, sizeof(int), num_offsets, file) != num_offsets
+        || fwrite(projection->columns, sizeof(int), num_nonzeros, file) != num_nonzeros) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Lê uma matriz de projeção gravada por projection_write().
+ * 
+ * Confere se os offsets são crescentes e se as colunas estão dentro da
+ * imagem. Os vetores são alocados e devem ser liberados por projection_free().
+ * 
+ * @param projection projeção a ser inicializada
+ * @param num_inputs número de pixels por imagem
+ * @param num_components número de componentes projetados
+ * @param file arquivo aberto para leitura, posicionado no início da matriz
+ * @return int 0, se a matriz foi lida; -1, se está incompleta ou corrompida
+ */
+int projection_read(projection_t *projection, int num_inputs, int num_components, FILE *file) {
+    size_t num_offsets = 2 * num_components + 1, num_nonzeros;
+
+    projection->num_inputs = num_inputs;
+    projection->num_components = num_components;
+    projection->columns = NULL;
+    projection->offsets = (int *) malloc(num_offsets * sizeof(int));
+
+    if(projection->offsets == NULL || fread(&projection->scale, sizeof(float), 1, file) != 1 || fread(projection->offsets, sizeof(int), num_offsets, file) != num_offsets
+        || projection->offsets[0] != 0) {
+        projection_free(projection);
+        return -1;
+    }
+
+    for(size_t i = 1; i < num_offsets; i++) {
+        if(projection->offsets[i] < projection->offsets[i - 1] || projection->offsets[i] - projection->offsets[i - 1] > num_inputs) {
+            projection_free(projection);
+            return -1;
+        }
+    }
+
+    num_nonzeros = projection_num_nonzeros(projection);
+    projection->columns = (int *) malloc((num_nonzeros + 1) * sizeof(int));
+
+    if(projection->columns == NULL || fread(projection->columns, sizeof(int), num_nonzeros, file) != num_nonzeros) {
+        projection_free(projection);
+        return -1;
+    }
+
+    for(size_t i = 0; i < num_nonzeros; i++) {
+        if(projection->columns[i] < 0 || projection->columns[i] >= num_inputs) {
+            projection_free(projection);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Libera os vetores da matriz de projeção.
+ * 
+ * @param projection projeção inicializada por projection_init() ou projection_read()
+ */
+void projection_free(projection_t *projection) {
+    free(projection->offsets);
+    free(projection->columns);
+    projection->offsets = NULL;
+    projection->columns = NULL;
+}
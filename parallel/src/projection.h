@@ -0,0 +1,54 @@
+#ifndef PROJECTION_H__
+#define PROJECTION_H__
+
+/**
+ * @file projection.h
+ * @brief Interface da projeção aleatória esparsa das imagens.
+ * 
+ * A projeção reduz cada imagem de D pixels a k componentes, y = R x, com
+ * uma matriz R (k x D) aleatória e muito esparsa: cada elemento vale
+ * +scale ou -scale com probabilidade 1 / (2s) cada, e zero nos demais
+ * casos, com s = raiz(D) e scale = raiz(s / k). As distâncias e os
+ * produtos escalares entre as imagens são preservados aproximadamente,
+ * e cada componente soma apenas cerca de D / s pixels.
+ * 
+ * A matriz é gerada a partir de uma semente, com um gerador próprio, e é
+ * armazenada por componente: as colunas dos elementos positivos seguidas
+ * das colunas dos elementos negativos. O componente c ocupa as posições
+ * [offsets[2c], offsets[2c + 1]) (positivos) e [offsets[2c + 1],
+ * offsets[2c + 2]) (negativos) do vetor de colunas.
+ * 
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+/** Semente padrão da matriz de projeção **/
+#define PROJECTION_SEED 508
+
+/** Projeção aleatória esparsa **/
+typedef struct projection {
+    int num_inputs;                 /* número de pixels por imagem (D) */
+    int num_components;             /* número de componentes projetados (k) */
+    float scale;                    /* valor absoluto dos elementos não nulos */
+    int *offsets;                   /* início dos elementos positivos e negativos de cada componente, 2k + 1 posições */
+    int *columns;                   /* coluna de cada elemento não nulo */
+} projection_t;
+
+extern int projection_init(projection_t *projection, int num_inputs, int num_components, uint64_t seed); /* gera a matriz */
+extern void projection_apply(const projection_t *projection, const float *x, float *y);               /* projeta uma imagem */
+extern int projection_write(const projection_t *projection, FILE *file);                                /* grava a matriz */
+extern int projection_read(projection_t *projection, int num_inputs, int num_components, FILE *file);  /* lê a matriz */
+extern void projection_free(projection_t *projection);                                                  /* libera a matriz */
+
+/**
+ * @brief Retorna o número de elementos não nulos da matriz.
+ * 
+ * @param projection projeção inicializada
+ * @return int número de elementos não nulos
+ */
+static inline int projection_num_nonzeros(const projection_t *projection) {
+    return projection->offsets[2 * projection->num_components];
+}
+
+#endif
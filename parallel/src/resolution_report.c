@@ -0,0 +1,174 @@
+/**
+ * @file resolution_report.c
+ * @brief Comparação da acurácia e do tempo por época entre as resoluções das imagens.
+ * 
+ * Treina o modelo com as imagens dos arquivos de entrada em cada resolução
+ * suportada (128 x 128 e as reduções por média de blocos para 64 x 64 e
+ * 32 x 32), com as mesmas épocas de lote completo, e gera na saída padrão
+ * uma linha CSV por época com o custo, a acurácia e o F1 de treinamento e
+ * o tempo da época. Ao final de cada resolução, uma linha com fase "test"
+ * registra as mesmas métricas sobre as imagens de teste, e uma linha com
+ * fase "load" registra o tempo da leitura, que inclui a redução.
+ * 
+ * As funções de main.c são usadas diretamente: o arquivo é compilado com
+ * a função main renomeada (ver o alvo resolution-report do Makefile).
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdio **/
+#include <stdio.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca OPENMP **/
+#include <omp.h>
+
+/** Inclusão do arquivo de cabeçalho do contêiner de dados **/
+#include "dataset.h"
+
+/** Inclusão do arquivo de cabeçalho dos kernels vetoriais **/
+#include "kernels.h"
+
+/** Inclusão do arquivo de cabeçalho das opções de linha de comando **/
+#include "options.h"
+
+/** Inclusão do arquivo de cabeçalho do otimizador **/
+#include "optimizer.h"
+
+/** Inclusão do arquivo de cabeçalho do posicionamento nos nós NUMA **/
+#include "topology.h"
+
+/** Inclusão do arquivo de cabeçalho com as constantes e as funções de main.c **/
+#include "main.h"
+
+/**
+ * @brief Grava uma linha do relatório a partir das métricas acumuladas.
+ * 
+ * @param width largura das imagens
+ * @param phase "train", "test" ou "load"
+ * @param epoch número da época (1 em diante), ou o número de épocas nas demais fases
+ * @param metrics matriz de confusão e custo total, indexados por METRIC_*; NULL na fase "load"
+ * @param num_images número de imagens
+ * @param time tempo da época, da classificação ou da leitura, em segundos
+ * @param memory tamanho da matriz, em MB
+ */
+static void print_row(int width, const char *phase, int epoch, const double metrics[NUM_METRICS], int num_images, double time, double memory) {
+    double cost = 0, accuracy = 0, f1 = 0;
+
+    if(metrics != NULL) {
+        double true_positive = metrics[METRIC_TRUE_POSITIVE], true_negative = metrics[METRIC_TRUE_NEGATIVE];
+
+        cost = metrics[METRIC_COST] / num_images;
+        accuracy = (true_positive + true_negative) / num_images;
+        f1 = true_positive > 0 ? 2 * true_positive / (2 * true_positive + metrics[METRIC_FALSE_POSITIVE] + metrics[METRIC_FALSE_NEGATIVE]) : 0;
+    }
+
+    printf("%dx%d,%s,%d,%.6f,%.6f,%.6f,%.6f,%.2f\n", width, width, phase, epoch, cost, accuracy, f1, time, memory);
+}
+
+/**
+ * @brief Função principal da comparação entre as resoluções.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv opções:
+ * --epochs=n número de épocas (padrão 30)
+ * --lr=x taxa de aprendizado (padrão 0.01)
+ * --images=n número de imagens de treinamento, incluindo o bias (padrão 4272)
+ * --threads=n número de threads (padrão: o do OpenMP)
+ * --dtype=nome tipo de armazenamento dos pixels (padrão float32)
+ * --isa=nome conjunto de instruções dos kernels (padrão: detecção automática)
+ * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
+ */
+int main(int argc, char *argv[]) {
+    int num_epochs = option_get_int(argc, argv, "epochs", 30);
+    float learning_rate = option_get_float(argc, argv, "lr", 0.01f);
+    int num_images_training = option_get_int(argc, argv, "images", 4272);
+    int num_threads = option_get_int(argc, argv, "threads", omp_get_max_threads());
+    int dtype = dataset_dtype_from_name(option_get(argc, argv, "dtype"));
+
+    if(num_epochs < 1 || num_images_training < 2 || num_threads < 1 || dtype == -1) {
+        fprintf(stderr, "Parâmetros inválidos!\n");
+        return -1;
+    }
+
+    if(kernels_init(option_get(argc, argv, "isa")) == -1) {
+        fprintf(stderr, "Conjunto de instruções não suportado: %s\n", option_get(argc, argv, "isa"));
+        return -1;
+    }
+
+    omp_set_num_threads(num_threads);
+
+    printf("resolution,phase,epoch,cost,accuracy,f1,time_s,memory_mb\n");
+
+    for(int width = IMAGE_WIDTH; width >= IMAGE_WIDTH / 4; width /= 2) {
+        int num_pixels = width * width;
+        dataset_t testing, training;
+        optimizer_t optimizer;
+        double metrics[NUM_METRICS];
+        double time_begin;
+        float *weights, *gradients;
+
+        set_resolution(width);
+
+        weights = (float *) malloc(num_pixels * sizeof(float));
+        gradients = (float *) malloc(num_pixels * sizeof(float));
+
+        if(weights == NULL || gradients == NULL || dataset_alloc(&testing, NUM_IMAGES_TESTING, num_pixels, dtype) == -1 || dataset_alloc(&training, num_images_training, num_pixels, dtype) == -1) {
+            fprintf(stderr, "Não foi possível alocar memória para os dados!\n");
+            return -1;
+        }
+
+        /* a leitura inclui a redução por média de blocos, feita linha a linha */
+        time_begin = omp_get_wtime();
+
+        if(read_data_and_labels(stderr, &testing, &training) == -1 || optimizer_init(&optimizer, num_pixels, learning_rate, 0, 0, 0, 1) == -1) {
+            return -1;
+        }
+
+        print_row(width, "load", num_epochs, NULL, 0, omp_get_wtime() - time_begin, (dataset_size(&testing) + dataset_size(&training)) / 1048576.0);
+
+        /* mesma semente em todas as resoluções */
+        srand(1);
+        initialize_weights(weights, num_images_training);
+
+        for(int epoch = 0; epoch < num_epochs; epoch++) {
+            time_begin = omp_get_wtime();
+
+            #pragma omp parallel
+            train_epoch(&training, weights, &optimizer, gradients, metrics, NULL);
+
+            print_row(width, "train", epoch + 1, metrics, training.num_images, omp_get_wtime() - time_begin, dataset_size(&training) / 1048576.0);
+        }
+
+        /* classifica as imagens de teste com os pesos finais */
+        memset(metrics, 0, sizeof(metrics));
+        time_begin = omp_get_wtime();
+
+        #pragma omp parallel for schedule(static) reduction(+:metrics[:NUM_METRICS])
+        for(int r = 0; r < testing.num_images; r++) {
+            accumulate_metrics(metrics, hypothesis_function(&testing, r, weights), testing.labels[r]);
+        }
+
+        print_row(width, "test", num_epochs, metrics, testing.num_images, omp_get_wtime() - time_begin, dataset_size(&testing) / 1048576.0);
+        fflush(stdout);
+
+        optimizer_free(&optimizer);
+        dataset_free(&testing);
+        dataset_free(&training);
+        free(weights);
+        free(gradients);
+    }
+
+    return 0;
+}
@@ -0,0 +1,350 @@
+/**
+ * @file stream.c
+ * @brief Leitura em blocos das imagens de treinamento, com leitura antecipada.
+ * 
+ * Esse arquivo contém os métodos para ler uma partição da seção de
+ * treinamento do cache binário em blocos de linhas, alternando entre dois
+ * buffers. Uma thread de leitura executa os pread() enquanto o treinamento
+ * processa o bloco anterior, sobrepondo a leitura do disco ao cálculo. Os
+ * blocos são entregues em ordem circular, de forma que a leitura do
+ * primeiro bloco de uma época é antecipada durante o último bloco da
+ * época anterior. Quando a partição cabe em um ou dois blocos, os blocos
+ * permanecem nos buffers e não são lidos novamente.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca time **/
+#include <time.h>
+
+/** Inclusão das bibliotecas para acesso a arquivos **/
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "stream.h"
+
+/**
+ * @brief Obtém o tempo atual de um relógio monotônico.
+ * 
+ * @return double tempo em segundos
+ */
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Lê um intervalo do arquivo, repetindo o pread() até completá-lo.
+ * 
+ * @param fd descritor do arquivo
+ * @param buffer destino dos dados
+ * @param size número de bytes
+ * @param offset posição inicial no arquivo
+ * @return int 0, se todos os bytes foram lidos; -1, caso contrário
+ */
+static int pread_full(int fd, void *buffer, size_t size, uint64_t offset) {
+    char *p = (char *) buffer;
+
+    while(size > 0) {
+        ssize_t length = pread(fd, p, size, offset);
+
+        if(length <= 0) {
+            return -1;
+        }
+
+        p += length;
+        size -= length;
+        offset += length;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Retorna o número de linhas de um bloco.
+ * 
+ * @param stream leitura em blocos
+ * @param k índice do bloco
+ * @return int número de linhas do bloco (o último pode ser menor)
+ */
+static int chunk_num_rows(const stream_t *stream, int k) {
+    int remaining = stream->num_rows - k * stream->chunk_rows;
+
+    return remaining < stream->chunk_rows ? remaining : stream->chunk_rows;
+}
+
+/**
+ * @brief Retorna o buffer usado pelo bloco de uma posição da sequência de entrega.
+ * 
+ * @param stream leitura em blocos
+ * @param sequence posição na sequência de blocos entregues
+ * @return int índice do buffer
+ */
+static int sequence_buffer(const stream_t *stream, long sequence) {
+    return stream->num_chunks == 1 ? 0 : sequence % 2;
+}
+
+/**
+ * @brief Lê as linhas e as labels de um bloco para um buffer.
+ * 
+ * @param stream leitura em blocos
+ * @param k índice do bloco
+ * @param b índice do buffer
+ * @return int 0, se a leitura foi bem sucedida; -1, caso contrário
+ */
+static int read_chunk(stream_t *stream, int k, int b) {
+    size_t row_size = (size_t) stream->stride * dataset_element_size(stream->dtype);
+    int num_rows = chunk_num_rows(stream, k);
+
+    if(pread_full(stream->fd, stream->buffers[b], num_rows * row_size, stream->data_offset + (uint64_t) k * stream->chunk_rows * row_size) == -1
+        || pread_full(stream->fd, stream->labels[b], num_rows * sizeof(int), stream->labels_offset + (uint64_t) k * stream->chunk_rows * sizeof(int)) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Laço da thread de leitura.
+ * 
+ * Aguarda a solicitação de um bloco, lê o bloco para o buffer indicado e
+ * sinaliza a conclusão, até que stream_close() seja chamada.
+ * 
+ * @param arg leitura em blocos
+ * @return void* NULL
+ */
+static void *reader(void *arg) {
+    stream_t *stream = (stream_t *) arg;
+
+    pthread_mutex_lock(&stream->mutex);
+
+    while(1) {
+        int k, b, status;
+        double begin;
+
+        while(stream->requested == -1 && !stream->stop) {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+        }
+
+        if(stream->stop) {
+            break;
+        }
+
+        k = stream->requested;
+        b = stream->requested_buffer;
+        pthread_mutex_unlock(&stream->mutex);
+
+        begin = now();
+        status = read_chunk(stream, k, b);
+
+        pthread_mutex_lock(&stream->mutex);
+        stream->time_reading += now() - begin;
+        if(status == -1) {
+            stream->status = -1;
+        } else {
+            stream->loaded[b] = k;
+        }
+        stream->requested = -1;
+        pthread_cond_broadcast(&stream->cond);
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+    return NULL;
+}
+
+/**
+ * @brief Solicita a leitura de um bloco à thread de leitura.
+ * 
+ * Deve ser chamada com o mutex adquirido e sem outra solicitação pendente.
+ * 
+ * @param stream leitura em blocos
+ * @param k índice do bloco
+ * @param b índice do buffer
+ */
+static void request_chunk(stream_t *stream, int k, int b) {
+    stream->loaded[b] = -1;
+    stream->requested = k;
+    stream->requested_buffer = b;
+    pthread_cond_broadcast(&stream->cond);
+}
+
+/**
+ * @brief Abre a leitura em blocos de uma partição da seção de treinamento.
+ * 
+ * O número de linhas por bloco é o maior que permite manter os dois
+ * buffers dentro do orçamento de memória (no mínimo uma linha). A leitura
+ * do primeiro bloco é solicitada imediatamente.
+ * 
+ * @param stream leitura em blocos a ser inicializada
+ * @param path caminho do arquivo de cache
+ * @param first_row primeira linha da seção de treinamento a ser usada
+ * @param num_rows número de linhas a partir de first_row
+ * @param budget memória disponível para os dois buffers, em bytes
+ * @return int 0, se a leitura foi iniciada; -1, caso contrário
+ */
+int stream_open(stream_t *stream, const char *path, int first_row, int num_rows, size_t budget) {
+    cache_header_t header;
+    size_t element_size, row_size;
+
+    memset(stream, 0, sizeof(*stream));
+
+    if((stream->fd = open(path, O_RDONLY)) == -1) {
+        return -1;
+    }
+
+    if(cache_read_header(stream->fd, &header) == -1 || first_row < 0 || num_rows <= 0 || (uint32_t) (first_row + num_rows) > header.training.num_images) {
+        close(stream->fd);
+        return -1;
+    }
+
+    element_size = dataset_element_size(header.dtype);
+    row_size = header.stride * element_size + sizeof(int);
+
+    stream->dtype = header.dtype;
+    stream->num_pixels = header.num_pixels;
+    stream->stride = header.stride;
+    stream->data_offset = header.training.offset + (uint64_t) first_row * header.stride * element_size;
+    stream->labels_offset = header.training.offset + (uint64_t) header.training.num_images * header.stride * element_size + (uint64_t) first_row * sizeof(int);
+    stream->num_rows = num_rows;
+    stream->chunk_rows = budget / 2 / row_size < (size_t) num_rows ? (int) (budget / 2 / row_size) : num_rows;
+    if(stream->chunk_rows == 0) {
+        stream->chunk_rows = 1;
+    }
+    stream->num_chunks = (num_rows + stream->chunk_rows - 1) / stream->chunk_rows;
+
+    for(int b = 0; b < (stream->num_chunks == 1 ? 1 : 2); b++) {
+        if(posix_memalign(&stream->buffers[b], DATASET_ALIGNMENT, stream->chunk_rows * header.stride * element_size) != 0) {
+            stream->buffers[b] = NULL;
+        }
+        stream->labels[b] = (int *) malloc(stream->chunk_rows * sizeof(int));
+
+        if(stream->buffers[b] == NULL || stream->labels[b] == NULL) {
+            for(; b >= 0; b--) {
+                free(stream->buffers[b]);
+                free(stream->labels[b]);
+            }
+            close(stream->fd);
+            return -1;
+        }
+    }
+
+    /* a partição é lida do início ao fim a cada época */
+    posix_fadvise(stream->fd, stream->data_offset, (uint64_t) num_rows * header.stride * element_size, POSIX_FADV_SEQUENTIAL);
+
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->cond, NULL);
+    stream->loaded[0] = stream->loaded[1] = -1;
+    stream->requested = 0;
+    stream->requested_buffer = 0;
+
+    if(pthread_create(&stream->thread, NULL, reader, stream) != 0) {
+        pthread_mutex_destroy(&stream->mutex);
+        pthread_cond_destroy(&stream->cond);
+        for(int b = 0; b < 2; b++) {
+            free(stream->buffers[b]);
+            free(stream->labels[b]);
+        }
+        close(stream->fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Entrega o próximo bloco e solicita a leitura do seguinte.
+ * 
+ * Aguarda a conclusão da leitura do bloco, caso ela ainda esteja em
+ * andamento, e solicita a leitura do bloco seguinte no outro buffer. O
+ * bloco entregue permanece válido até a próxima chamada. Os blocos são
+ * entregues em ordem circular: após o último, o próximo é o primeiro.
+ * 
+ * @param stream leitura em blocos
+ * @param chunk contêiner que passa a apontar para as linhas e as labels do bloco
+ * @return int 0, se o bloco foi entregue; -1, se houve falha de leitura
+ */
+int stream_next(stream_t *stream, dataset_t *chunk) {
+    int k = stream->sequence % stream->num_chunks, b = sequence_buffer(stream, stream->sequence);
+    int next = (stream->sequence + 1) % stream->num_chunks, next_b = sequence_buffer(stream, stream->sequence + 1);
+    double begin = now();
+
+    memset(chunk, 0, sizeof(*chunk));
+
+    pthread_mutex_lock(&stream->mutex);
+
+    while(stream->loaded[b] != k && stream->status == 0) {
+        pthread_cond_wait(&stream->cond, &stream->mutex);
+    }
+
+    stream->time_waiting += now() - begin;
+
+    if(stream->status == -1) {
+        pthread_mutex_unlock(&stream->mutex);
+        return -1;
+    }
+
+    /* o bloco seguinte pode já estar no outro buffer quando a partição tem um ou dois blocos */
+    if(stream->loaded[next_b] != next) {
+        request_chunk(stream, next, next_b);
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    chunk->data = stream->buffers[b];
+    chunk->dtype = stream->dtype;
+    chunk->num_images = chunk_num_rows(stream, k);
+    chunk->num_pixels = stream->num_pixels;
+    chunk->stride = stream->stride;
+    chunk->labels = stream->labels[b];
+    stream->sequence++;
+
+    return 0;
+}
+
+/**
+ * @brief Encerra a thread de leitura e libera os buffers.
+ * 
+ * @param stream leitura em blocos
+ */
+void stream_close(stream_t *stream) {
+    pthread_mutex_lock(&stream->mutex);
+    stream->stop = 1;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->mutex);
+
+    pthread_join(stream->thread, NULL);
+    pthread_mutex_destroy(&stream->mutex);
+    pthread_cond_destroy(&stream->cond);
+
+    for(int b = 0; b < 2; b++) {
+        free(stream->buffers[b]);
+        free(stream->labels[b]);
+    }
+
+    close(stream->fd);
+}
+
+/**
+ * @brief Retorna a memória ocupada por um buffer.
+ * 
+ * @param stream leitura em blocos
+ * @return size_t tamanho do buffer de pixels e de labels de um bloco, em bytes
+ */
+size_t stream_chunk_size(const stream_t *stream) {
+    return (size_t) stream->chunk_rows * (stream->stride * dataset_element_size(stream->dtype) + sizeof(int));
+}
@@ -0,0 +1,437 @@
+/**
+ * @file topology.c
+ * @brief Posicionamento das threads e dos dados nos nós NUMA.
+ * 
+ * Esse arquivo contém os métodos para obter os nós NUMA e as CPUs de cada
+ * nó a partir do sysfs, fixar as threads do OpenMP nas CPUs atribuídas,
+ * copiar a matriz de treinamento para a memória das threads que a
+ * processam (primeira escrita) e somar os gradientes parciais das threads
+ * em uma árvore que respeita a topologia.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/** Necessário para a afinidade das threads (CPU_SET, pthread_setaffinity_np, sched_getcpu) **/
+#define _GNU_SOURCE
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdio **/
+#include <stdio.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão das bibliotecas de afinidade das threads **/
+#include <sched.h>
+#include <pthread.h>
+
+/** Inclusão das bibliotecas para a leitura do sysfs e o mapeamento de memória **/
+#include <dirent.h>
+#include <sys/mman.h>
+
+/** Inclusão da biblioteca OPENMP **/
+#include <omp.h>
+
+#include "topology.h"
+
+/** Diretório com os nós NUMA do sistema **/
+#define TOPOLOGY_SYSFS_NODES "/sys/devices/system/node"
+
+/**
+ * @brief Lê uma lista de CPUs do sysfs (por exemplo, "0-15,32-47").
+ * 
+ * @param path caminho do arquivo cpulist
+ * @param allowed CPUs em que o processo pode executar
+ * @param cpus conjunto que recebe as CPUs da lista que estão em allowed
+ * @return int 0, se a lista foi lida; -1, caso contrário
+ */
+static int read_cpulist(const char *path, const cpu_set_t *allowed, cpu_set_t *cpus) {
+    char buffer[4096], *p = buffer;
+    FILE *file;
+
+    CPU_ZERO(cpus);
+
+    if((file = fopen(path, "r")) == NULL) {
+        return -1;
+    }
+
+    if(fgets(buffer, sizeof(buffer), file) == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+
+    while(*p >= '0' && *p <= '9') {
+        long first = strtol(p, &p, 10), last = first;
+
+        if(*p == '-') {
+            last = strtol(p + 1, &p, 10);
+        }
+
+        for(long c = first; c <= last && c < CPU_SETSIZE; c++) {
+            if(CPU_ISSET(c, allowed)) {
+                CPU_SET(c, cpus);
+            }
+        }
+
+        if(*p == ',') {
+            p++;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Compara dois inteiros, para o qsort().
+ * 
+ * @param a ponteiro para o primeiro inteiro
+ * @param b ponteiro para o segundo inteiro
+ * @return int negativo, zero ou positivo, conforme a ordem
+ */
+static int compare_int(const void *a, const void *b) {
+    return *(const int *) a - *(const int *) b;
+}
+
+/**
+ * @brief Obtém os nós NUMA e atribui uma CPU a cada thread.
+ * 
+ * Apenas as CPUs em que o processo pode executar são consideradas, e os
+ * nós sem CPUs disponíveis são ignorados. Cada nó recebe um bloco contíguo
+ * de threads proporcional ao seu número de CPUs, e as threads de um nó
+ * ocupam as CPUs do nó em ordem crescente. Sem o sysfs, todas as CPUs
+ * formam um único nó.
+ * 
+ * @param topology topologia a ser inicializada
+ * @param num_threads número de threads das regiões paralelas
+ * @param num_weights tamanho dos vetores gradiente
+ * @return int 0, se a topologia foi obtida; -1, caso contrário
+ */
+int topology_init(topology_t *topology, int num_threads, int num_weights) {
+    cpu_set_t allowed, node_cpus;
+    DIR *dir;
+    struct dirent *entry;
+    char path[300];
+    int *node_cpu_list, num_cpus = 0;
+
+    memset(topology, 0, sizeof(*topology));
+    topology->num_threads = num_threads;
+    topology->num_weights = num_weights;
+
+    if(num_threads <= 0 || sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+        return -1;
+    }
+
+    topology->node_ids = (int *) malloc(CPU_SETSIZE * sizeof(int));
+    topology->cpu_nodes = (int *) malloc(CPU_SETSIZE * sizeof(int));
+    topology->cpus = (int *) malloc(num_threads * sizeof(int));
+    topology->nodes = (int *) malloc(num_threads * sizeof(int));
+    topology->order = (int *) malloc(num_threads * sizeof(int));
+    topology->positions = (int *) malloc(num_threads * sizeof(int));
+    topology->partials = (float **) calloc(num_threads, sizeof(float *));
+    node_cpu_list = (int *) malloc(CPU_SETSIZE * sizeof(int));
+
+    if(topology->node_ids == NULL || topology->cpu_nodes == NULL || topology->cpus == NULL || topology->nodes == NULL
+        || topology->order == NULL || topology->positions == NULL || topology->partials == NULL || node_cpu_list == NULL) {
+        free(node_cpu_list);
+        topology_free(topology);
+        return -1;
+    }
+
+    for(int c = 0; c < CPU_SETSIZE; c++) {
+        topology->cpu_nodes[c] = -1;
+    }
+
+    /* nós com CPUs disponíveis, em ordem crescente de identificador */
+    if((dir = opendir(TOPOLOGY_SYSFS_NODES)) != NULL) {
+        while((entry = readdir(dir)) != NULL && topology->num_nodes < CPU_SETSIZE) {
+            int id;
+
+            if(sscanf(entry->d_name, "node%d", &id) != 1) {
+                continue;
+            }
+
+            snprintf(path, sizeof(path), "%s/node%d/cpulist", TOPOLOGY_SYSFS_NODES, id);
+            if(read_cpulist(path, &allowed, &node_cpus) == 0 && CPU_COUNT(&node_cpus) > 0) {
+                topology->node_ids[topology->num_nodes++] = id;
+            }
+        }
+
+        closedir(dir);
+    }
+
+    qsort(topology->node_ids, topology->num_nodes, sizeof(int), compare_int);
+
+    for(int n = 0; n < topology->num_nodes; n++) {
+        snprintf(path, sizeof(path), "%s/node%d/cpulist", TOPOLOGY_SYSFS_NODES, topology->node_ids[n]);
+        read_cpulist(path, &allowed, &node_cpus);
+
+        for(int c = 0; c < CPU_SETSIZE; c++) {
+            if(CPU_ISSET(c, &node_cpus) && topology->cpu_nodes[c] == -1) {
+                topology->cpu_nodes[c] = n;
+                num_cpus++;
+            }
+        }
+    }
+
+    /* sem o sysfs, as CPUs disponíveis formam um único nó */
+    if(num_cpus == 0) {
+        topology->num_nodes = 1;
+        topology->node_ids[0] = 0;
+
+        for(int c = 0; c < CPU_SETSIZE; c++) {
+            if(CPU_ISSET(c, &allowed)) {
+                topology->cpu_nodes[c] = 0;
+                num_cpus++;
+            }
+        }
+    }
+
+    /* cada nó recebe um bloco contíguo de threads, proporcional ao seu número de CPUs */
+    for(int n = 0, num_previous_cpus = 0; n < topology->num_nodes; n++) {
+        int num_node_cpus = 0, first_thread, end_thread;
+
+        for(int c = 0; c < CPU_SETSIZE; c++) {
+            if(topology->cpu_nodes[c] == n) {
+                node_cpu_list[num_node_cpus++] = c;
+            }
+        }
+
+        first_thread = (long) num_previous_cpus * num_threads / num_cpus;
+        end_thread = (long) (num_previous_cpus + num_node_cpus) * num_threads / num_cpus;
+
+        for(int t = first_thread; t < end_thread; t++) {
+            topology->cpus[t] = node_cpu_list[(t - first_thread) % num_node_cpus];
+            topology->nodes[t] = n;
+        }
+
+        num_previous_cpus += num_node_cpus;
+    }
+
+    free(node_cpu_list);
+    return 0;
+}
+
+/**
+ * @brief Fixa as threads do OpenMP e aloca os gradientes parciais.
+ * 
+ * Cada thread fixa a si mesma na CPU atribuída por topology_init(), a não
+ * ser que a afinidade já seja definida pelo OpenMP (OMP_PROC_BIND), e
+ * então aloca e escreve o seu gradiente parcial, que fica na memória do
+ * seu nó. As threads das regiões paralelas seguintes, com o mesmo número
+ * de threads, são as mesmas e mantêm a afinidade.
+ * 
+ * @param topology topologia obtida por topology_init()
+ * @return int 0, se todas as threads foram fixadas; -1, caso contrário
+ */
+int topology_bind(topology_t *topology) {
+    int status = 0;
+
+    topology->bound = omp_get_proc_bind() == omp_proc_bind_false;
+
+    #pragma omp parallel num_threads(topology->num_threads) reduction(min:status)
+    {
+        int t = omp_get_thread_num();
+
+        if(omp_get_num_threads() != topology->num_threads) {
+            status = -1;
+        } else if(topology->bound) {
+            cpu_set_t cpus;
+
+            CPU_ZERO(&cpus);
+            CPU_SET(topology->cpus[t], &cpus);
+            if(pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+                status = -1;
+            }
+        } else {
+            int cpu = sched_getcpu();
+
+            topology->cpus[t] = cpu;
+            topology->nodes[t] = cpu >= 0 && cpu < CPU_SETSIZE && topology->cpu_nodes[cpu] >= 0 ? topology->cpu_nodes[cpu] : 0;
+        }
+
+        /* a primeira escrita, pela própria thread, aloca as páginas no seu nó */
+        if(posix_memalign((void **) &topology->partials[t], DATASET_ALIGNMENT, topology->num_weights * sizeof(float)) != 0) {
+            topology->partials[t] = NULL;
+            status = -1;
+        } else {
+            memset(topology->partials[t], 0, topology->num_weights * sizeof(float));
+        }
+    }
+
+    /* ordem da redução: threads agrupadas por nó */
+    for(int n = 0, p = 0; n < topology->num_nodes; n++) {
+        for(int t = 0; t < topology->num_threads; t++) {
+            if(topology->nodes[t] == n) {
+                topology->order[p] = t;
+                topology->positions[t] = p++;
+            }
+        }
+    }
+
+    return status;
+}
+
+/**
+ * @brief Copia a matriz de um contêiner para a memória das threads que a processam.
+ * 
+ * A matriz é copiada para páginas anônimas novas, e cada linha é escrita
+ * pela thread que a processa no escalonamento estático (schedule(static))
+ * das épocas. As primeiras num_leading_rows linhas e as demais são
+ * divididas entre as threads separadamente, como as imagens de
+ * treinamento e as de validação separadas depois por dataset_split(). A
+ * matriz anterior é liberada, ou desmapeada se vier do cache.
+ * 
+ * Deve ser chamada fora de uma região paralela, após topology_bind().
+ * 
+ * @param topology topologia com as threads fixadas
+ * @param dataset contêiner cuja matriz é copiada
+ * @param num_leading_rows número de linhas da primeira divisão
+ * @return int 0, se a matriz foi copiada; -1, caso contrário
+ */
+int topology_place(const topology_t *topology, dataset_t *dataset, int num_leading_rows) {
+    size_t row_size = (size_t) dataset->stride * dataset_element_size(dataset->dtype), size = dataset_size(dataset);
+    const char *source = (const char *) dataset->data;
+    int num_images = dataset->num_images;
+    char *data;
+
+    if(size == 0) {
+        return 0;
+    }
+
+    /* páginas que ainda não foram escritas, ao contrário das que o malloc() pode reaproveitar */
+    if((data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+        return -1;
+    }
+
+    #pragma omp parallel num_threads(topology->num_threads)
+    {
+        #pragma omp for schedule(static)
+        for(int r = 0; r < num_leading_rows; r++) {
+            memcpy(data + r * row_size, source + r * row_size, row_size);
+        }
+
+        #pragma omp for schedule(static)
+        for(int r = num_leading_rows; r < num_images; r++) {
+            memcpy(data + r * row_size, source + r * row_size, row_size);
+        }
+    }
+
+    if(dataset->mapping != NULL) {
+        munmap(dataset->mapping, dataset->mapping_size);
+    } else {
+        free(dataset->data);
+    }
+
+    dataset->data = data;
+    dataset->mapping = data;
+    dataset->mapping_size = size;
+
+    return 0;
+}
+
+/**
+ * @brief Retorna o número de threads de um nó.
+ * 
+ * @param topology topologia com as threads fixadas
+ * @param node índice do nó
+ * @return int número de threads do nó
+ */
+int topology_node_threads(const topology_t *topology, int node) {
+    int num_threads = 0;
+
+    for(int t = 0; t < topology->num_threads; t++) {
+        num_threads += topology->nodes[t] == node;
+    }
+
+    return num_threads;
+}
+
+/**
+ * @brief Zera e retorna o gradiente parcial da thread chamadora.
+ * 
+ * @param topology topologia com as threads fixadas
+ * @return float* gradiente parcial, na memória do nó da thread
+ */
+float *topology_gradients(const topology_t *topology) {
+    float *partial = topology->partials[omp_get_thread_num()];
+
+    memset(partial, 0, topology->num_weights * sizeof(float));
+    return partial;
+}
+
+/**
+ * @brief Soma os gradientes parciais das threads.
+ * 
+ * A cada nível da árvore, a thread na posição p de order (múltiplo de
+ * 2 * step) soma ao seu gradiente parcial o da posição p + step. Como as
+ * threads de um nó são vizinhas em order, os primeiros níveis somam
+ * vetores do mesmo nó, e cada nível seguinte transfere no máximo um
+ * vetor entre dois nós. A soma final é copiada para gradients por todas
+ * as threads.
+ * 
+ * Deve ser chamada por todas as threads de uma região paralela já aberta,
+ * após o acúmulo nos vetores de topology_gradients(); retorna após uma
+ * barreira.
+ * 
+ * @param topology topologia com as threads fixadas
+ * @param gradients vetor que recebe a soma dos gradientes parciais
+ */
+void topology_reduce(const topology_t *topology, float *gradients) {
+    int num_threads = topology->num_threads, num_weights = topology->num_weights;
+    int position = topology->positions[omp_get_thread_num()];
+    const float *sum;
+
+    for(int step = 1; step < num_threads; step *= 2) {
+        #pragma omp barrier
+
+        if(position % (2 * step) == 0 && position + step < num_threads) {
+            float *target = topology->partials[topology->order[position]];
+            const float *source = topology->partials[topology->order[position + step]];
+
+            for(int c = 0; c < num_weights; c++) {
+                target[c] += source[c];
+            }
+        }
+    }
+
+    #pragma omp barrier
+
+    sum = topology->partials[topology->order[0]];
+
+    #pragma omp for schedule(static)
+    for(int c = 0; c < num_weights; c++) {
+        gradients[c] = sum[c];
+    }
+}
+
+/**
+ * @brief Libera a topologia e os gradientes parciais.
+ * 
+ * @param topology topologia obtida por topology_init()
+ */
+void topology_free(topology_t *topology) {
+    if(topology->partials != NULL) {
+        for(int t = 0; t < topology->num_threads; t++) {
+            free(topology->partials[t]);
+        }
+    }
+
+    free(topology->node_ids);
+    free(topology->cpu_nodes);
+    free(topology->cpus);
+    free(topology->nodes);
+    free(topology->order);
+    free(topology->positions);
+    free(topology->partials);
+    memset(topology, 0, sizeof(*topology));
+}
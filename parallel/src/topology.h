@@ -0,0 +1,51 @@
+#ifndef TOPOLOGY_H__
+#define TOPOLOGY_H__
+
+/**
+ * @file topology.h
+ * @brief Interface do posicionamento das threads e dos dados nos nós NUMA.
+ * 
+ * Em máquinas com mais de um soquete, cada nó NUMA tem a sua própria
+ * memória, e uma página é alocada no nó da thread que a escreve pela
+ * primeira vez. O modo NUMA fixa cada thread do OpenMP em uma CPU,
+ * distribuindo as threads entre os nós na proporção das CPUs disponíveis
+ * em cada um e mantendo contíguas as threads de um mesmo nó. A matriz de
+ * treinamento é copiada para páginas novas, escritas pela thread que
+ * processa cada linha no escalonamento estático das épocas, e cada thread
+ * acumula o gradiente em um vetor próprio, alocado no seu nó. Os vetores
+ * parciais são somados em árvore, na ordem das threads agrupadas por nó:
+ * as somas entre threads do mesmo nó são feitas primeiro, e apenas os
+ * últimos níveis da árvore transferem um vetor de um nó para outro.
+ * 
+ * Quando OMP_PROC_BIND está definida, a afinidade das threads é a
+ * definida pelo OpenMP (OMP_PLACES) e o nó de cada thread é obtido da CPU
+ * em que ela executa.
+ * 
+ */
+
+#include "dataset.h"
+
+/** Distribuição das threads do OpenMP entre os nós NUMA **/
+typedef struct topology {
+    int num_threads;                /* número de threads das regiões paralelas */
+    int num_nodes;                  /* número de nós com CPUs disponíveis para o processo */
+    int num_weights;                /* tamanho dos vetores gradiente */
+    int bound;                      /* 1, se as threads foram fixadas por topology_bind(); 0, se pela afinidade do OpenMP */
+    int *node_ids;                  /* identificador de cada nó no sistema */
+    int *cpu_nodes;                 /* nó (índice em node_ids) de cada CPU, ou -1 */
+    int *cpus;                      /* CPU atribuída a cada thread */
+    int *nodes;                     /* nó de cada thread */
+    int *order;                     /* threads agrupadas por nó, na ordem da redução */
+    int *positions;                 /* posição de cada thread em order */
+    float **partials;               /* gradiente parcial de cada thread, na memória do seu nó */
+} topology_t;
+
+extern int topology_init(topology_t *topology, int num_threads, int num_weights);              /* obtém os nós e atribui uma CPU a cada thread */
+extern int topology_bind(topology_t *topology);                                               /* fixa as threads e aloca os gradientes parciais */
+extern int topology_place(const topology_t *topology, dataset_t *dataset, int num_leading_rows); /* copia a matriz para a memória das threads que a processam */
+extern int topology_node_threads(const topology_t *topology, int node);                       /* número de threads de um nó */
+extern float *topology_gradients(const topology_t *topology);                                 /* zera e retorna o gradiente parcial da thread */
+extern void topology_reduce(const topology_t *topology, float *gradients);                    /* soma os gradientes parciais em árvore */
+extern void topology_free(topology_t *topology);                                              /* libera a topologia */
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * @file dataset.c
+ * @brief Contêiner para os dados de treinamento e teste.
+ * 
+ * Esse arquivo contém os métodos de alocação e liberação do contêiner
+ * que armazena as imagens, as labels e os nomes das imagens lidas.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca de mapeamento de memória **/
+#include <sys/mman.h>
+
+#include "dataset.h"
+
+/**
+ * @brief Aloca o contêiner de dados.
+ * 
+ * Aloca uma única matriz contígua para todas as imagens, alinhada em
+ * DATASET_ALIGNMENT bytes e com as linhas completadas com zeros até o
+ * stride, além dos vetores de labels e de nomes.
+ * 
+ * @param dataset contêiner a ser inicializado
+ * @param num_images número de imagens (linhas)
+ * @param num_pixels número de pixels por imagem (colunas)
+ * @param dtype tipo de armazenamento dos pixels (DATASET_*)
+ * @return int 0, se a alocação foi bem sucedida; -1, caso contrário
+ */
+int dataset_alloc(dataset_t *dataset, int num_images, int num_pixels, int dtype) {
+    void *data;
+
+    dataset->dtype = dtype;
+    dataset->num_images = num_images;
+    dataset->num_pixels = num_pixels;
+    dataset->stride = dataset_stride(num_pixels, dtype);
+
+    if (posix_memalign(&data, DATASET_ALIGNMENT, dataset_size(dataset)) != 0) {
+        return -1;
+    }
+
+    dataset->data = data;
+    dataset->mapping = NULL;
+    dataset->mapping_size = 0;
+    memset(dataset->data, 0, dataset_size(dataset));
+    dataset->labels = (int *) calloc(num_images, sizeof(int));
+    dataset->names = calloc(num_images, sizeof(dataset->names[0]));
+
+    if (dataset->labels == NULL || dataset->names == NULL) {
+        dataset_free(dataset);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Libera o contêiner de dados.
+ * 
+ * Desfaz o mapeamento quando a matriz foi mapeada a partir do cache.
+ * 
+ * @param dataset contêiner a ser liberado
+ */
+void dataset_free(dataset_t *dataset) {
+    if(dataset->mapping != NULL) {
+        munmap(dataset->mapping, dataset->mapping_size);
+    } else {
+        free(dataset->data);
+    }
+    dataset->mapping = NULL;
+    free(dataset->labels);
+    free(dataset->names);
+    dataset->data = NULL;
+    dataset->labels = NULL;
+    dataset->names = NULL;
+    dataset->num_images = 0;
+}
+
+/**
+ * @brief Calcula o stride de uma linha.
+ * 
+ * @param num_pixels número de pixels por imagem
+ * @param dtype tipo de armazenamento dos pixels
+ * @return int número de pixels por imagem arredondado para um múltiplo do alinhamento
+ */
+int dataset_stride(int num_pixels, int dtype) {
+    int elements_per_line = DATASET_ALIGNMENT / dataset_element_size(dtype);
+
+    return (num_pixels + elements_per_line - 1) / elements_per_line * elements_per_line;
+}
+
+/** Nomes dos tipos de armazenamento, na ordem de DATASET_* **/
+static const char *dtype_names[DATASET_NUM_DTYPES] = { "float32", "uint8", "float16", "bfloat16" };
+
+/**
+ * @brief Retorna o nome de um tipo de armazenamento.
+ * 
+ * @param dtype tipo de armazenamento dos pixels
+ * @return const char* "float32", "uint8", "float16" ou "bfloat16"
+ */
+const char *dataset_dtype_name(int dtype) {
+    return dtype >= 0 && dtype < DATASET_NUM_DTYPES ? dtype_names[dtype] : dtype_names[DATASET_FLOAT32];
+}
+
+/**
+ * @brief Obtém o tipo de armazenamento a partir do nome.
+ * 
+ * @param name "float32", "uint8", "float16", "bfloat16" ou NULL (float32)
+ * @return int tipo de armazenamento (DATASET_*); -1, se o nome não é suportado
+ */
+int dataset_dtype_from_name(const char *name) {
+    if(name == NULL) {
+        return DATASET_FLOAT32;
+    }
+
+    for(int dtype = 0; dtype < DATASET_NUM_DTYPES; dtype++) {
+        if(strcmp(name, dtype_names[dtype]) == 0) {
+            return dtype;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Separa as últimas linhas de um contêiner em uma visão.
+ * 
+ * O contêiner passa a ter num_rows linhas a menos e a visão aponta para as
+ * linhas separadas, sem cópia. A memória continua pertencendo ao
+ * contêiner original: a visão não deve ser liberada com dataset_free().
+ * 
+ * @param dataset contêiner a ser dividido
+ * @param num_rows número de linhas separadas, do final do contêiner
+ * @param tail visão que recebe as linhas separadas
+ */
+void dataset_split(dataset_t *dataset, int num_rows, dataset_t *tail) {
+    int first_row = dataset->num_images - num_rows;
+
+    *tail = *dataset;
+    tail->data = (char *) dataset->data + (size_t) first_row * dataset->stride * dataset_element_size(dataset->dtype);
+    tail->num_images = num_rows;
+    tail->labels = dataset->labels + first_row;
+    tail->names = dataset->names != NULL ? dataset->names + first_row : NULL;
+    tail->mapping = NULL;
+    tail->mapping_size = 0;
+
+    dataset->num_images = first_row;
+}
+
+/**
+ * @brief Converte um float para meia precisão IEEE 754.
+ * 
+ * Arredonda para o valor mais próximo (empates para o par), com
+ * subnormais, infinitos e NaN.
+ * 
+ * @param value valor em float
+ * @return uint16_t valor em float16
+ */
+static uint16_t float_to_half(float value) {
+    uint32_t bits, sign, mantissa, half, rest, halfway;
+    int exponent;
+
+    memcpy(&bits, &value, sizeof(bits));
+    sign = (bits >> 16) & 0x8000;
+    exponent = (int) ((bits >> 23) & 0xff) - 127 + 15;
+    mantissa = bits & 0x7fffff;
+
+    if(((bits >> 23) & 0xff) == 0xff) {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+
+    if(exponent >= 31) {
+        return sign | 0x7c00;
+    }
+
+    /* subnormal: o bit implícito passa a fazer parte da mantissa */
+    if(exponent <= 0) {
+        int shift = 14 - exponent;
+
+        if(shift > 24) {
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        half = ((uint32_t) exponent << 10) | (mantissa >> 13);
+        rest = mantissa & 0x1fff;
+        halfway = 0x1000;
+    }
+
+    /* o transporte do arredondamento para o expoente produz o valor correto, inclusive o infinito */
+    if(rest > halfway || (rest == halfway && (half & 1))) {
+        half++;
+    }
+
+    return sign | half;
+}
+
+/**
+ * @brief Converte um float para bfloat16.
+ * 
+ * Mantém os 16 bits mais significativos, arredondando para o valor mais
+ * próximo (empates para o par).
+ * 
+ * @param value valor em float
+ * @return uint16_t valor em bfloat16
+ */
+static uint16_t float_to_bfloat16(float value) {
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    if((bits & 0x7fffffff) > 0x7f800000) {
+        return (bits >> 16) | 0x40; //NaN silencioso
+    }
+
+    return (bits + 0x7fff + ((bits >> 16) & 1)) >> 16;
+}
+
+/**
+ * @brief Grava uma linha de pixels em float16 ou bfloat16.
+ * 
+ * Os pixels, já normalizados, são convertidos do float para o tipo de
+ * armazenamento do contêiner. Os demais pixels da linha não são alterados.
+ * 
+ * @param dataset contêiner em DATASET_FLOAT16 ou DATASET_BFLOAT16
+ * @param r índice da linha
+ * @param values pixels em float
+ * @param num_values número de pixels
+ */
+void dataset_pack_row(dataset_t *dataset, int r, const float *values, int num_values) {
+    uint16_t *row = dataset_row_u16(dataset, r);
+
+    if(dataset->dtype == DATASET_FLOAT16) {
+        for(int c = 0; c < num_values; c++) {
+            row[c] = float_to_half(values[c]);
+        }
+    } else {
+        for(int c = 0; c < num_values; c++) {
+            row[c] = float_to_bfloat16(values[c]);
+        }
+    }
+}
@@ -0,0 +1,1311 @@
+/**
+ * @file kernels.c
+ * @brief Kernels vetoriais usados no treinamento.
+ * 
+ * Esse arquivo contém as implementações escalar, SSE2, AVX2+FMA e AVX-512
+ * do produto escalar, do axpy e do produto escalar seguido de axpy, para
+ * linhas armazenadas em float, em uint8, em float16 ou em bfloat16 (as três
+ * últimas convertidas para float nos registradores, com acumulação em
+ * float). A conversão de float16 usa a instrução F16C (vcvtph2ps) nas
+ * implementações AVX2 e AVX-512; a de bfloat16 é apenas um deslocamento de
+ * 16 bits, disponível em todas as implementações vetoriais. Cada
+ * implementação é compilada com o atributo target correspondente, de forma
+ * que um mesmo binário execute em todos os nós, e a escolha é feita por
+ * kernels_init() a partir do CPUID.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+/** Inclusão da biblioteca math **/
+#include <math.h>
+
+/** Inclusão dos intrínsecos x86 **/
+#include <immintrin.h>
+
+#include "kernels.h"
+
+/* -- Escalar -- */
+
+static float dot_scalar(const float *x, const float *y, int n) {
+    float result = 0;
+
+    for(int i = 0; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+static void axpy_scalar(float a, const float *x, float *y, int n) {
+    for(int i = 0; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+static float dot_axpy_scalar(const float *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_scalar(x, w, n));
+
+    axpy_scalar(h - label, x, g, n);
+
+    return h;
+}
+
+static float dot_u8_scalar(const uint8_t *x, const float *y, int n) {
+    float result = 0;
+
+    for(int i = 0; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+static void axpy_u8_scalar(float a, const uint8_t *x, float *y, int n) {
+    for(int i = 0; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+static float dot_axpy_u8_scalar(const uint8_t *x, const float *w, float *g, float label, float scale, int n) {
+    float h = kernel_sigmoid(dot_u8_scalar(x, w, n) * scale);
+
+    axpy_u8_scalar((h - label) * scale, x, g, n);
+
+    return h;
+}
+
+static float half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t) (half & 0x8000) << 16, exponent = (half >> 10) & 0x1f, mantissa = half & 0x3ff, bits;
+    float result;
+
+    if(exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if(exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if(mantissa != 0) {
+        /* subnormal: normaliza a mantissa */
+        exponent = 113;
+        while(!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    } else {
+        bits = sign;
+    }
+
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static float bfloat16_to_float(uint16_t value) {
+    uint32_t bits = (uint32_t) value << 16;
+    float result;
+
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static float dot_f16_scalar(const uint16_t *x, const float *y, int n) {
+    float result = 0;
+
+    for(int i = 0; i < n; i++) {
+        result += half_to_float(x[i]) * y[i];
+    }
+
+    return result;
+}
+
+static void axpy_f16_scalar(float a, const uint16_t *x, float *y, int n) {
+    for(int i = 0; i < n; i++) {
+        y[i] += a * half_to_float(x[i]);
+    }
+}
+
+static float dot_axpy_f16_scalar(const uint16_t *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_f16_scalar(x, w, n));
+
+    axpy_f16_scalar(h - label, x, g, n);
+
+    return h;
+}
+
+static float dot_bf16_scalar(const uint16_t *x, const float *y, int n) {
+    float result = 0;
+
+    for(int i = 0; i < n; i++) {
+        result += bfloat16_to_float(x[i]) * y[i];
+    }
+
+    return result;
+}
+
+static void axpy_bf16_scalar(float a, const uint16_t *x, float *y, int n) {
+    for(int i = 0; i < n; i++) {
+        y[i] += a * bfloat16_to_float(x[i]);
+    }
+}
+
+static float dot_axpy_bf16_scalar(const uint16_t *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_bf16_scalar(x, w, n));
+
+    axpy_bf16_scalar(h - label, x, g, n);
+
+    return h;
+}
+
+static void dot_many_scalar(const float *x, const float *w, int ldw, int num_models, int n, float *results) {
+    for(int m = 0; m < num_models; m++) {
+        results[m] = dot_scalar(x, w + (long) m * ldw, n);
+    }
+}
+
+static void axpy_many_scalar(const float *a, const float *x, float *y, int ldy, int num_models, int n) {
+    for(int m = 0; m < num_models; m++) {
+        axpy_scalar(a[m], x, y + (long) m * ldy, n);
+    }
+}
+
+static float pool_cell_scalar(const float *x, int width, int factor, int i, int j) {
+    float sum = 0;
+
+    for(int a = 0; a < factor; a++) {
+        for(int b = 0; b < factor; b++) {
+            sum += x[(i * factor + a) * width + j * factor + b];
+        }
+    }
+
+    return sum / (factor * factor);
+}
+
+static void pool_2x2_scalar(const float *x, int width, int height, float *y) {
+    for(int i = 0; i < height / 2; i++) {
+        for(int j = 0; j < width / 2; j++) {
+            y[i * (width / 2) + j] = pool_cell_scalar(x, width, 2, i, j);
+        }
+    }
+}
+
+static void pool_4x4_scalar(const float *x, int width, int height, float *y) {
+    for(int i = 0; i < height / 4; i++) {
+        for(int j = 0; j < width / 4; j++) {
+            y[i * (width / 4) + j] = pool_cell_scalar(x, width, 4, i, j);
+        }
+    }
+}
+
+/* -- SSE2 -- */
+
+__attribute__((target("sse2")))
+static float hsum_sse2(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse2")))
+static float dot_sse2(const float *x, const float *y, int n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    int i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+    }
+
+    float result = hsum_sse2(_mm_add_ps(acc0, acc1));
+
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("sse2")))
+static void axpy_sse2(float a, const float *x, float *y, int n) {
+    __m128 va = _mm_set1_ps(a);
+    int i = 0;
+
+    for(; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static float dot_axpy_sse2(const float *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_sse2(x, w, n));
+
+    axpy_sse2(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("sse2")))
+static float dot_u8_sse2(const uint8_t *x, const float *y, int n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (x + i));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), _mm_loadu_ps(y + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), _mm_loadu_ps(y + i + 4)));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), _mm_loadu_ps(y + i + 8)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), _mm_loadu_ps(y + i + 12)));
+    }
+
+    float result = hsum_sse2(_mm_add_ps(acc0, acc1));
+
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("sse2")))
+static void axpy_u8_sse2(float a, const uint8_t *x, float *y, int n) {
+    __m128 va = _mm_set1_ps(a);
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (x + i));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)))));
+        _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_mul_ps(va, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)))));
+        _mm_storeu_ps(y + i + 8, _mm_add_ps(_mm_loadu_ps(y + i + 8), _mm_mul_ps(va, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)))));
+        _mm_storeu_ps(y + i + 12, _mm_add_ps(_mm_loadu_ps(y + i + 12), _mm_mul_ps(va, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)))));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("sse2")))
+static float dot_axpy_u8_sse2(const uint8_t *x, const float *w, float *g, float label, float scale, int n) {
+    float h = kernel_sigmoid(dot_u8_sse2(x, w, n) * scale);
+
+    axpy_u8_sse2((h - label) * scale, x, g, n);
+
+    return h;
+}
+
+/* bfloat16: os 16 bits entram na metade alta de cada float; float16 usa as versões escalares (sem F16C) */
+
+__attribute__((target("sse2")))
+static float dot_bf16_sse2(const uint16_t *x, const float *y, int n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        __m128i halves = _mm_loadu_si128((const __m128i *) (x + i));
+
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(zero, halves)), _mm_loadu_ps(y + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_castsi128_ps(_mm_unpackhi_epi16(zero, halves)), _mm_loadu_ps(y + i + 4)));
+    }
+
+    float result = hsum_sse2(_mm_add_ps(acc0, acc1));
+
+    for(; i < n; i++) {
+        result += bfloat16_to_float(x[i]) * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("sse2")))
+static void axpy_bf16_sse2(float a, const uint16_t *x, float *y, int n) {
+    __m128 va = _mm_set1_ps(a);
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        __m128i halves = _mm_loadu_si128((const __m128i *) (x + i));
+
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_castsi128_ps(_mm_unpacklo_epi16(zero, halves)))));
+        _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_mul_ps(va, _mm_castsi128_ps(_mm_unpackhi_epi16(zero, halves)))));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * bfloat16_to_float(x[i]);
+    }
+}
+
+__attribute__((target("sse2")))
+static float dot_axpy_bf16_sse2(const uint16_t *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_bf16_sse2(x, w, n));
+
+    axpy_bf16_sse2(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("sse2")))
+static void dot_many_sse2(const float *x, const float *w, int ldw, int num_models, int n, float *results) {
+    int m = 0;
+
+    for(; m + 4 <= num_models; m += 4) {
+        const float *w0 = w + (long) m * ldw, *w1 = w0 + ldw, *w2 = w1 + ldw, *w3 = w2 + ldw;
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        int i = 0;
+
+        for(; i + 4 <= n; i += 4) {
+            __m128 vx = _mm_loadu_ps(x + i);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(vx, _mm_loadu_ps(w0 + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(vx, _mm_loadu_ps(w1 + i)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(vx, _mm_loadu_ps(w2 + i)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(vx, _mm_loadu_ps(w3 + i)));
+        }
+
+        results[m] = hsum_sse2(acc0);
+        results[m + 1] = hsum_sse2(acc1);
+        results[m + 2] = hsum_sse2(acc2);
+        results[m + 3] = hsum_sse2(acc3);
+
+        for(; i < n; i++) {
+            results[m] += x[i] * w0[i];
+            results[m + 1] += x[i] * w1[i];
+            results[m + 2] += x[i] * w2[i];
+            results[m + 3] += x[i] * w3[i];
+        }
+    }
+
+    for(; m < num_models; m++) {
+        results[m] = dot_sse2(x, w + (long) m * ldw, n);
+    }
+}
+
+__attribute__((target("sse2")))
+static void axpy_many_sse2(const float *a, const float *x, float *y, int ldy, int num_models, int n) {
+    int m = 0;
+
+    for(; m + 4 <= num_models; m += 4) {
+        float *y0 = y + (long) m * ldy, *y1 = y0 + ldy, *y2 = y1 + ldy, *y3 = y2 + ldy;
+        __m128 va0 = _mm_set1_ps(a[m]), va1 = _mm_set1_ps(a[m + 1]), va2 = _mm_set1_ps(a[m + 2]), va3 = _mm_set1_ps(a[m + 3]);
+        int i = 0;
+
+        for(; i + 4 <= n; i += 4) {
+            __m128 vx = _mm_loadu_ps(x + i);
+            _mm_storeu_ps(y0 + i, _mm_add_ps(_mm_loadu_ps(y0 + i), _mm_mul_ps(va0, vx)));
+            _mm_storeu_ps(y1 + i, _mm_add_ps(_mm_loadu_ps(y1 + i), _mm_mul_ps(va1, vx)));
+            _mm_storeu_ps(y2 + i, _mm_add_ps(_mm_loadu_ps(y2 + i), _mm_mul_ps(va2, vx)));
+            _mm_storeu_ps(y3 + i, _mm_add_ps(_mm_loadu_ps(y3 + i), _mm_mul_ps(va3, vx)));
+        }
+
+        for(; i < n; i++) {
+            y0[i] += a[m] * x[i];
+            y1[i] += a[m + 1] * x[i];
+            y2[i] += a[m + 2] * x[i];
+            y3[i] += a[m + 3] * x[i];
+        }
+    }
+
+    for(; m < num_models; m++) {
+        axpy_sse2(a[m], x, y + (long) m * ldy, n);
+    }
+}
+
+/* soma dos pares de colunas vizinhas de a (colunas 0 a 3) e b (colunas 4 a 7) */
+__attribute__((target("sse2")))
+static inline __m128 pair_sum_sse2(__m128 a, __m128 b) {
+    return _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+__attribute__((target("sse2")))
+static void pool_2x2_sse2(const float *x, int width, int height, float *y) {
+    int out_width = width / 2;
+    __m128 quarter = _mm_set1_ps(0.25f);
+
+    for(int i = 0; i < height / 2; i++) {
+        const float *x0 = x + 2 * i * width, *x1 = x0 + width;
+        int j = 0;
+
+        for(; j + 4 <= out_width; j += 4) {
+            __m128 a = _mm_add_ps(_mm_loadu_ps(x0 + 2 * j), _mm_loadu_ps(x1 + 2 * j));
+            __m128 b = _mm_add_ps(_mm_loadu_ps(x0 + 2 * j + 4), _mm_loadu_ps(x1 + 2 * j + 4));
+            _mm_storeu_ps(y + i * out_width + j, _mm_mul_ps(pair_sum_sse2(a, b), quarter));
+        }
+
+        for(; j < out_width; j++) {
+            y[i * out_width + j] = pool_cell_scalar(x, width, 2, i, j);
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+static void pool_4x4_sse2(const float *x, int width, int height, float *y) {
+    int out_width = width / 4;
+    __m128 sixteenth = _mm_set1_ps(1.0f / 16);
+
+    for(int i = 0; i < height / 4; i++) {
+        const float *x0 = x + 4 * i * width, *x1 = x0 + width, *x2 = x1 + width, *x3 = x2 + width;
+        int j = 0;
+
+        for(; j + 4 <= out_width; j += 4) {
+            __m128 v[4];
+
+            for(int k = 0; k < 4; k++) {
+                int c = 4 * j + 4 * k;
+                v[k] = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(x0 + c), _mm_loadu_ps(x1 + c)), _mm_add_ps(_mm_loadu_ps(x2 + c), _mm_loadu_ps(x3 + c)));
+            }
+
+            __m128 sum = pair_sum_sse2(pair_sum_sse2(v[0], v[1]), pair_sum_sse2(v[2], v[3]));
+            _mm_storeu_ps(y + i * out_width + j, _mm_mul_ps(sum, sixteenth));
+        }
+
+        for(; j < out_width; j++) {
+            y[i * out_width + j] = pool_cell_scalar(x, width, 4, i, j);
+        }
+    }
+}
+
+/* -- AVX2 + FMA -- */
+
+__attribute__((target("avx2,fma")))
+static float hsum_avx2(__m256 v) {
+    __m128 r = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+    r = _mm_add_ss(r, _mm_shuffle_ps(r, r, 1));
+    return _mm_cvtss_f32(r);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float *x, const float *y, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24), acc3);
+    }
+
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+    }
+
+    float result = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(float a, const float *x, float *y, int n) {
+    __m256 va = _mm256_set1_ps(a);
+    int i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_axpy_avx2(const float *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_avx2(x, w, n));
+
+    axpy_avx2(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_u8_avx2(const uint8_t *x, const float *y, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (x + i)))), _mm256_loadu_ps(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (x + i + 8)))), _mm256_loadu_ps(y + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (x + i + 16)))), _mm256_loadu_ps(y + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (x + i + 24)))), _mm256_loadu_ps(y + i + 24), acc3);
+    }
+
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (x + i)))), _mm256_loadu_ps(y + i), acc0);
+    }
+
+    float result = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_u8_avx2(float a, const uint8_t *x, float *y, int n) {
+    __m256 va = _mm256_set1_ps(a);
+    int i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (x + i))));
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, vx, _mm256_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_axpy_u8_avx2(const uint8_t *x, const float *w, float *g, float label, float scale, int n) {
+    float h = kernel_sigmoid(dot_u8_avx2(x, w, n) * scale);
+
+    axpy_u8_avx2((h - label) * scale, x, g, n);
+
+    return h;
+}
+
+/* float16 é convertido por F16C; bfloat16 é estendido para 32 bits e deslocado */
+
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256 load_f16_avx2(const uint16_t *x) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) x));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256 load_bf16_avx2(const uint16_t *x) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) x)), 16));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_f16_avx2(const uint16_t *x, const float *y, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(load_f16_avx2(x + i), _mm256_loadu_ps(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(load_f16_avx2(x + i + 8), _mm256_loadu_ps(y + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(load_f16_avx2(x + i + 16), _mm256_loadu_ps(y + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(load_f16_avx2(x + i + 24), _mm256_loadu_ps(y + i + 24), acc3);
+    }
+
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(load_f16_avx2(x + i), _mm256_loadu_ps(y + i), acc0);
+    }
+
+    float result = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+
+    for(; i < n; i++) {
+        result += half_to_float(x[i]) * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void axpy_f16_avx2(float a, const uint16_t *x, float *y, int n) {
+    __m256 va = _mm256_set1_ps(a);
+    int i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, load_f16_avx2(x + i), _mm256_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * half_to_float(x[i]);
+    }
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_axpy_f16_avx2(const uint16_t *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_f16_avx2(x, w, n));
+
+    axpy_f16_avx2(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_bf16_avx2(const uint16_t *x, const float *y, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(load_bf16_avx2(x + i), _mm256_loadu_ps(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(load_bf16_avx2(x + i + 8), _mm256_loadu_ps(y + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(load_bf16_avx2(x + i + 16), _mm256_loadu_ps(y + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(load_bf16_avx2(x + i + 24), _mm256_loadu_ps(y + i + 24), acc3);
+    }
+
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(load_bf16_avx2(x + i), _mm256_loadu_ps(y + i), acc0);
+    }
+
+    float result = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+
+    for(; i < n; i++) {
+        result += bfloat16_to_float(x[i]) * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void axpy_bf16_avx2(float a, const uint16_t *x, float *y, int n) {
+    __m256 va = _mm256_set1_ps(a);
+    int i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, load_bf16_avx2(x + i), _mm256_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * bfloat16_to_float(x[i]);
+    }
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_axpy_bf16_avx2(const uint16_t *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_bf16_avx2(x, w, n));
+
+    axpy_bf16_avx2(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("avx2,fma")))
+static void dot_many_avx2(const float *x, const float *w, int ldw, int num_models, int n, float *results) {
+    int m = 0;
+
+    for(; m + 4 <= num_models; m += 4) {
+        const float *w0 = w + (long) m * ldw, *w1 = w0 + ldw, *w2 = w1 + ldw, *w3 = w2 + ldw;
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        int i = 0;
+
+        for(; i + 8 <= n; i += 8) {
+            __m256 vx = _mm256_loadu_ps(x + i);
+            acc0 = _mm256_fmadd_ps(vx, _mm256_loadu_ps(w0 + i), acc0);
+            acc1 = _mm256_fmadd_ps(vx, _mm256_loadu_ps(w1 + i), acc1);
+            acc2 = _mm256_fmadd_ps(vx, _mm256_loadu_ps(w2 + i), acc2);
+            acc3 = _mm256_fmadd_ps(vx, _mm256_loadu_ps(w3 + i), acc3);
+        }
+
+        results[m] = hsum_avx2(acc0);
+        results[m + 1] = hsum_avx2(acc1);
+        results[m + 2] = hsum_avx2(acc2);
+        results[m + 3] = hsum_avx2(acc3);
+
+        for(; i < n; i++) {
+            results[m] += x[i] * w0[i];
+            results[m + 1] += x[i] * w1[i];
+            results[m + 2] += x[i] * w2[i];
+            results[m + 3] += x[i] * w3[i];
+        }
+    }
+
+    for(; m < num_models; m++) {
+        results[m] = dot_avx2(x, w + (long) m * ldw, n);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_many_avx2(const float *a, const float *x, float *y, int ldy, int num_models, int n) {
+    int m = 0;
+
+    for(; m + 4 <= num_models; m += 4) {
+        float *y0 = y + (long) m * ldy, *y1 = y0 + ldy, *y2 = y1 + ldy, *y3 = y2 + ldy;
+        __m256 va0 = _mm256_set1_ps(a[m]), va1 = _mm256_set1_ps(a[m + 1]), va2 = _mm256_set1_ps(a[m + 2]), va3 = _mm256_set1_ps(a[m + 3]);
+        int i = 0;
+
+        for(; i + 8 <= n; i += 8) {
+            __m256 vx = _mm256_loadu_ps(x + i);
+            _mm256_storeu_ps(y0 + i, _mm256_fmadd_ps(va0, vx, _mm256_loadu_ps(y0 + i)));
+            _mm256_storeu_ps(y1 + i, _mm256_fmadd_ps(va1, vx, _mm256_loadu_ps(y1 + i)));
+            _mm256_storeu_ps(y2 + i, _mm256_fmadd_ps(va2, vx, _mm256_loadu_ps(y2 + i)));
+            _mm256_storeu_ps(y3 + i, _mm256_fmadd_ps(va3, vx, _mm256_loadu_ps(y3 + i)));
+        }
+
+        for(; i < n; i++) {
+            y0[i] += a[m] * x[i];
+            y1[i] += a[m + 1] * x[i];
+            y2[i] += a[m + 2] * x[i];
+            y3[i] += a[m + 3] * x[i];
+        }
+    }
+
+    for(; m < num_models; m++) {
+        axpy_avx2(a[m], x, y + (long) m * ldy, n);
+    }
+}
+
+/* soma dos pares de colunas vizinhas de a (colunas 0 a 7) e b (colunas 8 a 15), na ordem das colunas */
+__attribute__((target("avx2,fma")))
+static inline __m256 pair_sum_avx2(__m256 a, __m256 b) {
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_hadd_ps(a, b)), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__attribute__((target("avx2,fma")))
+static void pool_2x2_avx2(const float *x, int width, int height, float *y) {
+    int out_width = width / 2;
+    __m256 quarter = _mm256_set1_ps(0.25f);
+
+    for(int i = 0; i < height / 2; i++) {
+        const float *x0 = x + 2 * i * width, *x1 = x0 + width;
+        int j = 0;
+
+        for(; j + 8 <= out_width; j += 8) {
+            __m256 a = _mm256_add_ps(_mm256_loadu_ps(x0 + 2 * j), _mm256_loadu_ps(x1 + 2 * j));
+            __m256 b = _mm256_add_ps(_mm256_loadu_ps(x0 + 2 * j + 8), _mm256_loadu_ps(x1 + 2 * j + 8));
+            _mm256_storeu_ps(y + i * out_width + j, _mm256_mul_ps(pair_sum_avx2(a, b), quarter));
+        }
+
+        for(; j < out_width; j++) {
+            y[i * out_width + j] = pool_cell_scalar(x, width, 2, i, j);
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void pool_4x4_avx2(const float *x, int width, int height, float *y) {
+    int out_width = width / 4;
+    __m256 sixteenth = _mm256_set1_ps(1.0f / 16);
+
+    for(int i = 0; i < height / 4; i++) {
+        const float *x0 = x + 4 * i * width, *x1 = x0 + width, *x2 = x1 + width, *x3 = x2 + width;
+        int j = 0;
+
+        for(; j + 8 <= out_width; j += 8) {
+            __m256 v[4];
+
+            for(int k = 0; k < 4; k++) {
+                int c = 4 * j + 8 * k;
+                v[k] = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(x0 + c), _mm256_loadu_ps(x1 + c)), _mm256_add_ps(_mm256_loadu_ps(x2 + c), _mm256_loadu_ps(x3 + c)));
+            }
+
+            __m256 sum = pair_sum_avx2(pair_sum_avx2(v[0], v[1]), pair_sum_avx2(v[2], v[3]));
+            _mm256_storeu_ps(y + i * out_width + j, _mm256_mul_ps(sum, sixteenth));
+        }
+
+        for(; j < out_width; j++) {
+            y[i * out_width + j] = pool_cell_scalar(x, width, 4, i, j);
+        }
+    }
+}
+
+/* -- AVX-512 -- */
+
+__attribute__((target("avx512f")))
+static float dot_avx512(const float *x, const float *y, int n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), acc1);
+    }
+
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), acc0);
+    }
+
+    float result = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx512f")))
+static void axpy_avx512(float a, const float *x, float *y, int n) {
+    __m512 va = _mm512_set1_ps(a);
+    int i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("avx512f")))
+static float dot_axpy_avx512(const float *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_avx512(x, w, n));
+
+    axpy_avx512(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("avx512f")))
+static float dot_u8_avx512(const uint8_t *x, const float *y, int n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) (x + i)))), _mm512_loadu_ps(y + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) (x + i + 16)))), _mm512_loadu_ps(y + i + 16), acc1);
+    }
+
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) (x + i)))), _mm512_loadu_ps(y + i), acc0);
+    }
+
+    float result = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx512f")))
+static void axpy_u8_avx512(float a, const uint8_t *x, float *y, int n) {
+    __m512 va = _mm512_set1_ps(a);
+    int i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        __m512 vx = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *) (x + i))));
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, vx, _mm512_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+__attribute__((target("avx512f")))
+static float dot_axpy_u8_avx512(const uint8_t *x, const float *w, float *g, float label, float scale, int n) {
+    float h = kernel_sigmoid(dot_u8_avx512(x, w, n) * scale);
+
+    axpy_u8_avx512((h - label) * scale, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 load_f16_avx512(const uint16_t *x) {
+    return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *) x));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 load_bf16_avx512(const uint16_t *x) {
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) x)), 16));
+}
+
+__attribute__((target("avx512f")))
+static float dot_f16_avx512(const uint16_t *x, const float *y, int n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(load_f16_avx512(x + i), _mm512_loadu_ps(y + i), acc0);
+        acc1 = _mm512_fmadd_ps(load_f16_avx512(x + i + 16), _mm512_loadu_ps(y + i + 16), acc1);
+    }
+
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(load_f16_avx512(x + i), _mm512_loadu_ps(y + i), acc0);
+    }
+
+    float result = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+
+    for(; i < n; i++) {
+        result += half_to_float(x[i]) * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx512f")))
+static void axpy_f16_avx512(float a, const uint16_t *x, float *y, int n) {
+    __m512 va = _mm512_set1_ps(a);
+    int i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, load_f16_avx512(x + i), _mm512_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * half_to_float(x[i]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static float dot_axpy_f16_avx512(const uint16_t *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_f16_avx512(x, w, n));
+
+    axpy_f16_avx512(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("avx512f")))
+static float dot_bf16_avx512(const uint16_t *x, const float *y, int n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    int i = 0;
+
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(load_bf16_avx512(x + i), _mm512_loadu_ps(y + i), acc0);
+        acc1 = _mm512_fmadd_ps(load_bf16_avx512(x + i + 16), _mm512_loadu_ps(y + i + 16), acc1);
+    }
+
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(load_bf16_avx512(x + i), _mm512_loadu_ps(y + i), acc0);
+    }
+
+    float result = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+
+    for(; i < n; i++) {
+        result += bfloat16_to_float(x[i]) * y[i];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx512f")))
+static void axpy_bf16_avx512(float a, const uint16_t *x, float *y, int n) {
+    __m512 va = _mm512_set1_ps(a);
+    int i = 0;
+
+    for(; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, load_bf16_avx512(x + i), _mm512_loadu_ps(y + i)));
+    }
+
+    for(; i < n; i++) {
+        y[i] += a * bfloat16_to_float(x[i]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static float dot_axpy_bf16_avx512(const uint16_t *x, const float *w, float *g, float label, int n) {
+    float h = kernel_sigmoid(dot_bf16_avx512(x, w, n));
+
+    axpy_bf16_avx512(h - label, x, g, n);
+
+    return h;
+}
+
+__attribute__((target("avx512f")))
+static void dot_many_avx512(const float *x, const float *w, int ldw, int num_models, int n, float *results) {
+    int m = 0;
+
+    for(; m + 4 <= num_models; m += 4) {
+        const float *w0 = w + (long) m * ldw, *w1 = w0 + ldw, *w2 = w1 + ldw, *w3 = w2 + ldw;
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps(), acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        int i = 0;
+
+        for(; i + 16 <= n; i += 16) {
+            __m512 vx = _mm512_loadu_ps(x + i);
+            acc0 = _mm512_fmadd_ps(vx, _mm512_loadu_ps(w0 + i), acc0);
+            acc1 = _mm512_fmadd_ps(vx, _mm512_loadu_ps(w1 + i), acc1);
+            acc2 = _mm512_fmadd_ps(vx, _mm512_loadu_ps(w2 + i), acc2);
+            acc3 = _mm512_fmadd_ps(vx, _mm512_loadu_ps(w3 + i), acc3);
+        }
+
+        results[m] = _mm512_reduce_add_ps(acc0);
+        results[m + 1] = _mm512_reduce_add_ps(acc1);
+        results[m + 2] = _mm512_reduce_add_ps(acc2);
+        results[m + 3] = _mm512_reduce_add_ps(acc3);
+
+        for(; i < n; i++) {
+            results[m] += x[i] * w0[i];
+            results[m + 1] += x[i] * w1[i];
+            results[m + 2] += x[i] * w2[i];
+            results[m + 3] += x[i] * w3[i];
+        }
+    }
+
+    for(; m < num_models; m++) {
+        results[m] = dot_avx512(x, w + (long) m * ldw, n);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void axpy_many_avx512(const float *a, const float *x, float *y, int ldy, int num_models, int n) {
+    int m = 0;
+
+    for(; m + 4 <= num_models; m += 4) {
+        float *y0 = y + (long) m * ldy, *y1 = y0 + ldy, *y2 = y1 + ldy, *y3 = y2 + ldy;
+        __m512 va0 = _mm512_set1_ps(a[m]), va1 = _mm512_set1_ps(a[m + 1]), va2 = _mm512_set1_ps(a[m + 2]), va3 = _mm512_set1_ps(a[m + 3]);
+        int i = 0;
+
+        for(; i + 16 <= n; i += 16) {
+            __m512 vx = _mm512_loadu_ps(x + i);
+            _mm512_storeu_ps(y0 + i, _mm512_fmadd_ps(va0, vx, _mm512_loadu_ps(y0 + i)));
+            _mm512_storeu_ps(y1 + i, _mm512_fmadd_ps(va1, vx, _mm512_loadu_ps(y1 + i)));
+            _mm512_storeu_ps(y2 + i, _mm512_fmadd_ps(va2, vx, _mm512_loadu_ps(y2 + i)));
+            _mm512_storeu_ps(y3 + i, _mm512_fmadd_ps(va3, vx, _mm512_loadu_ps(y3 + i)));
+        }
+
+        for(; i < n; i++) {
+            y0[i] += a[m] * x[i];
+            y1[i] += a[m + 1] * x[i];
+            y2[i] += a[m + 2] * x[i];
+            y3[i] += a[m + 3] * x[i];
+        }
+    }
+
+    for(; m < num_models; m++) {
+        axpy_avx512(a[m], x, y + (long) m * ldy, n);
+    }
+}
+
+/* soma dos pares de colunas vizinhas de a (colunas 0 a 15) e b (colunas 16 a 31), na ordem das colunas */
+__attribute__((target("avx512f")))
+static inline __m512 pair_sum_avx512(__m512 a, __m512 b) {
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+
+    return _mm512_add_ps(_mm512_permutex2var_ps(a, even, b), _mm512_permutex2var_ps(a, odd, b));
+}
+
+__attribute__((target("avx512f")))
+static void pool_2x2_avx512(const float *x, int width, int height, float *y) {
+    int out_width = width / 2;
+    __m512 quarter = _mm512_set1_ps(0.25f);
+
+    for(int i = 0; i < height / 2; i++) {
+        const float *x0 = x + 2 * i * width, *x1 = x0 + width;
+        int j = 0;
+
+        for(; j + 16 <= out_width; j += 16) {
+            __m512 a = _mm512_add_ps(_mm512_loadu_ps(x0 + 2 * j), _mm512_loadu_ps(x1 + 2 * j));
+            __m512 b = _mm512_add_ps(_mm512_loadu_ps(x0 + 2 * j + 16), _mm512_loadu_ps(x1 + 2 * j + 16));
+            _mm512_storeu_ps(y + i * out_width + j, _mm512_mul_ps(pair_sum_avx512(a, b), quarter));
+        }
+
+        for(; j < out_width; j++) {
+            y[i * out_width + j] = pool_cell_scalar(x, width, 2, i, j);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void pool_4x4_avx512(const float *x, int width, int height, float *y) {
+    int out_width = width / 4;
+    __m512 sixteenth = _mm512_set1_ps(1.0f / 16);
+
+    for(int i = 0; i < height / 4; i++) {
+        const float *x0 = x + 4 * i * width, *x1 = x0 + width, *x2 = x1 + width, *x3 = x2 + width;
+        int j = 0;
+
+        for(; j + 16 <= out_width; j += 16) {
+            __m512 v[4];
+
+            for(int k = 0; k < 4; k++) {
+                int c = 4 * j + 16 * k;
+                v[k] = _mm512_add_ps(_mm512_add_ps(_mm512_loadu_ps(x0 + c), _mm512_loadu_ps(x1 + c)), _mm512_add_ps(_mm512_loadu_ps(x2 + c), _mm512_loadu_ps(x3 + c)));
+            }
+
+            __m512 sum = pair_sum_avx512(pair_sum_avx512(v[0], v[1]), pair_sum_avx512(v[2], v[3]));
+            _mm512_storeu_ps(y + i * out_width + j, _mm512_mul_ps(sum, sixteenth));
+        }
+
+        for(; j < out_width; j++) {
+            y[i * out_width + j] = pool_cell_scalar(x, width, 4, i, j);
+        }
+    }
+}
+
+/* -- Seleção da implementação -- */
+
+/** Implementações selecionadas, inicialmente as escalares **/
+float (*kernel_dot)(const float *x, const float *y, int n) = dot_scalar;
+void (*kernel_axpy)(float a, const float *x, float *y, int n) = axpy_scalar;
+float (*kernel_dot_axpy)(const float *x, const float *w, float *g, float label, int n) = dot_axpy_scalar;
+float (*kernel_dot_u8)(const uint8_t *x, const float *y, int n) = dot_u8_scalar;
+void (*kernel_axpy_u8)(float a, const uint8_t *x, float *y, int n) = axpy_u8_scalar;
+float (*kernel_dot_axpy_u8)(const uint8_t *x, const float *w, float *g, float label, float scale, int n) = dot_axpy_u8_scalar;
+float (*kernel_dot_f16)(const uint16_t *x, const float *y, int n) = dot_f16_scalar;
+void (*kernel_axpy_f16)(float a, const uint16_t *x, float *y, int n) = axpy_f16_scalar;
+float (*kernel_dot_axpy_f16)(const uint16_t *x, const float *w, float *g, float label, int n) = dot_axpy_f16_scalar;
+float (*kernel_dot_bf16)(const uint16_t *x, const float *y, int n) = dot_bf16_scalar;
+void (*kernel_axpy_bf16)(float a, const uint16_t *x, float *y, int n) = axpy_bf16_scalar;
+float (*kernel_dot_axpy_bf16)(const uint16_t *x, const float *w, float *g, float label, int n) = dot_axpy_bf16_scalar;
+void (*kernel_dot_many)(const float *x, const float *w, int ldw, int num_models, int n, float *results) = dot_many_scalar;
+void (*kernel_axpy_many)(const float *a, const float *x, float *y, int ldy, int num_models, int n) = axpy_many_scalar;
+void (*kernel_pool_2x2)(const float *x, int width, int height, float *y) = pool_2x2_scalar;
+void (*kernel_pool_4x4)(const float *x, int width, int height, float *y) = pool_4x4_scalar;
+
+/** Conjunto de instruções selecionado **/
+static kernel_isa_t selected_isa = KERNEL_ISA_SCALAR;
+
+/** Nomes dos conjuntos de instruções, na ordem de kernel_isa_t **/
+static const char *isa_names[] = { "scalar", "sse2", "avx2", "avx512" };
+
+/**
+ * @brief Verifica se o processador suporta um conjunto de instruções.
+ * 
+ * @param isa conjunto de instruções
+ * @return int 1, se suportado; 0, caso contrário
+ */
+static int isa_supported(kernel_isa_t isa) {
+    __builtin_cpu_init();
+
+    switch(isa) {
+        case KERNEL_ISA_AVX512:
+            return __builtin_cpu_supports("avx512f");
+        case KERNEL_ISA_AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+        case KERNEL_ISA_SSE2:
+            return __builtin_cpu_supports("sse2");
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Seleciona a implementação dos kernels.
+ * 
+ * Sem um conjunto de instruções informado, seleciona o mais recente
+ * suportado pelo processador. Caso um conjunto seja informado (para
+ * comparações de desempenho), ele é usado se for suportado.
+ * 
+ * @param isa_name "scalar", "sse2", "avx2", "avx512" ou NULL para detecção automática
+ * @return int 0, se a seleção foi bem sucedida; -1, se o conjunto é desconhecido ou não suportado
+ */
+int kernels_init(const char *isa_name) {
+    kernel_isa_t isa = KERNEL_ISA_AVX512;
+
+    if(isa_name != NULL && *isa_name != '\0') {
+        for(isa = KERNEL_ISA_SCALAR; isa <= KERNEL_ISA_AVX512; isa++) {
+            if(strcmp(isa_name, isa_names[isa]) == 0) {
+                break;
+            }
+        }
+
+        if(isa > KERNEL_ISA_AVX512 || !isa_supported(isa)) {
+            return -1;
+        }
+    } else {
+        while(!isa_supported(isa)) {
+            isa--;
+        }
+    }
+
+    switch(isa) {
+        case KERNEL_ISA_AVX512:
+            kernel_dot = dot_avx512;
+            kernel_axpy = axpy_avx512;
+            kernel_dot_axpy = dot_axpy_avx512;
+            kernel_dot_u8 = dot_u8_avx512;
+            kernel_axpy_u8 = axpy_u8_avx512;
+            kernel_dot_axpy_u8 = dot_axpy_u8_avx512;
+            kernel_dot_f16 = dot_f16_avx512;
+            kernel_axpy_f16 = axpy_f16_avx512;
+            kernel_dot_axpy_f16 = dot_axpy_f16_avx512;
+            kernel_dot_bf16 = dot_bf16_avx512;
+            kernel_axpy_bf16 = axpy_bf16_avx512;
+            kernel_dot_axpy_bf16 = dot_axpy_bf16_avx512;
+            kernel_dot_many = dot_many_avx512;
+            kernel_axpy_many = axpy_many_avx512;
+            kernel_pool_2x2 = pool_2x2_avx512;
+            kernel_pool_4x4 = pool_4x4_avx512;
+            break;
+        case KERNEL_ISA_AVX2:
+            kernel_dot = dot_avx2;
+            kernel_axpy = axpy_avx2;
+            kernel_dot_axpy = dot_axpy_avx2;
+            kernel_dot_u8 = dot_u8_avx2;
+            kernel_axpy_u8 = axpy_u8_avx2;
+            kernel_dot_axpy_u8 = dot_axpy_u8_avx2;
+            kernel_dot_f16 = dot_f16_avx2;
+            kernel_axpy_f16 = axpy_f16_avx2;
+            kernel_dot_axpy_f16 = dot_axpy_f16_avx2;
+            kernel_dot_bf16 = dot_bf16_avx2;
+            kernel_axpy_bf16 = axpy_bf16_avx2;
+            kernel_dot_axpy_bf16 = dot_axpy_bf16_avx2;
+            kernel_dot_many = dot_many_avx2;
+            kernel_axpy_many = axpy_many_avx2;
+            kernel_pool_2x2 = pool_2x2_avx2;
+            kernel_pool_4x4 = pool_4x4_avx2;
+            break;
+        case KERNEL_ISA_SSE2:
+            kernel_dot = dot_sse2;
+            kernel_axpy = axpy_sse2;
+            kernel_dot_axpy = dot_axpy_sse2;
+            kernel_dot_u8 = dot_u8_sse2;
+            kernel_axpy_u8 = axpy_u8_sse2;
+            kernel_dot_axpy_u8 = dot_axpy_u8_sse2;
+            kernel_dot_f16 = dot_f16_scalar;
+            kernel_axpy_f16 = axpy_f16_scalar;
+            kernel_dot_axpy_f16 = dot_axpy_f16_scalar;
+            kernel_dot_bf16 = dot_bf16_sse2;
+            kernel_axpy_bf16 = axpy_bf16_sse2;
+            kernel_dot_axpy_bf16 = dot_axpy_bf16_sse2;
+            kernel_dot_many = dot_many_sse2;
+            kernel_axpy_many = axpy_many_sse2;
+            kernel_pool_2x2 = pool_2x2_sse2;
+            kernel_pool_4x4 = pool_4x4_sse2;
+            break;
+        default:
+            kernel_dot = dot_scalar;
+            kernel_axpy = axpy_scalar;
+            kernel_dot_axpy = dot_axpy_scalar;
+            kernel_dot_u8 = dot_u8_scalar;
+            kernel_axpy_u8 = axpy_u8_scalar;
+            kernel_dot_axpy_u8 = dot_axpy_u8_scalar;
+            kernel_dot_f16 = dot_f16_scalar;
+            kernel_axpy_f16 = axpy_f16_scalar;
+            kernel_dot_axpy_f16 = dot_axpy_f16_scalar;
+            kernel_dot_bf16 = dot_bf16_scalar;
+            kernel_axpy_bf16 = axpy_bf16_scalar;
+            kernel_dot_axpy_bf16 = dot_axpy_bf16_scalar;
+            kernel_dot_many = dot_many_scalar;
+            kernel_axpy_many = axpy_many_scalar;
+            kernel_pool_2x2 = pool_2x2_scalar;
+            kernel_pool_4x4 = pool_4x4_scalar;
+            break;
+    }
+
+    selected_isa = isa;
+
+    return 0;
+}
+
+/**
+ * @brief Retorna o conjunto de instruções selecionado.
+ * 
+ * @return kernel_isa_t conjunto de instruções
+ */
+kernel_isa_t kernels_isa(void) {
+    return selected_isa;
+}
+
+/**
+ * @brief Retorna o nome do conjunto de instruções selecionado.
+ * 
+ * @return const char* nome do conjunto de instruções
+ */
+const char *kernels_isa_name(void) {
+    return isa_names[selected_isa];
+}
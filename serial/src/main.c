@@ -36,9 +36,39 @@
 /** Inclusão da biblioteca time **/
 #include <time.h>
 
-/** Inclusão do arquivo de cabeçalho responsável pela leitura do arquivo de entrada **/
+/** Inclusão da biblioteca unistd, para o truncate() **/
+#include <unistd.h>
+
+/** Inclusão do arquivo de cabeçalho responsável pela leitura dos arquivos de entrada **/
 #include "csv.h"
 
+/** Inclusão do arquivo de cabeçalho do contêiner de dados **/
+#include "dataset.h"
+
+/** Inclusão do arquivo de cabeçalho dos kernels vetoriais **/
+#include "kernels.h"
+
+/** Inclusão do arquivo de cabeçalho das opções de linha de comando **/
+#include "options.h"
+
+/** Inclusão do arquivo de cabeçalho do cache binário do dataset **/
+#include "cache.h"
+
+/** Inclusão do arquivo de cabeçalho do otimizador **/
+#include "optimizer.h"
+
+/** Inclusão do arquivo de cabeçalho do modelo treinado **/
+#include "model.h"
+
+/** Inclusão do arquivo de cabeçalho da leitura em blocos **/
+#include "stream.h"
+
+/** Inclusão do arquivo de cabeçalho do escritor assíncrono **/
+#include "sink.h"
+
+/** Inclusão do arquivo de cabeçalho dos checkpoints **/
+#include "checkpoint.h"
+
 
 /**
  * @brief Constante definindo o número de imagens para teste.
@@ -52,23 +82,113 @@ static const int NUM_IMAGES_TESTING = 1210;
  */
 static const int NUM_PIXELS = 128 * 128;
 
+/**
+ * @brief Constantes definindo a largura e a altura das imagens, registradas no modelo.
+ * 
+ */
+static const int IMAGE_WIDTH = 128, IMAGE_HEIGHT = 128;
+
+/**
+ * @brief Constante definindo o número de arquivos de entrada.
+ * 
+ */
+static const int NUM_FOLDS = 5;
+
+/**
+ * @brief Arquivos de entrada: o primeiro contém as imagens de teste e os demais, as de treinamento.
+ * 
+ */
+static const char *FOLD_FILES[] = {
+    "../../data/fold_0_after.csv",
+    "../../data/fold_1_after.csv",
+    "../../data/fold_2_after.csv",
+    "../../data/fold_3_after.csv",
+    "../../data/fold_4_after.csv"
+};
 
+/**
+ * @brief Caminhos padrão do cache binário do dataset, indexados pelo tipo de armazenamento dos pixels.
+ * 
+ */
+static const char *DEFAULT_CACHE_FILES[] = {
+    [DATASET_FLOAT32] = "../../data/dataset.bin",
+    [DATASET_UINT8] = "../../data/dataset_uint8.bin",
+    [DATASET_FLOAT16] = "../../data/dataset_float16.bin",
+    [DATASET_BFLOAT16] = "../../data/dataset_bfloat16.bin"
+};
 
 /**
- * @brief Realiza alocação dinâmica para uma string.
+ * @brief Arquivo de checkpoint padrão.
  * 
- * Realiza a alocação dinâmica para um espaço de memória de acordo com
- * a string informada.
+ */
+static const char *DEFAULT_CHECKPOINT_FILE = "../output/checkpoint.bin";
+
+/**
+ * @brief Fator de normalização dos pixels armazenados em uint8.
  * 
- * @param s string para a qual se deseja alocar um espaço de memória
- * @return void* ponteiro para o endereço de memória alocado
  */
-char *estrdup (char *s) {
-	char *t;
-	t = (char *) malloc(strlen(s)+1);
-	strcpy(t, s);
-	return t;
-}
+static const float PIXEL_SCALE = 1.0f / 255;
+
+/**
+ * @brief Posições do vetor de métricas de uma época.
+ * 
+ */
+enum { METRIC_TRUE_NEGATIVE, METRIC_FALSE_POSITIVE, METRIC_FALSE_NEGATIVE, METRIC_TRUE_POSITIVE, METRIC_COST, NUM_METRICS };
+
+/**
+ * @brief Registro de uma época, enviado ao escritor assíncrono.
+ */
+typedef struct epoch_record {
+    int epoch_num;                  /* número da época */
+    int num_images;                 /* número de imagens processadas na época */
+    double elapsed;                 /* tempo de treinamento decorrido ao final da época */
+    double metrics[NUM_METRICS];    /* métricas da época */
+} epoch_record_t;
+
+/**
+ * @brief Arquivos de saída gravados a cada época pelo escritor assíncrono.
+ */
+typedef struct epoch_files {
+    FILE *log, *cost, *accuracy, *precision, *f1, *recall, *accuracy_time;
+} epoch_files_t;
+
+/**
+ * @brief Arquivos de saída cujo tamanho é registrado nos checkpoints (CHECKPOINT_NUM_OUTPUTS).
+ */
+enum { OUTPUT_LOG, OUTPUT_CSV, OUTPUT_COST, OUTPUT_ACCURACY, OUTPUT_PRECISION, OUTPUT_RECALL, OUTPUT_F1, OUTPUT_ACCURACY_TIME };
+
+/**
+ * @brief Motivos da parada antecipada do treinamento.
+ */
+enum { STOP_NONE, STOP_PATIENCE, STOP_TARGET_F1 };
+
+/**
+ * @brief Critérios de parada antecipada e estado do monitoramento da validação.
+ */
+typedef struct early_stopping {
+    int patience;                   /* épocas sem melhora do custo de validação antes da parada; 0 desativa */
+    float min_delta;                /* redução mínima do custo de validação considerada uma melhora */
+    float target_f1;                /* F1 de validação que encerra o treinamento; 0 desativa */
+    double best_cost;               /* menor custo de validação */
+    double best_f1;                 /* F1 de validação da época de menor custo */
+    int best_epoch;                 /* época de menor custo (a partir de 1), ou 0 */
+    int num_bad_epochs;             /* épocas consecutivas sem melhora */
+    float *best_weights;            /* pesos ao final da época best_epoch */
+} early_stopping_t;
+
+/**
+ * @brief Número padrão de imagens por lote no modo de inferência.
+ * 
+ */
+static const int INFERENCE_BATCH_SIZE = 256;
+
+/**
+ * @brief Número de imagens convertidas e gravadas por vez na criação do cache.
+ * 
+ */
+static const int CACHE_BLOCK_ROWS = 256;
+
+
 
 /**
  * @brief Gera números reais aleatórios.
@@ -97,6 +217,45 @@ void initialize_weights(float *row, int num_total_images_training) {
     }
 }
 
+/**
+ * @brief Armazena uma linha do .csv de entrada em uma linha do contêiner.
+ * 
+ * A linha é rejeitada se não tem os campos de nome, label e pixels ou se
+ * o número de pixels convertidos é diferente do esperado.
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz que recebe a imagem
+ * @param line início da linha
+ * @param line_end fim da linha
+ * @param normalization valor pelo qual cada pixel armazenado em float é dividido
+ * @param scratch buffer de dataset->num_pixels posições, usado na conversão para 16 bits, ou NULL se não é necessário
+ * @return int 0, se a linha foi armazenada; -1, se a linha é inválida
+ */
+int store_record(dataset_t *dataset, int r, const char *line, const char *line_end, float normalization, float *scratch) {
+    csv_record_t record;
+    int num_decoded = 0;
+
+    if(csv_parse_record(line, line_end, &record) == -1) {
+        return -1;
+    }
+
+    dataset->labels[r] = record.label;
+    memcpy(dataset->names[r], record.name, record.name_length < DATASET_NAME_SIZE ? record.name_length : DATASET_NAME_SIZE - 1);
+
+    if(dataset->dtype == DATASET_UINT8) {
+        num_decoded = csv_decode_pixels_u8(record.pixels, record.pixels_end, dataset_row_u8(dataset, r), dataset->num_pixels); //normalização realizada nos kernels
+    } else if(scratch != NULL) {
+        num_decoded = csv_decode_pixels(record.pixels, record.pixels_end, scratch, dataset->num_pixels, normalization);
+        if(num_decoded == dataset->num_pixels) {
+            dataset_pack_row(dataset, r, scratch, dataset->num_pixels);
+        }
+    } else {
+        num_decoded = csv_decode_pixels(record.pixels, record.pixels_end, dataset_row(dataset, r), dataset->num_pixels, normalization);
+    }
+
+    return num_decoded == dataset->num_pixels ? 0 : -1;
+}
+
 /**
  * @brief Realiza a leitura completa do arquivo .csv de entrada.
  * 
@@ -104,92 +263,242 @@ void initialize_weights(float *row, int num_total_images_training) {
  * os pixels lidos nas matrizes para dados de teste e treinamento. Os
  * labels lidos são armazenados nos vetores de treinamento e de teste.
  * 
- * @param testing_images_names[NUM_IMAGES_TESTING][60] array contendo os nomes das imagens de teste
+ * Os cinco arquivos são mapeados em memória e divididos em blocos de
+ * linhas completas. As linhas de cada bloco são contadas para definir a
+ * posição de cada imagem nas matrizes e, em seguida, os blocos de todos
+ * os arquivos são convertidos em sequência.
+ * 
  * @param file_log_output ponteiro para escrita no log de saída
- * @param data_testing referência para matriz com dados para teste
- * @param data_training referência para matriz com dados para treinamento
- * @param labels_testing referência para vetor com labels para teste
- * @param labels_training referência para vetor com labels para treinamento
- * 
- * @return int 1, se a leitura foi bem sucedida; 0, caso contrário
- */
-int read_data_and_labels(char testing_images_names[NUM_IMAGES_TESTING][60], FILE *file_log_output, float **data_testing, float **data_training, int *labels_testing, int *labels_training, int num_total_images_training) {
-    char *line; //linha lida do arquivo
-    int row_testing = 0; //contador para linhas da matriz com dados para teste
-    int row_training = 1; //contador para linhas da matriz com dados para treinamento
-    char *label, *pixels, *usage, *pch, *name; 
-    float temp; 
-    FILE *file_input;
-    char *file_name;
-    int file_cont = 0;
-
-    /** aloca espaço para o bias e adiciona o bias ao dataset de treinamento **/
-    data_training[0] = (float *) malloc(NUM_PIXELS * sizeof(float));
-    for(int i = 0; i < NUM_PIXELS; i++) {
-        data_training[0][i] = 0;
-    } 
-    labels_training[0] = 1;
-
-    while (file_cont < 5 && row_training != num_total_images_training) {
-
-        if(file_cont == 0) {
-            file_name = estrdup("../../data/fold_0_after.csv");
-        } else if(file_cont == 1) {
-            file_name = estrdup("../../data/fold_1_after.csv");
-        } else if(file_cont == 2) {
-            file_name = estrdup("../../data/fold_2_after.csv");
-        } else if(file_cont == 3) {
-            file_name = estrdup("../../data/fold_3_after.csv");
-        } else if(file_cont == 4) {
-            file_name = estrdup("../../data/fold_4_after.csv");
-        }
-
-        /* tenta abrir o arquivo de entrada */
-        if ((file_input = fopen(file_name, "r")) == NULL) {
+ * @param testing contêiner com dados, labels e nomes das imagens de teste
+ * @param training contêiner com dados e labels das imagens de treinamento
+ * 
+ * @return int 0, se a leitura foi bem sucedida; -1, caso contrário
+ */
+int read_data_and_labels(FILE *file_log_output, dataset_t *testing, dataset_t *training) {
+    csv_file_t files[NUM_FOLDS]; //arquivos de entrada mapeados
+    csv_chunk_t **chunks; //blocos de todos os arquivos
+    int *chunk_files; //arquivo de cada bloco
+    int num_chunks = 0;
+    int num_invalid = 0; //linhas rejeitadas por store_record()
+    int next_row_testing = 0, next_row_training = 1; //posição da próxima linha de teste e de treinamento
+
+    /** adiciona o bias ao dataset de treinamento (a linha 0 já é alocada com zeros) **/
+    training->labels[0] = 1;
+
+    /* mapeia os arquivos de entrada */
+    for(int file_cont = 0; file_cont < NUM_FOLDS; file_cont++) {
+        if(csv_open(FOLD_FILES[file_cont], &files[file_cont], CSV_CHUNK_SIZE) == -1) {
             fprintf(file_log_output, "Não foi possível abrir o arquivo!");
+            while(file_cont-- > 0) {
+                csv_close(&files[file_cont]);
+            }
             return -1;
         }
+        num_chunks += files[file_cont].num_chunks;
+    }
+
+    chunks = (csv_chunk_t **) malloc(num_chunks * sizeof(csv_chunk_t *));
+    chunk_files = (int *) malloc(num_chunks * sizeof(int));
+
+    for(int file_cont = 0, i = 0; file_cont < NUM_FOLDS; file_cont++) {
+        for(int k = 0; k < files[file_cont].num_chunks; k++, i++) {
+            chunks[i] = &files[file_cont].chunks[k];
+            chunk_files[i] = file_cont;
+        }
+    }
 
-        /* itera o arquivo até o final, ou seja, até a linha obtida ser NULL */
-        while(((line = csvgetline(file_input, ',', 0)) != NULL) && row_training != num_total_images_training) {
-            name = estrdup(csvfield(0)); //obtém o nome do arquivo 
-            label = estrdup(csvfield(1)); //obtém o primeiro campo de uma linha (label)
-            pixels = estrdup(csvfield(2)); //obtém o segundo campo de uma linha (pixels)
+    /* conta as linhas de cada bloco */
+    for(int i = 0; i < num_chunks; i++) {
+        chunks[i]->num_lines = csv_count_lines(chunks[i]);
+    }
 
-            pch = strtok(pixels, " "); //separa os pixels por espaços
+    /* define a linha da matriz que recebe a primeira imagem de cada bloco: o arquivo 0
+     * contém as imagens de teste e os demais, as de treinamento, após o bias */
+    for(int i = 0; i < num_chunks; i++) {
+        if(chunk_files[i] == 0) {
+            chunks[i]->first_line = next_row_testing;
+            next_row_testing += chunks[i]->num_lines;
+        } else {
+            chunks[i]->first_line = next_row_training;
+            next_row_training += chunks[i]->num_lines;
+        }
+    }
 
-            if(file_cont == 0) { //verifica se a linha possui dados para teste
-                data_testing[row_testing] = (float *) malloc(NUM_PIXELS * sizeof(float));
-                labels_testing[row_testing] = atoi(label); //converte a label para inteiro e divide por 4, tornando-a 1 ou 0
-                strcpy(testing_images_names[row_testing], estrdup(csvfield(0)));
-            } else {
-                data_training[row_training] = (float *) malloc(NUM_PIXELS * sizeof(float));
-                labels_training[row_training] = atoi(label);
+    /* converte as linhas de todos os blocos */
+    for(int i = 0; i < num_chunks; i++) {
+        dataset_t *dataset = chunk_files[i] == 0 ? testing : training;
+        int row_end = dataset->num_images; //ignora imagens excedentes
+        const char *p = chunks[i]->begin, *line, *line_end;
+        float *scratch = dataset_element_size(dataset->dtype) == sizeof(uint16_t) ? (float *) malloc(dataset->num_pixels * sizeof(float)) : NULL; //pixels em float antes da conversão para 16 bits
+
+        for(int r = chunks[i]->first_line; r < row_end && (line = csv_next_line(p, chunks[i]->end, &line_end, &p)) != NULL; r++) {
+            if(store_record(dataset, r, line, line_end, 255, scratch) == -1) { //realiza normalização nos pixels
+                num_invalid++;
             }
+        }
 
-            /** realiza iteração para cada pixel que será lido **/
-            for(int c = 0; c < NUM_PIXELS; c++) {
-                temp = strtof(pch, NULL); //obtém 1 pixel
-                temp = temp/255; //realiza normalização no pixel
+        free(scratch);
+    }
 
-                if(file_cont == 0) { 
-                    data_testing[row_testing][c] = temp;
-                } else {
-                    data_training[row_training][c] = temp;
-                }
+    for(int file_cont = 0; file_cont < NUM_FOLDS; file_cont++) {
+        csv_close(&files[file_cont]);
+    }
+
+    free(chunks);
+    free(chunk_files);
 
-                pch = strtok(NULL, " ");
+    if(num_invalid > 0) {
+        fprintf(file_log_output, "Arquivos de entrada inválidos: %d linha(s) sem nome, label ou pixels, ou com um número de pixels diferente de %d!", num_invalid, NUM_PIXELS);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Converte os arquivos .csv de entrada para o cache binário.
+ * 
+ * Os arquivos são percorridos em sequência e as imagens são convertidas
+ * em blocos de CACHE_BLOCK_ROWS linhas, gravados no cache assim que
+ * prontos; apenas um bloco fica em memória, de forma que a conversão não
+ * depende do tamanho do conjunto de treinamento.
+ * 
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param cache_path caminho do arquivo de cache
+ * @param dtype tipo de armazenamento dos pixels
+ * @return int 0, se a conversão foi bem sucedida; -1, caso contrário
+ */
+int convert_data_to_cache(FILE *file_log_output, const char *cache_path, int dtype) {
+    cache_writer_t writer;
+    csv_file_t file;
+    dataset_t block; //bloco de imagens convertidas
+    const char **lines, **line_ends; //linhas do bloco
+    float *scratch = NULL; //pixels em float antes da conversão para 16 bits
+    int num_images_training = cache_count_lines(FOLD_FILES + 1, NUM_FOLDS - 1); //imagens de treinamento disponíveis
+    int next_row_testing = 0, next_row_training = 1; //posição da próxima linha de teste e de treinamento
+    int num_invalid = 0; //linhas rejeitadas por store_record()
+    int status = 0;
+
+    if(num_images_training == -1) {
+        fprintf(file_log_output, "Não foi possível abrir o arquivo!");
+        return -1;
+    }
+
+    lines = (const char **) malloc(CACHE_BLOCK_ROWS * sizeof(char *));
+    line_ends = (const char **) malloc(CACHE_BLOCK_ROWS * sizeof(char *));
+    if(dataset_element_size(dtype) == sizeof(uint16_t)) {
+        scratch = (float *) malloc(NUM_PIXELS * sizeof(float));
+    }
+
+    if(lines == NULL || line_ends == NULL || (dataset_element_size(dtype) == sizeof(uint16_t) && scratch == NULL) || dataset_alloc(&block, CACHE_BLOCK_ROWS, NUM_PIXELS, dtype) == -1) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        free(lines);
+        free(line_ends);
+        free(scratch);
+        return -1;
+    }
+
+    /* a linha adicional corresponde ao bias */
+    if(cache_writer_open(&writer, cache_path, FOLD_FILES, NUM_FOLDS, &block, NUM_IMAGES_TESTING, num_images_training + 1) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+        dataset_free(&block);
+        free(lines);
+        free(line_ends);
+        free(scratch);
+        return -1;
+    }
+
+    /** grava o bias na linha 0 do treinamento (o bloco é alocado com zeros) **/
+    block.labels[0] = 1;
+    if(cache_writer_put(&writer, CACHE_SECTION_TRAINING, 0, &block, 1) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+        status = -1;
+    }
+
+    /* o arquivo 0 contém as imagens de teste e os demais, as de treinamento */
+    for(int file_cont = 0; status == 0 && num_invalid == 0 && file_cont < NUM_FOLDS; file_cont++) {
+        int section = file_cont == 0 ? CACHE_SECTION_TESTING : CACHE_SECTION_TRAINING;
+        int *next_row = file_cont == 0 ? &next_row_testing : &next_row_training;
+        int row_end = file_cont == 0 ? NUM_IMAGES_TESTING : num_images_training + 1; //ignora imagens excedentes
+        const char *p, *end;
+        int num_rows;
+
+        if(csv_open(FOLD_FILES[file_cont], &file, CSV_CHUNK_SIZE) == -1) {
+            fprintf(file_log_output, "Não foi possível abrir o arquivo!");
+            status = -1;
+            break;
+        }
+
+        p = file.data;
+        end = file.data + file.size;
+
+        do {
+            /* separa as próximas linhas do arquivo */
+            for(num_rows = 0; num_rows < CACHE_BLOCK_ROWS && *next_row + num_rows < row_end
+                && (lines[num_rows] = csv_next_line(p, end, &line_ends[num_rows], &p)) != NULL; num_rows++);
+
+            memset(block.names, 0, num_rows * sizeof(block.names[0]));
+
+            for(int r = 0; r < num_rows; r++) {
+                if(store_record(&block, r, lines[r], line_ends[r], 255, scratch) == -1) { //realiza normalização nos pixels
+                    num_invalid++;
+                }
             }
 
-            if(file_cont == 0) {
-                row_testing++; //atualiza a contagem das linhas de teste
-            } else {
-                row_training++; //atualiza a contagem das linhas de treinamento
+            if(num_invalid == 0 && num_rows > 0 && cache_writer_put(&writer, section, *next_row, &block, num_rows) == -1) {
+                fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+                status = -1;
             }
-        }
 
-        fclose(file_input);
-        file_cont++;
+            *next_row += num_rows;
+        } while(status == 0 && num_invalid == 0 && num_rows == CACHE_BLOCK_ROWS);
+
+        csv_close(&file);
+    }
+
+    if(num_invalid > 0) {
+        fprintf(file_log_output, "Arquivos de entrada inválidos: %d linha(s) sem nome, label ou pixels, ou com um número de pixels diferente de %d!", num_invalid, NUM_PIXELS);
+        status = -1;
+    }
+
+    if(status == -1) {
+        cache_writer_abort(&writer);
+    } else if(cache_writer_close(&writer) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o cache %s!", cache_path);
+        status = -1;
+    }
+
+    dataset_free(&block);
+    free(lines);
+    free(line_ends);
+    free(scratch);
+
+    return status;
+}
+
+/**
+ * @brief Realiza a leitura dos dados a partir do cache binário.
+ * 
+ * Verifica o cache e, se ele estiver ausente ou desatualizado, converte
+ * os arquivos .csv de entrada. Em seguida, as matrizes são mapeadas em
+ * memória diretamente a partir do arquivo.
+ * 
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param cache_path caminho do arquivo de cache
+ * @param testing contêiner para as imagens de teste
+ * @param training contêiner para as imagens de treinamento
+ * @param num_total_images_training número de imagens de treinamento usadas
+ * @param dtype tipo de armazenamento dos pixels
+ * @return int 0, se a leitura foi bem sucedida; -1, caso contrário
+ */
+int read_cached_data_and_labels(FILE *file_log_output, const char *cache_path, dataset_t *testing, dataset_t *training, int num_total_images_training, int dtype) {
+    if(cache_validate(cache_path, FOLD_FILES, NUM_FOLDS, NUM_PIXELS, dtype) == -1 && convert_data_to_cache(file_log_output, cache_path, dtype) == -1) {
+        return -1;
+    }
+
+    if(cache_open(cache_path, testing, training, 0, num_total_images_training) == -1) {
+        fprintf(file_log_output, "Não foi possível mapear o cache %s!", cache_path);
+        return -1;
     }
 
     return 0;
@@ -199,31 +508,21 @@ int read_data_and_labels(char testing_images_names[NUM_IMAGES_TESTING][60], FILE
  * @brief Salva os resultados do treinamento em arquivo
  * 
  * @param epoch_num número da epoca
- * @param results vetor contendo resultados da regressão logistica
- * @param labels labels lidas do arquivo (valores corretos)
+ * @param metrics métricas da época
  * @param num_images número de imagens que foram processadas
  * @param file_log_output ponteiro para o arquivo de log de saída
+ * @param file_cost_output ponteiro para o arquivo com registros de custo
  * @param file_accuracy_output ponteiro para o arquivo com registros de acurácia
  * @param file_precision_output ponteiro para o arquivo com registros de precisão
  * @param file_f1_output ponteiro para o arquivo com registros de f1
  * @param file_recall_output ponteiro para o arquivo com registros de recall
+ * @return float acurácia da época
  */
-void save_training_results(int epoch_num, int *results, int *labels, int num_images, FILE *file_log_output, FILE *file_accuracy_output, FILE *file_precision_output, FILE *file_f1_output, FILE *file_recall_output) {
-    int true_positive = 0, true_negative = 0, false_positive = 0, false_negative = 0;
+float save_training_results(int epoch_num, double metrics[NUM_METRICS], int num_images, FILE *file_log_output, FILE *file_cost_output, FILE *file_accuracy_output, FILE *file_precision_output, FILE *file_f1_output, FILE *file_recall_output) {
+    int true_positive = metrics[METRIC_TRUE_POSITIVE], true_negative = metrics[METRIC_TRUE_NEGATIVE];
+    int false_positive = metrics[METRIC_FALSE_POSITIVE], false_negative = metrics[METRIC_FALSE_NEGATIVE];
     float accuracy = 0, precision = 0, recall = 0, f1 = 0;
-
-    /** computa os verdadeiros positivos e negativos e os falsos positivos e negativos **/
-    for(int i=0; i < num_images; i++) {
-        if(results[i] == 1 && labels[i] == 1) {
-            true_positive++;
-        } else if(results[i] == 1 && labels[i] == 0) {
-            false_positive++;
-        } else if(results[i] == 0 && labels[i] == 1) {
-            false_negative++;
-        } else {
-            true_negative++;
-        }
-    }
+    float cost = metrics[METRIC_COST] / num_images;
 
     accuracy = (float) (true_positive + true_negative) / (true_positive + true_negative + false_positive + false_negative);
     precision = (float) (true_positive) / (true_positive + false_positive); 
@@ -237,10 +536,102 @@ void save_training_results(int epoch_num, int *results, int *labels, int num_ima
 
     fprintf(file_log_output, "Acertos: %d       Erros: %d\n", true_positive + true_negative, false_positive + false_negative);
     fprintf(file_log_output, "Acurácia: %f      Precisão: %f        Revocação: %f       F1: %f\n", accuracy, precision, recall, f1);
+    fprintf(file_log_output, "Custo:    %f\n\n", cost);
+    fprintf(file_cost_output, "%d,%f\n", epoch_num + 1, cost);
     fprintf(file_accuracy_output, "%d,%f\n", epoch_num + 1, accuracy);
     fprintf(file_precision_output, "%d,%f\n", epoch_num + 1, precision);
     fprintf(file_recall_output, "%d,%f\n", epoch_num + 1, recall);
     fprintf(file_f1_output, "%d,%f\n", epoch_num + 1, f1);
+
+    return accuracy;
+}
+
+/**
+ * @brief Grava o registro de uma época, na thread do escritor assíncrono
+ * 
+ * @param record registro da época (epoch_record_t)
+ * @param context arquivos de saída (epoch_files_t)
+ */
+void write_epoch_record(const void *record, void *context) {
+    epoch_record_t *epoch = (epoch_record_t *) record;
+    epoch_files_t *files = (epoch_files_t *) context;
+
+    float accuracy = save_training_results(epoch->epoch_num, epoch->metrics, epoch->num_images, files->log, files->cost, files->accuracy, files->precision, files->f1, files->recall);
+    fprintf(files->accuracy_time, "%d,%f,%f\n", epoch->epoch_num + 1, epoch->elapsed, accuracy);
+}
+
+/**
+ * @brief Descarrega os arquivos de saída ao final de um lote de registros
+ * 
+ * @param context arquivos de saída (epoch_files_t)
+ */
+void flush_epoch_files(void *context) {
+    epoch_files_t *files = (epoch_files_t *) context;
+
+    fflush(files->log);
+    fflush(files->cost);
+    fflush(files->accuracy);
+    fflush(files->precision);
+    fflush(files->f1);
+    fflush(files->recall);
+    fflush(files->accuracy_time);
+}
+
+/**
+ * @brief Abre um arquivo de saída
+ * 
+ * Sem checkpoint, o arquivo é criado vazio. Ao retomar um treinamento, o
+ * arquivo é cortado no tamanho registrado no checkpoint, descartando o que
+ * foi gravado após ele, e aberto para acréscimo.
+ * 
+ * @param path caminho do arquivo
+ * @param resumed checkpoint carregado por --resume, ou NULL
+ * @param output índice do arquivo (OUTPUT_*)
+ * @return FILE* arquivo aberto, ou NULL
+ */
+FILE *open_output(const char *path, const checkpoint_t *resumed, int output) {
+    if(resumed == NULL) {
+        return fopen(path, "w");
+    }
+
+    /* um arquivo removido após o checkpoint é recriado */
+    if(truncate(path, resumed->offsets[output]) == -1 && errno != ENOENT) {
+        return NULL;
+    }
+
+    return fopen(path, "a");
+}
+
+/**
+ * @brief Grava um checkpoint ao final de uma época
+ * 
+ * Aguarda o escritor assíncrono, de forma que o tamanho registrado de cada
+ * arquivo de saída corresponda exatamente às épocas concluídas.
+ * 
+ * @param path caminho do arquivo de checkpoint
+ * @param checkpoint estado do treinamento, com os vetores preenchidos
+ * @param sink escritor assíncrono dos resultados das épocas
+ * @param output_files arquivos de saída, indexados por OUTPUT_*
+ * @param num_epochs número de épocas concluídas
+ * @param elapsed tempo de treinamento decorrido
+ * @param stopping estado da parada antecipada, gravado quando há validação
+ * @return int 0, se o checkpoint foi gravado; -1, caso contrário
+ */
+int write_checkpoint(const char *path, checkpoint_t *checkpoint, sink_t *sink, FILE *output_files[CHECKPOINT_NUM_OUTPUTS], int num_epochs, double elapsed, const early_stopping_t *stopping) {
+    sink_sync(sink);
+
+    for(int k = 0; k < CHECKPOINT_NUM_OUTPUTS; k++) {
+        checkpoint->offsets[k] = ftell(output_files[k]);
+    }
+
+    checkpoint->num_epochs = num_epochs;
+    checkpoint->elapsed = elapsed;
+    checkpoint->best_cost = stopping->best_cost;
+    checkpoint->best_f1 = stopping->best_f1;
+    checkpoint->best_epoch = stopping->best_epoch;
+    checkpoint->num_bad_epochs = stopping->num_bad_epochs;
+
+    return checkpoint_save(path, checkpoint);
 }
 
 /**
@@ -249,11 +640,11 @@ void save_training_results(int epoch_num, int *results, int *labels, int num_ima
  * @param results vetor contendo resultados da regressão logistica
  * @param labels labels lidas do arquivo (valores corretos)
  * @param num_images número de imagens que foram processadas
- * @param testing_images_names[NUM_IMAGES_TESTING][60] array contendo os nomes das imagens de teste
+ * @param testing_images_names array contendo os nomes das imagens de teste
  * @param file_log_output ponteiro para escrita no log de saída
  * @param file_csv_output ponteiro para escrita no arquivo csv de saída
  */
-void save_testing_results(int *results, int *labels, int num_images, char testing_images_names[NUM_IMAGES_TESTING][60], FILE *file_log_output, FILE *file_csv_output) {
+void save_testing_results(int *results, int *labels, int num_images, char testing_images_names[][DATASET_NAME_SIZE], FILE *file_log_output, FILE *file_csv_output) {
     int true_positive = 0, true_negative = 0, false_positive = 0, false_negative = 0;
     float accuracy = 0, precision = 0, recall = 0, f1 = 0;
 
@@ -291,84 +682,502 @@ void save_testing_results(int *results, int *labels, int num_images, char testin
  * @brief Realiza o cálculo da função hipótese.
  * 
  * Realiza o cálculo da função hipótese de acordo com uma
- * linha da matriz e com o vetor de pesos informado.
+ * linha da matriz e com o vetor de pesos informado. Usa a
+ * implementação do produto escalar selecionada por kernels_init().
+ * Linhas em uint8 são normalizadas após o produto escalar; linhas em
+ * float16 e bfloat16 são convertidas para float nos registradores.
  * 
- * @param row linha da matriz
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz
  * @param weights vetor de pesos
  * @return float resultado da função hipotese
  */
-float hypothesis_function(float *row, float *weights) {
-    float result = 0;
+float hypothesis_function(const dataset_t *dataset, int r, float *weights) {
+    float result;
+
+    if(dataset->dtype == DATASET_UINT8) {
+        result = kernel_dot_u8(dataset_row_u8(dataset, r), weights, dataset->num_pixels) * PIXEL_SCALE;
+    } else if(dataset->dtype == DATASET_FLOAT16) {
+        result = kernel_dot_f16(dataset_row_u16(dataset, r), weights, dataset->num_pixels);
+    } else if(dataset->dtype == DATASET_BFLOAT16) {
+        result = kernel_dot_bf16(dataset_row_u16(dataset, r), weights, dataset->num_pixels);
+    } else {
+        result = kernel_dot(dataset_row(dataset, r), weights, dataset->num_pixels);
+    }
+
+    return kernel_sigmoid(result); //aplica a função sigmoid e retorna o resultado
+}
+
+/**
+ * @brief Calcula a função hipótese de uma imagem e acumula a sua contribuição no gradiente.
+ * 
+ * O termo (h_r - y_r) * x_r é acumulado no vetor gradiente logo após o
+ * cálculo de h_r, enquanto a linha ainda está na cache, de forma que cada
+ * linha do dataset de treinamento é lida da memória uma única vez por
+ * época. Usa o kernel kernel_dot_axpy selecionado por kernels_init(); em
+ * linhas uint8, a normalização é aplicada ao produto escalar e ao coeficiente.
+ * 
+ * @param dataset contêiner de dados
+ * @param r índice da linha da matriz (imagem)
+ * @param weights vetor de pesos
+ * @param gradients vetor gradiente no qual a contribuição é acumulada
+ * @return float resultado da função hipótese
+ */
+float hypothesis_gradient(const dataset_t *dataset, int r, float *weights, float *gradients) {
+    if(dataset->dtype == DATASET_UINT8) {
+        return kernel_dot_axpy_u8(dataset_row_u8(dataset, r), weights, gradients, dataset->labels[r], PIXEL_SCALE, dataset->num_pixels);
+    }
+
+    if(dataset->dtype == DATASET_FLOAT16) {
+        return kernel_dot_axpy_f16(dataset_row_u16(dataset, r), weights, gradients, dataset->labels[r], dataset->num_pixels);
+    }
 
-    for(int c=0; c < NUM_PIXELS; c++) {
-        result += weights[c] * row[c];
+    if(dataset->dtype == DATASET_BFLOAT16) {
+        return kernel_dot_axpy_bf16(dataset_row_u16(dataset, r), weights, gradients, dataset->labels[r], dataset->num_pixels);
     }
 
-    return 1/(1 + exp(-result)); //aplica a função sigmoid e retorna o resultado
+    return kernel_dot_axpy(dataset_row(dataset, r), weights, gradients, dataset->labels[r], dataset->num_pixels);
 }
 
 /**
- * @brief Realiza o cálculo do gradiente descendente.
+ * @brief Acumula o resultado de uma imagem nas métricas da época.
  * 
- * Realiza o cálculo do gradiente descendente de acordo com o dataset de treinamento
- * informado, labels de treinamento e valores de hipótese.
+ * Incrementa a posição da matriz de confusão correspondente à hipótese
+ * binarizada e à label da imagem e soma o custo (log-loss) da imagem.
  * 
- * @param data_training dataset de treinamento
- * @param labels labels de treinamento
- * @param all_hypothesis valores calculados para hipótese
- * @param c valor atual da coluna
- * @param learning_rate taxa de aprendizado
- * @return float valor de gradiente resultante
+ * @param metrics vetor de métricas, indexado por METRIC_*
+ * @param hypothesis valor da função hipótese
+ * @param label label da imagem
  */
-float gradient(float **data_training, int *labels, float *all_hypothesis, int c, float learning_rate, int num_total_images_training) {
-    float gradient_sum = 0;
+void accumulate_metrics(double metrics[NUM_METRICS], float hypothesis, int label) {
+    int result = hypothesis >= 0.5; //realiza binarização do valor de hipótese
 
-    for(int r = 0; r < num_total_images_training; r++) {
-        gradient_sum += (all_hypothesis[r] - labels[r]) * data_training[r][c];
+    if(label == 1) {
+        metrics[result ? METRIC_TRUE_POSITIVE : METRIC_FALSE_NEGATIVE]++;
+    } else {
+        metrics[result ? METRIC_FALSE_POSITIVE : METRIC_TRUE_NEGATIVE]++;
     }
 
-    return gradient_sum * learning_rate;
+    metrics[METRIC_COST] += -(label * log(hypothesis)) - (1 - label) * log(1 - hypothesis);
 }
 
 /**
- * @brief Realiza a atualização dos pesos.
+ * @brief Realiza uma época de treinamento com o lote completo.
  * 
- * Realiza a atualização do vetor de pesos após a
- * execução de uma época de treinamento.
+ * Em uma única passagem pelas linhas do dataset de treinamento, calcula a
+ * função hipótese de cada imagem, acumula a matriz de confusão e o custo
+ * e soma a contribuição da imagem no gradiente. Ao final, os pesos são
+ * atualizados pelo otimizador.
  * 
- * @param data_training dataset de treinamento
+ * @param training contêiner com o dataset de treinamento
  * @param weights vetor de pesos
- * @param all_hypothesis valores calculados para hipótese
- * @param labels labels de treinamento
- * @param learning_rate taxa de aprendizado
+ * @param optimizer otimizador com a taxa de aprendizado e o momento
+ * @param gradients vetor gradiente
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
  */
-void update_weights(float **data_training, float *weights, float *all_hypothesis, int *labels, float learning_rate, int num_total_images_training) {
+void train_epoch(const dataset_t *training, float *weights, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS]) {
+    memset(gradients, 0, NUM_PIXELS * sizeof(float));
+    memset(metrics, 0, NUM_METRICS * sizeof(double));
 
-    for(int c=0; c < NUM_PIXELS; c++) {
-        weights[c] = weights[c] - (gradient(data_training, labels, all_hypothesis, c, learning_rate, num_total_images_training)/num_total_images_training);
+    for(int r = 0; r < training->num_images; r++) {
+        accumulate_metrics(metrics, hypothesis_gradient(training, r, weights, gradients), training->labels[r]);
     }
 
+    optimizer_step(optimizer, weights, gradients, training->num_images);
 }
 
 /**
- * @brief Realiza o cálculo da função de custo.
+ * @brief Realiza uma época de treinamento em mini-lotes.
  * 
- * Realiza o cálculo da função de custo.
+ * As imagens são embaralhadas e divididas em lotes, e os pesos são
+ * atualizados ao final de cada lote com o gradiente médio do lote. A
+ * hipótese de cada imagem, calculada com os pesos vigentes no momento em
+ * que a imagem é visitada, é acumulada nas métricas da época.
+ * 
+ * @param training contêiner com o dataset de treinamento
+ * @param weights vetor de pesos
+ * @param order ordem de visita das imagens, embaralhada a cada época
+ * @param optimizer otimizador com o tamanho dos lotes
+ * @param gradients vetor gradiente
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
+ */
+void train_minibatch_epoch(const dataset_t *training, float *weights, int *order, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS]) {
+    int num_images = training->num_images;
+    int num_batches = optimizer_num_batches(optimizer, num_images);
+
+    memset(metrics, 0, NUM_METRICS * sizeof(double));
+    optimizer_shuffle(optimizer, order, num_images);
+
+    for(int k = 0; k < num_batches; k++) {
+        int begin = optimizer_batch_begin(num_images, num_batches, k), end = optimizer_batch_begin(num_images, num_batches, k + 1);
+
+        memset(gradients, 0, NUM_PIXELS * sizeof(float));
+
+        for(int i = begin; i < end; i++) {
+            int r = order[i];
+
+            accumulate_metrics(metrics, hypothesis_gradient(training, r, weights, gradients), training->labels[r]);
+        }
+
+        optimizer_step(optimizer, weights, gradients, end - begin);
+    }
+}
+
+/**
+ * @brief Realiza uma época de treinamento com o lote completo, lendo as imagens em blocos.
+ * 
+ * Equivalente a train_epoch() no treinamento fora da memória: as linhas de
+ * cada bloco entregue por stream_next() são processadas enquanto a thread
+ * de leitura carrega o bloco seguinte, e os pesos são atualizados após o
+ * último bloco da época.
+ * 
+ * @param stream leitura em blocos das imagens de treinamento
+ * @param weights vetor de pesos
+ * @param optimizer otimizador com a taxa de aprendizado e o momento
+ * @param gradients vetor gradiente
+ * @param metrics vetor que recebe as métricas da época, indexado por METRIC_*
+ * @return int 0, se a época foi concluída; -1, se houve falha de leitura
+ */
+int train_stream_epoch(stream_t *stream, float *weights, optimizer_t *optimizer, float *gradients, double metrics[NUM_METRICS]) {
+    dataset_t chunk;
+
+    memset(gradients, 0, NUM_PIXELS * sizeof(float));
+    memset(metrics, 0, NUM_METRICS * sizeof(double));
+
+    for(int k = 0; k < stream->num_chunks; k++) {
+        if(stream_next(stream, &chunk) == -1) {
+            return -1;
+        }
+
+        for(int r = 0; r < chunk.num_images; r++) {
+            accumulate_metrics(metrics, hypothesis_gradient(&chunk, r, weights, gradients), chunk.labels[r]);
+        }
+    }
+
+    optimizer_step(optimizer, weights, gradients, stream->num_rows);
+
+    return 0;
+}
+
+/**
+ * @brief Calcula as métricas do conjunto de validação.
  * 
- * @param all_hypothesis vetor com valores calculados para hipótese
+ * @param validation contêiner com as imagens de validação
  * @param weights vetor de pesos
- * @param labels vetor de labels
- * @param num_total_images_training número de imagens
- * @return float custo resultante
+ * @param metrics vetor que recebe as métricas de validação, indexado por METRIC_*
  */
-float cost_function(float *all_hypothesis, float *weights, int *labels, int num_total_images_training) {
-    float cost = 0;
+void validate(const dataset_t *validation, float *weights, double metrics[NUM_METRICS]) {
+    memset(metrics, 0, NUM_METRICS * sizeof(double));
+
+    for(int r = 0; r < validation->num_images; r++) {
+        accumulate_metrics(metrics, hypothesis_function(validation, r, weights), validation->labels[r]);
+    }
+}
+
+/**
+ * @brief Atualiza o monitoramento da validação ao final de uma época.
+ * 
+ * Uma época melhora o treinamento quando reduz o menor custo de validação
+ * em mais de min_delta; nesse caso, os pesos são copiados para
+ * best_weights. O treinamento deve ser encerrado após patience épocas
+ * consecutivas sem melhora ou quando o F1 de validação atinge target_f1.
+ * 
+ * @param stopping critérios e estado da parada antecipada
+ * @param metrics métricas de validação da época, indexadas por METRIC_*
+ * @param num_images número de imagens de validação
+ * @param weights pesos ao final da época
+ * @param epoch_num número de épocas concluídas
+ * @return int motivo da parada (STOP_*), ou STOP_NONE para continuar
+ */
+int early_stopping_update(early_stopping_t *stopping, double metrics[NUM_METRICS], int num_images, const float *weights, int epoch_num) {
+    double cost = metrics[METRIC_COST] / num_images;
+    double true_positive = metrics[METRIC_TRUE_POSITIVE];
+    double f1 = true_positive > 0 ? 2 * true_positive / (2 * true_positive + metrics[METRIC_FALSE_POSITIVE] + metrics[METRIC_FALSE_NEGATIVE]) : 0;
+
+    if(cost < stopping->best_cost - stopping->min_delta) {
+        stopping->best_cost = cost;
+        stopping->best_f1 = f1;
+        stopping->best_epoch = epoch_num;
+        stopping->num_bad_epochs = 0;
+        memcpy(stopping->best_weights, weights, NUM_PIXELS * sizeof(float));
+    } else {
+        stopping->num_bad_epochs++;
+    }
 
-    for(int r=0; r < num_total_images_training; r++) {
-        cost += -(labels[r] * log(all_hypothesis[r])) - (1 - labels[r]) * log(1 - all_hypothesis[r]);
+    if(stopping->target_f1 > 0 && f1 >= stopping->target_f1) {
+        return STOP_TARGET_F1;
     }
 
-    return cost / num_total_images_training;
+    if(stopping->patience > 0 && stopping->num_bad_epochs >= stopping->patience) {
+        return STOP_PATIENCE;
+    }
+
+    return STOP_NONE;
+}
+
+/**
+ * @brief Obtém o tempo atual de um relógio monotônico.
+ * 
+ * @return double tempo em segundos
+ */
+double get_time(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Realiza a leitura de um arquivo .csv de imagens.
+ * 
+ * O arquivo é mapeado em memória e dividido em blocos de linhas completas,
+ * como em read_data_and_labels(). O contêiner é alocado com o número de
+ * linhas do arquivo.
+ * 
+ * @param file_log_output ponteiro para escrita no log de saída
+ * @param path caminho do arquivo .csv
+ * @param dataset contêiner a ser alocado e preenchido
+ * @param num_pixels número de pixels por imagem
+ * @param dtype tipo de armazenamento dos pixels
+ * @param normalization divisor aplicado aos pixels armazenados em float
+ * @return int 0, se a leitura foi bem sucedida; -1, caso contrário
+ */
+int read_images(FILE *file_log_output, const char *path, dataset_t *dataset, int num_pixels, int dtype, float normalization) {
+    csv_file_t file;
+    int num_images = 0, num_invalid = 0;
+
+    if(csv_open(path, &file, CSV_CHUNK_SIZE) == -1) {
+        fprintf(file_log_output, "Não foi possível abrir o arquivo %s!", path);
+        return -1;
+    }
+
+    /* conta as linhas de cada bloco */
+    for(int i = 0; i < file.num_chunks; i++) {
+        file.chunks[i].num_lines = csv_count_lines(&file.chunks[i]);
+    }
+
+    for(int i = 0; i < file.num_chunks; i++) {
+        file.chunks[i].first_line = num_images;
+        num_images += file.chunks[i].num_lines;
+    }
+
+    if(dataset_alloc(dataset, num_images, num_pixels, dtype) == -1) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        csv_close(&file);
+        return -1;
+    }
+
+    /* converte as linhas de todos os blocos */
+    for(int i = 0; i < file.num_chunks; i++) {
+        const char *p = file.chunks[i].begin, *line, *line_end;
+        float *scratch = dataset_element_size(dataset->dtype) == sizeof(uint16_t) ? (float *) malloc(dataset->num_pixels * sizeof(float)) : NULL; //pixels em float antes da conversão para 16 bits
+
+        for(int r = file.chunks[i].first_line; (line = csv_next_line(p, file.chunks[i].end, &line_end, &p)) != NULL; r++) {
+            if(store_record(dataset, r, line, line_end, normalization, scratch) == -1) {
+                num_invalid++;
+            }
+        }
+
+        free(scratch);
+    }
+
+    csv_close(&file);
+
+    if(num_invalid > 0) {
+        fprintf(file_log_output, "Arquivo %s inválido: %d linha(s) sem nome, label ou pixels, ou com um número de pixels diferente de %d!", path, num_invalid, num_pixels);
+        dataset_free(dataset);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Compara dois valores double, para uso com qsort().
+ * 
+ * @param a ponteiro para o primeiro valor
+ * @param b ponteiro para o segundo valor
+ * @return int negativo, zero ou positivo, conforme a ordem dos valores
+ */
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Executa o modo de inferência.
+ * 
+ * Carrega o modelo gravado ao final de um treinamento e classifica as
+ * imagens de um arquivo .csv, no formato dos arquivos de entrada, ou da
+ * seção de teste de um cache binário (.bin). As imagens são processadas em
+ * lotes e o tempo de cada lote é medido; o log registra as imagens por
+ * segundo, a latência dos lotes e a matriz de confusão, e o tempo de cada
+ * lote é gravado em ../graphics.
+ * 
+ * @param argc quantidade de argumentos
+ * @param argv vetor contendo as opções:
+ * --predict=arquivo modelo gravado por um treinamento
+ * --input=arquivo imagens a classificar (.csv ou cache .bin); padrão: imagens de teste
+ * --batch=B número de imagens por lote (padrão: INFERENCE_BATCH_SIZE)
+ * --isa e --dtype, como no treinamento
+ * @return int 0, se a inferência foi finalizada sem erros; -1, caso contrário
+ */
+int run_inference(int argc, char *argv[]) {
+    const char *model_path = option_get(argc, argv, "predict");
+    const char *input_path = option_get(argc, argv, "input");
+    int dtype = dataset_dtype_from_name(option_get(argc, argv, "dtype"));
+    int batch_size = option_get_int(argc, argv, "batch", INFERENCE_BATCH_SIZE);
+    int num_batches, status = 0;
+    double time_reading_begin, time_reading_end, time_inference;
+    double *latencies = NULL, *sorted_latencies = NULL;
+    float *hypothesis = NULL;
+    int *results = NULL;
+    model_t model = { 0 };
+    dataset_t images = { 0 }, unused;
+    FILE *file_log_output, *file_csv_output, *file_latency_output;
+    char filename[400], filename2[400], file_name_graphics[120];
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+
+    strftime(filename, sizeof(filename)-1, "../output/%Y%m%d-%H%M-inference.txt", t);
+    strftime(filename2, sizeof(filename2)-1, "../output/%Y%m%d-%H%M-inference.csv", t);
+
+    if((file_log_output = fopen(filename, "w")) == NULL) {
+        fprintf(stderr, "Não foi possível abrir o arquivo de log %s!\n", filename);
+        status = -1;
+        goto cleanup;
+    }
+
+    if(input_path == NULL) {
+        input_path = FOLD_FILES[0];
+    }
+
+    if(kernels_init(option_get(argc, argv, "isa")) == -1) {
+        fprintf(file_log_output, "Conjunto de instruções não suportado: %s", option_get(argc, argv, "isa"));
+        status = -1;
+        goto cleanup;
+    }
+
+    if(dtype == -1) {
+        fprintf(file_log_output, "Tipo de armazenamento não suportado: %s", option_get(argc, argv, "dtype"));
+        status = -1;
+        goto cleanup;
+    }
+
+    if(batch_size <= 0) {
+        fprintf(file_log_output, "Tamanho de lote inválido: %d", batch_size);
+        status = -1;
+        goto cleanup;
+    }
+
+    if(model_load(model_path, &model) == -1) {
+        fprintf(file_log_output, "Não foi possível carregar o modelo %s!", model_path);
+        status = -1;
+        goto cleanup;
+    }
+
+    time_reading_begin = get_time();
+
+    /* um cache binário é mapeado diretamente; os demais arquivos são lidos como .csv */
+    if(cache_open(input_path, &images, &unused, 0, 0) == 0) {
+        dataset_free(&unused);
+    } else if(read_images(file_log_output, input_path, &images, model.width * model.height, dtype, 1 / model.pixel_scale) == -1) {
+        status = -1;
+        goto cleanup;
+    }
+
+    time_reading_end = get_time();
+
+    if(images.num_pixels != model.width * model.height || images.num_images == 0) {
+        fprintf(file_log_output, "As imagens de %s não correspondem ao modelo (%d x %d)!", input_path, model.width, model.height);
+        status = -1;
+        goto cleanup;
+    }
+
+    num_batches = (images.num_images + batch_size - 1) / batch_size;
+    hypothesis = (float *) malloc(images.num_images * sizeof(float));
+    results = (int *) malloc(images.num_images * sizeof(int));
+    latencies = (double *) malloc(num_batches * sizeof(double));
+    sorted_latencies = (double *) malloc(num_batches * sizeof(double));
+
+    if(hypothesis == NULL || results == NULL || latencies == NULL || sorted_latencies == NULL) {
+        fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+        status = -1;
+        goto cleanup;
+    }
+
+    /* classifica as imagens lote a lote, medindo o tempo de cada lote */
+    for(int k = 0; k < num_batches; k++) {
+        int first_row = k * batch_size;
+        int num_rows = images.num_images - first_row < batch_size ? images.num_images - first_row : batch_size;
+        double time_batch_begin = get_time();
+
+        model_predict(&model, &images, first_row, num_rows, hypothesis + first_row);
+
+        latencies[k] = get_time() - time_batch_begin;
+    }
+
+    time_inference = 0;
+    for(int k = 0; k < num_batches; k++) {
+        time_inference += latencies[k];
+    }
+
+    //realiza binarização dos valores de hipótese
+    for(int r = 0; r < images.num_images; r++) {
+        results[r] = hypothesis[r] >= model.threshold;
+    }
+
+    memcpy(sorted_latencies, latencies, num_batches * sizeof(double));
+    qsort(sorted_latencies, num_batches, sizeof(double), compare_double);
+
+    fprintf(file_log_output, "RESULTADO - INFERÊNCIA:\n");
+    fprintf(file_log_output, "MODELO: %s (%d x %d pixels, %d épocas, taxa de aprendizado %f, %d imagens de treinamento)\n", model_path, model.width, model.height, model.num_epochs, model.learning_rate, model.num_images_training);
+    fprintf(file_log_output, "ENTRADA: %s\n", input_path);
+    fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  TAMANHO DO LOTE: %d  /  NÚMERO DE LOTES: %d\n", images.num_images, batch_size, num_batches);
+    fprintf(file_log_output, "CONJUNTO DE INSTRUÇÕES: %s\n", kernels_isa_name());
+    fprintf(file_log_output, "ARMAZENAMENTO DOS PIXELS: %s (%.2f MB)\n", dataset_dtype_name(images.dtype), dataset_size(&images) / 1048576.0);
+    fprintf(file_log_output, "TEMPO DE LEITURA: %f s\n", time_reading_end - time_reading_begin);
+    fprintf(file_log_output, "TEMPO DE INFERÊNCIA: %f s\n", time_inference);
+    fprintf(file_log_output, "IMAGENS POR SEGUNDO: %.1f\n", images.num_images / time_inference);
+    fprintf(file_log_output, "LATÊNCIA POR LOTE (ms): média %.4f  /  mediana %.4f  /  p95 %.4f  /  máxima %.4f\n\n\n", time_inference / num_batches * 1000,
+        sorted_latencies[(num_batches - 1) / 2] * 1000, sorted_latencies[(int) (0.95 * (num_batches - 1))] * 1000, sorted_latencies[num_batches - 1] * 1000);
+
+    /* grava as predições e a matriz de confusão em relação às labels do arquivo */
+    if((file_csv_output = fopen(filename2, "w")) == NULL) {
+        fprintf(file_log_output, "Não foi possível abrir o arquivo de saída %s!", filename2);
+        status = -1;
+        goto cleanup;
+    }
+
+    save_testing_results(results, images.labels, images.num_images, images.names, file_log_output, file_csv_output);
+    fclose(file_csv_output);
+
+    /* grava o tempo de cada lote */
+    snprintf(file_name_graphics, sizeof(file_name_graphics), "../graphics/inference_latency_%d_images_%d_batch_output.csv", images.num_images, batch_size);
+
+    if((file_latency_output = fopen(file_name_graphics, "w")) != NULL) {
+        for(int k = 0; k < num_batches; k++) {
+            fprintf(file_latency_output, "%d,%f\n", k + 1, latencies[k]);
+        }
+        fclose(file_latency_output);
+    } else {
+        status = -1;
+    }
+
+cleanup:
+    dataset_free(&images);
+    model_free(&model);
+    free(hypothesis);
+    free(results);
+    free(latencies);
+    free(sorted_latencies);
+
+    if(file_log_output != NULL) {
+        fclose(file_log_output);
+    }
+
+    return status;
 }
 
 /**
@@ -379,15 +1188,52 @@ float cost_function(float *all_hypothesis, float *weights, int *labels, int num_
  * de aprendizagem.
  * 
  * @param argc quantidade de argumentos
- * @param argv vetor contendo os argumentos número de épocas e taxa de aprendizado
+ * @param argv vetor contendo os argumentos número de épocas, taxa de aprendizado e
+ * número de imagens, seguidos das opções:
+ * --isa=scalar|sse2|avx2|avx512 força o conjunto de instruções dos kernels
+ * --cache[=arquivo] lê os dados do cache binário, criando-o quando necessário
+ * --dtype=float32|uint8|float16|bfloat16 define o armazenamento dos pixels (uint8 ocupa 1/4 da memória; float16 e bfloat16, metade)
+ * --batch=B treina em mini-lotes de B imagens, embaralhadas a cada época
+ * --momentum=m aplica momento com coeficiente m; --nesterov usa o momento de Nesterov
+ * --stream[=MB] lê as imagens de treinamento do cache em blocos, com a memória dos buffers limitada a MB (padrão: STREAM_DEFAULT_BUDGET_MB)
+ * --model=arquivo define o arquivo em que o modelo treinado é gravado (padrão: ../output/<data>-model.bin)
+ * --checkpoint-epochs=K e --checkpoint-seconds=T gravam um checkpoint a cada K épocas e/ou T segundos
+ * --checkpoint=arquivo define o arquivo de checkpoint (padrão: DEFAULT_CHECKPOINT_FILE)
+ * --resume retoma o treinamento do checkpoint, continuando os arquivos de saída da execução interrompida
+ * --validation=f separa a fração f das imagens de treinamento para validação; ao final, os pesos da época de menor custo de validação são restaurados
+ * --patience=P encerra o treinamento após P épocas sem redução do custo de validação maior que --min-delta=d
+ * --target-f1=f encerra o treinamento quando o F1 de validação atinge f (mantendo os pesos dessa época)
+ * --predict=arquivo apenas classifica imagens com um modelo gravado (ver run_inference())
  * @return int 0, se a execução foi finalizada sem erros; -1, caso contrário
  */
 int main(int argc, char *argv[]) {
+    /* --predict: executa apenas a inferência, sem os argumentos posicionais do treinamento */
+    if(option_get(argc, argv, "predict") != NULL) {
+        return run_inference(argc, argv);
+    }
+
     /** obtém os argumentos, converte para int ou float e inicializa o número de 
      * épocas e a taxa de aprendizado **/
     int num_max_epochs = atoi(argv[1]);
     float learning_rate = atof(argv[2]);
     int num_total_images_training = atoi(argv[3]);
+    double time_training_begin, time_training_end; //tempo de treinamento
+    double time_reading_begin, time_reading_end; //tempo de leitura dos dados
+    const char *cache_path = option_get(argc, argv, "cache"); //cache binário do dataset
+    const char *dtype_name = option_get(argc, argv, "dtype"); //armazenamento dos pixels
+    int dtype;
+    const char *model_path = option_get(argc, argv, "model"); //arquivo do modelo treinado
+    int streaming = option_get(argc, argv, "stream") != NULL; //treinamento fora da memória
+    int stream_budget = option_get_int(argc, argv, "stream", STREAM_DEFAULT_BUDGET_MB); //memória dos buffers de leitura, em MB
+    int batch_size = option_get_int(argc, argv, "batch", 0); //imagens por mini-lote; 0 para o lote completo
+    float momentum = option_get_float(argc, argv, "momentum", 0); //coeficiente do momento
+    int nesterov = option_get(argc, argv, "nesterov") != NULL; //momento de Nesterov
+    const char *checkpoint_path = option_get(argc, argv, "checkpoint"); //arquivo de checkpoint
+    int checkpoint_epochs = option_get_int(argc, argv, "checkpoint-epochs", 0); //épocas entre dois checkpoints
+    float checkpoint_seconds = option_get_float(argc, argv, "checkpoint-seconds", 0); //segundos entre dois checkpoints
+    int resuming = option_get(argc, argv, "resume") != NULL; //retoma o treinamento do checkpoint
+    float validation_fraction = option_get_float(argc, argv, "validation", 0); //fração das imagens de treinamento usada na validação
+    int validating = validation_fraction > 0;
 
     /* vetor de pesos */
     float *weights = (float *) malloc(NUM_PIXELS * sizeof(float));
@@ -396,14 +1242,46 @@ int main(int argc, char *argv[]) {
 
     int corretos = 0;
     
-    /* vetor contendo todos os valores de hipóteses calculados na épca */
-    float *all_hypothesis = (float *) malloc(num_total_images_training * sizeof(float));
-
-    /* vetor contendo os resultados, ou seja, os valores de hipótese binarizados */
-    int *results = (int *) malloc(num_total_images_training * sizeof(int));
+    /* ordem de visita das imagens nos mini-lotes */
+    int *order = (int *) malloc(num_total_images_training * sizeof(int));
 
     int *results_testing = (int *) malloc(NUM_IMAGES_TESTING * sizeof(int));
 
+    /* vetor gradiente dos mini-lotes */
+    float *gradients = (float *) malloc(NUM_PIXELS * sizeof(float));
+
+    /* métricas da época, indexadas por METRIC_* */
+    double metrics[NUM_METRICS];
+
+    /* otimizador: taxa de aprendizado, momento e tamanho dos lotes */
+    optimizer_t optimizer;
+
+    /* leitura em blocos das imagens de treinamento (--stream) */
+    stream_t stream;
+
+    /* escritor assíncrono dos resultados de cada época e os arquivos que ele grava */
+    sink_t sink;
+    epoch_files_t epoch_files;
+
+    /* registro da época enviado ao escritor assíncrono */
+    epoch_record_t record;
+
+    /* estado gravado nos checkpoints e estado carregado por --resume (resumed é NULL sem --resume) */
+    checkpoint_t checkpoint, resume, *resumed = NULL;
+
+    /* imagens de validação (--validation), métricas de validação da época e critérios de parada antecipada */
+    dataset_t validation = { 0 };
+    double validation_metrics[NUM_METRICS];
+    early_stopping_t stopping = { option_get_int(argc, argv, "patience", 0), option_get_float(argc, argv, "min-delta", 0), option_get_float(argc, argv, "target-f1", 0), INFINITY, 0, 0, 0, NULL };
+    int stop_reason = STOP_NONE;
+
+    /* número de imagens de treinamento e de validação (em todos os processos) */
+    int num_images_training = num_total_images_training, num_images_validation = 0;
+
+    /* número de checkpoints gravados, tempo gasto nas gravações e instante da última */
+    int num_checkpoints = 0;
+    double time_checkpoints = 0, time_last_checkpoint;
+
     /* ponteiro para o arquivo de entrada */
     FILE *file_input;
 
@@ -413,27 +1291,48 @@ int main(int argc, char *argv[]) {
     /* ponteiro para o arquivo de dados de saída */
     FILE *file_cost_output, *file_accuracy_output, *file_precision_output, *file_recall_output, *file_f1_output;
 
+    /* ponteiro para o arquivo com a acurácia em função do tempo de treinamento */
+    FILE *file_accuracy_time_output;
+
     /* linha do arquivo */
     char *line; 
 
-    /* matrizes com dados para teste e treinamento */
-    float **data_testing, **data_training; 
-
-    /* vetores com labels para teste e treinamento */
-    int *labels_testing, *labels_training;
-
-    /* nomes das imagens lidas */
-    char testing_images_names[NUM_IMAGES_TESTING][60];
+    /* contêineres com dados, labels e nomes das imagens para teste e treinamento */
+    dataset_t testing, training;
 
-    char filename[400], filename2[400];
+    char filename[400], filename2[400], filename3[400], run_name[CHECKPOINT_RUN_NAME_SIZE];
     time_t now = time(NULL);
     struct tm *t = localtime(&now);
-    strftime(filename, sizeof(filename)-1, "../output/%Y%m%d-%H%M-output.txt", t);
-    strftime(filename2, sizeof(filename2)-1, "../output/%Y%m%d-%H%M-output.csv", t);
+    strftime(run_name, sizeof(run_name)-1, "%Y%m%d-%H%M", t);
+
+    if(checkpoint_path == NULL || *checkpoint_path == '\0') {
+        checkpoint_path = DEFAULT_CHECKPOINT_FILE;
+    }
+
+    /* --resume: o checkpoint deve ter sido gravado com os mesmos parâmetros; a execução continua os arquivos da interrompida */
+    if(resuming && checkpoint_load(checkpoint_path, &resume) == 0) {
+        if(resume.num_weights == NUM_PIXELS && resume.num_images == num_total_images_training && resume.num_seeds == 1 && resume.batch_size == (batch_size > 0 ? batch_size : 0)
+            && resume.learning_rate == learning_rate && resume.momentum == momentum && resume.nesterov == nesterov && resume.validation_fraction == validation_fraction) {
+            resumed = &resume;
+            strcpy(run_name, resume.run_name);
+        } else {
+            checkpoint_free(&resume);
+        }
+    }
+
+    snprintf(filename, sizeof(filename), "../output/%s-output.txt", run_name);
+    snprintf(filename2, sizeof(filename2), "../output/%s-output.csv", run_name);
+    snprintf(filename3, sizeof(filename3), "../output/%s-model.bin", run_name);
 
     /* cria o arquivo log de saída */
-    file_log_output = fopen(filename, "w");
-    file_csv_output = fopen(filename2, "w");
+    file_log_output = open_output(filename, resumed, OUTPUT_LOG);
+
+    if(file_log_output == NULL) {
+        fprintf(stderr, "Não foi possível abrir o arquivo de log %s!\n", filename);
+        return -1;
+    }
+
+    file_csv_output = open_output(filename2, resumed, OUTPUT_CSV);
 
     char file_name_graphics[80], *file_name_middle = "_pdataset_", *file_name_end = "_epochs_output.csv";
 
@@ -444,7 +1343,7 @@ int main(int argc, char *argv[]) {
     strcat(file_name_graphics, argv[1]);
     strcat(file_name_graphics, file_name_end);
 
-    file_cost_output = fopen(file_name_graphics, "w");
+    file_cost_output = open_output(file_name_graphics, resumed, OUTPUT_COST);
 
     strcpy(file_name_graphics, "../graphics/accuracy_");
     strcat(file_name_graphics, argv[3]);
@@ -452,7 +1351,7 @@ int main(int argc, char *argv[]) {
     strcat(file_name_graphics, argv[1]);
     strcat(file_name_graphics, file_name_end);
 
-    file_accuracy_output = fopen(file_name_graphics, "w");
+    file_accuracy_output = open_output(file_name_graphics, resumed, OUTPUT_ACCURACY);
 
     strcpy(file_name_graphics, "../graphics/precision_");
     strcat(file_name_graphics, argv[3]);
@@ -460,7 +1359,7 @@ int main(int argc, char *argv[]) {
     strcat(file_name_graphics, argv[1]);
     strcat(file_name_graphics, file_name_end);
 
-    file_precision_output = fopen(file_name_graphics, "w");
+    file_precision_output = open_output(file_name_graphics, resumed, OUTPUT_PRECISION);
 
     strcpy(file_name_graphics, "../graphics/recall_");
     strcat(file_name_graphics, argv[3]);
@@ -468,7 +1367,7 @@ int main(int argc, char *argv[]) {
     strcat(file_name_graphics, argv[1]);
     strcat(file_name_graphics, file_name_end);
 
-    file_recall_output = fopen(file_name_graphics, "w");
+    file_recall_output = open_output(file_name_graphics, resumed, OUTPUT_RECALL);
 
     strcpy(file_name_graphics, "../graphics/f1_");
     strcat(file_name_graphics, argv[3]);
@@ -476,53 +1375,268 @@ int main(int argc, char *argv[]) {
     strcat(file_name_graphics, argv[1]);
     strcat(file_name_graphics, file_name_end);
 
-    file_f1_output = fopen(file_name_graphics, "w");
+    file_f1_output = open_output(file_name_graphics, resumed, OUTPUT_F1);
 
-    /* realiza alocação de espaços de memórias para matrizes e vetores usados */
-    data_testing = (float **) malloc(NUM_IMAGES_TESTING * sizeof(float *));
-    data_training = (float **) malloc(num_total_images_training * sizeof(float *));
-    labels_testing = (int *) malloc(NUM_IMAGES_TESTING * sizeof(int));
-    labels_training = (int *) malloc(num_total_images_training * sizeof(int));
-    
-    if(read_data_and_labels(testing_images_names, file_log_output, data_testing, data_training, labels_testing, labels_training, num_total_images_training) == -1) {
+    snprintf(file_name_graphics, sizeof(file_name_graphics), "../graphics/accuracy_time_%s_pdataset_%s_epochs_%d_batch_output.csv", argv[3], argv[1], batch_size > 0 ? batch_size : num_total_images_training);
+
+    file_accuracy_time_output = open_output(file_name_graphics, resumed, OUTPUT_ACCURACY_TIME);
+
+    if(file_csv_output == NULL || file_cost_output == NULL || file_accuracy_output == NULL || file_precision_output == NULL || file_recall_output == NULL || file_f1_output == NULL || file_accuracy_time_output == NULL) {
+        fprintf(file_log_output, "Não foi possível abrir os arquivos de saída em ../output e ../graphics!");
+        return -1;
+    }
+
+    /* arquivos cujo tamanho é registrado nos checkpoints, indexados por OUTPUT_* */
+    FILE *output_files[CHECKPOINT_NUM_OUTPUTS] = { file_log_output, file_csv_output, file_cost_output, file_accuracy_output, file_precision_output, file_recall_output, file_f1_output, file_accuracy_time_output };
+
+    if(resuming && resumed == NULL) {
+        fprintf(file_log_output, "Não foi possível retomar o treinamento: o checkpoint %s está ausente, corrompido ou não corresponde aos parâmetros informados!", checkpoint_path);
+        return -1;
+    }
+
+    /* seleciona os kernels vetoriais; --isa força um conjunto de instruções específico */
+    if(kernels_init(option_get(argc, argv, "isa")) == -1) {
+        fprintf(file_log_output, "Conjunto de instruções não suportado: %s", option_get(argc, argv, "isa"));
         return -1;
     }
 
+    if((dtype = dataset_dtype_from_name(dtype_name)) == -1) {
+        fprintf(file_log_output, "Tipo de armazenamento não suportado: %s", dtype_name);
+        return -1;
+    }
+
+    if(optimizer_init(&optimizer, NUM_PIXELS, learning_rate, momentum, nesterov, batch_size, 1) == -1) {
+        fprintf(file_log_output, "Não foi possível alocar memória para o otimizador!");
+        return -1;
+    }
+
+    if(streaming && batch_size > 0) {
+        fprintf(file_log_output, "O treinamento fora da memória (--stream) usa apenas o lote completo!");
+        return -1;
+    }
+
+    if(validation_fraction < 0 || validation_fraction >= 1 || (validating && streaming)) {
+        fprintf(file_log_output, "A fração de validação deve estar entre 0 e 1 e não pode ser usada com o treinamento fora da memória (--stream)!");
+        return -1;
+    }
+
+    /* o early stopping precisa de ao menos uma imagem de validação */
+    if(validating && (int) (num_total_images_training * validation_fraction) < 1) {
+        fprintf(file_log_output, "A fração de validação %g não separa nenhuma das %d imagens de treinamento!", validation_fraction, num_total_images_training);
+        return -1;
+    }
+
+    if((stopping.patience > 0 || stopping.target_f1 > 0) && !validating) {
+        fprintf(file_log_output, "Os critérios de parada antecipada (--patience, --target-f1) requerem um conjunto de validação (--validation)!");
+        return -1;
+    }
+
+    time_reading_begin = get_time();
+
+    if(streaming) {
+        /* --stream: mapeia apenas as imagens de teste; as de treinamento são lidas em blocos a cada época */
+        cache_path = cache_path != NULL && *cache_path != '\0' ? cache_path : DEFAULT_CACHE_FILES[dtype];
+
+        if(read_cached_data_and_labels(file_log_output, cache_path, &testing, &training, 0, dtype) == -1) {
+            return -1;
+        }
+
+        if(stream_open(&stream, cache_path, 0, num_total_images_training, (size_t) stream_budget << 20) == -1) {
+            fprintf(file_log_output, "Não foi possível ler o cache %s em blocos!", cache_path);
+            return -1;
+        }
+    } else if(cache_path != NULL) {
+        /* --cache: mapeia as matrizes a partir do cache binário */
+        if(read_cached_data_and_labels(file_log_output, *cache_path != '\0' ? cache_path : DEFAULT_CACHE_FILES[dtype], &testing, &training, num_total_images_training, dtype) == -1) {
+            return -1;
+        }
+    } else {
+        /* realiza alocação de espaços de memórias para as matrizes e vetores usados */
+        if(dataset_alloc(&testing, NUM_IMAGES_TESTING, NUM_PIXELS, dtype) == -1 || dataset_alloc(&training, num_total_images_training, NUM_PIXELS, dtype) == -1) {
+            fprintf(file_log_output, "Não foi possível alocar memória para os dados!");
+            return -1;
+        }
+        
+        if(read_data_and_labels(file_log_output, &testing, &training) == -1) {
+            return -1;
+        }
+    }
+
+    time_reading_end = get_time();
+
+    /* --validation: separa as últimas imagens de treinamento para a validação */
+    if(validating) {
+        dataset_split(&training, (int) (training.num_images * validation_fraction), &validation);
+        stopping.best_weights = (float *) malloc(NUM_PIXELS * sizeof(float));
+        num_images_validation = validation.num_images;
+        num_images_training = training.num_images;
+    }
+
     initialize_weights(weights, num_total_images_training);
 
-    fprintf(file_log_output, "RESULTADO - TREINAMENTOS:\n");
-    fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  NÚMERO DE ÉPOCAS: %d  /  TAXA DE APRENDIZADO: %f\n", num_total_images_training, num_max_epochs, learning_rate);
-    fprintf(file_log_output, "NÚMERO DE THREADS: %d\n\n\n", atoi(argv[3]));
+    for(int r = 0; r < num_total_images_training; r++) {
+        order[r] = r;
+    }
+
+    /* --resume: restaura os pesos, o otimizador e a ordem das imagens gravados no checkpoint */
+    if(resumed != NULL) {
+        memcpy(weights, resumed->weights, NUM_PIXELS * sizeof(float));
+        if(resumed->velocity != NULL) {
+            memcpy(optimizer.velocity, resumed->velocity, NUM_PIXELS * sizeof(float));
+        }
+        optimizer.seed = resumed->seeds[0];
+        memcpy(order, resumed->order, num_total_images_training * sizeof(int));
+        num_epochs = resumed->num_epochs;
+        if(resumed->best_weights != NULL) {
+            memcpy(stopping.best_weights, resumed->best_weights, NUM_PIXELS * sizeof(float));
+            stopping.best_cost = resumed->best_cost;
+            stopping.best_f1 = resumed->best_f1;
+            stopping.best_epoch = resumed->best_epoch;
+            stopping.num_bad_epochs = resumed->num_bad_epochs;
+        }
+    }
+
+    if(resumed == NULL) {
+        fprintf(file_log_output, "RESULTADO - TREINAMENTOS:\n");
+        fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  NÚMERO DE ÉPOCAS: %d  /  TAXA DE APRENDIZADO: %f\n", num_total_images_training, num_max_epochs, learning_rate);
+        fprintf(file_log_output, "TAMANHO DO LOTE: %d  /  MOMENTO: %f%s\n", batch_size > 0 ? batch_size : num_images_training, optimizer.momentum, optimizer.nesterov ? " (Nesterov)" : "");
+        fprintf(file_log_output, "CONJUNTO DE INSTRUÇÕES: %s\n", kernels_isa_name());
+        fprintf(file_log_output, "ARMAZENAMENTO DOS PIXELS: %s (%.2f MB)\n", dataset_dtype_name(dtype), (dataset_size(&testing) + dataset_size(&training)) / 1048576.0);
+        if(streaming) {
+            fprintf(file_log_output, "TREINAMENTO FORA DA MEMÓRIA: %d blocos de até %d imagens  /  %.2f MB por buffer (orçamento: %d MB)\n", stream.num_chunks, stream.chunk_rows, stream_chunk_size(&stream) / 1048576.0, stream_budget);
+        }
+        if(validating) {
+            fprintf(file_log_output, "VALIDAÇÃO: %d imagens  /  PACIÊNCIA: %d  /  DELTA MÍNIMO: %f  /  F1 ALVO: %f\n", num_images_validation, stopping.patience, stopping.min_delta, stopping.target_f1);
+        }
+        fprintf(file_log_output, "TEMPO DE LEITURA: %f s\n", time_reading_end - time_reading_begin);
+        fprintf(file_log_output, "NÚMERO DE THREADS: %d\n\n\n", atoi(argv[3]));
+    } else {
+        /* a execução interrompida já registrou o cabeçalho no log */
+        fprintf(file_log_output, "RETOMADO DO CHECKPOINT: %s  /  ÉPOCAS CONCLUÍDAS: %d  /  TEMPO DE LEITURA: %f s\n\n", checkpoint_path, num_epochs, time_reading_end - time_reading_begin);
+    }
+
+    /* os resultados de cada época são formatados e gravados fora da thread de treinamento */
+    epoch_files = (epoch_files_t) { file_log_output, file_cost_output, file_accuracy_output, file_precision_output, file_f1_output, file_recall_output, file_accuracy_time_output };
+
+    if(sink_open(&sink, sizeof(epoch_record_t), SINK_DEFAULT_CAPACITY, write_epoch_record, flush_epoch_files, &epoch_files) == -1) {
+        fprintf(file_log_output, "Não foi possível iniciar o escritor assíncrono!");
+        return -1;
+    }
+
+    /* estado gravado nos checkpoints; os vetores são os do próprio treinamento */
+    checkpoint = (checkpoint_t) { .num_weights = NUM_PIXELS, .num_images = num_total_images_training, .num_seeds = 1, .batch_size = optimizer.batch_size, .nesterov = optimizer.nesterov,
+        .learning_rate = learning_rate, .momentum = optimizer.momentum, .weights = weights, .velocity = optimizer.velocity, .validation_fraction = validation_fraction, .best_weights = stopping.best_weights, .seeds = &optimizer.seed, .order = order };
+    strcpy(checkpoint.run_name, run_name);
+
+    /* ao retomar, o tempo de treinamento continua a partir do registrado no checkpoint */
+    time_training_begin = get_time() - (resumed != NULL ? resumed->elapsed : 0);
+    time_last_checkpoint = get_time();
 
     /* realiza iterações até o número máximo de épocas */
     while (num_epochs < num_max_epochs) {
 
-        /* realiza iterações de acordo com o número de imagens para treinamento */
-        for(int r=0; r < num_total_images_training; r++) {
+        /* calcula as hipóteses, as métricas e o gradiente em uma única passagem pelos dados */
+        if(streaming) {
+            if(train_stream_epoch(&stream, weights, &optimizer, gradients, metrics) == -1) {
+                sink_close(&sink);
+                fprintf(file_log_output, "Não foi possível ler um bloco do cache %s!", cache_path);
+                return -1;
+            }
+        } else if(optimizer.batch_size > 0) {
+            train_minibatch_epoch(&training, weights, order, &optimizer, gradients, metrics);
+        } else {
+            train_epoch(&training, weights, &optimizer, gradients, metrics);
+        }
+
+        record.epoch_num = num_epochs;
+        record.num_images = num_images_training;
+        record.elapsed = get_time() - time_training_begin;
+        memcpy(record.metrics, metrics, sizeof(record.metrics));
+        sink_push(&sink, &record);
+
+        num_epochs++;
+
+        /* --validation: avalia os pesos atualizados e aplica os critérios de parada antecipada */
+        if(validating) {
+            validate(&validation, weights, validation_metrics);
+
+            stop_reason = early_stopping_update(&stopping, validation_metrics, num_images_validation, weights, num_epochs);
+        }
 
-            all_hypothesis[r] = hypothesis_function((float *) data_training[r], weights);
+        /* --checkpoint-epochs/--checkpoint-seconds: grava o estado ao final da época */
+        if((checkpoint_epochs > 0 && num_epochs % checkpoint_epochs == 0) || (checkpoint_seconds > 0 && get_time() - time_last_checkpoint >= checkpoint_seconds)) {
+            double time_checkpoint_begin = get_time();
 
-            //realiza binarização dos valores de hipótese
-            if(all_hypothesis[r] >= 0.5) {
-                results[r] = 1;
+            if(write_checkpoint(checkpoint_path, &checkpoint, &sink, output_files, num_epochs, time_checkpoint_begin - time_training_begin, &stopping) == -1) {
+                /* o treinamento continua; o log está sincronizado pela gravação */
+                fprintf(file_log_output, "Não foi possível gravar o checkpoint %s!\n", checkpoint_path);
             } else {
-                results[r] = 0;
+                num_checkpoints++;
             }
+
+            time_last_checkpoint = get_time();
+            time_checkpoints += time_last_checkpoint - time_checkpoint_begin;
         }
 
-        save_training_results(num_epochs, results, labels_training, num_total_images_training, file_log_output, file_accuracy_output, file_precision_output, file_f1_output, file_recall_output);
-        fprintf(file_cost_output, "%d,%f\n", num_epochs+1, cost_function(all_hypothesis, weights, labels_training, num_total_images_training));
-        fprintf(file_log_output, "Custo:    %f\n\n", cost_function(all_hypothesis, weights, labels_training, num_total_images_training));
-        update_weights(data_training, weights, all_hypothesis, labels_training, learning_rate, num_total_images_training);
-        num_epochs++;
+        if(stop_reason != STOP_NONE) {
+            break;
+        }
+    }
+
+    time_training_end = get_time();
+
+    /* épocas que produziram os pesos do modelo */
+    int model_epochs = num_epochs;
+
+    /* restaura os pesos da época de menor custo de validação; a parada pelo F1 alvo mantém os pesos que o atingiram */
+    if(validating && stop_reason != STOP_TARGET_F1 && stopping.best_epoch > 0 && stopping.best_epoch != num_epochs) {
+        memcpy(weights, stopping.best_weights, NUM_PIXELS * sizeof(float));
+        model_epochs = stopping.best_epoch;
+    }
+
+    /* aguarda a gravação dos registros pendentes antes de voltar a escrever no log */
+    sink_close(&sink);
+
+    /* tempo de referência para o cálculo da aceleração das versões paralelas */
+    fprintf(file_log_output, "TEMPO DE TREINAMENTO: %f s\n", time_training_end - time_training_begin);
+
+    if(validating) {
+        fprintf(file_log_output, "MELHOR ÉPOCA DE VALIDAÇÃO: %d  /  CUSTO: %f  /  F1: %f%s\n", stopping.best_epoch, stopping.best_cost, stopping.best_f1, model_epochs != num_epochs ? "  /  PESOS RESTAURADOS" : "");
+    }
+
+    if(stop_reason != STOP_NONE) {
+        fprintf(file_log_output, "PARADA ANTECIPADA: ÉPOCA %d DE %d (%s)  /  TEMPO ECONOMIZADO ESTIMADO: %f s\n", num_epochs, num_max_epochs, stop_reason == STOP_PATIENCE ? "paciência" : "F1 alvo", (num_max_epochs - num_epochs) * (time_training_end - time_training_begin) / num_epochs);
+    }
+
+    if(checkpoint_epochs > 0 || checkpoint_seconds > 0) {
+        fprintf(file_log_output, "CHECKPOINTS: %d gravados em %s  /  TEMPO DE GRAVAÇÃO: %f s\n", num_checkpoints, checkpoint_path, time_checkpoints);
+    }
+
+    if(streaming) {
+        fprintf(file_log_output, "TEMPO DE LEITURA DOS BLOCOS: %f s  /  TEMPO DE ESPERA PELOS BLOCOS: %f s\n", stream.time_reading, stream.time_waiting);
+        stream_close(&stream);
     }
 
     fclose(file_cost_output);
     fclose(file_accuracy_output);
     fclose(file_f1_output);
+    fclose(file_accuracy_time_output);
     fclose(file_precision_output);
     fclose(file_recall_output);
 
+    /* grava o modelo treinado; --model define o caminho do arquivo */
+    model_t model = { weights, IMAGE_WIDTH, IMAGE_HEIGHT, NUM_PIXELS, MODEL_BIAS_ROW, PIXEL_SCALE, 0.5f, learning_rate, model_epochs, num_images_training, NULL };
+
+    if(model_path == NULL || *model_path == '\0') {
+        model_path = filename3;
+    }
+
+    if(model_save(model_path, &model) == -1) {
+        fprintf(file_log_output, "Não foi possível gravar o modelo %s!\n", model_path);
+    } else {
+        fprintf(file_log_output, "MODELO: %s\n", model_path);
+    }
+
     fprintf(file_log_output, "\n\n\nRESULTADO - TESTE:\n");
     fprintf(file_log_output, "NÚMERO DE AMOSTRAS: %d  /  TAXA DE APRENDIZADO: %f\n\n\n", NUM_IMAGES_TESTING, learning_rate);
 
@@ -530,7 +1644,7 @@ int main(int argc, char *argv[]) {
 
     //executa a etapa de testes
     for(int r=0; r < NUM_IMAGES_TESTING; r++) {
-        hypothesis = hypothesis_function((float *) data_testing[r], weights);
+        hypothesis = hypothesis_function(&testing, r, weights);
                  
         //realiza binarização dos valores de hipótese
         if(hypothesis >= 0.5) {
@@ -541,7 +1655,18 @@ int main(int argc, char *argv[]) {
     }
 
 
-    save_testing_results(results_testing, labels_testing, NUM_IMAGES_TESTING, testing_images_names, file_log_output, file_csv_output);
+    save_testing_results(results_testing, testing.labels, NUM_IMAGES_TESTING, testing.names, file_log_output, file_csv_output);
+
+    dataset_free(&testing);
+    dataset_free(&training);
+    free(gradients);
+    optimizer_free(&optimizer);
+
+    if(resumed != NULL) {
+        checkpoint_free(resumed);
+    }
+
+    free(stopping.best_weights);
 
     fclose(file_log_output);
     fclose(file_csv_output);
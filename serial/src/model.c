@@ -0,0 +1,290 @@
+/**
+ * @file model.c
+ * @brief Gravação, leitura e aplicação do modelo treinado.
+ * 
+ * Esse arquivo contém os métodos para gravar o vetor de pesos aprendido em
+ * um arquivo binário versionado, para carregá-lo no modo de inferência e
+ * para calcular a função hipótese de um lote de imagens com os kernels
+ * vetoriais. Os modelos com projeção aleatória projetam cada imagem antes
+ * do produto escalar.
+ * 
+ * @author Nadine Cerqueira Marques (nadymarkes@gmail.com)
+ * @author Valmir Vinicius de Almeida Santos (vvalmeida96@gmail.com)
+ * 
+ * @copyright Copyright (c) 2018
+ * 
+ */
+
+/* -- Includes -- */
+
+/** Inclusão da biblioteca stdio **/
+#include <stdio.h>
+
+/** Inclusão da biblioteca stdlib **/
+#include <stdlib.h>
+
+/** Inclusão da biblioteca string **/
+#include <string.h>
+
+#include "kernels.h"
+#include "model.h"
+
+/**
+ * @brief Acumula bytes na soma de verificação.
+ * 
+ * Aplica o FNV-1a de 64 bits, continuando a partir de hash.
+ * 
+ * @param hash soma acumulada
+ * @param data bytes a serem acumulados
+ * @param size número de bytes
+ * @return uint64_t soma atualizada
+ */
+static uint64_t checksum_update(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *) data;
+
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Calcula a soma de verificação dos pesos e da matriz de projeção.
+ * 
+ * @param weights vetor de pesos
+ * @param num_weights número de pesos
+ * @param projection matriz de projeção, ou NULL
+ * @return uint64_t soma de verificação
+ */
+static uint64_t model_checksum(const float *weights, int num_weights, const projection_t *projection) {
+    uint64_t hash = checksum_update(14695981039346656037ULL, weights, (size_t) num_weights * sizeof(float));
+
+    if(projection != NULL) {
+        hash = checksum_update(hash, &projection->scale, sizeof(float));
+        hash = checksum_update(hash, projection->offsets, (2 * (size_t) projection->num_components + 1) * sizeof(int));
+        hash = checksum_update(hash, projection->columns, (size_t) projection_num_nonzeros(projection) * sizeof(int));
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Grava o modelo em um arquivo binário.
+ * 
+ * O arquivo é gravado com um nome temporário e renomeado ao final, de forma
+ * que um modelo incompleto nunca seja lido.
+ * 
+ * @param path caminho do arquivo do modelo
+ * @param model modelo a ser gravado
+ * @return int 0, se a gravação foi bem sucedida; -1, caso contrário
+ */
+int model_save(const char *path, const model_t *model) {
+    model_header_t header;
+    char temp_path[400];
+    FILE *file;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MODEL_MAGIC, sizeof(header.magic));
+    header.version = MODEL_VERSION;
+    header.width = model->width;
+    header.height = model->height;
+    header.num_weights = model->num_weights;
+    header.bias = model->bias;
+    header.pixel_scale = model->pixel_scale;
+    header.threshold = model->threshold;
+    header.learning_rate = model->learning_rate;
+    header.num_epochs = model->num_epochs;
+    header.num_images_training = model->num_images_training;
+    header.checksum = model_checksum(model->weights, model->num_weights, model->projection);
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    if((file = fopen(temp_path, "wb")) == NULL) {
+        return -1;
+    }
+
+    if(fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(model->weights, sizeof(float), model->num_weights, file) != (size_t) model->num_weights
+        || (model->projection != NULL && projection_write(model->projection, file) == -1)) {
+        fclose(file);
+        remove(temp_path);
+        return -1;
+    }
+
+    if(fclose(file) != 0 || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Carrega um modelo gravado por model_save().
+ * 
+ * Confere a identificação, a versão, as dimensões e a soma de verificação
+ * dos pesos e da matriz de projeção. Os arquivos da versão 1, sem
+ * projeção, continuam aceitos. O vetor de pesos e a projeção são alocados
+ * e devem ser liberados por model_free(); em caso de falha, nada permanece
+ * alocado e os ponteiros do modelo não apontam para memória liberada.
+ * 
+ * @param path caminho do arquivo do modelo
+ * @param model modelo a ser inicializado
+ * @return int 0, se o modelo foi carregado; -1, se está ausente, corrompido ou é de uma versão incompatível
+ */
+int model_load(const char *path, model_t *model) {
+    model_header_t header;
+    int has_projection;
+    FILE *file;
+
+    if((file = fopen(path, "rb")) == NULL) {
+        return -1;
+    }
+
+    /* sem projeção, há um peso por pixel; com projeção (apenas na versão 2), um peso por componente */
+    if(fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, MODEL_MAGIC, sizeof(header.magic)) != 0 || header.version < 1 || header.version > MODEL_VERSION
+        || header.bias != MODEL_BIAS_ROW || header.num_weights == 0 || header.num_weights > header.width * header.height
+        || (header.version == 1 && header.num_weights != header.width * header.height)) {
+        fclose(file);
+        return -1;
+    }
+
+    has_projection = header.num_weights != header.width * header.height;
+    model->weights = (float *) malloc(header.num_weights * sizeof(float));
+    model->projection = has_projection ? (projection_t *) malloc(sizeof(projection_t)) : NULL;
+
+    if(model->weights == NULL || (has_projection && model->projection == NULL) || fread(model->weights, sizeof(float), header.num_weights, file) != header.num_weights) {
+        free(model->weights);
+        free(model->projection);
+        model->weights = NULL;
+        model->projection = NULL;
+        fclose(file);
+        return -1;
+    }
+
+    if(model->projection != NULL && projection_read(model->projection, header.width * header.height, header.num_weights, file) == -1) {
+        free(model->weights);
+        free(model->projection);
+        model->weights = NULL;
+        model->projection = NULL;
+        fclose(file);
+        return -1;
+    }
+
+    if(model_checksum(model->weights, header.num_weights, model->projection) != header.checksum) {
+        model_free(model);
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+
+    model->width = header.width;
+    model->height = header.height;
+    model->num_weights = header.num_weights;
+    model->bias = header.bias;
+    model->pixel_scale = header.pixel_scale;
+    model->threshold = header.threshold;
+    model->learning_rate = header.learning_rate;
+    model->num_epochs = header.num_epochs;
+    model->num_images_training = header.num_images_training;
+
+    return 0;
+}
+
+/**
+ * @brief Libera o vetor de pesos e a projeção de um modelo carregado.
+ * 
+ * @param model modelo carregado por model_load()
+ */
+void model_free(model_t *model) {
+    if(model->projection != NULL) {
+        projection_free(model->projection);
+        free(model->projection);
+    }
+
+    free(model->weights);
+    model->weights = NULL;
+    model->projection = NULL;
+}
+
+/**
+ * @brief Calcula a função hipótese de um lote de imagens com a projeção do modelo.
+ * 
+ * Cada imagem é convertida para float (normalizando as linhas em uint8
+ * com o fator do modelo) e projetada em um buffer, e o produto escalar é
+ * calculado com os pesos dos componentes.
+ * 
+ * @param model modelo carregado, com projeção
+ * @param dataset contêiner com as imagens, com model->projection->num_inputs pixels por imagem
+ * @param first_row primeira imagem do lote
+ * @param num_rows número de imagens do lote
+ * @param hypothesis vetor que recebe a hipótese de cada imagem do lote
+ */
+static void predict_projected(const model_t *model, const dataset_t *dataset, int first_row, int num_rows, float *hypothesis) {
+    const projection_t *projection = model->projection;
+    float *pixels = (float *) malloc((projection->num_inputs + projection->num_components) * sizeof(float));
+    float *components = pixels + projection->num_inputs;
+
+    for(int i = 0; i < num_rows; i++) {
+        const float *row = pixels;
+
+        if(dataset->dtype == DATASET_FLOAT32) {
+            row = dataset_row(dataset, first_row + i);
+        } else {
+            memset(pixels, 0, projection->num_inputs * sizeof(float));
+
+            if(dataset->dtype == DATASET_UINT8) {
+                kernel_axpy_u8(model->pixel_scale, dataset_row_u8(dataset, first_row + i), pixels, projection->num_inputs);
+            } else if(dataset->dtype == DATASET_FLOAT16) {
+                kernel_axpy_f16(1, dataset_row_u16(dataset, first_row + i), pixels, projection->num_inputs);
+            } else {
+                kernel_axpy_bf16(1, dataset_row_u16(dataset, first_row + i), pixels, projection->num_inputs);
+            }
+        }
+
+        projection_apply(projection, row, components);
+
+        hypothesis[i] = kernel_sigmoid(kernel_dot(components, model->weights, model->num_weights));
+    }
+
+    free(pixels);
+}
+
+/**
+ * @brief Calcula a função hipótese de um lote de imagens.
+ * 
+ * Cada imagem do lote é processada pelo produto escalar vetorial
+ * selecionado por kernels_init(). Linhas em float devem ter sido
+ * normalizadas na leitura com o fator do modelo; linhas em uint8 são
+ * normalizadas após o produto escalar. Nos modelos com projeção, as
+ * imagens são projetadas por predict_projected().
+ * 
+ * @param model modelo carregado
+ * @param dataset contêiner com as imagens, com model->width x model->height pixels por imagem
+ * @param first_row primeira imagem do lote
+ * @param num_rows número de imagens do lote
+ * @param hypothesis vetor que recebe a hipótese de cada imagem do lote
+ */
+void model_predict(const model_t *model, const dataset_t *dataset, int first_row, int num_rows, float *hypothesis) {
+    if(model->projection != NULL) {
+        predict_projected(model, dataset, first_row, num_rows, hypothesis);
+        return;
+    }
+
+    for(int i = 0; i < num_rows; i++) {
+        float result;
+
+        if(dataset->dtype == DATASET_UINT8) {
+            result = kernel_dot_u8(dataset_row_u8(dataset, first_row + i), model->weights, model->num_weights) * model->pixel_scale;
+        } else if(dataset->dtype == DATASET_FLOAT16) {
+            result = kernel_dot_f16(dataset_row_u16(dataset, first_row + i), model->weights, model->num_weights);
+        } else if(dataset->dtype == DATASET_BFLOAT16) {
+            result = kernel_dot_bf16(dataset_row_u16(dataset, first_row + i), model->weights, model->num_weights);
+        } else {
+            result = kernel_dot(dataset_row(dataset, first_row + i), model->weights, model->num_weights);
+        }
+
+        hypothesis[i] = kernel_sigmoid(result);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef SINK_H__
+#define SINK_H__
+
+/**
+ * @file sink.h
+ * @brief Interface do escritor assíncrono de registros.
+ * 
+ * O laço de treinamento envia registros de tamanho fixo para um buffer
+ * circular sem travas (um produtor e um consumidor). Uma thread de
+ * escrita retira os registros em lotes, chama a função de formatação de
+ * cada registro e descarrega os arquivos ao final de cada lote, de forma
+ * que a gravação em disco não ocorre na thread de treinamento.
+ * 
+ */
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/** Número padrão de registros do buffer circular (potência de 2) **/
+#define SINK_DEFAULT_CAPACITY 1024
+
+/** Formata e grava um registro **/
+typedef void (*sink_write_t)(const void *record, void *context);
+
+/** Descarrega os arquivos ao final de um lote de registros **/
+typedef void (*sink_flush_t)(void *context);
+
+/** Escritor assíncrono com buffer circular de registros **/
+typedef struct sink {
+    char *records;                  /* buffer circular */
+    size_t record_size;             /* tamanho de um registro, em bytes */
+    unsigned long capacity;         /* número de registros do buffer (potência de 2) */
+    atomic_ulong head;              /* número de registros enviados pelo produtor */
+    atomic_ulong tail;              /* número de registros gravados pela thread de escrita */
+    atomic_int closing;             /* sinaliza que não haverá novos registros */
+    sink_write_t write;             /* formatação de um registro */
+    sink_flush_t flush;             /* descarga dos arquivos */
+    void *context;                  /* arquivos de saída, repassados às funções */
+    pthread_t thread;               /* thread de escrita */
+} sink_t;
+
+extern int sink_open(sink_t *sink, size_t record_size, unsigned long capacity, sink_write_t write, sink_flush_t flush, void *context); /* inicia a thread de escrita */
+extern void sink_push(sink_t *sink, const void *record);   /* envia um registro */
+extern void sink_sync(sink_t *sink);                       /* aguarda a gravação dos registros enviados */
+extern void sink_close(sink_t *sink);                      /* grava os registros pendentes e encerra a thread */
+
+#endif
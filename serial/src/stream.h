@@ -0,0 +1,58 @@
+#ifndef STREAM_H__
+#define STREAM_H__
+
+/**
+ * @file stream.h
+ * @brief Interface da leitura em blocos das imagens de treinamento.
+ * 
+ * No treinamento fora da memória, as imagens de treinamento não são
+ * mapeadas: elas são lidas da seção de treinamento do cache binário em
+ * blocos de linhas de tamanho fixo, com pread(). Dois buffers são usados
+ * de forma alternada: enquanto as linhas de um bloco são processadas, uma
+ * thread de leitura carrega o bloco seguinte no outro buffer. A memória
+ * usada pelos buffers é limitada pelo orçamento informado, qualquer que seja
+ * o tamanho do dataset.
+ * 
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "dataset.h"
+
+/** Orçamento de memória padrão dos buffers, em MB **/
+#define STREAM_DEFAULT_BUDGET_MB 256
+
+/** Leitura em blocos de uma partição da seção de treinamento do cache **/
+typedef struct stream {
+    int fd;                         /* descritor do arquivo de cache */
+    int dtype;                      /* tipo de armazenamento dos pixels (DATASET_*) */
+    int num_pixels;                 /* número de pixels por imagem */
+    int stride;                     /* distância, em elementos, entre duas linhas */
+    uint64_t data_offset;           /* posição da primeira linha da partição no arquivo */
+    uint64_t labels_offset;         /* posição da label da primeira linha da partição no arquivo */
+    int num_rows;                   /* número de linhas da partição */
+    int chunk_rows;                 /* número de linhas por bloco */
+    int num_chunks;                 /* número de blocos da partição */
+    void *buffers[2];               /* pixels dos blocos, alinhados em DATASET_ALIGNMENT */
+    int *labels[2];                 /* labels dos blocos */
+    int loaded[2];                  /* bloco presente em cada buffer, ou -1 */
+    int requested;                  /* bloco solicitado à thread de leitura, ou -1 */
+    int requested_buffer;           /* buffer que recebe o bloco solicitado */
+    long sequence;                  /* número de blocos já entregues por stream_next() */
+    int status;                     /* -1, após uma falha de leitura */
+    int stop;                       /* sinaliza o fim da thread de leitura */
+    double time_reading;            /* tempo gasto pela thread de leitura, em segundos */
+    double time_waiting;            /* tempo em que o treinamento esperou por um bloco, em segundos */
+    pthread_t thread;               /* thread de leitura */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} stream_t;
+
+extern int stream_open(stream_t *stream, const char *path, int first_row, int num_rows, size_t budget); /* abre a partição e inicia a leitura */
+extern int stream_next(stream_t *stream, dataset_t *chunk);  /* entrega o próximo bloco e solicita o seguinte */
+extern void stream_close(stream_t *stream);                  /* encerra a leitura e libera os buffers */
+extern size_t stream_chunk_size(const stream_t *stream);     /* memória ocupada por um buffer, em bytes */
+
+#endif